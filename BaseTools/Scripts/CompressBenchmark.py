@@ -0,0 +1,102 @@
+## @file
+#  Measure the time the compression tools of BaseTools take to encode an image,
+#  and the time LzmaCompress takes to decode it. Chunked LZMA images are decoded
+#  by several threads the way the firmware decodes them on several processors.
+#
+#  The numbers depend on the host and are not checked by the unit tests in
+#  BaseTools/Tests, which only check the images.
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+from __future__ import print_function
+import argparse
+import os
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+CBinDir = os.path.normpath(os.path.join(os.path.dirname(os.path.realpath(__file__)), '..', 'Source', 'C', 'bin'))
+
+## Build an FV like input: code like random blocks, repeated blocks and padding
+#
+def GetDefaultInput(Size):
+    Random = random.Random(0x24)
+    Blocks = [bytes(Random.getrandbits(8) for Index in range(0x1000)) for Index in range(16)]
+    Data = b''
+    while len(Data) < Size:
+        Data += Random.choice(Blocks)[:Random.randint(0x100, 0x1000)]
+        Data += b'\xff' * Random.randint(0, 0x800)
+    return Data[:Size]
+
+## Run a tool and return the wall clock time it took
+#
+def RunTool(BinDir, ToolName, *Args):
+    Start = time.time()
+    subprocess.check_call([os.path.join(BinDir, ToolName)] + list(Args))
+    return time.time() - Start
+
+## Encode and decode with 1, 2 and 4 threads, with and without chunks
+#
+def BenchmarkLzma(BinDir, Input, TmpDir, Repeat):
+    Output = os.path.join(TmpDir, 'output')
+    Decoded = os.path.join(TmpDir, 'decoded')
+    for Mode in ([], ['--chunked']):
+        Times = []
+        for Threads in (1, 2, 4):
+            Times.append(min(RunTool(BinDir, 'LzmaCompress', '-e', '-q', '--threads', str(Threads), '-o', Output, Input, *Mode) for Index in range(Repeat)))
+        print('LzmaCompress %s encode: 1 thread %.3f s, 2 threads %.3f s, 4 threads %.3f s, %d of %d bytes' % (
+            ' '.join(Mode) or 'single stream', Times[0], Times[1], Times[2], os.path.getsize(Output), os.path.getsize(Input)))
+        Times = []
+        for Threads in (1, 2, 4):
+            Times.append(min(RunTool(BinDir, 'LzmaCompress', '-d', '-q', '--threads', str(Threads), '-o', Decoded, Output, *Mode) for Index in range(Repeat)))
+        with open(Input, 'rb') as InputFile, open(Decoded, 'rb') as DecodedFile:
+            if InputFile.read() != DecodedFile.read():
+                raise Exception('LzmaCompress %s did not decode to the input' % (' '.join(Mode) or 'single stream'))
+        print('LzmaCompress %s decode: 1 thread %.3f s, 2 threads %.3f s, 4 threads %.3f s' % (
+            ' '.join(Mode) or 'single stream', Times[0], Times[1], Times[2]))
+
+## Encode in each mode of TianoCompress
+#
+def BenchmarkTiano(BinDir, Input, TmpDir, Repeat):
+    Output = os.path.join(TmpDir, 'output')
+    for Mode in ([], ['--fast'], ['--optimal'], ['--uefi'], ['--uefi', '--fast'], ['--uefi', '--optimal']):
+        Elapsed = min(RunTool(BinDir, 'TianoCompress', '-e', '-o', Output, Input, *Mode) for Index in range(Repeat))
+        print('TianoCompress %s: %.2f MB/s, %.1f%% of %d bytes' % (
+            ' '.join(Mode) or 'default', os.path.getsize(Input) / Elapsed / 0x100000, os.path.getsize(Output) * 100.0 / os.path.getsize(Input), os.path.getsize(Input)))
+
+Benchmarks = {
+    'LzmaCompress': BenchmarkLzma,
+    'TianoCompress': BenchmarkTiano,
+    }
+
+def Main():
+    Parser = argparse.ArgumentParser(description='Measure the time the compression tools of BaseTools take to encode and decode an image.')
+    Parser.add_argument('-i', '--input', help='Image to compress. An FV like image is generated by default.')
+    Parser.add_argument('-s', '--size', type=lambda Value: int(Value, 0), default=0x400000, help='Size of the generated image, 4 MB by default.')
+    Parser.add_argument('-t', '--tool', choices=sorted(Benchmarks), action='append', help='Tool to measure. All tools are measured by default.')
+    Parser.add_argument('-r', '--repeat', type=int, default=3, help='Number of runs; the fastest one is reported.')
+    Parser.add_argument('--bin-dir', default=CBinDir, help='Directory of the C tools, %s by default.' % CBinDir)
+    Options = Parser.parse_args()
+
+    TmpDir = tempfile.mkdtemp()
+    try:
+        Input = Options.input
+        if Input is None:
+            Input = os.path.join(TmpDir, 'input')
+            with open(Input, 'wb') as File:
+                File.write(GetDefaultInput(Options.size))
+        for ToolName in Options.tool or sorted(Benchmarks):
+            Benchmarks[ToolName](Options.bin_dir, Input, TmpDir, max(Options.repeat, 1))
+    finally:
+        shutil.rmtree(TmpDir)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(Main())
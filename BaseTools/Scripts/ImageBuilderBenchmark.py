@@ -0,0 +1,176 @@
+## @file
+#  Compare the time GenFds takes to build leaf sections and FFS files with the
+#  GenSec and GenFfs tools and in process with GenFds.ImageBuilder.
+#
+#  The sections and FFS files are first built directly, then GenFds builds an
+#  FV of the same modules from an FDF. GenFds runs once with ImageBuilder
+#  turned off, as it ran before ImageBuilder, and once as it runs now.
+#
+#  The numbers depend on the host and are not checked by the unit tests in
+#  BaseTools/Tests, which only check that both give the same images.
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+from __future__ import print_function
+import argparse
+import os
+import random
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+import uuid
+
+BaseToolsDir = os.path.normpath(os.path.join(os.path.dirname(os.path.realpath(__file__)), '..'))
+CBinDir = os.path.join(BaseToolsDir, 'Source', 'C', 'bin')
+ConfDir = os.path.join(os.path.dirname(BaseToolsDir), 'Conf')
+sys.path.append(os.path.join(BaseToolsDir, 'Source', 'Python'))
+
+import GenFds.ImageBuilder as ImageBuilder
+
+FileGuid = '3e1e2a4b-6d7c-4a5f-9b8e-1f2d3c4b5a69'
+
+FvAttributes = [
+    'FvAlignment        = 16',
+    'ERASE_POLARITY     = 1',
+    'MEMORY_MAPPED      = TRUE',
+    'STICKY_WRITE       = TRUE',
+    'LOCK_CAP           = TRUE',
+    'LOCK_STATUS        = TRUE',
+    'WRITE_DISABLED_CAP = TRUE',
+    'WRITE_ENABLED_CAP  = TRUE',
+    'WRITE_STATUS       = TRUE',
+    'WRITE_LOCK_CAP     = TRUE',
+    'WRITE_LOCK_STATUS  = TRUE',
+    'READ_DISABLED_CAP  = TRUE',
+    'READ_ENABLED_CAP   = TRUE',
+    'READ_STATUS        = TRUE',
+    'READ_LOCK_CAP      = TRUE',
+    'READ_LOCK_STATUS   = TRUE',
+    ]
+
+#
+# Run GenFds, with ImageBuilder turned off when the first argument is "tools".
+# GenFds then calls GenSec and GenFfs for every section and FFS file.
+#
+GenFdsScript = '''
+import sys
+sys.path.insert(0, %r)
+import GenFds.ImageBuilder as ImageBuilder
+if sys.argv.pop(1) == 'tools':
+    ImageBuilder.GetLeafSection = ImageBuilder.GetVersionSection = ImageBuilder.GetFfsFile = lambda *Args, **Kwargs: None
+from GenFds.GenFds import main
+sys.exit(main())
+''' % os.path.join(BaseToolsDir, 'Source', 'Python')
+
+## Write a driver image and its PE32 section, as GenFds gets them from a module build
+#
+def WriteModule(Random, TmpDir, Index, Size):
+    Image = os.path.join(TmpDir, 'image%d' % Index)
+    Data = bytes(Random.getrandbits(8) for Count in range(Size))
+    with open(Image, 'wb') as File:
+        File.write(Data)
+    Section = os.path.join(TmpDir, 'pe32%d' % Index)
+    with open(Section, 'wb') as File:
+        File.write(struct.pack('<3BB', (Size + 4) & 0xff, ((Size + 4) >> 8) & 0xff, (Size + 4) >> 16, 0x10) + Data)
+    return Image, Section
+
+## Write a platform whose FDF puts every module image in an FV, as a driver
+#  with a PE32, a UI and a version section
+#
+#  The FV is not in an FD, so GenFv does not rebase the images, which are not
+#  real PE32 images.
+#
+def WritePlatform(Random, Workspace, Modules):
+    os.makedirs(os.path.join(Workspace, 'Bench'))
+    Fdf = ['[FV.FVMAIN]'] + FvAttributes + ['']
+    for Index, (Image, Section) in enumerate(Modules):
+        Fdf += [
+            'FILE DRIVER = %s {' % uuid.UUID(int=Random.getrandbits(128), version=4),
+            '  SECTION PE32 = %s' % Image,
+            '  SECTION UI = "Module%d"' % Index,
+            '  SECTION VERSION = "1.0"',
+            '}',
+            '',
+            ]
+    with open(os.path.join(Workspace, 'Bench', 'Bench.fdf'), 'w') as File:
+        File.write('\n'.join(Fdf))
+    with open(os.path.join(Workspace, 'Bench', 'Bench.dsc'), 'w') as File:
+        File.write('\n'.join([
+            '[Defines]',
+            '  PLATFORM_NAME           = Bench',
+            '  PLATFORM_GUID           = 5c1b7e3a-1f42-4d8b-9e6a-2b3c4d5e6f70',
+            '  PLATFORM_VERSION        = 0.1',
+            '  DSC_SPECIFICATION       = 0x00010005',
+            '  OUTPUT_DIRECTORY        = Build/Bench',
+            '  SUPPORTED_ARCHITECTURES = X64',
+            '  BUILD_TARGETS           = DEBUG',
+            '  SKUID_IDENTIFIER        = DEFAULT',
+            '  FLASH_DEFINITION        = Bench/Bench.fdf',
+            '',
+            ]))
+
+## Run GenFds on the platform, and return the wall clock time it took and the FV
+#
+def RunGenFds(Workspace, Mode, BinDir, ConfDir):
+    OutputDir = os.path.join(Workspace, 'Build', 'Bench', 'DEBUG_GCC5')
+    if os.path.exists(OutputDir):
+        shutil.rmtree(OutputDir)
+    os.makedirs(OutputDir)
+    Environment = dict(os.environ, WORKSPACE=Workspace, PATH=os.pathsep.join([BinDir, os.environ.get('PATH', '')]))
+    Start = time.time()
+    subprocess.check_call(
+        [sys.executable, '-c', GenFdsScript, Mode, '-f', 'Bench/Bench.fdf', '-p', 'Bench/Bench.dsc', '-a', 'X64', '-b', 'DEBUG',
+         '-t', 'GCC5', '-o', OutputDir, '-w', Workspace, '--conf', ConfDir, '-i', 'FVMAIN'],
+        cwd=Workspace, env=Environment, stdout=subprocess.DEVNULL)
+    Elapsed = time.time() - Start
+    with open(os.path.join(OutputDir, 'FV', 'FVMAIN.Fv'), 'rb') as File:
+        return Elapsed, File.read()
+
+def Main():
+    Parser = argparse.ArgumentParser(description='Compare the time GenFds takes to build sections and FFS files with the tools and in process.')
+    Parser.add_argument('-n', '--count', type=int, default=300, help='Number of modules, 300 by default.')
+    Parser.add_argument('-s', '--size', type=lambda Value: int(Value, 0), default=0x8000, help='Size of each module image, 32 KB by default.')
+    Parser.add_argument('--bin-dir', default=CBinDir, help='Directory of the C tools, %s by default.' % CBinDir)
+    Parser.add_argument('--conf', default=ConfDir, help='Conf directory of the workspace, as created by edksetup, %s by default.' % ConfDir)
+    Options = Parser.parse_args()
+
+    Random = random.Random(0x22)
+    TmpDir = tempfile.mkdtemp()
+    try:
+        Modules = [WriteModule(Random, TmpDir, Index, Options.size) for Index in range(Options.count)]
+        Output = os.path.join(TmpDir, 'output')
+
+        Start = time.time()
+        for Image, Section in Modules:
+            subprocess.check_call([os.path.join(Options.bin_dir, 'GenSec'), '-s', 'EFI_SECTION_PE32', '-o', Output, Image])
+            subprocess.check_call([os.path.join(Options.bin_dir, 'GenFfs'), '-t', 'EFI_FV_FILETYPE_DRIVER', '-g', FileGuid, '-o', Output, '-i', Section, '-n', '4K'])
+        ToolsTime = time.time() - Start
+
+        Start = time.time()
+        for Image, Section in Modules:
+            ImageBuilder.GetLeafSection('EFI_SECTION_PE32', [Image])
+            ImageBuilder.GetFfsFile([Section], 'EFI_FV_FILETYPE_DRIVER', FileGuid, SectionAlign=['4K'])
+        InProcessTime = time.time() - Start
+
+        Workspace = os.path.join(TmpDir, 'Workspace')
+        WritePlatform(Random, Workspace, Modules)
+        GenFdsToolsTime, ToolsFv = RunGenFds(Workspace, 'tools', Options.bin_dir, Options.conf)
+        GenFdsInProcessTime, InProcessFv = RunGenFds(Workspace, 'in-process', Options.bin_dir, Options.conf)
+        if ToolsFv != InProcessFv:
+            raise Exception('GenFds built a different FV in process')
+    finally:
+        shutil.rmtree(TmpDir)
+
+    print('%d modules, one section and one FFS file each: tools %.3f s, in process %.3f s' % (Options.count, ToolsTime, InProcessTime))
+    print('GenFds, FV of %d modules with PE32, UI and version sections: before ImageBuilder %.3f s, with ImageBuilder %.3f s' % (Options.count, GenFdsToolsTime, GenFdsInProcessTime))
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(Main())
@@ -79,4 +79,62 @@ EFI_STATUS
   IN OUT  UINT32  *DstSize
   );
 
+//
+// Parses of CompressParse()
+//
+#define COMPRESS_PARSE_NORMAL   0
+#define COMPRESS_PARSE_FAST     1
+#define COMPRESS_PARSE_OPTIMAL  2
+
+/*++
+
+Routine Description:
+
+  Output an Original Character or a Pointer to a repeated string.
+
+Arguments:
+
+  CharC       - The original character, or the string length plus 0xFD
+  Position    - The distance to the repeated string minus one
+
+--*/
+typedef
+VOID
+(*COMPRESS_OUTPUT_FUNCTION) (
+  IN UINT32  CharC,
+  IN UINT32  Position
+  );
+
+/*++
+
+Routine Description:
+
+  Select the parse used by the LZ77 stage of TianoCompress() and EfiCompress().
+  COMPRESS_PARSE_OPTIMAL gives a smaller output and takes more time.
+  COMPRESS_PARSE_FAST takes less time and gives a larger output, which may be
+  larger than the output of the tree search of the previous encoder.
+
+--*/
+VOID
+SetCompressParseMode (
+  IN UINT32  Mode
+  )
+;
+
+/*++
+
+Routine Description:
+
+  LZ77 stage of TianoCompress() and EfiCompress().
+
+--*/
+EFI_STATUS
+CompressParse (
+  IN UINT8                     *SrcBuffer,
+  IN UINT32                    SrcSize,
+  IN UINT32                    WindowBit,
+  IN COMPRESS_OUTPUT_FUNCTION  OutputFunction
+  )
+;
+
 #endif
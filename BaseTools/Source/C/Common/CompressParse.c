@@ -0,0 +1,820 @@
+/** @file
+LZ77 stage of the EFI and Tiano compression algorithms. The source data is
+transformed into a sequence of Original Characters and Pointers to repeated
+strings, which the caller then codes with its Huffman stage.
+
+The repeated strings are found with hash chains of bounded depth. The optimal
+parse searches every position of a block and picks the sequence with the
+smallest estimated coded size. By default it searches few strings, which is
+enough to compress better than the tree search of the previous encoder. The
+fast parse is lazy: a Pointer is deferred by one character when the next
+position starts a longer string.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "Compress.h"
+
+//
+// Macro Definitions
+//
+#define THRESHOLD             3
+#define MAXMATCH              256
+#define NC                    (0x100 + MAXMATCH + 1 - THRESHOLD)
+#define MAX_POSITION_BIT      32
+#define HASH_BIT              16
+#define HASH_SIZE             (1U << HASH_BIT)
+#define HASH(p)               ((((UINT32) (p)[0] | ((UINT32) (p)[1] << 8) | ((UINT32) (p)[2] << 16)) * 0x9E3779B1U) >> (32 - HASH_BIT))
+#define NIL                   0xFFFFFFFFU
+
+//
+// A string of THRESHOLD characters further than this is not worth a Pointer
+//
+#define FAR_POSITION          (1U << 11)
+
+//
+// Parameters of the lazy parse
+//
+#define LAZY_CHAIN_DEPTH      64
+#define LAZY_MATCH_LENGTH     64
+
+//
+// Parameters of the optimal parse, see OPTIMAL_PARAMETERS
+//
+#define OPTIMAL_BLOCK_SIZE    0x4000
+#define OPTIMAL_MATCH_COUNT   16
+
+//
+// Costs are estimated in 1/16 bit, a code is 1 to 16 bits long
+//
+#define COST_BIT              4
+#define MIN_CODE_COST         (1U << COST_BIT)
+#define MAX_CODE_COST         (16U << COST_BIT)
+
+typedef struct {
+  UINT32  Length;
+  UINT32  Distance;
+} MATCH;
+
+//
+// Only the full length of a string of at least NiceLength characters is
+// considered, and the positions it covers are not searched. At most
+// MatchCount strings, up to OPTIMAL_MATCH_COUNT, are kept for each position.
+//
+typedef struct {
+  UINT32  ChainDepth;
+  UINT32  NiceLength;
+  UINT32  MatchCount;
+  UINT32  PassCount;
+} OPTIMAL_PARAMETERS;
+
+//
+// Function Prototypes
+//
+
+STATIC
+VOID
+InsertString (
+  IN UINT32 Pos
+  );
+
+STATIC
+UINT32
+SearchChain (
+  IN     UINT32 Pos,
+  IN     UINT32 Offset,
+  IN     UINT32 MaxLength,
+  IN OUT MATCH  *Matches,
+  IN     UINT32 MaxCount,
+  IN     UINT32 Count
+  );
+
+STATIC
+UINT32
+FindMatches (
+  IN  UINT32 Pos,
+  IN  UINT32 MaxLength,
+  OUT MATCH  *Matches,
+  IN  UINT32 MaxCount
+  );
+
+STATIC
+VOID
+GetLongestMatch (
+  IN  UINT32 Pos,
+  OUT MATCH  *Match
+  );
+
+STATIC
+VOID
+LazyParse (
+  VOID
+  );
+
+STATIC
+EFI_STATUS
+OptimalParse (
+  IN CONST OPTIMAL_PARAMETERS *Parameters
+  );
+
+STATIC
+UINT32
+Log2Cost (
+  IN UINT32 Value
+  );
+
+STATIC
+UINT32
+GetPositionBit (
+  IN UINT32 Position
+  );
+
+STATIC
+VOID
+UpdateCosts (
+  IN UINT32 CFreq[],
+  IN UINT32 PFreq[]
+  );
+
+//
+//  Global Variables
+//
+
+//
+// The default parse searches few strings, COMPRESS_PARSE_OPTIMAL many more
+//
+STATIC CONST OPTIMAL_PARAMETERS mNormalParameters  = { 16, 32, 8, 1 };
+STATIC CONST OPTIMAL_PARAMETERS mOptimalParameters = { 256, 64, 16, 2 };
+STATIC UINT32                   mParseMode = COMPRESS_PARSE_NORMAL;
+STATIC UINT8                    *mText;
+STATIC UINT32                   mTextSize, mWindowSize, mChainDepth;
+STATIC UINT32                   *mHead, *mChain;
+STATIC COMPRESS_OUTPUT_FUNCTION mOutput;
+STATIC UINT32                   mCCost[NC], mPCost[MAX_POSITION_BIT + 1];
+
+//
+// functions
+//
+VOID
+SetCompressParseMode (
+  IN UINT32  Mode
+  )
+/*++
+
+Routine Description:
+
+  Select the parse used by the following calls of CompressParse().
+
+Arguments:
+
+  Mode    - COMPRESS_PARSE_NORMAL, COMPRESS_PARSE_FAST or COMPRESS_PARSE_OPTIMAL
+
+Returns: (VOID)
+
+--*/
+{
+  mParseMode = Mode;
+}
+
+EFI_STATUS
+CompressParse (
+  IN UINT8                     *SrcBuffer,
+  IN UINT32                    SrcSize,
+  IN UINT32                    WindowBit,
+  IN COMPRESS_OUTPUT_FUNCTION  OutputFunction
+  )
+/*++
+
+Routine Description:
+
+  Transform the source data into Original Characters and Pointers.
+
+Arguments:
+
+  SrcBuffer       - The buffer storing the source data
+  SrcSize         - The size of source data
+  WindowBit       - Log2 of the largest distance of a Pointer
+  OutputFunction  - Called for each Original Character and Pointer, in order
+
+Returns:
+
+  EFI_SUCCESS           - The source data is parsed
+  EFI_OUT_OF_RESOURCES  - Not enough memory for the hash chains
+
+--*/
+{
+  EFI_STATUS                Status;
+  CONST OPTIMAL_PARAMETERS  *Parameters;
+
+  Parameters  = (mParseMode == COMPRESS_PARSE_OPTIMAL) ? &mOptimalParameters : &mNormalParameters;
+  mText       = SrcBuffer;
+  mTextSize   = SrcSize;
+  mWindowSize = 1U << WindowBit;
+  mOutput     = OutputFunction;
+  mChainDepth = (mParseMode == COMPRESS_PARSE_FAST) ? LAZY_CHAIN_DEPTH : Parameters->ChainDepth;
+
+  mHead   = malloc (HASH_SIZE * sizeof (*mHead));
+  mChain  = malloc (mWindowSize * sizeof (*mChain));
+  if (mHead == NULL || mChain == NULL) {
+    free (mHead);
+    free (mChain);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  memset (mHead, 0xFF, HASH_SIZE * sizeof (*mHead));
+
+  Status = EFI_SUCCESS;
+  if (mParseMode == COMPRESS_PARSE_FAST) {
+    LazyParse ();
+  } else {
+    Status = OptimalParse (Parameters);
+  }
+
+  free (mHead);
+  free (mChain);
+  return Status;
+}
+
+STATIC
+VOID
+InsertString (
+  IN UINT32 Pos
+  )
+/*++
+
+Routine Description:
+
+  Insert the string at a position into its hash chain
+
+Arguments:
+
+  Pos     - the position of the string
+
+Returns: (VOID)
+
+--*/
+{
+  UINT32  Hash;
+
+  if (Pos + THRESHOLD <= mTextSize) {
+    Hash                              = HASH (&mText[Pos]);
+    mChain[Pos & (mWindowSize - 1)]   = mHead[Hash];
+    mHead[Hash]                       = Pos;
+  }
+}
+
+STATIC
+UINT32
+SearchChain (
+  IN     UINT32 Pos,
+  IN     UINT32 Offset,
+  IN     UINT32 MaxLength,
+  IN OUT MATCH  *Matches,
+  IN     UINT32 MaxCount,
+  IN     UINT32 Count
+  )
+/*++
+
+Routine Description:
+
+  Search a hash chain for repeated strings. Each string found is longer than
+  the previous ones, and is the nearest one of its length found in the chain.
+  When MaxCount strings are found, the last one is replaced by the longer ones.
+
+Arguments:
+
+  Pos       - the position to search
+  Offset    - the chain searched is the one of the string at Pos + Offset,
+              each string in it is then compared from Offset characters before
+  MaxLength - the largest length of a string
+  Matches   - the strings found
+  MaxCount  - the number of entries of Matches
+  Count     - the number of strings already found
+
+Returns:
+
+  The number of strings found
+
+--*/
+{
+  UINT8   *Current;
+  UINT8   *String;
+  UINT32  Candidate;
+  UINT32  Next;
+  UINT32  Limit;
+  UINT32  Depth;
+  UINT32  Length;
+  UINT32  BestLength;
+
+  Current     = &mText[Pos];
+  Candidate   = mHead[HASH (&Current[Offset])];
+  Limit       = ((Pos > mWindowSize) ? Pos - mWindowSize : 0) + Offset;
+  BestLength  = (Count > 0) ? Matches[Count - 1].Length : THRESHOLD - 1;
+
+  for (Depth = mChainDepth; Depth > 0 && Candidate != NIL && Candidate >= Limit; Depth--) {
+    String = &mText[Candidate - Offset];
+    if (String[BestLength] == Current[BestLength] && String[0] == Current[0]) {
+      Length = 1;
+      while (Length < MaxLength && String[Length] == Current[Length]) {
+        Length++;
+      }
+
+      if (Length > BestLength) {
+        BestLength = Length;
+        if (Count == MaxCount) {
+          Count--;
+        }
+
+        Matches[Count].Length   = Length;
+        Matches[Count].Distance = Pos + Offset - Candidate;
+        Count++;
+        if (Length == MaxLength) {
+          break;
+        }
+      }
+    }
+
+    //
+    // A link that does not go back was overwritten by a newer string
+    //
+    Next = mChain[Candidate & (mWindowSize - 1)];
+    if (Next >= Candidate) {
+      break;
+    }
+
+    Candidate = Next;
+  }
+
+  return Count;
+}
+
+STATIC
+UINT32
+FindMatches (
+  IN  UINT32 Pos,
+  IN  UINT32 MaxLength,
+  OUT MATCH  *Matches,
+  IN  UINT32 MaxCount
+  )
+/*++
+
+Routine Description:
+
+  Search the hash chains of a position for repeated strings. Each string found
+  is longer than the previous ones. When MaxCount strings are found, the last
+  one is replaced by the longer ones.
+
+Arguments:
+
+  Pos       - the position to search
+  MaxLength - the largest length of a string
+  Matches   - the strings found
+  MaxCount  - the number of entries of Matches
+
+Returns:
+
+  The number of strings found
+
+--*/
+{
+  UINT8   *Current;
+  UINT32  RunLength;
+  UINT32  Count;
+
+  if (MaxLength < THRESHOLD || Pos + THRESHOLD > mTextSize) {
+    return 0;
+  }
+
+  Count = SearchChain (Pos, 0, MaxLength, Matches, MaxCount, 0);
+  if (Count > 0 && Matches[Count - 1].Length == MaxLength) {
+    return Count;
+  }
+
+  //
+  // The chain of a run of the same character is full of the positions of the
+  // earlier runs, so the strings that go on after the run are also searched
+  // in the chain of the end of the run
+  //
+  Current   = &mText[Pos];
+  RunLength = 1;
+  while (RunLength < MaxLength && Current[RunLength] == Current[0]) {
+    RunLength++;
+  }
+
+  if (RunLength >= THRESHOLD && RunLength < MaxLength && Pos + RunLength + 1 <= mTextSize) {
+    Count = SearchChain (Pos, RunLength - 2, MaxLength, Matches, MaxCount, Count);
+  }
+
+  return Count;
+}
+
+STATIC
+VOID
+GetLongestMatch (
+  IN  UINT32 Pos,
+  OUT MATCH  *Match
+  )
+/*++
+
+Routine Description:
+
+  Find the longest repeated string worth a Pointer at a position, and insert
+  the position into its hash chain.
+
+Arguments:
+
+  Pos     - the position to search
+  Match   - the string found, a Length of 0 if none
+
+Returns: (VOID)
+
+--*/
+{
+  UINT32  MaxLength;
+
+  MaxLength = (Pos < mTextSize) ? mTextSize - Pos : 0;
+  if (MaxLength > MAXMATCH) {
+    MaxLength = MAXMATCH;
+  }
+
+  if (FindMatches (Pos, MaxLength, Match, 1) == 0 ||
+      (Match->Length == THRESHOLD && Match->Distance - 1 > FAR_POSITION)) {
+    Match->Length = 0;
+  }
+
+  InsertString (Pos);
+}
+
+STATIC
+VOID
+LazyParse (
+  VOID
+  )
+/*++
+
+Routine Description:
+
+  Parse the source data with the longest string of each position, unless the
+  next position starts a longer one.
+
+Arguments: (VOID)
+
+Returns: (VOID)
+
+--*/
+{
+  UINT32  Pos;
+  UINT32  Next;
+  MATCH   Match;
+  MATCH   NextMatch;
+
+  Pos = 0;
+  GetLongestMatch (Pos, &Match);
+  while (Pos < mTextSize) {
+    if (Match.Length == 0) {
+      mOutput (mText[Pos], 0);
+      Pos++;
+      GetLongestMatch (Pos, &Match);
+      continue;
+    }
+
+    Next = Pos + 1;
+    if (Match.Length < LAZY_MATCH_LENGTH) {
+      GetLongestMatch (Next, &NextMatch);
+      Next++;
+      if (NextMatch.Length > Match.Length) {
+        //
+        // Not enough benefits are gained by outputting a pointer,
+        // so just output the original character
+        //
+        mOutput (mText[Pos], 0);
+        Pos++;
+        Match = NextMatch;
+        continue;
+      }
+    }
+
+    mOutput (Match.Length + (0x100 - THRESHOLD), Match.Distance - 1);
+    while (Next < Pos + Match.Length) {
+      InsertString (Next);
+      Next++;
+    }
+
+    Pos += Match.Length;
+    GetLongestMatch (Pos, &Match);
+  }
+}
+
+STATIC
+UINT32
+Log2Cost (
+  IN UINT32 Value
+  )
+/*++
+
+Routine Description:
+
+  Compute log2 of a value in 1/16 bit
+
+Arguments:
+
+  Value   - the value, not 0
+
+Returns:
+
+  The logarithm
+
+--*/
+{
+  UINT32  Integer;
+  UINT32  Fraction;
+  UINT64  Mantissa;
+  UINT32  Index;
+
+  Integer = 0;
+  while ((Value >> Integer) > 1) {
+    Integer++;
+  }
+
+  //
+  // Square the mantissa in [1, 2) once per bit of the fraction
+  //
+  Mantissa  = ((UINT64) Value << 16) >> Integer;
+  Fraction  = 0;
+  for (Index = 0; Index < COST_BIT; Index++) {
+    Mantissa  = (Mantissa * Mantissa) >> 16;
+    Fraction <<= 1;
+    if (Mantissa >= (2U << 16)) {
+      Mantissa >>= 1;
+      Fraction |= 1;
+    }
+  }
+
+  return (Integer << COST_BIT) | Fraction;
+}
+
+STATIC
+UINT32
+GetPositionBit (
+  IN UINT32 Position
+  )
+/*++
+
+Routine Description:
+
+  Get the number of bits of the 'Position' field of a Pointer, which is the
+  symbol of the Position Set
+
+Arguments:
+
+  Position  - the 'Position' field
+
+Returns:
+
+  The number of bits
+
+--*/
+{
+  UINT32  Bit;
+
+  Bit = 0;
+  while (Position != 0) {
+    Position >>= 1;
+    Bit++;
+  }
+
+  return Bit;
+}
+
+STATIC
+VOID
+UpdateCosts (
+  IN UINT32 CFreq[],
+  IN UINT32 PFreq[]
+  )
+/*++
+
+Routine Description:
+
+  Estimate the code length of each symbol from its frequency
+
+Arguments:
+
+  CFreq   - the frequencies of the Char&Len Set
+  PFreq   - the frequencies of the Position Set
+
+Returns: (VOID)
+
+--*/
+{
+  UINT32  Index;
+  UINT32  Total;
+  UINT32  Cost;
+
+  Total = 0;
+  for (Index = 0; Index < NC; Index++) {
+    Total += CFreq[Index] + 1;
+  }
+
+  for (Index = 0; Index < NC; Index++) {
+    Cost          = Log2Cost (Total) - Log2Cost (CFreq[Index] + 1);
+    mCCost[Index] = (Cost < MIN_CODE_COST) ? MIN_CODE_COST : (Cost > MAX_CODE_COST) ? MAX_CODE_COST : Cost;
+  }
+
+  Total = 0;
+  for (Index = 0; Index <= MAX_POSITION_BIT; Index++) {
+    Total += PFreq[Index] + 1;
+  }
+
+  for (Index = 0; Index <= MAX_POSITION_BIT; Index++) {
+    Cost          = Log2Cost (Total) - Log2Cost (PFreq[Index] + 1);
+    mPCost[Index] = (Cost < MIN_CODE_COST) ? MIN_CODE_COST : (Cost > MAX_CODE_COST) ? MAX_CODE_COST : Cost;
+    //
+    // The bits below the most significant one follow the symbol
+    //
+    if (Index > 1) {
+      mPCost[Index] += (Index - 1) << COST_BIT;
+    }
+  }
+}
+
+STATIC
+EFI_STATUS
+OptimalParse (
+  IN CONST OPTIMAL_PARAMETERS *Parameters
+  )
+/*++
+
+Routine Description:
+
+  Parse each block of the source data with the sequence of Original
+  Characters and Pointers of the smallest estimated coded size. The code
+  lengths are first estimated from the greedy parse of the block, then from
+  the previous pass.
+
+Arguments:
+
+  Parameters  - the depth of the search and the number of passes
+
+Returns:
+
+  EFI_SUCCESS           - The source data is parsed
+  EFI_OUT_OF_RESOURCES  - Not enough memory for the parse
+
+--*/
+{
+  MATCH   *Matches;
+  UINT32  *MatchCount;
+  UINT32  *Cost;
+  MATCH   *Choice;
+  UINT32  *Path;
+  UINT32  CFreq[NC];
+  UINT32  PFreq[MAX_POSITION_BIT + 1];
+  UINT32  Start;
+  UINT32  Size;
+  UINT32  Index;
+  UINT32  Count;
+  UINT32  Length;
+  UINT32  Pass;
+  UINT32  Base;
+  UINT32  NewCost;
+  UINT32  PositionCost;
+  MATCH   *List;
+
+  Matches     = malloc (OPTIMAL_BLOCK_SIZE * OPTIMAL_MATCH_COUNT * sizeof (*Matches));
+  MatchCount  = malloc (OPTIMAL_BLOCK_SIZE * sizeof (*MatchCount));
+  Cost        = malloc ((OPTIMAL_BLOCK_SIZE + 1) * sizeof (*Cost));
+  Choice      = malloc ((OPTIMAL_BLOCK_SIZE + 1) * sizeof (*Choice));
+  Path        = malloc ((OPTIMAL_BLOCK_SIZE + 1) * sizeof (*Path));
+  if (Matches == NULL || MatchCount == NULL || Cost == NULL || Choice == NULL || Path == NULL) {
+    free (Matches);
+    free (MatchCount);
+    free (Cost);
+    free (Choice);
+    free (Path);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Start = 0; Start < mTextSize; Start += Size) {
+    Size = mTextSize - Start;
+    if (Size > OPTIMAL_BLOCK_SIZE) {
+      Size = OPTIMAL_BLOCK_SIZE;
+    }
+
+    //
+    // Find the strings of every position of the block
+    //
+    for (Index = 0; Index < Size; Index++) {
+      Length = Size - Index;
+      if (Length > MAXMATCH) {
+        Length = MAXMATCH;
+      }
+
+      List              = &Matches[Index * OPTIMAL_MATCH_COUNT];
+      Count             = FindMatches (Start + Index, Length, List, Parameters->MatchCount);
+      MatchCount[Index] = Count;
+      InsertString (Start + Index);
+      if (Count > 0 && List[Count - 1].Length >= Parameters->NiceLength) {
+        for (Length = 1; Length < List[Count - 1].Length; Length++) {
+          MatchCount[Index + Length] = 0;
+          InsertString (Start + Index + Length);
+        }
+
+        Index += Length - 1;
+      }
+    }
+
+    for (Pass = 0; Pass < Parameters->PassCount; Pass++) {
+      memset (CFreq, 0, sizeof (CFreq));
+      memset (PFreq, 0, sizeof (PFreq));
+      Index = 0;
+      while (Index < Size) {
+        if (Pass == 0) {
+          Count   = MatchCount[Index];
+          Length  = (Count > 0) ? Matches[Index * OPTIMAL_MATCH_COUNT + Count - 1].Length : 1;
+          if (Length > 1) {
+            CFreq[Length + (0x100 - THRESHOLD)]++;
+            PFreq[GetPositionBit (Matches[Index * OPTIMAL_MATCH_COUNT + Count - 1].Distance - 1)]++;
+          } else {
+            CFreq[mText[Start + Index]]++;
+          }
+        } else {
+          Length = Path[Index] - Index;
+          if (Choice[Path[Index]].Distance != 0) {
+            CFreq[Length + (0x100 - THRESHOLD)]++;
+            PFreq[GetPositionBit (Choice[Path[Index]].Distance - 1)]++;
+          } else {
+            CFreq[mText[Start + Index]]++;
+          }
+        }
+
+        Index += Length;
+      }
+
+      UpdateCosts (CFreq, PFreq);
+
+      //
+      // Cost[Index] is the smallest cost of the first Index characters of the
+      // block, reached by Choice[Index]
+      //
+      Cost[0] = 0;
+      for (Index = 1; Index <= Size; Index++) {
+        Cost[Index] = NIL;
+      }
+
+      for (Index = 0; Index < Size; Index++) {
+        Base    = Cost[Index];
+        NewCost = Base + mCCost[mText[Start + Index]];
+        if (NewCost < Cost[Index + 1]) {
+          Cost[Index + 1]             = NewCost;
+          Choice[Index + 1].Length    = 1;
+          Choice[Index + 1].Distance  = 0;
+        }
+
+        List    = &Matches[Index * OPTIMAL_MATCH_COUNT];
+        Length  = THRESHOLD;
+        for (Count = 0; Count < MatchCount[Index]; Count++) {
+          PositionCost = mPCost[GetPositionBit (List[Count].Distance - 1)];
+          if (List[Count].Length >= Parameters->NiceLength) {
+            Length = List[Count].Length;
+          }
+
+          for (; Length <= List[Count].Length; Length++) {
+            NewCost = Base + mCCost[Length + (0x100 - THRESHOLD)] + PositionCost;
+            if (NewCost < Cost[Index + Length]) {
+              Cost[Index + Length]            = NewCost;
+              Choice[Index + Length].Length   = Length;
+              Choice[Index + Length].Distance = List[Count].Distance;
+            }
+          }
+        }
+      }
+
+      //
+      // Path[Index] is the end of the item starting at Index
+      //
+      for (Index = Size; Index > 0; Index -= Choice[Index].Length) {
+        Path[Index - Choice[Index].Length] = Index;
+      }
+    }
+
+    Index = 0;
+    while (Index < Size) {
+      if (Choice[Path[Index]].Distance != 0) {
+        mOutput (Choice[Path[Index]].Length + (0x100 - THRESHOLD), Choice[Path[Index]].Distance - 1);
+      } else {
+        mOutput (mText[Start + Index], 0);
+      }
+
+      Index = Path[Index];
+    }
+  }
+
+  free (Matches);
+  free (MatchCount);
+  free (Cost);
+  free (Choice);
+  free (Path);
+  return EFI_SUCCESS;
+}
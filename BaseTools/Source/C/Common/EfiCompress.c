@@ -17,21 +17,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 //
 
 #undef UINT8_MAX
-typedef INT16             NODE;
 #define UINT8_MAX         0xff
 #define UINT8_BIT         8
 #define THRESHOLD         3
-#define INIT_CRC          0
 #define WNDBIT            13
 #define WNDSIZ            (1U << WNDBIT)
 #define MAXMATCH          256
-#define PERC_FLAG         0x8000U
 #define CODE_BIT          16
-#define NIL               0
-#define MAX_HASH_VAL      (3 * WNDSIZ + (WNDSIZ / 512 + 1) * UINT8_MAX)
-#define HASH(p, c)        ((p) + ((c) << (WNDBIT - 9)) + WNDSIZ * 2)
-#define CRCPOLY           0xA001
-#define UPDATE_CRC(c)     mCrc = mCrcTable[(mCrc ^ (c)) & 0xFF] ^ (mCrc >> UINT8_BIT)
 
 //
 // C: the Char&Len Set; P: the Position Set; T: the exTra Set
@@ -69,47 +61,6 @@ VOID
 FreeMemory (
   );
 
-STATIC
-VOID
-InitSlide (
-  );
-
-STATIC
-NODE
-Child (
-  IN NODE q,
-  IN UINT8 c
-  );
-
-STATIC
-VOID
-MakeChild (
-  IN NODE q,
-  IN UINT8 c,
-  IN NODE r
-  );
-
-STATIC
-VOID
-Split (
-  IN NODE Old
-  );
-
-STATIC
-VOID
-InsertNode (
-  );
-
-STATIC
-VOID
-DeleteNode (
-  );
-
-STATIC
-VOID
-GetNextMatch (
-  );
-
 STATIC
 EFI_STATUS
 Encode (
@@ -167,11 +118,6 @@ VOID
 HufEncodeEnd (
   );
 
-STATIC
-VOID
-MakeCrcTable (
-  );
-
 STATIC
 VOID
 PutBits (
@@ -179,13 +125,6 @@ PutBits (
   IN UINT32 x
   );
 
-STATIC
-INT32
-FreadCrc (
-  OUT UINT8 *p,
-  IN  INT32 n
-  );
-
 STATIC
 VOID
 InitPutBits (
@@ -233,18 +172,16 @@ MakeTree (
 
 STATIC UINT8  *mSrc, *mDst, *mSrcUpperLimit, *mDstUpperLimit;
 
-STATIC UINT8  *mLevel, *mText, *mChildCount, *mBuf, mCLen[NC], mPTLen[NPT], *mLen;
+STATIC UINT8  *mBuf, mCLen[NC], mPTLen[NPT], *mLen;
 STATIC INT16  mHeap[NC + 1];
-STATIC INT32  mRemainder, mMatchLen, mBitCount, mHeapSize, mN;
-STATIC UINT32 mBufSiz = 0, mOutputPos, mOutputMask, mSubBitBuf, mCrc;
+STATIC INT32  mBitCount, mHeapSize, mN;
+STATIC UINT32 mBufSiz = 0, mOutputPos, mOutputMask, mSubBitBuf;
 STATIC UINT32 mCompSize, mOrigSize;
 
 STATIC UINT16 *mFreq, *mSortPtr, mLenCnt[17], mLeft[2 * NC - 1], mRight[2 * NC - 1],
-              mCrcTable[UINT8_MAX + 1], mCFreq[2 * NC - 1],mCCode[NC],
+              mCFreq[2 * NC - 1],mCCode[NC],
               mPFreq[2 * NP - 1], mPTCode[NPT], mTFreq[2 * NT - 1];
 
-STATIC NODE   mPos, mMatchPos, mAvail, *mPosition, *mParent, *mPrev, *mNext = NULL;
-
 
 //
 // functions
@@ -286,13 +223,6 @@ Returns:
   //
   mBufSiz = 0;
   mBuf = NULL;
-  mText       = NULL;
-  mLevel      = NULL;
-  mChildCount = NULL;
-  mPosition   = NULL;
-  mParent     = NULL;
-  mPrev       = NULL;
-  mNext       = NULL;
 
 
   mSrc = SrcBuffer;
@@ -303,10 +233,7 @@ Returns:
   PutDword(0L);
   PutDword(0L);
 
-  MakeCrcTable ();
-
   mOrigSize = mCompSize = 0;
-  mCrc = INIT_CRC;
 
   //
   // Compress it
@@ -399,27 +326,6 @@ Returns:
 
 --*/
 {
-  UINT32      i;
-
-  mText       = malloc (WNDSIZ * 2 + MAXMATCH);
-  if (mText == NULL) {
-    return EFI_OUT_OF_RESOURCES;
-  }
-  for (i = 0 ; i < WNDSIZ * 2 + MAXMATCH; i ++) {
-    mText[i] = 0;
-  }
-
-  mLevel      = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*mLevel));
-  mChildCount = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*mChildCount));
-  mPosition   = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*mPosition));
-  mParent     = malloc (WNDSIZ * 2 * sizeof(*mParent));
-  mPrev       = malloc (WNDSIZ * 2 * sizeof(*mPrev));
-  mNext       = malloc ((MAX_HASH_VAL + 1) * sizeof(*mNext));
-  if (mLevel == NULL || mChildCount == NULL || mPosition == NULL ||
-    mParent == NULL || mPrev == NULL || mNext == NULL) {
-    return EFI_OUT_OF_RESOURCES;
-  }
-
   mBufSiz = 16 * 1024U;
   while ((mBuf = malloc(mBufSiz)) == NULL) {
     mBufSiz = (mBufSiz / 10U) * 9U;
@@ -446,34 +352,6 @@ Returns: (VOID)
 
 --*/
 {
-  if (mText) {
-    free (mText);
-  }
-
-  if (mLevel) {
-    free (mLevel);
-  }
-
-  if (mChildCount) {
-    free (mChildCount);
-  }
-
-  if (mPosition) {
-    free (mPosition);
-  }
-
-  if (mParent) {
-    free (mParent);
-  }
-
-  if (mPrev) {
-    free (mPrev);
-  }
-
-  if (mNext) {
-    free (mNext);
-  }
-
   if (mBuf) {
     free (mBuf);
   }
@@ -482,365 +360,6 @@ Returns: (VOID)
 }
 
 
-STATIC
-VOID
-InitSlide ()
-/*++
-
-Routine Description:
-
-  Initialize String Info Log data structures
-
-Arguments: (VOID)
-
-Returns: (VOID)
-
---*/
-{
-  NODE i;
-
-  for (i = WNDSIZ; i <= WNDSIZ + UINT8_MAX; i++) {
-    mLevel[i] = 1;
-    mPosition[i] = NIL;  /* sentinel */
-  }
-  for (i = WNDSIZ; i < WNDSIZ * 2; i++) {
-    mParent[i] = NIL;
-  }
-  mAvail = 1;
-  for (i = 1; i < WNDSIZ - 1; i++) {
-    mNext[i] = (NODE)(i + 1);
-  }
-
-  mNext[WNDSIZ - 1] = NIL;
-  for (i = WNDSIZ * 2; i <= MAX_HASH_VAL; i++) {
-    mNext[i] = NIL;
-  }
-}
-
-
-STATIC
-NODE
-Child (
-  IN NODE q,
-  IN UINT8 c
-  )
-/*++
-
-Routine Description:
-
-  Find child node given the parent node and the edge character
-
-Arguments:
-
-  q       - the parent node
-  c       - the edge character
-
-Returns:
-
-  The child node (NIL if not found)
-
---*/
-{
-  NODE r;
-
-  r = mNext[HASH(q, c)];
-  mParent[NIL] = q;  /* sentinel */
-  while (mParent[r] != q) {
-    r = mNext[r];
-  }
-
-  return r;
-}
-
-STATIC
-VOID
-MakeChild (
-  IN NODE q,
-  IN UINT8 c,
-  IN NODE r
-  )
-/*++
-
-Routine Description:
-
-  Create a new child for a given parent node.
-
-Arguments:
-
-  q       - the parent node
-  c       - the edge character
-  r       - the child node
-
-Returns: (VOID)
-
---*/
-{
-  NODE h, t;
-
-  h = (NODE)HASH(q, c);
-  t = mNext[h];
-  mNext[h] = r;
-  mNext[r] = t;
-  mPrev[t] = r;
-  mPrev[r] = h;
-  mParent[r] = q;
-  mChildCount[q]++;
-}
-
-STATIC
-VOID
-Split (
-  NODE Old
-  )
-/*++
-
-Routine Description:
-
-  Split a node.
-
-Arguments:
-
-  Old     - the node to split
-
-Returns: (VOID)
-
---*/
-{
-  NODE New, t;
-
-  New = mAvail;
-  mAvail = mNext[New];
-  mChildCount[New] = 0;
-  t = mPrev[Old];
-  mPrev[New] = t;
-  mNext[t] = New;
-  t = mNext[Old];
-  mNext[New] = t;
-  mPrev[t] = New;
-  mParent[New] = mParent[Old];
-  mLevel[New] = (UINT8)mMatchLen;
-  mPosition[New] = mPos;
-  MakeChild(New, mText[mMatchPos + mMatchLen], Old);
-  MakeChild(New, mText[mPos + mMatchLen], mPos);
-}
-
-STATIC
-VOID
-InsertNode ()
-/*++
-
-Routine Description:
-
-  Insert string info for current position into the String Info Log
-
-Arguments: (VOID)
-
-Returns: (VOID)
-
---*/
-{
-  NODE q, r, j, t;
-  UINT8 c, *t1, *t2;
-
-  if (mMatchLen >= 4) {
-
-    //
-    // We have just got a long match, the target tree
-    // can be located by MatchPos + 1. Traverse the tree
-    // from bottom up to get to a proper starting point.
-    // The usage of PERC_FLAG ensures proper node deletion
-    // in DeleteNode() later.
-    //
-
-    mMatchLen--;
-    r = (INT16)((mMatchPos + 1) | WNDSIZ);
-    while ((q = mParent[r]) == NIL) {
-      r = mNext[r];
-    }
-    while (mLevel[q] >= mMatchLen) {
-      r = q;  q = mParent[q];
-    }
-    t = q;
-    while (mPosition[t] < 0) {
-      mPosition[t] = mPos;
-      t = mParent[t];
-    }
-    if (t < WNDSIZ) {
-      mPosition[t] = (NODE)(mPos | PERC_FLAG);
-    }
-  } else {
-
-    //
-    // Locate the target tree
-    //
-
-    q = (INT16)(mText[mPos] + WNDSIZ);
-    c = mText[mPos + 1];
-    if ((r = Child(q, c)) == NIL) {
-      MakeChild(q, c, mPos);
-      mMatchLen = 1;
-      return;
-    }
-    mMatchLen = 2;
-  }
-
-  //
-  // Traverse down the tree to find a match.
-  // Update Position value along the route.
-  // Node split or creation is involved.
-  //
-
-  for ( ; ; ) {
-    if (r >= WNDSIZ) {
-      j = MAXMATCH;
-      mMatchPos = r;
-    } else {
-      j = mLevel[r];
-      mMatchPos = (NODE)(mPosition[r] & ~PERC_FLAG);
-    }
-    if (mMatchPos >= mPos) {
-      mMatchPos -= WNDSIZ;
-    }
-    t1 = &mText[mPos + mMatchLen];
-    t2 = &mText[mMatchPos + mMatchLen];
-    while (mMatchLen < j) {
-      if (*t1 != *t2) {
-        Split(r);
-        return;
-      }
-      mMatchLen++;
-      t1++;
-      t2++;
-    }
-    if (mMatchLen >= MAXMATCH) {
-      break;
-    }
-    mPosition[r] = mPos;
-    q = r;
-    if ((r = Child(q, *t1)) == NIL) {
-      MakeChild(q, *t1, mPos);
-      return;
-    }
-    mMatchLen++;
-  }
-  t = mPrev[r];
-  mPrev[mPos] = t;
-  mNext[t] = mPos;
-  t = mNext[r];
-  mNext[mPos] = t;
-  mPrev[t] = mPos;
-  mParent[mPos] = q;
-  mParent[r] = NIL;
-
-  //
-  // Special usage of 'next'
-  //
-  mNext[r] = mPos;
-
-}
-
-STATIC
-VOID
-DeleteNode ()
-/*++
-
-Routine Description:
-
-  Delete outdated string info. (The Usage of PERC_FLAG
-  ensures a clean deletion)
-
-Arguments: (VOID)
-
-Returns: (VOID)
-
---*/
-{
-  NODE q, r, s, t, u;
-
-  if (mParent[mPos] == NIL) {
-    return;
-  }
-
-  r = mPrev[mPos];
-  s = mNext[mPos];
-  mNext[r] = s;
-  mPrev[s] = r;
-  r = mParent[mPos];
-  mParent[mPos] = NIL;
-  if (r >= WNDSIZ || --mChildCount[r] > 1) {
-    return;
-  }
-  t = (NODE)(mPosition[r] & ~PERC_FLAG);
-  if (t >= mPos) {
-    t -= WNDSIZ;
-  }
-  s = t;
-  q = mParent[r];
-  while ((u = mPosition[q]) & PERC_FLAG) {
-    u &= ~PERC_FLAG;
-    if (u >= mPos) {
-      u -= WNDSIZ;
-    }
-    if (u > s) {
-      s = u;
-    }
-    mPosition[q] = (INT16)(s | WNDSIZ);
-    q = mParent[q];
-  }
-  if (q < WNDSIZ) {
-    if (u >= mPos) {
-      u -= WNDSIZ;
-    }
-    if (u > s) {
-      s = u;
-    }
-    mPosition[q] = (INT16)(s | WNDSIZ | PERC_FLAG);
-  }
-  s = Child(r, mText[t + mLevel[r]]);
-  t = mPrev[s];
-  u = mNext[s];
-  mNext[t] = u;
-  mPrev[u] = t;
-  t = mPrev[r];
-  mNext[t] = s;
-  mPrev[s] = t;
-  t = mNext[r];
-  mPrev[t] = s;
-  mNext[s] = t;
-  mParent[s] = mParent[r];
-  mParent[r] = NIL;
-  mNext[r] = mAvail;
-  mAvail = r;
-}
-
-STATIC
-VOID
-GetNextMatch ()
-/*++
-
-Routine Description:
-
-  Advance the current position (read in new data if needed).
-  Delete outdated string info. Find a match string for current position.
-
-Arguments: (VOID)
-
-Returns: (VOID)
-
---*/
-{
-  INT32 n;
-
-  mRemainder--;
-  if (++mPos == WNDSIZ * 2) {
-    memmove(&mText[0], &mText[WNDSIZ], WNDSIZ + MAXMATCH);
-    n = FreadCrc(&mText[WNDSIZ + MAXMATCH], WNDSIZ);
-    mRemainder += n;
-    mPos = WNDSIZ;
-  }
-  DeleteNode();
-  InsertNode();
-}
 
 STATIC
 EFI_STATUS
@@ -861,8 +380,6 @@ Returns:
 --*/
 {
   EFI_STATUS  Status;
-  INT32       LastMatchLen;
-  NODE        LastMatchPos;
 
   Status = AllocateMemory();
   if (EFI_ERROR(Status)) {
@@ -870,49 +387,13 @@ Returns:
     return Status;
   }
 
-  InitSlide();
-
   HufEncodeStart();
 
-  mRemainder = FreadCrc(&mText[WNDSIZ], WNDSIZ + MAXMATCH);
-
-  mMatchLen = 0;
-  mPos = WNDSIZ;
-  InsertNode();
-  if (mMatchLen > mRemainder) {
-    mMatchLen = mRemainder;
-  }
-  while (mRemainder > 0) {
-    LastMatchLen = mMatchLen;
-    LastMatchPos = mMatchPos;
-    GetNextMatch();
-    if (mMatchLen > mRemainder) {
-      mMatchLen = mRemainder;
-    }
-
-    if (mMatchLen > LastMatchLen || LastMatchLen < THRESHOLD) {
-
-      //
-      // Not enough benefits are gained by outputting a pointer,
-      // so just output the original character
-      //
-
-      Output(mText[mPos - 1], 0);
-    } else {
-
-      //
-      // Outputting a pointer is beneficial enough, do it.
-      //
-
-      Output(LastMatchLen + (UINT8_MAX + 1 - THRESHOLD),
-             (mPos - LastMatchPos - 2) & (WNDSIZ - 1));
-      while (--LastMatchLen > 0) {
-        GetNextMatch();
-      }
-      if (mMatchLen > mRemainder) {
-        mMatchLen = mRemainder;
-      }
-    }
+  mOrigSize = (UINT32) (mSrcUpperLimit - mSrc);
+  Status = CompressParse(mSrc, mOrigSize, WNDBIT, Output);
+  if (EFI_ERROR(Status)) {
+    FreeMemory();
+    return Status;
   }
 
   HufEncodeEnd();
@@ -1244,25 +725,6 @@ HufEncodeEnd ()
 }
 
 
-STATIC
-VOID
-MakeCrcTable ()
-{
-  UINT32 i, j, r;
-
-  for (i = 0; i <= UINT8_MAX; i++) {
-    r = i;
-    for (j = 0; j < UINT8_BIT; j++) {
-      if (r & 1) {
-        r = (r >> 1) ^ CRCPOLY;
-      } else {
-        r >>= 1;
-      }
-    }
-    mCrcTable[i] = (UINT16)r;
-  }
-}
-
 STATIC
 VOID
 PutBits (
@@ -1311,44 +773,6 @@ Returns: (VOID)
   }
 }
 
-STATIC
-INT32
-FreadCrc (
-  OUT UINT8 *p,
-  IN  INT32 n
-  )
-/*++
-
-Routine Description:
-
-  Read in source data
-
-Arguments:
-
-  p   - the buffer to hold the data
-  n   - number of bytes to read
-
-Returns:
-
-  number of bytes actually read
-
---*/
-{
-  INT32 i;
-
-  for (i = 0; mSrc < mSrcUpperLimit && i < n; i++) {
-    *p++ = *mSrc++;
-  }
-  n = i;
-
-  p -= n;
-  mOrigSize += n;
-  while (--i >= 0) {
-    UPDATE_CRC(*p++);
-  }
-  return n;
-}
-
 
 STATIC
 VOID
@@ -22,11 +22,28 @@
 #include "Sdk/C/LzmaDec.h"
 #include "Sdk/C/LzmaEnc.h"
 #include "Sdk/C/Bra.h"
+#ifndef _7ZIP_ST
+#include "Sdk/C/Threads.h"
+#endif
 #include "CommonLib.h"
 #include "ParseInf.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 #define LZMA_HEADER_SIZE (LZMA_PROPS_SIZE + 8)
 
+//
+// Chunked LZMA format, see LZMA_CHUNKED_HEADER in
+// MdeModulePkg/Include/Guid/LzmaDecompress.h. The header is followed by the
+// compressed size of every block, then by the blocks. Each block is a complete
+// LZMA stream, so the blocks can be decoded independently of each other.
+//
+#define LZMA_CHUNKED_SIGNATURE          0x434D5A4C  // 'L','Z','M','C'
+#define LZMA_CHUNKED_HEADER_SIZE        16
+#define LZMA_CHUNKED_DEFAULT_BLOCK_SIZE 0x100000
+
 typedef enum {
   NoConverter,
   X86Converter,
@@ -41,6 +58,9 @@ const char *kInvalidParamValMessage = "Invalid parameter value";
 
 static BoolInt mQuietMode = False;
 static CONVERTER_TYPE mConType = NoConverter;
+static BoolInt mChunked = False;
+static UInt32 mBlockSize = LZMA_CHUNKED_DEFAULT_BLOCK_SIZE;
+static UInt32 mNumThreads = 0;
 
 UINT64 mDictionarySize = 28;
 UINT64 mCompressionMode = 2;
@@ -60,6 +80,10 @@ void PrintHelp(char *buffer)
              "  -d: decode file\n"
              "  -o FileName, --output FileName: specify the output filename\n"
              "  --f86: enable converter for x86 code\n"
+             "  --chunked: split the data in blocks that can be decoded in parallel\n"
+             "  --block-size Size: set the block size of --chunked, default: 0x100000\n"
+             "  --threads Number: set the number of threads, default: number of processors\n"
+             "                    the output does not depend on the number of threads\n"
              "  -v, --verbose: increase output messages\n"
              "  -q, --quiet: reduce output messages\n"
              "  --debug [0-9]: set debug level\n"
@@ -94,40 +118,41 @@ void PrintVersion(char *buffer)
   sprintf (buffer, "%s Version %d.%d %s ", UTILITY_NAME, UTILITY_MAJOR_VERSION, UTILITY_MINOR_VERSION, __BUILD_VERSION);
 }
 
-static SRes Encode(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 fileSize, CLzmaEncProps *props)
+static size_t EncodeBound(size_t inSize)
 {
-  SRes res;
-  size_t inSize = (size_t)fileSize;
-  Byte *inBuffer = 0;
-  Byte *outBuffer = 0;
-  Byte *filteredStream = 0;
-  size_t outSize;
+  // we allocate 105% of original size + 64KB for output buffer
+  return inSize / 20 * 21 + (1 << 16);
+}
 
-  if (inSize != 0) {
-    inBuffer = (Byte *)MyAlloc(inSize);
-    if (inBuffer == 0)
-      return SZ_ERROR_MEM;
-  } else {
-    return SZ_ERROR_INPUT_EOF;
-  }
+static void WriteUInt32(Byte *buffer, UInt32 value)
+{
+  int i;
+  for (i = 0; i < 4; i++)
+    buffer[i] = (Byte)(value >> (8 * i));
+}
 
-  if (SeqInStream_Read(inStream, inBuffer, inSize) != SZ_OK) {
-    res = SZ_ERROR_READ;
-    goto Done;
-  }
+static UInt32 ReadUInt32(const Byte *buffer)
+{
+  return (UInt32)buffer[0] | ((UInt32)buffer[1] << 8) |
+         ((UInt32)buffer[2] << 16) | ((UInt32)buffer[3] << 24);
+}
 
-  // we allocate 105% of original size + 64KB for output buffer
-  outSize = (size_t)fileSize / 20 * 21 + (1 << 16);
-  outBuffer = (Byte *)MyAlloc(outSize);
-  if (outBuffer == 0) {
-    res = SZ_ERROR_MEM;
-    goto Done;
-  }
+//
+// Encode inBuffer into a complete LZMA stream, header included. On entry
+// *outSize is the size of outBuffer, on exit the size of the stream.
+//
+static SRes EncodeStream(Byte *outBuffer, size_t *outSize, const Byte *inBuffer, size_t inSize, CLzmaEncProps *props)
+{
+  SRes res;
+  Byte *filteredStream = 0;
+
+  if (*outSize < LZMA_HEADER_SIZE)
+    return SZ_ERROR_OUTPUT_EOF;
 
   {
     int i;
     for (i = 0; i < 8; i++)
-      outBuffer[i + LZMA_PROPS_SIZE] = (Byte)(fileSize >> (8 * i));
+      outBuffer[i + LZMA_PROPS_SIZE] = (Byte)((UInt64)inSize >> (8 * i));
   }
 
   if (mConType != NoConverter)
@@ -149,7 +174,7 @@ static SRes Encode(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 file
   }
 
   {
-    size_t outSizeProcessed = outSize - LZMA_HEADER_SIZE;
+    size_t outSizeProcessed = *outSize - LZMA_HEADER_SIZE;
     size_t outPropsSize = LZMA_PROPS_SIZE;
 
     res = LzmaEncode(outBuffer + LZMA_HEADER_SIZE, &outSizeProcessed,
@@ -160,16 +185,457 @@ static SRes Encode(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 file
     if (res != SZ_OK)
       goto Done;
 
-    outSize = LZMA_HEADER_SIZE + outSizeProcessed;
+    *outSize = LZMA_HEADER_SIZE + outSizeProcessed;
+  }
+
+Done:
+  MyFree(filteredStream);
+
+  return res;
+}
+
+static UInt32 GetNumberOfProcessors(void)
+{
+#ifdef _WIN32
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return systemInfo.dwNumberOfProcessors;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (UInt32)count : 1;
+#endif
+}
+
+//
+// The blocks of a chunked stream are encoded by several threads, each block
+// in its own slot of the output buffer. The slots are compacted in block order
+// once all the blocks are encoded, so that the output does not depend on the
+// number of threads.
+//
+typedef struct {
+  const Byte *inBuffer;
+  size_t inSize;
+  Byte *outBuffer;
+  size_t slotSize;
+  size_t *blockOutSizes;
+  UInt32 blockCount;
+  UInt32 nextBlock;
+  SRes res;
+  CLzmaEncProps props;
+#ifndef _7ZIP_ST
+  CCriticalSection cs;
+#endif
+} CHUNKED_ENCODER;
+
+static void EncodeChunkedBlocks(CHUNKED_ENCODER *p)
+{
+  for (;;) {
+    UInt32 block;
+    size_t offset;
+    size_t blockInSize;
+    SRes res;
+
+#ifndef _7ZIP_ST
+    CriticalSection_Enter(&p->cs);
+#endif
+    block = p->nextBlock;
+    if (p->res == SZ_OK && block < p->blockCount)
+      p->nextBlock++;
+    else
+      block = p->blockCount;
+#ifndef _7ZIP_ST
+    CriticalSection_Leave(&p->cs);
+#endif
+    if (block == p->blockCount)
+      break;
+
+    offset = (size_t)block * mBlockSize;
+    blockInSize = p->inSize - offset < mBlockSize ? p->inSize - offset : mBlockSize;
+    p->blockOutSizes[block] = p->slotSize;
+    res = EncodeStream(p->outBuffer + (size_t)block * p->slotSize, &p->blockOutSizes[block],
+        p->inBuffer + offset, blockInSize, &p->props);
+    if (res != SZ_OK) {
+#ifndef _7ZIP_ST
+      CriticalSection_Enter(&p->cs);
+#endif
+      if (p->res == SZ_OK)
+        p->res = res;
+#ifndef _7ZIP_ST
+      CriticalSection_Leave(&p->cs);
+#endif
+    }
+  }
+}
+
+#ifndef _7ZIP_ST
+static THREAD_FUNC_DECL EncodeChunkedThread(void *p)
+{
+  EncodeChunkedBlocks((CHUNKED_ENCODER *)p);
+  return 0;
+}
+#endif
+
+//
+// Encode the input in blocks of mBlockSize bytes, each one compressed as an
+// independent LZMA stream, and write them behind the chunked header and the
+// block index.
+//
+static SRes EncodeChunked(ISeqOutStream *outStream, const Byte *inBuffer, size_t inSize, CLzmaEncProps *props)
+{
+  SRes res = SZ_OK;
+  UInt64 blockCount64;
+  UInt32 blockCount;
+  UInt32 block;
+  size_t indexSize;
+  size_t outSize;
+  size_t blocksSize;
+  Byte *outBuffer;
+  CHUNKED_ENCODER encoder;
+#ifndef _7ZIP_ST
+  CThread *threads = 0;
+  UInt32 numThreads;
+  UInt32 thread;
+#endif
+
+  if ((UInt64)inSize > 0xFFFFFFFF)
+    return SZ_ERROR_PARAM;
+
+  blockCount64 = ((UInt64)inSize + mBlockSize - 1) / mBlockSize;
+  blockCount = (UInt32)blockCount64;
+  indexSize = LZMA_CHUNKED_HEADER_SIZE + (size_t)blockCount * sizeof(UInt32);
+
+  outSize = indexSize + (size_t)blockCount * EncodeBound(mBlockSize);
+  outBuffer = (Byte *)MyAlloc(outSize);
+  if (outBuffer == 0)
+    return SZ_ERROR_MEM;
+
+  WriteUInt32(outBuffer, LZMA_CHUNKED_SIGNATURE);
+  WriteUInt32(outBuffer + 4, mBlockSize);
+  WriteUInt32(outBuffer + 8, blockCount);
+  WriteUInt32(outBuffer + 12, (UInt32)inSize);
+
+  encoder.inBuffer = inBuffer;
+  encoder.inSize = inSize;
+  encoder.outBuffer = outBuffer + indexSize;
+  encoder.slotSize = EncodeBound(mBlockSize);
+  encoder.blockOutSizes = (size_t *)MyAlloc((size_t)blockCount * sizeof(size_t));
+  encoder.blockCount = blockCount;
+  encoder.nextBlock = 0;
+  encoder.res = SZ_OK;
+  encoder.props = *props;
+  if (encoder.blockOutSizes == 0) {
+    res = SZ_ERROR_MEM;
+    goto Done;
+  }
+
+#ifndef _7ZIP_ST
+  //
+  // The blocks are already encoded in parallel, each one with a single
+  // threaded match finder
+  //
+  encoder.props.numThreads = 1;
+  if (CriticalSection_Init(&encoder.cs) != 0) {
+    res = SZ_ERROR_THREAD;
+    goto Done;
+  }
+
+  numThreads = mNumThreads < blockCount ? mNumThreads : blockCount;
+  if (numThreads > 1) {
+    threads = (CThread *)MyAlloc((size_t)(numThreads - 1) * sizeof(CThread));
+  }
+  for (thread = 0; threads != 0 && thread < numThreads - 1; thread++) {
+    Thread_Construct(&threads[thread]);
+    if (Thread_Create(&threads[thread], EncodeChunkedThread, &encoder) != 0)
+      break;
+  }
+#endif
+
+  //
+  // This thread encodes blocks too, and alone if no thread could be created
+  //
+  EncodeChunkedBlocks(&encoder);
+
+#ifndef _7ZIP_ST
+  if (threads != 0) {
+    while (thread > 0) {
+      thread--;
+      Thread_Wait(&threads[thread]);
+      Thread_Close(&threads[thread]);
+    }
+    MyFree(threads);
+  }
+  CriticalSection_Delete(&encoder.cs);
+#endif
+
+  res = encoder.res;
+  if (res != SZ_OK)
+    goto Done;
+
+  blocksSize = 0;
+  for (block = 0; block < blockCount; block++) {
+    memmove(outBuffer + indexSize + blocksSize,
+        encoder.outBuffer + (size_t)block * encoder.slotSize, encoder.blockOutSizes[block]);
+    WriteUInt32(outBuffer + LZMA_CHUNKED_HEADER_SIZE + block * sizeof(UInt32), (UInt32)encoder.blockOutSizes[block]);
+    blocksSize += encoder.blockOutSizes[block];
+  }
+
+  outSize = indexSize + blocksSize;
+  if (outStream->Write(outStream, outBuffer, outSize) != outSize)
+    res = SZ_ERROR_WRITE;
+
+Done:
+  MyFree(encoder.blockOutSizes);
+  MyFree(outBuffer);
+
+  return res;
+}
+
+static SRes Encode(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 fileSize, CLzmaEncProps *props)
+{
+  SRes res;
+  size_t inSize = (size_t)fileSize;
+  Byte *inBuffer = 0;
+  Byte *outBuffer = 0;
+  size_t outSize;
+
+  if (inSize != 0) {
+    inBuffer = (Byte *)MyAlloc(inSize);
+    if (inBuffer == 0)
+      return SZ_ERROR_MEM;
+  } else {
+    return SZ_ERROR_INPUT_EOF;
+  }
+
+  if (SeqInStream_Read(inStream, inBuffer, inSize) != SZ_OK) {
+    res = SZ_ERROR_READ;
+    goto Done;
+  }
+
+  if (mChunked) {
+    res = EncodeChunked(outStream, inBuffer, inSize, props);
+    goto Done;
+  }
+
+  outSize = EncodeBound(inSize);
+  outBuffer = (Byte *)MyAlloc(outSize);
+  if (outBuffer == 0) {
+    res = SZ_ERROR_MEM;
+    goto Done;
   }
 
+  res = EncodeStream(outBuffer, &outSize, inBuffer, inSize, props);
+  if (res != SZ_OK)
+    goto Done;
+
   if (outStream->Write(outStream, outBuffer, outSize) != outSize)
     res = SZ_ERROR_WRITE;
 
 Done:
   MyFree(outBuffer);
   MyFree(inBuffer);
-  MyFree(filteredStream);
+
+  return res;
+}
+
+//
+// Decode a complete LZMA stream, header included, that must expand to exactly
+// outSize bytes.
+//
+static SRes DecodeStream(Byte *outBuffer, size_t outSize, const Byte *inBuffer, size_t inSize)
+{
+  SRes res;
+  size_t outSizeProcessed = outSize;
+  size_t inSizePure;
+  ELzmaStatus status;
+  UInt64 outSize64 = 0;
+  int i;
+
+  if (inSize < LZMA_HEADER_SIZE)
+    return SZ_ERROR_INPUT_EOF;
+
+  for (i = 0; i < 8; i++)
+    outSize64 += ((UInt64)inBuffer[LZMA_PROPS_SIZE + i]) << (i * 8);
+
+  if (outSize64 != outSize)
+    return SZ_ERROR_DATA;
+
+  inSizePure = inSize - LZMA_HEADER_SIZE;
+  res = LzmaDecode(outBuffer, &outSizeProcessed, inBuffer + LZMA_HEADER_SIZE, &inSizePure,
+      inBuffer, LZMA_PROPS_SIZE, LZMA_FINISH_END, &status, &g_Alloc);
+
+  if (res == SZ_OK && outSizeProcessed != outSize)
+    res = SZ_ERROR_DATA;
+
+  return res;
+}
+
+//
+// The blocks of a chunked stream are decoded by several threads, the same
+// way the firmware decodes them on several processors, each block straight
+// into its place in the output buffer.
+//
+typedef struct {
+  const Byte *inBuffer;
+  Byte *outBuffer;
+  size_t *blockOffsets;
+  UInt32 blockSize;
+  UInt32 blockCount;
+  UInt32 totalSize;
+  UInt32 nextBlock;
+  SRes res;
+#ifndef _7ZIP_ST
+  CCriticalSection cs;
+#endif
+} CHUNKED_DECODER;
+
+static void DecodeChunkedBlocks(CHUNKED_DECODER *p)
+{
+  for (;;) {
+    UInt32 block;
+    size_t blockInSize;
+    size_t blockOutSize;
+    SRes res;
+
+#ifndef _7ZIP_ST
+    CriticalSection_Enter(&p->cs);
+#endif
+    block = p->nextBlock;
+    if (p->res == SZ_OK && block < p->blockCount)
+      p->nextBlock++;
+    else
+      block = p->blockCount;
+#ifndef _7ZIP_ST
+    CriticalSection_Leave(&p->cs);
+#endif
+    if (block == p->blockCount)
+      break;
+
+    blockInSize = ReadUInt32(p->inBuffer + LZMA_CHUNKED_HEADER_SIZE + block * sizeof(UInt32));
+    blockOutSize = block == p->blockCount - 1 ? p->totalSize - (size_t)block * p->blockSize : p->blockSize;
+    res = DecodeStream(p->outBuffer + (size_t)block * p->blockSize, blockOutSize,
+        p->inBuffer + p->blockOffsets[block], blockInSize);
+    if (res != SZ_OK) {
+#ifndef _7ZIP_ST
+      CriticalSection_Enter(&p->cs);
+#endif
+      if (p->res == SZ_OK)
+        p->res = res;
+#ifndef _7ZIP_ST
+      CriticalSection_Leave(&p->cs);
+#endif
+    }
+  }
+}
+
+#ifndef _7ZIP_ST
+static THREAD_FUNC_DECL DecodeChunkedThread(void *p)
+{
+  DecodeChunkedBlocks((CHUNKED_DECODER *)p);
+  return 0;
+}
+#endif
+
+//
+// Decode the blocks of a chunked LZMA stream. Every block must decode to
+// exactly its share of the data described by the chunked header.
+//
+static SRes DecodeChunked(ISeqOutStream *outStream, const Byte *inBuffer, size_t inSize)
+{
+  SRes res = SZ_OK;
+  UInt32 block;
+  size_t offset;
+  CHUNKED_DECODER decoder;
+#ifndef _7ZIP_ST
+  CThread *threads = 0;
+  UInt32 numThreads;
+  UInt32 thread;
+#endif
+
+  if (inSize < LZMA_CHUNKED_HEADER_SIZE || ReadUInt32(inBuffer) != LZMA_CHUNKED_SIGNATURE)
+    return SZ_ERROR_DATA;
+
+  decoder.inBuffer = inBuffer;
+  decoder.blockSize = ReadUInt32(inBuffer + 4);
+  decoder.blockCount = ReadUInt32(inBuffer + 8);
+  decoder.totalSize = ReadUInt32(inBuffer + 12);
+  decoder.nextBlock = 0;
+  decoder.res = SZ_OK;
+  if (decoder.blockCount > (inSize - LZMA_CHUNKED_HEADER_SIZE) / sizeof(UInt32) ||
+      (decoder.blockCount == 0) != (decoder.totalSize == 0) ||
+      (decoder.blockCount != 0 && (decoder.blockSize == 0 ||
+       decoder.blockCount != ((UInt64)decoder.totalSize + decoder.blockSize - 1) / decoder.blockSize)))
+    return SZ_ERROR_DATA;
+
+  if (decoder.totalSize == 0)
+    return SZ_OK;
+
+  decoder.outBuffer = (Byte *)MyAlloc(decoder.totalSize);
+  decoder.blockOffsets = (size_t *)MyAlloc((size_t)decoder.blockCount * sizeof(size_t));
+  if (decoder.outBuffer == 0 || decoder.blockOffsets == 0) {
+    res = SZ_ERROR_MEM;
+    goto Done;
+  }
+
+  //
+  // Check that every block lies in the input before any is decoded
+  //
+  offset = LZMA_CHUNKED_HEADER_SIZE + (size_t)decoder.blockCount * sizeof(UInt32);
+  for (block = 0; block < decoder.blockCount; block++) {
+    size_t blockInSize = ReadUInt32(inBuffer + LZMA_CHUNKED_HEADER_SIZE + block * sizeof(UInt32));
+
+    if (blockInSize > inSize - offset) {
+      res = SZ_ERROR_DATA;
+      goto Done;
+    }
+
+    decoder.blockOffsets[block] = offset;
+    offset += blockInSize;
+  }
+
+#ifndef _7ZIP_ST
+  if (CriticalSection_Init(&decoder.cs) != 0) {
+    res = SZ_ERROR_THREAD;
+    goto Done;
+  }
+
+  numThreads = mNumThreads < decoder.blockCount ? mNumThreads : decoder.blockCount;
+  if (numThreads > 1) {
+    threads = (CThread *)MyAlloc((size_t)(numThreads - 1) * sizeof(CThread));
+  }
+  for (thread = 0; threads != 0 && thread < numThreads - 1; thread++) {
+    Thread_Construct(&threads[thread]);
+    if (Thread_Create(&threads[thread], DecodeChunkedThread, &decoder) != 0)
+      break;
+  }
+#endif
+
+  //
+  // This thread decodes blocks too, and alone if no thread could be created
+  //
+  DecodeChunkedBlocks(&decoder);
+
+#ifndef _7ZIP_ST
+  if (threads != 0) {
+    while (thread > 0) {
+      thread--;
+      Thread_Wait(&threads[thread]);
+      Thread_Close(&threads[thread]);
+    }
+    MyFree(threads);
+  }
+  CriticalSection_Delete(&decoder.cs);
+#endif
+
+  res = decoder.res;
+  if (res != SZ_OK)
+    goto Done;
+
+  if (outStream->Write(outStream, decoder.outBuffer, decoder.totalSize) != decoder.totalSize)
+    res = SZ_ERROR_WRITE;
+
+Done:
+  MyFree(decoder.blockOffsets);
+  MyFree(decoder.outBuffer);
 
   return res;
 }
@@ -199,6 +665,11 @@ static SRes Decode(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 file
     goto Done;
   }
 
+  if (mChunked) {
+    res = DecodeChunked(outStream, inBuffer, inSize);
+    goto Done;
+  }
+
   for (i = 0; i < 8; i++)
     outSize64 += ((UInt64)inBuffer[LZMA_PROPS_SIZE + i]) << (i * 8);
 
@@ -272,6 +743,28 @@ int main2(int numArgs, const char *args[], char *rs)
       modeWasSet = True;
     } else if (strcmp(args[param], "--f86") == 0) {
       mConType = X86Converter;
+    } else if (strcmp(args[param], "--chunked") == 0) {
+      mChunked = True;
+    } else if (strcmp(args[param], "--block-size") == 0) {
+      UINT64 blockSize;
+      if (numArgs < (param + 2)) {
+        return PrintUserError(rs);
+      }
+      if (AsciiStringToUint64(args[++param], FALSE, &blockSize) != EFI_SUCCESS ||
+          blockSize == 0 || blockSize > 0x80000000) {
+        return PrintError(rs, kInvalidParamValMessage);
+      }
+      mBlockSize = (UInt32)blockSize;
+    } else if (strcmp(args[param], "--threads") == 0) {
+      UINT64 numThreads;
+      if (numArgs < (param + 2)) {
+        return PrintUserError(rs);
+      }
+      if (AsciiStringToUint64(args[++param], FALSE, &numThreads) != EFI_SUCCESS ||
+          numThreads == 0 || numThreads > 256) {
+        return PrintError(rs, kInvalidParamValMessage);
+      }
+      mNumThreads = (UInt32)numThreads;
     } else if (strcmp(args[param], "-o") == 0 ||
                strcmp(args[param], "--output") == 0) {
       if (numArgs < (param + 2)) {
@@ -342,6 +835,24 @@ int main2(int numArgs, const char *args[], char *rs)
     return PrintUserError(rs);
   }
 
+  //
+  // The decoders of chunked sections do not convert x86 code
+  //
+  if (mChunked && mConType != NoConverter) {
+    return PrintUserError(rs);
+  }
+
+  if (mNumThreads == 0) {
+    mNumThreads = GetNumberOfProcessors();
+  }
+
+  //
+  // A single LZMA stream is encoded with at most two threads, one of them
+  // running the match finder. The multithreaded match finder finds the same
+  // matches as the single threaded one, so the output is the same.
+  //
+  props.numThreads = mNumThreads > 1 ? 2 : 1;
+
   {
     size_t t4 = sizeof(UInt32);
     size_t t8 = sizeof(UInt64);
@@ -32,8 +32,6 @@
 #define CODE_BIT  16
 #define BAD_TABLE - 1
 
-typedef INT32 NODE;
-
 //
 // C: Char&Len Set; P: Position Set; T: exTra Set
 //
@@ -108,51 +106,6 @@ FreeMemory (
   VOID
   );
 
-STATIC
-VOID
-InitSlide (
-  VOID
-  );
-
-STATIC
-NODE
-Child (
-  IN NODE   NodeQ,
-  IN UINT8  CharC
-  );
-
-STATIC
-VOID
-MakeChild (
-  IN NODE  NodeQ,
-  IN UINT8 CharC,
-  IN NODE  NodeR
-  );
-
-STATIC
-VOID
-Split (
-  IN NODE Old
-  );
-
-STATIC
-VOID
-InsertNode (
-  VOID
-  );
-
-STATIC
-VOID
-DeleteNode (
-  VOID
-  );
-
-STATIC
-VOID
-GetNextMatch (
-  VOID
-  );
-
 STATIC
 EFI_STATUS
 Encode (
@@ -216,12 +169,6 @@ HufEncodeEnd (
   VOID
   );
 
-STATIC
-VOID
-MakeCrcTable (
-  VOID
-  );
-
 
 STATIC
 VOID
@@ -230,13 +177,6 @@ PutBits (
   IN UINT32 Value
   );
 
-STATIC
-INT32
-FreadCrc (
-  OUT UINT8 *Pointer,
-  IN  INT32 Number
-  );
-
 STATIC
 VOID
 InitPutBits (
@@ -20,7 +20,10 @@ from Common import GlobalData
 from Common import EdkLogger
 import Common.LongFilePathOs as os
 
-DATABASE_VERSION = 7
+DATABASE_VERSION = 8
+
+## Number of local tokens described by one entry of the SizeIndexTable, see PCD_SIZE_INDEX_TABLE_STRIDE
+SIZE_INDEX_TABLE_STRIDE = 32
 
 gPcdDatabaseAutoGenC = TemplateString("""
 //
@@ -185,10 +188,11 @@ typedef struct {
   //TABLE_OFFSET          SizeTableOffset;
   //TABLE_OFFSET          SkuIdTableOffset;
   //TABLE_OFFSET          PcdNameTableOffset;
+  //TABLE_OFFSET          SizeIndexTableOffset;
   //UINT16                LocalTokenCount;  // LOCAL_TOKEN_NUMBER for all
   //UINT16                ExTokenCount;     // EX_TOKEN_NUMBER for DynamicEx
   //UINT16                GuidTableCount;   // The Number of Guid in GuidTable
-  //UINT8                 Pad[6];
+  //UINT8                 Pad[2];
   ${PHASE}_PCD_DATABASE_INIT    Init;
   ${PHASE}_PCD_DATABASE_UNINIT  Uninit;
 } ${PHASE}_PCD_DATABASE;
@@ -591,6 +595,36 @@ def GetTokenTypeValue(TokenType):
         }
     return eval(TokenType, TokenTypeDict)
 
+## Sort the ExMap table so that the PCD driver can binary search it
+#
+#   @param      ExMapTable  The list of (ExTokenNumber, TokenNumber, ExGuidIndex) entries
+#
+#   @retval     The entries sorted by ExGuidIndex, then by ExTokenNumber
+#
+def GetSortedExMapTable(ExMapTable):
+    return sorted(ExMapTable, key=lambda Item: (GetIntegerValue(Item[2]), GetIntegerValue(Item[0])))
+
+## Get the SizeIndexTable of the PCD database
+#
+#   The SizeTable has a MaxSize and a CurrentSize entry for each VOID* PCD, in
+#   local token order. The SizeIndexTable holds the index in the SizeTable of
+#   every SIZE_INDEX_TABLE_STRIDE local tokens.
+#
+#   @param      TokenTypeList  The token type of each local token
+#
+#   @retval     The SizeIndexTable
+#
+def GetSizeIndexTable(TokenTypeList):
+    SizeIndexTable = []
+    SizeTableIndex = 0
+    for Index, TokenType in enumerate(TokenTypeList):
+        if Index % SIZE_INDEX_TABLE_STRIDE == 0:
+            SizeIndexTable.append(SizeTableIndex)
+        # VOID* PCDs have the PCD_DATUM_TYPE_POINTER (0) datum type
+        if (GetTokenTypeValue(TokenType) & (0xF << 24)) == 0:
+            SizeTableIndex += 2
+    return SizeIndexTable
+
 ## construct the external Pcd database using data from Dict
 #
 #   @param      Dict  A dictionary contains Pcd related tables
@@ -613,6 +647,8 @@ def BuildExDataBase(Dict):
     DbExMapTable = DbExMapTblItemList(8, RawDataList = ExMapTable)
     LocalTokenNumberTable = Dict['LOCAL_TOKEN_NUMBER_DB_VALUE']
     DbLocalTokenNumberTable = DbItemList(4, RawDataList = LocalTokenNumberTable)
+    SizeIndexTable = GetSizeIndexTable(Dict['TOKEN_TYPE'][:len(LocalTokenNumberTable)])
+    DbSizeIndexTable = DbItemList(4, RawDataList = SizeIndexTable)
     GuidTable = Dict['GUID_STRUCTURE']
     DbGuidTable = DbItemList(16, RawDataList = GuidTable)
     StringHeadValue = Dict['STRING_DB_VALUE']
@@ -676,16 +712,16 @@ def BuildExDataBase(Dict):
     PcdTokenNumberMap = Dict['PCD_ORDER_TOKEN_NUMBER_MAP']
 
     DbNameTotle = ["SkuidValue",  "InitValueUint64", "VardefValueUint64", "InitValueUint32", "VardefValueUint32", "VpdHeadValue", "ExMapTable",
-               "LocalTokenNumberTable", "GuidTable", "StringHeadValue",  "PcdNameOffsetTable", "VariableTable", "StringTableLen", "PcdTokenTable", "PcdCNameTable",
+               "LocalTokenNumberTable", "SizeIndexTable", "GuidTable", "StringHeadValue",  "PcdNameOffsetTable", "VariableTable", "StringTableLen", "PcdTokenTable", "PcdCNameTable",
                "SizeTableValue", "InitValueUint16", "VardefValueUint16", "InitValueUint8", "VardefValueUint8", "InitValueBoolean",
                "VardefValueBoolean", "UnInitValueUint64", "UnInitValueUint32", "UnInitValueUint16", "UnInitValueUint8", "UnInitValueBoolean"]
 
     DbTotal = [SkuidValue,  InitValueUint64, VardefValueUint64, InitValueUint32, VardefValueUint32, VpdHeadValue, ExMapTable,
-               LocalTokenNumberTable, GuidTable, StringHeadValue,  PcdNameOffsetTable, VariableTable, StringTableLen, PcdTokenTable, PcdCNameTable,
+               LocalTokenNumberTable, SizeIndexTable, GuidTable, StringHeadValue,  PcdNameOffsetTable, VariableTable, StringTableLen, PcdTokenTable, PcdCNameTable,
                SizeTableValue, InitValueUint16, VardefValueUint16, InitValueUint8, VardefValueUint8, InitValueBoolean,
                VardefValueBoolean, UnInitValueUint64, UnInitValueUint32, UnInitValueUint16, UnInitValueUint8, UnInitValueBoolean]
     DbItemTotal = [DbSkuidValue,  DbInitValueUint64, DbVardefValueUint64, DbInitValueUint32, DbVardefValueUint32, DbVpdHeadValue, DbExMapTable,
-               DbLocalTokenNumberTable, DbGuidTable, DbStringHeadValue,  DbPcdNameOffsetTable, DbVariableTable, DbStringTableLen, DbPcdTokenTable, DbPcdCNameTable,
+               DbLocalTokenNumberTable, DbSizeIndexTable, DbGuidTable, DbStringHeadValue,  DbPcdNameOffsetTable, DbVariableTable, DbStringTableLen, DbPcdTokenTable, DbPcdCNameTable,
                DbSizeTableValue, DbInitValueUint16, DbVardefValueUint16, DbInitValueUint8, DbVardefValueUint8, DbInitValueBoolean,
                DbVardefValueBoolean, DbUnInitValueUint64, DbUnInitValueUint32, DbUnInitValueUint16, DbUnInitValueUint8, DbUnInitValueBoolean]
 
@@ -759,6 +795,8 @@ def BuildExDataBase(Dict):
             LocalTokenNumberTableOffset = DbTotalLength
         elif DbItemTotal[DbIndex] is DbExMapTable:
             ExMapTableOffset = DbTotalLength
+        elif DbItemTotal[DbIndex] is DbSizeIndexTable:
+            SizeIndexTableOffset = DbTotalLength
         elif DbItemTotal[DbIndex] is DbGuidTable:
             GuidTableOffset = DbTotalLength
         elif DbItemTotal[DbIndex] is DbStringTableLen:
@@ -826,6 +864,9 @@ def BuildExDataBase(Dict):
     Buffer += b
     b = pack('=L', DbPcdNameOffset)
 
+    Buffer += b
+    b = pack('=L', SizeIndexTableOffset)
+
     Buffer += b
     b = pack('=H', LocalTokenCount)
 
@@ -839,10 +880,6 @@ def BuildExDataBase(Dict):
     b = pack('=B', Pad)
     Buffer += b
     Buffer += b
-    Buffer += b
-    Buffer += b
-    Buffer += b
-    Buffer += b
 
     Index = 0
     for Item in DbItemTotal:
@@ -1550,6 +1587,10 @@ def CreatePcdDatabasePhaseSpecificAutoGen (Platform, DynamicPcdList, Phase):
         Dict['EXMAP_TABLE_EMPTY']    = 'FALSE'
         Dict['EXMAPPING_TABLE_SIZE'] = str(NumberOfExTokens) + 'U'
         Dict['EX_TOKEN_NUMBER']      = str(NumberOfExTokens) + 'U'
+        ExMapTable = GetSortedExMapTable(zip(Dict['EXMAPPING_TABLE_EXTOKEN'], Dict['EXMAPPING_TABLE_LOCAL_TOKEN'], Dict['EXMAPPING_TABLE_GUID_INDEX']))
+        Dict['EXMAPPING_TABLE_EXTOKEN']     = [Item[0] for Item in ExMapTable]
+        Dict['EXMAPPING_TABLE_LOCAL_TOKEN'] = [Item[1] for Item in ExMapTable]
+        Dict['EXMAPPING_TABLE_GUID_INDEX']  = [Item[2] for Item in ExMapTable]
     else:
         Dict['EXMAPPING_TABLE_EXTOKEN'].append('0U')
         Dict['EXMAPPING_TABLE_LOCAL_TOKEN'].append('0U')
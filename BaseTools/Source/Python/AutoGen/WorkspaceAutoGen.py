@@ -899,6 +899,8 @@ class WorkspaceAutoGen(AutoGen):
             FdsCommandDict["quiet"] = True
 
         FdsCommandDict["GenfdsMultiThread"] = GlobalData.gEnableGenfdsMultiThread
+        if GlobalData.gFdsIncremental:
+            FdsCommandDict["FdsIncremental"] = True
         if GlobalData.gIgnoreSource:
             FdsCommandDict["IgnoreSources"] = True
 
@@ -94,6 +94,10 @@ def resetFdsGlobalVariable():
     GenFdsGlobalVariable.CopyList   = []
     GenFdsGlobalVariable.ModuleFile = ''
     GenFdsGlobalVariable.EnableGenfdsMultiThread = True
+    GenFdsGlobalVariable.FdsIncremental = False
+    GenFdsGlobalVariable.IncrementalHashDict = {}
+    GenFdsGlobalVariable.IncrementalReusedList = []
+    GenFdsGlobalVariable.FileDigestDict = {}
 
     GenFdsGlobalVariable.LargeFileInFvFlags = []
     GenFdsGlobalVariable.EFI_FIRMWARE_FILE_SYSTEM3_GUID = '5473C07A-3DCB-4dca-BD6F-1E9689E7349A'
@@ -119,6 +123,9 @@ def GenFdsApi(FdsCommandDict, WorkSpaceDataBase=None):
         if FdsCommandDict.get("FixedAddress"):
             GenFdsGlobalVariable.FixedLoadAddress = True
 
+        if FdsCommandDict.get("FdsIncremental"):
+            GenFdsGlobalVariable.FdsIncremental = True
+
         if FdsCommandDict.get("quiet"):
             EdkLogger.SetLevel(EdkLogger.QUIET)
         if FdsCommandDict.get("debug"):
@@ -370,6 +377,10 @@ def GenFdsApi(FdsCommandDict, WorkSpaceDataBase=None):
         """Call GenFds"""
         GenFds.GenFd('', FdfParserObj, BuildWorkSpace, ArchList)
 
+        """Record the inputs of the images generated for the next incremental build"""
+        if GenFdsGlobalVariable.FdsIncremental:
+            GenFdsGlobalVariable.UpdateIncrementalHash()
+
         """Generate GUID cross reference file"""
         GenFds.GenerateGuidXRefFile(BuildWorkSpace, ArchList, FdfParserObj)
 
@@ -407,6 +418,7 @@ def OptionsToCommandDict(Options):
     FdsCommandDict["debug"] = Options.debug
     FdsCommandDict["Workspace"] = Options.Workspace
     FdsCommandDict["GenfdsMultiThread"] = not Options.NoGenfdsMultiThread
+    FdsCommandDict["FdsIncremental"] = Options.FdsIncremental
     FdsCommandDict["fdf_file"] = [PathClass(Options.filename)] if Options.filename else []
     FdsCommandDict["build_target"] = Options.BuildTarget
     FdsCommandDict["toolchain_tag"] = Options.ToolChain
@@ -465,6 +477,7 @@ def myOptionParser():
     Parser.add_option("--pcd", action="append", dest="OptionPcd", help="Set PCD value by command line. Format: \"PcdName=Value\" ")
     Parser.add_option("--genfds-multi-thread", action="store_true", dest="GenfdsMultiThread", default=True, help="Enable GenFds multi thread to generate ffs file.")
     Parser.add_option("--no-genfds-multi-thread", action="store_true", dest="NoGenfdsMultiThread", default=False, help="Disable GenFds multi thread to generate ffs file.")
+    Parser.add_option("--fds-incremental", action="store_true", dest="FdsIncremental", default=False, help="Generate again only the images whose input content changed, and report them.")
 
     Options, _ = Parser.parse_args()
     return Options
@@ -14,6 +14,7 @@ from __future__ import absolute_import
 
 import Common.LongFilePathOs as os
 import sys
+import hashlib
 from sys import stdout
 from subprocess import PIPE,Popen
 from struct import Struct
@@ -33,6 +34,7 @@ from Common.MultipleWorkspace import MultipleWorkspace as mws
 import Common.GlobalData as GlobalData
 from Common.BuildToolError import *
 from AutoGen.AutoGen import CalculatePriorityValue
+from . import ImageBuilder
 
 ## Global variables
 #
@@ -74,6 +76,18 @@ class GenFdsGlobalVariable:
     ModuleFile = ''
     EnableGenfdsMultiThread = True
 
+    #
+    # With --fds-incremental, an image is generated again only when the content
+    # of its inputs or its command changed. The digest of the inputs of each
+    # image is kept in a .hash file next to the image.
+    # IncrementalHashDict holds the digests of the images generated in this run,
+    # IncrementalReusedList the images that were kept.
+    #
+    FdsIncremental = False
+    IncrementalHashDict = {}
+    IncrementalReusedList = []
+    FileDigestDict = {}
+
     #
     # The list whose element are flags to indicate if large FFS or SECTION files exist in FV.
     # At the beginning of each generation of FV, false flag is appended to the list,
@@ -406,18 +420,28 @@ class GenFdsGlobalVariable:
     #
     #   @param  Output          Path of output file
     #   @param  Input           Path list of input files
+    #   @param  Cmd             The command generating the output
+    #   @param  HashInput       Path list of the inputs only checked by content
     #
     #   @retval True            if Output doesn't exist, or any Input is newer
     #   @retval False           if all Input is older than Output
     #
+    #   With --fds-incremental, the content of the inputs and the command are
+    #   checked instead of the time stamps, see NeedsUpdateByHash()
+    #
     @staticmethod
-    def NeedsUpdate(Output, Input):
+    def NeedsUpdate(Output, Input, Cmd=None, HashInput=[]):
         if not os.path.exists(Output):
+            if GenFdsGlobalVariable.FdsIncremental:
+                GenFdsGlobalVariable.NeedsUpdateByHash(Output, Input, Cmd, HashInput)
             return True
         # always update "Output" if no "Input" given
         if not Input:
             return True
 
+        if GenFdsGlobalVariable.FdsIncremental:
+            return GenFdsGlobalVariable.NeedsUpdateByHash(Output, Input, Cmd, HashInput)
+
         # if fdf file is changed after the 'Output" is generated, update the 'Output'
         OutputTime = os.path.getmtime(Output)
         if GenFdsGlobalVariable.FdfFileTimeStamp > OutputTime:
@@ -432,6 +456,85 @@ class GenFdsGlobalVariable:
                 return True
         return False
 
+    ## Get the digest of the content of a file
+    #
+    #   @param  File            Path of the file
+    #
+    #   @retval string          The MD5 digest of the file
+    #   @retval None            if the file doesn't exist
+    #
+    @staticmethod
+    def GetFileDigest(File):
+        if not os.path.isfile(File):
+            return None
+        Key = (File, os.path.getmtime(File), os.path.getsize(File))
+        if Key not in GenFdsGlobalVariable.FileDigestDict:
+            with open(File, 'rb') as Fd:
+                GenFdsGlobalVariable.FileDigestDict[Key] = hashlib.md5(Fd.read()).hexdigest()
+        return GenFdsGlobalVariable.FileDigestDict[Key]
+
+    ## Check if the content of the input files or the command changed since the output was generated
+    #
+    #   The images generated again are recorded, their digests are written by
+    #   UpdateIncrementalHash() once all the images are generated.
+    #
+    #   @param  Output          Path of output file
+    #   @param  Input           Path list of input files
+    #   @param  Cmd             The command generating the output, the FDF file is
+    #                           used instead when it is not given
+    #   @param  HashInput       Path list of the other input files
+    #
+    #   @retval True            if Output must be generated again
+    #   @retval False           if Output is generated from the same inputs and command
+    #
+    @staticmethod
+    def NeedsUpdateByHash(Output, Input, Cmd=None, HashInput=[]):
+        if Cmd is None:
+            Cmd = [GenFdsGlobalVariable.FdfFile, str(GenFdsGlobalVariable.GetFileDigest(GenFdsGlobalVariable.FdfFile))]
+        Digest = hashlib.md5(' '.join(Cmd).encode('utf-8'))
+        for F in list(Input) + list(HashInput):
+            FileDigest = GenFdsGlobalVariable.GetFileDigest(F)
+            if FileDigest is None:
+                Digest = None
+                break
+            Digest.update(('\n%s %s' % (F, FileDigest)).encode('utf-8'))
+        if Digest is not None:
+            Digest = Digest.hexdigest()
+
+        HashFile = Output + '.hash'
+        if Digest is not None and os.path.exists(Output):
+            if Output in GenFdsGlobalVariable.IncrementalHashDict:
+                if GenFdsGlobalVariable.IncrementalHashDict[Output] == Digest:
+                    return False
+            elif os.path.exists(HashFile):
+                with open(HashFile, 'r') as Fd:
+                    if Fd.read() == Digest:
+                        GenFdsGlobalVariable.IncrementalReusedList.append(Output)
+                        return False
+
+        #
+        # The digest of the previous output is removed before the output is
+        # generated, so that it is not reused if the generation fails
+        #
+        if os.path.exists(HashFile):
+            os.remove(HashFile)
+        GenFdsGlobalVariable.IncrementalHashDict[Output] = Digest
+        return True
+
+    ## Write the digests of the inputs of the images generated in this run, and report them
+    #
+    @staticmethod
+    def UpdateIncrementalHash():
+        for Output, Digest in GenFdsGlobalVariable.IncrementalHashDict.items():
+            if Digest is not None and os.path.exists(Output):
+                SaveFileOnChange(Output + '.hash', Digest, False)
+
+        Reused = set(GenFdsGlobalVariable.IncrementalReusedList) - set(GenFdsGlobalVariable.IncrementalHashDict)
+        GenFdsGlobalVariable.InfLogger("\nGenFds incremental: %d image(s) generated, %d image(s) reused" %
+                                       (len(GenFdsGlobalVariable.IncrementalHashDict), len(Reused)))
+        for Output in sorted(GenFdsGlobalVariable.IncrementalHashDict):
+            GenFdsGlobalVariable.InfLogger("  Generated %s" % Output)
+
     @staticmethod
     def GenerateSection(Output, Input, Type=None, CompressionType=None, Guid=None,
                         GuidHdrLen=None, GuidAttr=[], Ui=None, Ver=None, InputAlign=[], BuildNumber=None, DummyFile=None, IsMakefile=False):
@@ -470,23 +573,7 @@ class GenFdsGlobalVariable:
                 SectionData.append(0)
                 Len = len(SectionData)
                 GenFdsGlobalVariable.SectionHeader.pack_into(SectionData, 0, Len & 0xff, (Len >> 8) & 0xff, (Len >> 16) & 0xff, 0x15)
-
-
-                DirName = os.path.dirname(Output)
-                if not CreateDirectory(DirName):
-                    EdkLogger.error(None, FILE_CREATE_FAILURE, "Could not create directory %s" % DirName)
-                else:
-                    if DirName == '':
-                        DirName = os.getcwd()
-                    if not os.access(DirName, os.W_OK):
-                        EdkLogger.error(None, PERMISSION_FAILURE, "Do not have write permission on directory %s" % DirName)
-
-                try:
-                    with open(Output, "wb") as Fd:
-                        SectionData.tofile(Fd)
-                        Fd.flush()
-                except IOError as X:
-                    EdkLogger.error(None, FILE_CREATE_FAILURE, ExtraData='IOError %s' % X)
+                GenFdsGlobalVariable.WriteImage(Output, SectionData.tobytes())
 
         elif Ver:
             Cmd += ("-n", Ver)
@@ -499,9 +586,13 @@ class GenFdsGlobalVariable:
                 if ' '.join(Cmd).strip() not in GenFdsGlobalVariable.SecCmdList:
                     GenFdsGlobalVariable.SecCmdList.append(' '.join(Cmd).strip())
             else:
-                if not GenFdsGlobalVariable.NeedsUpdate(Output, list(Input) + [CommandFile]):
+                if not GenFdsGlobalVariable.NeedsUpdate(Output, list(Input) + [CommandFile], Cmd):
                     return
-                GenFdsGlobalVariable.CallExternalTool(Cmd, "Failed to generate section")
+                SectionData = ImageBuilder.GetVersionSection(Ver, BuildNumber)
+                if SectionData is not None:
+                    GenFdsGlobalVariable.WriteImage(Output, SectionData)
+                else:
+                    GenFdsGlobalVariable.CallExternalTool(Cmd, "Failed to generate section")
         else:
             Cmd += ("-o", Output)
             Cmd += Input
@@ -514,9 +605,19 @@ class GenFdsGlobalVariable:
                     Cmd = ['-test', '-e', Input[0], "&&"] + Cmd
                 if ' '.join(Cmd).strip() not in GenFdsGlobalVariable.SecCmdList:
                     GenFdsGlobalVariable.SecCmdList.append(' '.join(Cmd).strip())
-            elif GenFdsGlobalVariable.NeedsUpdate(Output, list(Input) + [CommandFile]):
+            elif GenFdsGlobalVariable.NeedsUpdate(Output, list(Input) + [CommandFile], Cmd):
                 GenFdsGlobalVariable.DebugLogger(EdkLogger.DEBUG_5, "%s needs update because of newer %s" % (Output, Input))
-                GenFdsGlobalVariable.CallExternalTool(Cmd, "Failed to generate section")
+                #
+                # A leaf section is a section header followed by the input file,
+                # it is built without launching GenSec
+                #
+                SectionData = None
+                if not (CompressionType or Guid or DummyFile or GuidHdrLen or GuidAttr or InputAlign):
+                    SectionData = ImageBuilder.GetLeafSection(Type, Input)
+                if SectionData is not None:
+                    GenFdsGlobalVariable.WriteImage(Output, SectionData)
+                else:
+                    GenFdsGlobalVariable.CallExternalTool(Cmd, "Failed to generate section")
                 if (os.path.getsize(Output) >= GenFdsGlobalVariable.LARGE_FILE_SIZE and
                     GenFdsGlobalVariable.LargeFileInFvFlags):
                     GenFdsGlobalVariable.LargeFileInFvFlags[-1] = True
@@ -570,17 +671,40 @@ class GenFdsGlobalVariable:
             GenFdsGlobalVariable.SecCmdList = []
             GenFdsGlobalVariable.CopyList = []
         else:
-            if not GenFdsGlobalVariable.NeedsUpdate(Output, list(Input) + [CommandFile]):
+            if not GenFdsGlobalVariable.NeedsUpdate(Output, list(Input) + [CommandFile], Cmd):
                 return
-            GenFdsGlobalVariable.CallExternalTool(Cmd, "Failed to generate FFS")
+            FfsData = ImageBuilder.GetFfsFile(Input, Type, Guid, Fixed, CheckSum, Align, SectionAlign)
+            if FfsData is not None:
+                GenFdsGlobalVariable.WriteImage(Output, FfsData)
+            else:
+                GenFdsGlobalVariable.CallExternalTool(Cmd, "Failed to generate FFS")
+
+    ## Write an image built in process
+    #
+    #   @param  Output      The output file name
+    #   @param  Data        The image
+    #
+    @staticmethod
+    def WriteImage(Output, Data):
+        DirName = os.path.dirname(Output)
+        if not CreateDirectory(DirName):
+            EdkLogger.error(None, FILE_CREATE_FAILURE, "Could not create directory %s" % DirName)
+        else:
+            if DirName == '':
+                DirName = os.getcwd()
+            if not os.access(DirName, os.W_OK):
+                EdkLogger.error(None, PERMISSION_FAILURE, "Do not have write permission on directory %s" % DirName)
+
+        try:
+            with open(Output, "wb") as Fd:
+                Fd.write(Data)
+                Fd.flush()
+        except IOError as X:
+            EdkLogger.error(None, FILE_CREATE_FAILURE, ExtraData='IOError %s' % X)
 
     @staticmethod
     def GenerateFirmwareVolume(Output, Input, BaseAddress=None, ForceRebase=None, Capsule=False, Dump=False,
                                AddressFile=None, MapFile=None, FfsList=[], FileSystemGuid=None):
-        if not GenFdsGlobalVariable.NeedsUpdate(Output, Input+FfsList):
-            return
-        GenFdsGlobalVariable.DebugLogger(EdkLogger.DEBUG_5, "%s needs update because of newer %s" % (Output, Input))
-
         Cmd = ["GenFv"]
         if BaseAddress:
             Cmd += ("-r", BaseAddress)
@@ -604,16 +728,16 @@ class GenFdsGlobalVariable:
         for I in Input:
             Cmd += ("-i", I)
 
+        if not GenFdsGlobalVariable.NeedsUpdate(Output, Input+FfsList, Cmd, [AddressFile] if AddressFile else []):
+            return
+        GenFdsGlobalVariable.DebugLogger(EdkLogger.DEBUG_5, "%s needs update because of newer %s" % (Output, Input))
+
         GenFdsGlobalVariable.CallExternalTool(Cmd, "Failed to generate FV")
 
     @staticmethod
     def GenerateFirmwareImage(Output, Input, Type="efi", SubType=None, Zero=False,
                               Strip=False, Replace=False, TimeStamp=None, Join=False,
                               Align=None, Padding=None, Convert=False, IsMakefile=False):
-        if not GenFdsGlobalVariable.NeedsUpdate(Output, Input) and not IsMakefile:
-            return
-        GenFdsGlobalVariable.DebugLogger(EdkLogger.DEBUG_5, "%s needs update because of newer %s" % (Output, Input))
-
         Cmd = ["GenFw"]
         if Type.lower() == "te":
             Cmd.append("-t")
@@ -637,6 +761,10 @@ class GenFdsGlobalVariable:
             Cmd.append("-m")
         Cmd += ("-o", Output)
         Cmd += Input
+        if not IsMakefile and not GenFdsGlobalVariable.NeedsUpdate(Output, Input, Cmd):
+            return
+        GenFdsGlobalVariable.DebugLogger(EdkLogger.DEBUG_5, "%s needs update because of newer %s" % (Output, Input))
+
         if IsMakefile:
             if " ".join(Cmd).strip() not in GenFdsGlobalVariable.SecCmdList:
                 GenFdsGlobalVariable.SecCmdList.append(" ".join(Cmd).strip())
@@ -665,11 +793,6 @@ class GenFdsGlobalVariable:
                 Cmd.append(BinFile)
                 InputList.append (BinFile)
 
-        # Check List
-        if not GenFdsGlobalVariable.NeedsUpdate(Output, InputList) and not IsMakefile:
-            return
-        GenFdsGlobalVariable.DebugLogger(EdkLogger.DEBUG_5, "%s needs update because of newer %s" % (Output, InputList))
-
         if ClassCode:
             Cmd += ("-l", ClassCode)
         if Revision:
@@ -680,6 +803,12 @@ class GenFdsGlobalVariable:
             Cmd += ("-f", VendorId)
 
         Cmd += ("-o", Output)
+
+        # Check List
+        if not IsMakefile and not GenFdsGlobalVariable.NeedsUpdate(Output, InputList, Cmd):
+            return
+        GenFdsGlobalVariable.DebugLogger(EdkLogger.DEBUG_5, "%s needs update because of newer %s" % (Output, InputList))
+
         if IsMakefile:
             if " ".join(Cmd).strip() not in GenFdsGlobalVariable.SecCmdList:
                 GenFdsGlobalVariable.SecCmdList.append(" ".join(Cmd).strip())
@@ -688,14 +817,14 @@ class GenFdsGlobalVariable:
 
     @staticmethod
     def GuidTool(Output, Input, ToolPath, Options='', returnValue=[], IsMakefile=False):
-        if not GenFdsGlobalVariable.NeedsUpdate(Output, Input) and not IsMakefile:
-            return
-        GenFdsGlobalVariable.DebugLogger(EdkLogger.DEBUG_5, "%s needs update because of newer %s" % (Output, Input))
-
         Cmd = [ToolPath, ]
         Cmd += Options.split(' ')
         Cmd += ("-o", Output)
         Cmd += Input
+        if not IsMakefile and not GenFdsGlobalVariable.NeedsUpdate(Output, Input, Cmd):
+            return
+        GenFdsGlobalVariable.DebugLogger(EdkLogger.DEBUG_5, "%s needs update because of newer %s" % (Output, Input))
+
         if IsMakefile:
             if " ".join(Cmd).strip() not in GenFdsGlobalVariable.SecCmdList:
                 GenFdsGlobalVariable.SecCmdList.append(" ".join(Cmd).strip())
@@ -13,8 +13,12 @@ import os
 import sys
 import unittest
 
+import CheckImageBuilder
+import CheckLzmaCompress
 import TianoCompress
 modules = (
+    CheckImageBuilder,
+    CheckLzmaCompress,
     TianoCompress,
     )
 
@@ -0,0 +1,107 @@
+## @file
+#  Unit tests for the content hash based incremental image generation of GenFds
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+from __future__ import print_function
+import os
+import time
+import unittest
+
+import TestTools
+
+from GenFds.GenFdsGlobalVariable import GenFdsGlobalVariable
+
+from Common import EdkLogger
+EdkLogger.InitializeForUnitTest()
+
+class Tests(TestTools.BaseToolsTest):
+
+    ModuleCount = 50
+    FileGuid = '3e1e2a4b-6d7c-4a5f-9b8e-1f2d3c4b5a%02x'
+
+    def setUp(self):
+        TestTools.BaseToolsTest.setUp(self)
+        GenFdsGlobalVariable.FdsIncremental = True
+        self.StartRun()
+
+    def tearDown(self):
+        GenFdsGlobalVariable.FdsIncremental = False
+        self.StartRun()
+        TestTools.BaseToolsTest.tearDown(self)
+
+    def StartRun(self):
+        GenFdsGlobalVariable.IncrementalHashDict = {}
+        GenFdsGlobalVariable.IncrementalReusedList = []
+        GenFdsGlobalVariable.FileDigestDict = {}
+
+    def Touch(self, FileName):
+        #
+        # Make the file newer than every output, without changing its content
+        #
+        Time = time.time() + 10
+        os.utime(FileName, (Time, Time))
+
+    def GenerateFfsFiles(self):
+        #
+        # One PE32 section and one FFS file per module
+        #
+        for Index in range(self.ModuleCount):
+            Efi = self.GetTmpFilePath('module%d.efi' % Index)
+            Section = self.GetTmpFilePath('module%d.pe32' % Index)
+            Ffs = self.GetTmpFilePath('module%d.ffs' % Index)
+            GenFdsGlobalVariable.GenerateSection(Section, [Efi], 'EFI_SECTION_PE32')
+            GenFdsGlobalVariable.GenerateFfs(Ffs, [Section], 'EFI_FV_FILETYPE_DRIVER', self.FileGuid % Index)
+        GenFdsGlobalVariable.UpdateIncrementalHash()
+        Generated = sorted(GenFdsGlobalVariable.IncrementalHashDict)
+        self.StartRun()
+        return Generated
+
+    def testIncrementalGeneration(self):
+        for Index in range(self.ModuleCount):
+            self.WriteTmpFile('module%d.efi' % Index, bytes([Index]) * 0x1000)
+        self.assertEqual(len(self.GenerateFfsFiles()), self.ModuleCount * 2)
+        self.assertEqual(self.GenerateFfsFiles(), [])
+
+        #
+        # Rebuilding the modules with the same result does not generate any image
+        #
+        for Index in range(self.ModuleCount):
+            self.Touch(self.GetTmpFilePath('module%d.efi' % Index))
+        self.assertEqual(self.GenerateFfsFiles(), [])
+
+        #
+        # Changing one module generates its section and its FFS file only
+        #
+        self.WriteTmpFile('module7.efi', b'\xff' * 0x1000)
+        self.assertEqual(self.GenerateFfsFiles(), [self.GetTmpFilePath('module7.ffs'), self.GetTmpFilePath('module7.pe32')])
+        with self.OpenTmpFile('module7.ffs', 'rb') as File:
+            self.assertTrue(File.read().endswith(b'\xff' * 0x1000))
+
+        #
+        # A removed image or digest is generated again
+        #
+        os.remove(self.GetTmpFilePath('module3.ffs'))
+        os.remove(self.GetTmpFilePath('module4.pe32.hash'))
+        self.assertEqual(self.GenerateFfsFiles(), [self.GetTmpFilePath('module3.ffs'), self.GetTmpFilePath('module4.pe32')])
+
+    def testCommandChange(self):
+        self.WriteTmpFile('input', b'\0' * 0x100)
+        Input = [self.GetTmpFilePath('input')]
+        Output = self.GetTmpFilePath('output')
+        self.assertTrue(GenFdsGlobalVariable.NeedsUpdate(Output, Input, ['GenSec', '-s', 'EFI_SECTION_RAW']))
+        self.WriteTmpFile('output', b'')
+        GenFdsGlobalVariable.UpdateIncrementalHash()
+        self.StartRun()
+        self.assertFalse(GenFdsGlobalVariable.NeedsUpdate(Output, Input, ['GenSec', '-s', 'EFI_SECTION_RAW']))
+        self.assertTrue(GenFdsGlobalVariable.NeedsUpdate(Output, Input, ['GenSec', '-s', 'EFI_SECTION_PE32']))
+
+TheTestSuite = TestTools.MakeTheTestSuite(locals())
+
+if __name__ == '__main__':
+    allTests = TheTestSuite()
+    unittest.TextTestRunner().run(allTests)
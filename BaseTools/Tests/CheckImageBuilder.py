@@ -0,0 +1,110 @@
+## @file
+#  Unit tests for the sections and FFS files built in process by GenFds.ImageBuilder
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+import random
+import struct
+import unittest
+
+import TestTools
+
+import GenFds.ImageBuilder as ImageBuilder
+
+class Tests(TestTools.BaseToolsTest):
+
+    FileGuid = '3e1e2a4b-6d7c-4a5f-9b8e-1f2d3c4b5a69'
+
+    def setUp(self):
+        TestTools.BaseToolsTest.setUp(self)
+        self.Random = random.Random(0x22)
+
+    def GetRandomData(self, Length):
+        return bytes(self.Random.getrandbits(8) for Index in range(Length))
+
+    def WriteSection(self, FileName, Type, Data):
+        Length = len(Data) + 4
+        if Length < 0x1000000:
+            Header = struct.pack('<3BB', Length & 0xff, (Length >> 8) & 0xff, Length >> 16, Type)
+        else:
+            Header = struct.pack('<3BBL', 0xff, 0xff, 0xff, Type, Length + 4)
+        self.WriteTmpFile(FileName, Header + Data)
+        return self.GetTmpFilePath(FileName)
+
+    def GetTeImage(self, StrippedSize, Length):
+        return struct.pack('<HHBBH', 0x5A56, 0x8664, 1, 0x0B, StrippedSize) + bytes(32) + self.GetRandomData(Length)
+
+    def ReadImage(self, FileName):
+        with self.OpenTmpFile(FileName, 'rb') as File:
+            return File.read()
+
+    def CheckSection(self, Type, Data):
+        Input = self.GetTmpFilePath('input')
+        self.WriteTmpFile('input', Data)
+        self.assertEqual(self.RunTool('-s', Type, '-o', self.GetTmpFilePath('output'), Input, toolName='GenSec'), 0)
+        self.assertEqual(ImageBuilder.GetLeafSection(Type, [Input]), self.ReadImage('output'))
+
+    def CheckFfsFile(self, Input, Type, Fixed=False, CheckSum=False, Align=None, SectionAlign=None):
+        Args = ['-t', Type, '-g', self.FileGuid, '-o', self.GetTmpFilePath('output')]
+        if Fixed:
+            Args.append('-x')
+        if CheckSum:
+            Args.append('-s')
+        if Align:
+            Args += ('-a', Align)
+        for Index, FileName in enumerate(Input):
+            Args += ('-i', FileName)
+            if SectionAlign and SectionAlign[Index]:
+                Args += ('-n', SectionAlign[Index])
+        self.assertEqual(self.RunTool(*Args, toolName='GenFfs'), 0)
+        self.assertEqual(ImageBuilder.GetFfsFile(Input, Type, self.FileGuid, Fixed, CheckSum, Align, SectionAlign), self.ReadImage('output'))
+
+    def testLeafSections(self):
+        for Type in ('EFI_SECTION_PE32', 'EFI_SECTION_TE', 'EFI_SECTION_RAW', 'EFI_SECTION_PEI_DEPEX',
+                     'EFI_SECTION_DXE_DEPEX', 'EFI_SECTION_FIRMWARE_VOLUME_IMAGE'):
+            self.CheckSection(Type, self.GetRandomData(self.Random.randint(1, 0x3000)))
+        self.CheckSection('EFI_SECTION_RAW', b'')
+        self.CheckSection('EFI_SECTION_RAW', self.GetRandomData(0x100) * 0x10000)
+        self.assertIsNone(ImageBuilder.GetLeafSection('EFI_SECTION_COMPRESSION', [self.GetTmpFilePath('input')]))
+
+    def testVersionSection(self):
+        for (Version, BuildNumber) in (('1.0', None), ('"Version 2.1-beta"', '12'), ('""', '65535')):
+            Args = ['-s', 'EFI_SECTION_VERSION', '-n', Version.strip('"'), '-o', self.GetTmpFilePath('output')]
+            if BuildNumber:
+                Args += ('-j', BuildNumber)
+            self.assertEqual(self.RunTool(*Args, toolName='GenSec'), 0)
+            self.assertEqual(ImageBuilder.GetVersionSection(Version, BuildNumber), self.ReadImage('output'))
+        self.assertIsNone(ImageBuilder.GetVersionSection('"$(VERSION)"'))
+        self.assertIsNone(ImageBuilder.GetVersionSection('1.0', '-1'))
+
+    def testFfsFiles(self):
+        Pe32 = self.WriteSection('pe32', 0x10, self.GetRandomData(0x1234))
+        Te = self.WriteSection('te', 0x12, self.GetTeImage(0x1C8, 0x2345))
+        Ui = self.WriteSection('ui', 0x15, 'Driver'.encode('utf-16-le') + b'\0\0')
+        Depex = self.WriteSection('depex', 0x1B, self.GetRandomData(0x11))
+        Raw = self.WriteSection('raw', 0x19, self.GetRandomData(0x333))
+        Guided = self.WriteSection('guided', 0x02, struct.pack('<16sHH', bytes(range(16)), 0x1C, 0) + bytes(4) + self.GetRandomData(0x777))
+
+        self.CheckFfsFile([Pe32, Ui], 'EFI_FV_FILETYPE_DRIVER')
+        self.CheckFfsFile([Depex, Pe32, Ui], 'EFI_FV_FILETYPE_DRIVER', CheckSum=True, SectionAlign=[None, '4K', None])
+        self.CheckFfsFile([Depex, Te, Ui], 'EFI_FV_FILETYPE_PEIM', SectionAlign=[None, '32', None])
+        self.CheckFfsFile([Te], 'EFI_FV_FILETYPE_PEI_CORE', Fixed=True, Align='4K', SectionAlign=['4K'])
+        self.CheckFfsFile([Ui, Te], 'EFI_FV_FILETYPE_SECURITY_CORE', Fixed=True, SectionAlign=[None, '64K'])
+        self.CheckFfsFile([Raw], 'EFI_FV_FILETYPE_FREEFORM', Align='1M', SectionAlign=['128'])
+        self.CheckFfsFile([Raw, Raw], 'EFI_FV_FILETYPE_RAW', Align='2')
+        self.CheckFfsFile([Depex, Guided, Ui], 'EFI_FV_FILETYPE_DRIVER', SectionAlign=[None, '1K', None])
+        self.CheckFfsFile([self.WriteSection('large', 0x19, self.GetRandomData(0x100) * 0x10000)], 'EFI_FV_FILETYPE_FREEFORM')
+
+        self.assertIsNone(ImageBuilder.GetFfsFile([Ui], 'EFI_FV_FILETYPE_DRIVER', self.FileGuid))
+        self.assertIsNone(ImageBuilder.GetFfsFile([Pe32, Te], 'EFI_FV_FILETYPE_DXE_CORE', self.FileGuid))
+        self.assertIsNone(ImageBuilder.GetFfsFile([Pe32], 'EFI_FV_FILETYPE_DRIVER', self.FileGuid, SectionAlign=['0']))
+
+TheTestSuite = TestTools.MakeTheTestSuite(locals())
+
+if __name__ == '__main__':
+    allTests = TheTestSuite()
+    unittest.TextTestRunner().run(allTests)
@@ -0,0 +1,65 @@
+## @file
+#  Unit tests for the multithreaded encoder of LzmaCompress
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+import random
+import unittest
+
+import TestTools
+
+class Tests(TestTools.BaseToolsTest):
+
+    def setUp(self):
+        TestTools.BaseToolsTest.setUp(self)
+        self.toolName = 'LzmaCompress'
+        #
+        # FV like input: code like random blocks, repeated blocks and padding
+        #
+        Random = random.Random(0x24)
+        Blocks = [bytes(Random.getrandbits(8) for Index in range(0x1000)) for Index in range(16)]
+        Data = b''
+        while len(Data) < 0x300000:
+            Data += Random.choice(Blocks)[:Random.randint(0x100, 0x1000)]
+            Data += b'\xff' * Random.randint(0, 0x800)
+        self.WriteTmpFile('input', Data)
+
+    def ReadImage(self, FileName):
+        with self.OpenTmpFile(FileName, 'rb') as File:
+            return File.read()
+
+    def Encode(self, Output, *Args):
+        self.assertEqual(self.RunTool('-e', '-q', '-o', self.GetTmpFilePath(Output), self.GetTmpFilePath('input'), *Args), 0)
+
+    def CheckRoundTrip(self, Input, *Args):
+        self.assertEqual(self.RunTool('-d', '-q', '-o', self.GetTmpFilePath('decoded'), self.GetTmpFilePath(Input), *Args), 0)
+        self.assertEqual(self.ReadImage('decoded'), self.ReadImage('input'))
+
+    def CheckThreads(self, *Args):
+        #
+        # The image does not depend on the number of threads
+        #
+        for Threads in (1, 2, 4):
+            self.Encode('output%d' % Threads, '--threads', str(Threads), *Args)
+        self.assertEqual(self.ReadImage('output1'), self.ReadImage('output2'))
+        self.assertEqual(self.ReadImage('output1'), self.ReadImage('output4'))
+        self.CheckRoundTrip('output4', *Args)
+
+    def testSingleStream(self):
+        self.CheckThreads()
+
+    def testChunked(self):
+        self.CheckThreads('--chunked')
+
+    def testInvalidThreads(self):
+        self.assertNotEqual(self.RunTool('-e', '--threads', '0', '-o', self.GetTmpFilePath('output'), self.GetTmpFilePath('input')), 0)
+
+TheTestSuite = TestTools.MakeTheTestSuite(locals())
+
+if __name__ == '__main__':
+    allTests = TheTestSuite()
+    unittest.TextTestRunner().run(allTests)
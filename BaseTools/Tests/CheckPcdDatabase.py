@@ -0,0 +1,80 @@
+## @file
+#  Unit tests for the PCD database tables generated by AutoGen.GenPcdDb
+#
+#  SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+##
+# Import Modules
+#
+import bisect
+import random
+import unittest
+
+import TestTools
+
+import AutoGen.GenPcdDb as GenPcdDb
+
+from Common import EdkLogger
+EdkLogger.InitializeForUnitTest()
+
+class Tests(TestTools.BaseToolsTest):
+
+    PcdCount = 5000
+    GuidCount = 40
+
+    def setUp(self):
+        TestTools.BaseToolsTest.setUp(self)
+        #
+        # Synthetic PCD database, one PCD in eight is a VOID* PCD and every
+        # PCD is a DynamicEx PCD with a random token number
+        #
+        Random = random.Random(self.PcdCount)
+        self.TokenTypeList = []
+        self.ExMapTable = []
+        for Index in range(self.PcdCount):
+            if Index % 8 == 0:
+                self.TokenTypeList.append('PCD_TYPE_STRING | PCD_DATUM_TYPE_POINTER')
+            else:
+                self.TokenTypeList.append('PCD_TYPE_DATA | PCD_DATUM_TYPE_UINT32')
+            self.ExMapTable.append((
+                '0x%08xU' % Random.randrange(0x100000000),
+                '%dU' % (Index + 1),
+                '%dU' % Random.randrange(self.GuidCount)
+                ))
+
+    def GetKeys(self, ExMapTable):
+        return [(GenPcdDb.GetIntegerValue(GuidIndex), GenPcdDb.GetIntegerValue(ExToken)) for (ExToken, Token, GuidIndex) in ExMapTable]
+
+    def testSortedExMapTable(self):
+        Sorted = GenPcdDb.GetSortedExMapTable(self.ExMapTable)
+        self.assertEqual(sorted(Sorted), sorted(self.ExMapTable))
+        Keys = self.GetKeys(Sorted)
+        self.assertEqual(Keys, sorted(Keys))
+
+    def testSizeIndexTable(self):
+        SizeIndexTable = GenPcdDb.GetSizeIndexTable(self.TokenTypeList)
+        self.assertEqual(len(SizeIndexTable), (self.PcdCount + GenPcdDb.SIZE_INDEX_TABLE_STRIDE - 1) // GenPcdDb.SIZE_INDEX_TABLE_STRIDE)
+        SizeTableIndex = 0
+        for Index, TokenType in enumerate(self.TokenTypeList):
+            if Index % GenPcdDb.SIZE_INDEX_TABLE_STRIDE == 0:
+                self.assertEqual(SizeIndexTable[Index // GenPcdDb.SIZE_INDEX_TABLE_STRIDE], SizeTableIndex)
+            if 'PCD_DATUM_TYPE_POINTER' in TokenType:
+                SizeTableIndex += 2
+
+    def testExMapLookup(self):
+        #
+        # The binary search of the PCD drivers finds the token of every PCD
+        #
+        Sorted = GenPcdDb.GetSortedExMapTable(self.ExMapTable)
+        SortedKeys = self.GetKeys(Sorted)
+        for Key, (ExToken, Token, GuidIndex) in zip(self.GetKeys(self.ExMapTable), self.ExMapTable):
+            Index = bisect.bisect_left(SortedKeys, Key)
+            self.assertEqual(SortedKeys[Index], Key)
+            self.assertEqual(Sorted[Index][1], Token)
+
+TheTestSuite = TestTools.MakeTheTestSuite(locals())
+
+if __name__ == '__main__':
+    allTests = TheTestSuite()
+    unittest.TextTestRunner().run(allTests)
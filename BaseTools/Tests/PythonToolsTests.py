@@ -20,6 +20,10 @@ def TheTestSuite():
     suites.append(CheckPythonSyntax.TheTestSuite())
     import CheckUnicodeSourceFiles
     suites.append(CheckUnicodeSourceFiles.TheTestSuite())
+    import CheckPcdDatabase
+    suites.append(CheckPcdDatabase.TheTestSuite())
+    import CheckGenFdsIncremental
+    suites.append(CheckGenFdsIncremental.TheTestSuite())
     return unittest.TestSuite(suites)
 
 if __name__ == '__main__':
@@ -17,6 +17,8 @@ import unittest
 
 import TestTools
 
+Modes = ([], ['--fast'], ['--optimal'], ['--uefi'], ['--uefi', '--fast'], ['--uefi', '--optimal'])
+
 class Tests(TestTools.BaseToolsTest):
 
     def setUp(self):
@@ -60,6 +62,43 @@ class Tests(TestTools.BaseToolsTest):
             self.compressionTestCycle(data)
             self.CleanUpTmpDir()
 
+    def getCorpus(self, size):
+        #
+        # The C tools are a corpus of the code and data of firmware images
+        #
+        data = b''
+        binDir = os.path.join(TestTools.CSourceDir, 'bin')
+        for fileName in sorted(os.listdir(binDir)):
+            with open(os.path.join(binDir, fileName), 'rb') as f:
+                data += f.read(size - len(data))
+            if len(data) == size:
+                break
+        return data
+
+    def compress(self, mode):
+        result = self.RunTool(*(['-e'] + mode + ['-o', self.GetTmpFilePath('output1'), self.GetTmpFilePath('input')]))
+        self.assertTrue(result == 0)
+
+    def testModeCycles(self):
+        self.WriteTmpFile('input', self.getCorpus(0x40000))
+        for mode in Modes:
+            self.compress(mode)
+            result = self.RunTool(*(['-d'] + mode + ['-o', self.GetTmpFilePath('output2'), self.GetTmpFilePath('output1')]))
+            self.assertTrue(result == 0)
+            with self.OpenTmpFile('input', 'rb') as start, self.OpenTmpFile('output2', 'rb') as finish:
+                self.assertTrue(start.read() == finish.read())
+
+    def testDefaultSize(self):
+        #
+        # The default parse must not compress worse than the fast one
+        #
+        self.WriteTmpFile('input', self.getCorpus(0x40000))
+        for mode in ([], ['--uefi']):
+            self.compress(mode)
+            size = os.path.getsize(self.GetTmpFilePath('output1'))
+            self.compress(mode + ['--fast'])
+            self.assertTrue(size <= os.path.getsize(self.GetTmpFilePath('output1')))
+
 TheTestSuite = TestTools.MakeTheTestSuite(locals())
 
 if __name__ == '__main__':
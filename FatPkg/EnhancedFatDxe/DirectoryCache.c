@@ -37,9 +37,41 @@ FatFreeODir (
     FatFreeDirEnt (DirEnt);
   }
 
+  FreePool (ODir->LongNameHashTable);
   FreePool (ODir);
 }
 
+/**
+
+  Compute the memory used by the directory structure.
+
+  @param  ODir                  - The directory.
+
+  @return The size in bytes of the directory structure, its hash tables and its directory entries.
+
+**/
+STATIC
+UINTN
+FatODirSize (
+  IN FAT_ODIR  *ODir
+  )
+{
+  FAT_DIRENT  *DirEnt;
+  LIST_ENTRY  *Link;
+  UINTN       Size;
+
+  Size = sizeof (FAT_ODIR) + 2 * ODir->HashTableSize * sizeof (FAT_DIRENT *);
+  for (Link = ODir->ChildList.ForwardLink; Link != &ODir->ChildList; Link = Link->ForwardLink) {
+    DirEnt = DIRENT_FROM_LINK (Link);
+    Size  += sizeof (FAT_DIRENT);
+    if (DirEnt->FileString != NULL) {
+      Size += StrSize (DirEnt->FileString);
+    }
+  }
+
+  return Size;
+}
+
 /**
 
   Allocate the directory structure.
@@ -63,6 +95,17 @@ FatAllocateODir (
     ODir->Signature = FAT_ODIR_SIGNATURE;
     InitializeListHead (&ODir->ChildList);
     ODir->CurrentCursor = &ODir->ChildList;
+    //
+    // The long name and short name hash tables share one allocation
+    //
+    ODir->LongNameHashTable = AllocateZeroPool (2 * HASH_TABLE_MIN_SIZE * sizeof (FAT_DIRENT *));
+    if (ODir->LongNameHashTable == NULL) {
+      FreePool (ODir);
+      return NULL;
+    }
+
+    ODir->ShortNameHashTable = ODir->LongNameHashTable + HASH_TABLE_MIN_SIZE;
+    ODir->HashTableSize      = HASH_TABLE_MIN_SIZE;
   }
 
   return ODir;
@@ -72,6 +115,9 @@ FatAllocateODir (
 
   Discard the directory structure when an OFile will be freed.
   Volume will cache this directory if the OFile does not represent a deleted file.
+  The least recently used directories are released when the directory cache
+  uses more than FAT_MAX_DIR_CACHE_SIZE bytes, large directories do not push
+  all the others out of the cache unless they have to.
 
   @param  OFile                 - The OFile whose directory structure is to be discarded.
 
@@ -91,29 +137,30 @@ FatDiscardODir (
     // If OFile does not represent a deleted file, then we will cache the directory
     // We use OFile's first cluster as the directory's tag
     //
-    ODir->DirCacheTag = OFile->FileCluster;
+    ODir->DirCacheTag  = OFile->FileCluster;
+    ODir->DirCacheSize = FatODirSize (ODir);
     InsertHeadList (&Volume->DirCacheList, &ODir->DirCacheLink);
-    if (Volume->DirCacheCount == FAT_MAX_DIR_CACHE_COUNT) {
-      //
-      // Replace the least recent used directory
-      //
+    Volume->DirCacheCount++;
+    Volume->DirCacheSize += ODir->DirCacheSize;
+    //
+    // Replace the least recent used directories, but keep the one just cached
+    //
+    while ((Volume->DirCacheSize > FAT_MAX_DIR_CACHE_SIZE) && (Volume->DirCacheCount > 1)) {
       ODir = ODIR_FROM_DIRCACHELINK (Volume->DirCacheList.BackLink);
       RemoveEntryList (&ODir->DirCacheLink);
-    } else {
-      //
-      // No need to find a replace
-      //
-      Volume->DirCacheCount++;
-      ODir = NULL;
+      Volume->DirCacheCount--;
+      Volume->DirCacheSize -= ODir->DirCacheSize;
+      Volume->DirEvictCount++;
+      FatFreeODir (ODir);
     }
+
+    return;
   }
 
   //
   // Release ODir Structure
   //
-  if (ODir != NULL) {
-    FatFreeODir (ODir);
-  }
+  FatFreeODir (ODir);
 }
 
 /**
@@ -149,7 +196,8 @@ FatRequestODir (
     if (CurrentODir->DirCacheTag == DirCacheTag) {
       RemoveEntryList (&CurrentODir->DirCacheLink);
       Volume->DirCacheCount--;
-      ODir = CurrentODir;
+      Volume->DirCacheSize -= CurrentODir->DirCacheSize;
+      ODir                  = CurrentODir;
       break;
     }
   }
@@ -158,6 +206,7 @@ FatRequestODir (
     //
     // This directory is not cached, then allocate a new one
     //
+    Volume->DirLoadCount++;
     ODir = FatAllocateODir (OFile);
   }
 
@@ -178,9 +227,17 @@ FatCleanupODirCache (
 {
   FAT_ODIR  *ODir;
 
+  DEBUG ((
+    DEBUG_INFO,
+    "FAT: directory cache %Lu loads, %Lu evictions\n",
+    (UINT64)Volume->DirLoadCount,
+    (UINT64)Volume->DirEvictCount
+    ));
+
   while (Volume->DirCacheCount > 0) {
     ODir = ODIR_FROM_DIRCACHELINK (Volume->DirCacheList.BackLink);
     RemoveEntryList (&ODir->DirCacheLink);
+    Volume->DirCacheSize -= ODir->DirCacheSize;
     FatFreeODir (ODir);
     Volume->DirCacheCount--;
   }
@@ -8,6 +8,128 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "Fat.h"
 
+/**
+
+  Get the address of the cache page of a cache group.
+
+  @param  DiskCache             - The disk cache.
+  @param  CacheTag              - The Cache Tag of the group.
+
+  @return The address of the cache page.
+
+**/
+STATIC
+UINT8 *
+FatGetCachePageAddress (
+  IN DISK_CACHE  *DiskCache,
+  IN CACHE_TAG   *CacheTag
+  )
+{
+  return DiskCache->CacheBase + ((UINTN)(CacheTag - DiskCache->CacheTag) << DiskCache->PageAlignment);
+}
+
+/**
+
+  Find the cache group of a page, or the group to load it in.
+
+  If the page is not cached, the group is an empty group of the set of the page,
+  or the least recently used one.
+
+  @param  DiskCache             - The disk cache.
+  @param  PageNo                - The page to find.
+
+  @return The Cache Tag of the group.
+
+**/
+STATIC
+CACHE_TAG *
+FatSelectCacheTag (
+  IN DISK_CACHE  *DiskCache,
+  IN UINTN       PageNo
+  )
+{
+  UINTN      GroupNo;
+  CACHE_TAG  *CacheTag;
+  CACHE_TAG  *Victim;
+
+  Victim = NULL;
+  for (GroupNo = PageNo & DiskCache->SetMask; GroupNo < DiskCache->GroupCount; GroupNo += DiskCache->SetMask + 1) {
+    CacheTag = &DiskCache->CacheTag[GroupNo];
+    if (CacheTag->RealSize == 0) {
+      if ((Victim == NULL) || (Victim->RealSize > 0)) {
+        Victim = CacheTag;
+      }
+    } else if (CacheTag->PageNo == PageNo) {
+      return CacheTag;
+    } else if ((Victim == NULL) || ((Victim->RealSize > 0) && (CacheTag->LastUse < Victim->LastUse))) {
+      Victim = CacheTag;
+    }
+  }
+
+  return Victim;
+}
+
+/**
+
+  Find the cache group that holds a page.
+
+  @param  DiskCache             - The disk cache.
+  @param  PageNo                - The page to find.
+
+  @return The Cache Tag of the group, or NULL if the page is not cached.
+
+**/
+STATIC
+CACHE_TAG *
+FatFindCacheTag (
+  IN DISK_CACHE  *DiskCache,
+  IN UINTN       PageNo
+  )
+{
+  CACHE_TAG  *CacheTag;
+
+  CacheTag = FatSelectCacheTag (DiskCache, PageNo);
+  if ((CacheTag->RealSize > 0) && (CacheTag->PageNo == PageNo)) {
+    return CacheTag;
+  }
+
+  return NULL;
+}
+
+/**
+
+  Wait for the non-blocking read ahead of the data cache to complete.
+
+  The groups of the read ahead hold their pages, but must not be used or reloaded
+  until the read is complete.
+
+  @param  DiskCache             - The data cache.
+
+**/
+STATIC
+VOID
+FatWaitCachePages (
+  IN DISK_CACHE  *DiskCache
+  )
+{
+  UINTN  Index;
+
+  if (DiskCache->PendingCount == 0) {
+    return;
+  }
+
+  while (gBS->CheckEvent (DiskCache->PendingToken.Event) == EFI_NOT_READY) {
+  }
+
+  if (EFI_ERROR (DiskCache->PendingToken.TransactionStatus)) {
+    for (Index = 0; Index < DiskCache->PendingCount; Index++) {
+      DiskCache->CacheTag[DiskCache->PendingGroupNo + Index].RealSize = 0;
+    }
+  }
+
+  DiskCache->PendingCount = 0;
+}
+
 /**
 
   This function is used by the Data Cache.
@@ -38,24 +160,22 @@ FatFlushDataCacheRange (
   )
 {
   UINTN       PageNo;
-  UINTN       GroupNo;
-  UINTN       GroupMask;
   UINTN       PageSize;
   UINT8       PageAlignment;
   DISK_CACHE  *DiskCache;
   CACHE_TAG   *CacheTag;
-  UINT8       *BaseAddress;
 
   DiskCache     = &Volume->DiskCache[CacheData];
-  BaseAddress   = DiskCache->CacheBase;
-  GroupMask     = DiskCache->GroupMask;
   PageAlignment = DiskCache->PageAlignment;
   PageSize      = (UINTN)1 << PageAlignment;
 
+  if (IoMode != ReadDisk) {
+    FatWaitCachePages (DiskCache);
+  }
+
   for (PageNo = StartPageNo; PageNo < EndPageNo; PageNo++) {
-    GroupNo  = PageNo & GroupMask;
-    CacheTag = &DiskCache->CacheTag[GroupNo];
-    if ((CacheTag->RealSize > 0) && (CacheTag->PageNo == PageNo)) {
+    CacheTag = FatFindCacheTag (DiskCache, PageNo);
+    if (CacheTag != NULL) {
       //
       // When reading data form disk directly, if some dirty data
       // in cache is in this rang, this data in the Buffer need to
@@ -65,7 +185,7 @@ FatFlushDataCacheRange (
         if (CacheTag->Dirty) {
           CopyMem (
             Buffer + ((PageNo - StartPageNo) << PageAlignment),
-            BaseAddress + (GroupNo << PageAlignment),
+            FatGetCachePageAddress (DiskCache, CacheTag),
             PageSize
             );
         }
@@ -104,7 +224,6 @@ FatExchangeCachePage (
   )
 {
   EFI_STATUS  Status;
-  UINTN       GroupNo;
   UINTN       PageNo;
   UINTN       WriteCount;
   UINTN       RealSize;
@@ -116,9 +235,8 @@ FatExchangeCachePage (
 
   DiskCache     = &Volume->DiskCache[DataType];
   PageNo        = CacheTag->PageNo;
-  GroupNo       = PageNo & DiskCache->GroupMask;
   PageAlignment = DiskCache->PageAlignment;
-  PageAddress   = DiskCache->CacheBase + (GroupNo << PageAlignment);
+  PageAddress   = FatGetCachePageAddress (DiskCache, CacheTag);
   EntryPos      = DiskCache->BaseAddress + LShiftU64 (PageNo, PageAlignment);
   RealSize      = CacheTag->RealSize;
   if (IoMode == ReadDisk) {
@@ -152,12 +270,162 @@ FatExchangeCachePage (
   return EFI_SUCCESS;
 }
 
+/**
+
+  Write the dirty data cache pages in the range back to the disk.
+
+  A non-blocking read of the disk completes after the data cache is checked, so
+  the dirty data of this range must be on the disk before the read is submitted.
+
+  @param  Volume                - FAT file system volume.
+  @param  StartPageNo           - First PageNo to be checked in the cache.
+  @param  EndPageNo             - Last PageNo to be checked in the cache.
+
+  @retval EFI_SUCCESS           - The dirty pages were written successfully.
+  @return Others                - An error occurred when writing the pages.
+
+**/
+STATIC
+EFI_STATUS
+FatStoreDataCacheRange (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       StartPageNo,
+  IN UINTN       EndPageNo
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       PageNo;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *CacheTag;
+
+  DiskCache = &Volume->DiskCache[CacheData];
+  for (PageNo = StartPageNo; PageNo < EndPageNo; PageNo++) {
+    CacheTag = FatFindCacheTag (DiskCache, PageNo);
+    if ((CacheTag != NULL) && CacheTag->Dirty) {
+      Status = FatExchangeCachePage (Volume, CacheData, WriteDisk, CacheTag, NULL);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Load the data cache page PageNo and the pages following it.
+
+  The pages are read into the consecutive groups of the way of CacheTag, up to the
+  last group of the way, and up to the first group that holds a dirty page or a page
+  that is already cached. The first page is read at once; when the disk supports
+  DiskIo2, the following pages are read with a non-blocking read that is waited for
+  when one of their groups is used.
+
+  @param  Volume                - FAT file system volume.
+  @param  PageNo                - The first page to read.
+  @param  CacheTag              - The Cache Tag of the group to load PageNo in.
+
+  @retval EFI_SUCCESS           - The page PageNo was read successfully.
+  @retval EFI_UNSUPPORTED       - Less than two pages can be read.
+  @return Others                - An error occurred when reading the pages.
+
+**/
+STATIC
+EFI_STATUS
+FatReadAheadCachePages (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       PageNo,
+  IN CACHE_TAG   *CacheTag
+  )
+{
+  EFI_STATUS  Status;
+  DISK_CACHE  *DiskCache;
+  UINTN       GroupNo;
+  UINTN       PageCount;
+  UINTN       ReadCount;
+  UINTN       PageSize;
+  UINTN       Index;
+  UINT64      EntryPos;
+  UINT8       *Address;
+  UINT8       PageAlignment;
+
+  DiskCache     = &Volume->DiskCache[CacheData];
+  GroupNo       = (UINTN)(CacheTag - DiskCache->CacheTag);
+  PageAlignment = DiskCache->PageAlignment;
+  PageSize      = (UINTN)1 << PageAlignment;
+  EntryPos      = DiskCache->BaseAddress + LShiftU64 (PageNo, PageAlignment);
+
+  FatWaitCachePages (DiskCache);
+  for (PageCount = 1; PageCount < FAT_DATACACHE_READ_AHEAD_COUNT; PageCount++) {
+    if (((GroupNo + PageCount) & DiskCache->SetMask) == 0) {
+      break;
+    }
+
+    CacheTag = &DiskCache->CacheTag[GroupNo + PageCount];
+    if (((CacheTag->RealSize > 0) && CacheTag->Dirty) || (FatFindCacheTag (DiskCache, PageNo + PageCount) != NULL)) {
+      break;
+    }
+  }
+
+  //
+  // Only whole pages are read ahead
+  //
+  while ((PageCount > 0) && (EntryPos + LShiftU64 (PageCount, PageAlignment) > DiskCache->LimitAddress)) {
+    PageCount--;
+  }
+
+  if (PageCount < 2) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Address = FatGetCachePageAddress (DiskCache, &DiskCache->CacheTag[GroupNo]);
+  if ((Volume->DiskIo2 == NULL) || (DiskCache->PendingToken.Event == NULL)) {
+    Status    = FatDiskIo (Volume, ReadDisk, EntryPos, PageCount << PageAlignment, Address, NULL);
+    ReadCount = PageCount;
+  } else {
+    Status    = FatDiskIo (Volume, ReadDisk, EntryPos, PageSize, Address, NULL);
+    ReadCount = 1;
+    if (!EFI_ERROR (Status) &&
+        !EFI_ERROR (
+           Volume->DiskIo2->ReadDiskEx (
+                              Volume->DiskIo2,
+                              Volume->MediaId,
+                              EntryPos + PageSize,
+                              &DiskCache->PendingToken,
+                              (PageCount - 1) << PageAlignment,
+                              Address + PageSize
+                              )
+           ))
+    {
+      DiskCache->PendingGroupNo = GroupNo + 1;
+      DiskCache->PendingCount   = PageCount - 1;
+      ReadCount                 = PageCount;
+    }
+  }
+
+  for (Index = 0; Index < PageCount; Index++) {
+    CacheTag           = &DiskCache->CacheTag[GroupNo + Index];
+    CacheTag->PageNo   = PageNo + Index;
+    CacheTag->RealSize = (EFI_ERROR (Status) || (Index >= ReadCount)) ? 0 : PageSize;
+    CacheTag->Dirty    = FALSE;
+    CacheTag->LastUse  = DiskCache->AccessCount;
+  }
+
+  if (!EFI_ERROR (Status)) {
+    DiskCache->ReadAheadCount += ReadCount - 1;
+  }
+
+  return Status;
+}
+
 /**
 
   Get one cache page by specified PageNo.
 
   @param  Volume                - FAT file system volume.
   @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
+  @param  IoMode                - Indicate whether the page is read or written.
   @param  PageNo                - PageNo to match with the cache.
   @param  CacheTag              - The Cache Tag for the current cache page.
 
@@ -170,21 +438,38 @@ EFI_STATUS
 FatGetCachePage (
   IN FAT_VOLUME       *Volume,
   IN CACHE_DATA_TYPE  CacheDataType,
+  IN IO_MODE          IoMode,
   IN UINTN            PageNo,
   IN CACHE_TAG        *CacheTag
   )
 {
   EFI_STATUS  Status;
   UINTN       OldPageNo;
+  UINTN       GroupNo;
+  DISK_CACHE  *DiskCache;
+  BOOLEAN     Sequential;
+
+  DiskCache             = &Volume->DiskCache[CacheDataType];
+  Sequential            = (BOOLEAN)(PageNo == DiskCache->LastPageNo + 1);
+  DiskCache->LastPageNo = PageNo;
+  DiskCache->AccessCount++;
+
+  GroupNo = (UINTN)(CacheTag - DiskCache->CacheTag);
+  if ((GroupNo >= DiskCache->PendingGroupNo) && (GroupNo < DiskCache->PendingGroupNo + DiskCache->PendingCount)) {
+    FatWaitCachePages (DiskCache);
+  }
 
   OldPageNo = CacheTag->PageNo;
   if ((CacheTag->RealSize > 0) && (OldPageNo == PageNo)) {
     //
     // Cache Hit occurred
     //
+    CacheTag->LastUse = DiskCache->AccessCount;
     return EFI_SUCCESS;
   }
 
+  DiskCache->MissCount++;
+
   //
   // Write dirty cache page back to disk
   //
@@ -195,11 +480,22 @@ FatGetCachePage (
     }
   }
 
+  //
+  // The file data is read sequentially, load the next pages as well
+  //
+  if ((CacheDataType == CacheData) && (IoMode == ReadDisk) && Sequential) {
+    Status = FatReadAheadCachePages (Volume, PageNo, CacheTag);
+    if (Status != EFI_UNSUPPORTED) {
+      return Status;
+    }
+  }
+
   //
   // Load new data from disk;
   //
-  CacheTag->PageNo = PageNo;
-  Status           = FatExchangeCachePage (Volume, CacheDataType, ReadDisk, CacheTag, NULL);
+  CacheTag->PageNo  = PageNo;
+  CacheTag->LastUse = DiskCache->AccessCount;
+  Status            = FatExchangeCachePage (Volume, CacheDataType, ReadDisk, CacheTag, NULL);
 
   return Status;
 }
@@ -216,6 +512,7 @@ FatGetCachePage (
   @param  Offset                - The starting byte of cache page.
   @param  Length                - The number of bytes that is read or written
   @param  Buffer                - Buffer containing cache data.
+  @param  Task                    point to task instance.
 
   @retval EFI_SUCCESS           - The data was accessed correctly.
   @return Others                - An error occurred when accessing unaligned cache page.
@@ -230,7 +527,8 @@ FatAccessUnalignedCachePage (
   IN     UINTN            PageNo,
   IN     UINTN            Offset,
   IN     UINTN            Length,
-  IN OUT VOID             *Buffer
+  IN OUT VOID             *Buffer,
+  IN     FAT_TASK         *Task
   )
 {
   EFI_STATUS  Status;
@@ -238,14 +536,30 @@ FatAccessUnalignedCachePage (
   VOID        *Destination;
   DISK_CACHE  *DiskCache;
   CACHE_TAG   *CacheTag;
-  UINTN       GroupNo;
 
   DiskCache = &Volume->DiskCache[CacheDataType];
-  GroupNo   = PageNo & DiskCache->GroupMask;
-  CacheTag  = &DiskCache->CacheTag[GroupNo];
-  Status    = FatGetCachePage (Volume, CacheDataType, PageNo, CacheTag);
+  CacheTag  = FatSelectCacheTag (DiskCache, PageNo);
+
+  //
+  // A non-blocking read of a page that is not cached does not wait for the page,
+  // the data is read from the disk into the buffer with the other non-blocking reads.
+  //
+  if ((Task != NULL) && (CacheDataType == CacheData) && (IoMode == ReadDisk) &&
+      ((CacheTag->RealSize == 0) || (CacheTag->PageNo != PageNo)))
+  {
+    return FatDiskIo (
+             Volume,
+             ReadDisk,
+             DiskCache->BaseAddress + LShiftU64 (PageNo, DiskCache->PageAlignment) + Offset,
+             Length,
+             Buffer,
+             Task
+             );
+  }
+
+  Status = FatGetCachePage (Volume, CacheDataType, IoMode, PageNo, CacheTag);
   if (!EFI_ERROR (Status)) {
-    Source      = DiskCache->CacheBase + (GroupNo << DiskCache->PageAlignment) + Offset;
+    Source      = FatGetCachePageAddress (DiskCache, CacheTag) + Offset;
     Destination = Buffer;
     if (IoMode != ReadDisk) {
       CacheTag->Dirty  = TRUE;
@@ -329,7 +643,7 @@ FatAccessCache (
       Length = BufferSize;
     }
 
-    Status = FatAccessUnalignedCachePage (Volume, CacheDataType, IoMode, PageNo, UnderRun, Length, Buffer);
+    Status = FatAccessUnalignedCachePage (Volume, CacheDataType, IoMode, PageNo, UnderRun, Length, Buffer, Task);
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -350,6 +664,13 @@ FatAccessCache (
     //
     ASSERT (CacheDataType == CacheData);
 
+    if ((Task != NULL) && (IoMode == ReadDisk)) {
+      Status = FatStoreDataCacheRange (Volume, PageNo, OverRunPageNo);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+
     EntryPos    = Volume->RootPos + LShiftU64 (PageNo, PageAlignment);
     AlignedSize = AlignedPageCount << PageAlignment;
     Status      = FatDiskIo (Volume, IoMode, EntryPos, AlignedSize, Buffer, Task);
@@ -374,7 +695,7 @@ FatAccessCache (
     //
     // Last read is not a complete page
     //
-    Status = FatAccessUnalignedCachePage (Volume, CacheDataType, IoMode, OverRunPageNo, 0, OverRun, Buffer);
+    Status = FatAccessUnalignedCachePage (Volume, CacheDataType, IoMode, OverRunPageNo, 0, OverRun, Buffer, Task);
   }
 
   return Status;
@@ -400,7 +721,6 @@ FatVolumeFlushCache (
   EFI_STATUS       Status;
   CACHE_DATA_TYPE  CacheDataType;
   UINTN            GroupIndex;
-  UINTN            GroupMask;
   DISK_CACHE       *DiskCache;
   CACHE_TAG        *CacheTag;
 
@@ -410,8 +730,7 @@ FatVolumeFlushCache (
       //
       // Data cache or fat cache is dirty, write the dirty data back
       //
-      GroupMask = DiskCache->GroupMask;
-      for (GroupIndex = 0; GroupIndex <= GroupMask; GroupIndex++) {
+      for (GroupIndex = 0; GroupIndex < DiskCache->GroupCount; GroupIndex++) {
         CacheTag = &DiskCache->CacheTag[GroupIndex];
         if ((CacheTag->RealSize > 0) && CacheTag->Dirty) {
           //
@@ -435,6 +754,68 @@ FatVolumeFlushCache (
   return Status;
 }
 
+/**
+
+  Get the size of the free memory from the memory map.
+
+  @return The size of the conventional memory that is not allocated, or 0 if the
+          memory map cannot be read.
+
+**/
+STATIC
+UINT64
+FatGetFreeMemorySize (
+  VOID
+  )
+{
+  EFI_STATUS             Status;
+  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
+  EFI_MEMORY_DESCRIPTOR  *Entry;
+  UINTN                  MemoryMapSize;
+  UINTN                  MapKey;
+  UINTN                  DescriptorSize;
+  UINT32                 DescriptorVersion;
+  UINT64                 FreeMemorySize;
+
+  MemoryMap     = NULL;
+  MemoryMapSize = 0;
+  Status        = gBS->GetMemoryMap (&MemoryMapSize, MemoryMap, &MapKey, &DescriptorSize, &DescriptorVersion);
+  while (Status == EFI_BUFFER_TOO_SMALL) {
+    if (MemoryMap != NULL) {
+      FreePool (MemoryMap);
+    }
+
+    //
+    // The allocation of the buffer can split a descriptor of the memory map
+    //
+    MemoryMapSize += 2 * DescriptorSize;
+    MemoryMap      = AllocatePool (MemoryMapSize);
+    if (MemoryMap == NULL) {
+      return 0;
+    }
+
+    Status = gBS->GetMemoryMap (&MemoryMapSize, MemoryMap, &MapKey, &DescriptorSize, &DescriptorVersion);
+  }
+
+  FreeMemorySize = 0;
+  if (!EFI_ERROR (Status)) {
+    for (Entry = MemoryMap;
+         (UINT8 *)Entry < (UINT8 *)MemoryMap + MemoryMapSize;
+         Entry = NEXT_MEMORY_DESCRIPTOR (Entry, DescriptorSize))
+    {
+      if (Entry->Type == EfiConventionalMemory) {
+        FreeMemorySize += EFI_PAGES_TO_SIZE (Entry->NumberOfPages);
+      }
+    }
+  }
+
+  if (MemoryMap != NULL) {
+    FreePool (MemoryMap);
+  }
+
+  return FreeMemorySize;
+}
+
 /**
 
   Initialize the disk cache according to Volume's FatType.
@@ -452,14 +833,18 @@ FatInitializeDiskCache (
 {
   DISK_CACHE  *DiskCache;
   UINTN       FatCacheGroupCount;
+  UINTN       DataCacheGroupCount;
   UINTN       DataCacheSize;
   UINTN       FatCacheSize;
+  UINT64      FreeMemorySize;
   UINT8       *CacheBuffer;
+  EFI_STATUS  Status;
 
   DiskCache = Volume->DiskCache;
   //
   // Configure the parameters of disk cache
   //
+  DataCacheGroupCount = FAT_DATACACHE_GROUP_MIN_COUNT;
   if (Volume->FatType == Fat12) {
     FatCacheGroupCount                 = FAT_FATCACHE_GROUP_MIN_COUNT;
     DiskCache[CacheFat].PageAlignment  = FAT_FATCACHE_PAGE_MIN_ALIGNMENT;
@@ -468,26 +853,92 @@ FatInitializeDiskCache (
     FatCacheGroupCount                 = FAT_FATCACHE_GROUP_MAX_COUNT;
     DiskCache[CacheFat].PageAlignment  = FAT_FATCACHE_PAGE_MAX_ALIGNMENT;
     DiskCache[CacheData].PageAlignment = FAT_DATACACHE_PAGE_MAX_ALIGNMENT;
+
+    //
+    // Larger volumes get a larger data cache, if the memory is not short
+    //
+    FreeMemorySize = FatGetFreeMemorySize ();
+    while ((DataCacheGroupCount < FAT_DATACACHE_GROUP_MAX_COUNT) &&
+           (LShiftU64 (DataCacheGroupCount * 2, DiskCache[CacheData].PageAlignment + FAT_DATACACHE_VOLUME_SHIFT) <= Volume->VolumeSize) &&
+           (LShiftU64 (DataCacheGroupCount * 2, DiskCache[CacheData].PageAlignment + FAT_DATACACHE_MEMORY_SHIFT) <= FreeMemorySize))
+    {
+      DataCacheGroupCount *= 2;
+    }
   }
 
-  DiskCache[CacheData].GroupMask    = FAT_DATACACHE_GROUP_COUNT - 1;
-  DiskCache[CacheData].BaseAddress  = Volume->RootPos;
-  DiskCache[CacheData].LimitAddress = Volume->VolumeSize;
-  DiskCache[CacheFat].GroupMask     = FatCacheGroupCount - 1;
-  DiskCache[CacheFat].BaseAddress   = Volume->FatPos;
-  DiskCache[CacheFat].LimitAddress  = Volume->FatPos + Volume->FatSize;
-  FatCacheSize                      = FatCacheGroupCount << DiskCache[CacheFat].PageAlignment;
-  DataCacheSize                     = FAT_DATACACHE_GROUP_COUNT << DiskCache[CacheData].PageAlignment;
+  FatCacheSize = FatCacheGroupCount << DiskCache[CacheFat].PageAlignment;
   //
-  // Allocate the Fat Cache buffer
+  // Allocate the Fat Cache buffer, with a smaller data cache if the memory is short
   //
-  CacheBuffer = AllocateZeroPool (FatCacheSize + DataCacheSize);
+  do {
+    DataCacheSize = DataCacheGroupCount << DiskCache[CacheData].PageAlignment;
+    CacheBuffer   = AllocateZeroPool (FatCacheSize + DataCacheSize);
+    if (CacheBuffer != NULL) {
+      break;
+    }
+
+    DataCacheGroupCount /= 2;
+  } while (DataCacheGroupCount >= FAT_DATACACHE_GROUP_MIN_COUNT);
+
   if (CacheBuffer == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
 
+  DiskCache[CacheData].SetMask      = DataCacheGroupCount / FAT_DATACACHE_WAY_COUNT - 1;
+  DiskCache[CacheData].GroupCount   = DataCacheGroupCount;
+  DiskCache[CacheData].BaseAddress  = Volume->RootPos;
+  DiskCache[CacheData].LimitAddress = Volume->VolumeSize;
+  DiskCache[CacheFat].SetMask       = FatCacheGroupCount - 1;
+  DiskCache[CacheFat].GroupCount    = FatCacheGroupCount;
+  DiskCache[CacheFat].BaseAddress   = Volume->FatPos;
+  DiskCache[CacheFat].LimitAddress  = Volume->FatPos + Volume->FatSize;
+
   Volume->CacheBuffer            = CacheBuffer;
   DiskCache[CacheFat].CacheBase  = CacheBuffer;
   DiskCache[CacheData].CacheBase = CacheBuffer + FatCacheSize;
+
+  //
+  // The pages read ahead are read with DiskIo2 if the disk supports it
+  //
+  if (Volume->DiskIo2 != NULL) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &DiskCache[CacheData].PendingToken.Event);
+    if (EFI_ERROR (Status)) {
+      DiskCache[CacheData].PendingToken.Event = NULL;
+    }
+  }
+
   return EFI_SUCCESS;
 }
+
+/**
+
+  Free the disk cache of the volume.
+
+  @param  Volume                - FAT file system volume.
+
+**/
+VOID
+FatFreeDiskCache (
+  IN FAT_VOLUME  *Volume
+  )
+{
+  DISK_CACHE  *DiskCache;
+
+  DiskCache = &Volume->DiskCache[CacheData];
+  DEBUG ((
+    DEBUG_INFO,
+    "FAT: data cache %Lu pages, %Lu accesses, %Lu misses, %Lu pages read ahead\n",
+    (UINT64)DiskCache->GroupCount,
+    (UINT64)DiskCache->AccessCount,
+    (UINT64)DiskCache->MissCount,
+    (UINT64)DiskCache->ReadAheadCount
+    ));
+
+  if (DiskCache->PendingToken.Event != NULL) {
+    FatWaitCachePages (DiskCache);
+    gBS->CloseEvent (DiskCache->PendingToken.Event);
+  }
+
+  FreePool (Volume->CacheBuffer);
+  Volume->CacheBuffer = NULL;
+}
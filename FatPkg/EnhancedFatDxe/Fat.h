@@ -80,10 +80,27 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define FAT_FATCACHE_PAGE_MAX_ALIGNMENT   15
 #define FAT_DATACACHE_PAGE_MIN_ALIGNMENT  13
 #define FAT_DATACACHE_PAGE_MAX_ALIGNMENT  16
-#define FAT_DATACACHE_GROUP_COUNT         64
+#define FAT_DATACACHE_GROUP_MIN_COUNT     64
+#define FAT_DATACACHE_GROUP_MAX_COUNT     256
 #define FAT_FATCACHE_GROUP_MIN_COUNT      1
 #define FAT_FATCACHE_GROUP_MAX_COUNT      16
 
+//
+// The data cache is at most 1/32 of the volume size and 1/1024 of the free memory
+//
+#define FAT_DATACACHE_VOLUME_SHIFT  5
+#define FAT_DATACACHE_MEMORY_SHIFT  10
+
+//
+// Number of data cache groups a page can be cached in
+//
+#define FAT_DATACACHE_WAY_COUNT  4
+
+//
+// Maximum number of data cache pages read at once when the pages are read sequentially
+//
+#define FAT_DATACACHE_READ_AHEAD_COUNT  8
+
 //
 // Used in 8.3 generation algorithm
 //
@@ -103,7 +120,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define LC_ISO_639_2_ENTRY_SIZE  3
 #define MAX_LANG_CODE_SIZE       100
 
-#define FAT_MAX_DIR_CACHE_COUNT  8
+#define FAT_MAX_DIR_CACHE_SIZE   0x100000
+#define FAT_MIN_EXTENT_COUNT     8
+#define FAT_MAX_EXTENT_COUNT     1024
 #define FAT_MAX_DIRENTRY_COUNT   0xFFFF
 typedef CHAR8 LC_ISO_639_2;
 
@@ -146,23 +165,36 @@ typedef struct {
   UINTN      PageNo;
   UINTN      RealSize;
   BOOLEAN    Dirty;
+  UINTN      LastUse;          // The access count of the cache when the page was last used
 } CACHE_TAG;
 
+//
+// A page is cached in one of the groups of its set. The groups of a set are SetMask + 1
+// groups apart, so that consecutive pages can be cached in consecutive groups.
+//
 typedef struct {
-  UINT64       BaseAddress;
-  UINT64       LimitAddress;
-  UINT8        *CacheBase;
-  BOOLEAN      Dirty;
-  UINT8        PageAlignment;
-  UINTN        GroupMask;
-  CACHE_TAG    CacheTag[FAT_DATACACHE_GROUP_COUNT];
+  UINT64                BaseAddress;
+  UINT64                LimitAddress;
+  UINT8                 *CacheBase;
+  BOOLEAN               Dirty;
+  UINT8                 PageAlignment;
+  UINTN                 SetMask;
+  UINTN                 GroupCount;
+  UINTN                 LastPageNo;     // The last page accessed, to detect sequential reads
+  UINTN                 AccessCount;    // The number of page accesses
+  UINTN                 MissCount;      // The number of page accesses that read the disk
+  UINTN                 ReadAheadCount; // The number of pages read ahead
+  UINTN                 PendingGroupNo; // The first group of the non-blocking read ahead
+  UINTN                 PendingCount;   // The number of groups of the non-blocking read ahead
+  EFI_DISK_IO2_TOKEN    PendingToken;
+  CACHE_TAG             CacheTag[FAT_DATACACHE_GROUP_MAX_COUNT];
 } DISK_CACHE;
 
 //
-// Hash table size
+// Hash table size, the hash tables of a directory grow with its entries
 //
-#define HASH_TABLE_SIZE  0x400
-#define HASH_TABLE_MASK  (HASH_TABLE_SIZE - 1)
+#define HASH_TABLE_MIN_SIZE  0x40
+#define HASH_TABLE_MAX_SIZE  0x10000
 
 //
 // The directory entry for opened directory
@@ -182,6 +214,8 @@ struct _FAT_DIRENT {
   FAT_OFILE              *OFile;                // The OFile of the corresponding directory entry
   FAT_DIRENT             *ShortNameForwardLink; // Hash successor link for short filename
   FAT_DIRENT             *LongNameForwardLink;  // Hash successor link for long filename
+  UINT32                 ShortNameHash;         // Hash value of the short filename
+  UINT32                 LongNameHash;          // Hash value of the long filename
   LIST_ENTRY             Link;                  // Connection of every directory entry
   FAT_DIRECTORY_ENTRY    Entry;                 // The physical directory entry stored in disk
 };
@@ -195,8 +229,11 @@ struct _FAT_ODIR {
   BOOLEAN       EndOfDir;                     // Indicate whether we have reached the end of the directory
   LIST_ENTRY    DirCacheLink;                 // Linked in Volume->DirCacheList when discarded
   UINTN         DirCacheTag;                  // The identification of the directory when in directory cache
-  FAT_DIRENT    *LongNameHashTable[HASH_TABLE_SIZE];
-  FAT_DIRENT    *ShortNameHashTable[HASH_TABLE_SIZE];
+  UINTN         DirCacheSize;                 // The memory used by the directory when in directory cache
+  FAT_DIRENT    **LongNameHashTable;
+  FAT_DIRENT    **ShortNameHashTable;
+  UINTN         HashTableSize;                // The number of buckets of each hash table
+  UINTN         HashEntryCount;               // The number of directory entries in the hash tables
 };
 
 typedef struct {
@@ -228,6 +265,15 @@ typedef struct {
   LIST_ENTRY            Link;
 } FAT_SUBTASK;
 
+//
+// FAT_EXTENT - A run of consecutive clusters of an opened file
+//
+typedef struct {
+  UINTN    FileClusterNo;                     // The index in the file of the first cluster of the run
+  UINTN    Cluster;                           // The first cluster of the run
+  UINTN    ClusterCount;                      // The number of clusters of the run
+} FAT_EXTENT;
+
 //
 // FAT_OFILE - Each opened file
 //
@@ -271,6 +317,16 @@ struct _FAT_OFILE {
   UINT64        PosDisk;        // on the disk
   UINTN         PosRem;         // remaining in this disk run
   //
+  // The extents of the file, from its first cluster. The cluster chain
+  // is mapped to extents when the file is accessed, and the extents
+  // are discarded when the file is truncated. ExtentsComplete is set
+  // if the last extent ends the cluster chain
+  //
+  FAT_EXTENT    *Extents;
+  UINTN         ExtentCount;
+  UINTN         ExtentMaxCount;
+  BOOLEAN       ExtentsComplete;
+  //
   // The opened parent, full path length and currently opened child files
   //
   FAT_OFILE     *Parent;
@@ -368,6 +424,9 @@ struct _FAT_VOLUME {
   //
   LIST_ENTRY                         DirCacheList;
   UINTN                              DirCacheCount;
+  UINTN                              DirCacheSize;
+  UINTN                              DirLoadCount;
+  UINTN                              DirEvictCount;
 
   //
   // Disk Cache for this volume
@@ -711,6 +770,18 @@ FatInitializeDiskCache (
   IN FAT_VOLUME  *Volume
   );
 
+/**
+
+  Free the disk cache of the volume.
+
+  @param  Volume                - FAT file system volume.
+
+**/
+VOID
+FatFreeDiskCache (
+  IN FAT_VOLUME  *Volume
+  );
+
 /**
 
   Read BufferSize bytes from the position of Offset into Buffer,
@@ -406,6 +406,8 @@ FatShrinkEof (
   OFile->FileCurrentCluster = OFile->FileCluster;
   OFile->FileLastCluster    = LastCluster;
   OFile->Dirty              = TRUE;
+  OFile->ExtentCount        = 0;
+  OFile->ExtentsComplete    = FALSE;
   //
   // Free the remaining cluster chain
   //
@@ -490,8 +492,10 @@ FatGrowEof (
 
     //
     // Loop until we've allocated enough space
+    // The extents remain valid, the cluster chain is only extended
     //
-    LastCluster = OFile->FileLastCluster;
+    LastCluster            = OFile->FileLastCluster;
+    OFile->ExtentsComplete = FALSE;
 
     while (CurSize < NewSize) {
       NewCluster = FatAllocateCluster (Volume);
@@ -545,6 +549,188 @@ Done:
   return Status;
 }
 
+/**
+
+  Map the next cluster of the cluster chain of the open file to its extents.
+
+  @param  OFile                 - The open file.
+
+  @retval EFI_SUCCESS           - The next cluster was mapped, or the chain ends.
+  @retval EFI_VOLUME_CORRUPTED  - Cluster chain corrupt.
+  @retval EFI_OUT_OF_RESOURCES  - The file already has FAT_MAX_EXTENT_COUNT extents,
+                                  or not enough memory for another extent.
+
+**/
+STATIC
+EFI_STATUS
+FatMapNextCluster (
+  IN FAT_OFILE  *OFile
+  )
+{
+  FAT_VOLUME  *Volume;
+  FAT_EXTENT  *Extent;
+  FAT_EXTENT  *Extents;
+  UINTN       ExtentMaxCount;
+  UINTN       FileClusterNo;
+  UINTN       Cluster;
+
+  Volume = OFile->Volume;
+  if (OFile->ExtentCount == 0) {
+    FileClusterNo = 0;
+    Cluster       = OFile->FileCluster;
+  } else {
+    Extent  = &OFile->Extents[OFile->ExtentCount - 1];
+    Cluster = FatGetFatEntry (Volume, Extent->Cluster + Extent->ClusterCount - 1);
+    if (FAT_END_OF_FAT_CHAIN (Cluster)) {
+      OFile->ExtentsComplete = TRUE;
+      return EFI_SUCCESS;
+    }
+
+    if (Cluster == Extent->Cluster + Extent->ClusterCount) {
+      Extent->ClusterCount++;
+      return EFI_SUCCESS;
+    }
+
+    FileClusterNo = Extent->FileClusterNo + Extent->ClusterCount;
+  }
+
+  if ((Cluster < FAT_MIN_CLUSTER) || (Cluster > Volume->MaxCluster + 1)) {
+    DEBUG ((DEBUG_INIT | DEBUG_ERROR, "FatMapNextCluster: cluster chain corrupt\n"));
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  if (OFile->ExtentCount == FAT_MAX_EXTENT_COUNT) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (OFile->ExtentCount == OFile->ExtentMaxCount) {
+    ExtentMaxCount = MIN (MAX (OFile->ExtentMaxCount * 2, FAT_MIN_EXTENT_COUNT), FAT_MAX_EXTENT_COUNT);
+    Extents        = ReallocatePool (
+                       OFile->ExtentMaxCount * sizeof (FAT_EXTENT),
+                       ExtentMaxCount * sizeof (FAT_EXTENT),
+                       OFile->Extents
+                       );
+    if (Extents == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    OFile->Extents        = Extents;
+    OFile->ExtentMaxCount = ExtentMaxCount;
+  }
+
+  Extent                = &OFile->Extents[OFile->ExtentCount++];
+  Extent->FileClusterNo = FileClusterNo;
+  Extent->Cluster       = Cluster;
+  Extent->ClusterCount  = 1;
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Seek OFile to requested position with its extents, and calculate the number of
+  consecutive clusters from the position in the file.
+
+  The cluster chain is mapped up to the position, and further while the last
+  extent continues and is shorter than PosLimit. The extent of the position is
+  then found with a binary search. Past FAT_MAX_EXTENT_COUNT extents, the caller
+  runs the cluster chain instead.
+
+  @param  OFile                 - The open file.
+  @param  Position              - The file's position which will be accessed.
+  @param  PosLimit              - The maximum length current reading/writing may access
+
+  @retval EFI_SUCCESS           - Set the info successfully.
+  @retval EFI_VOLUME_CORRUPTED  - Cluster chain corrupt.
+  @retval EFI_OUT_OF_RESOURCES  - The position is not in the extents, and they
+                                  cannot grow.
+
+**/
+STATIC
+EFI_STATUS
+FatExtentPosition (
+  IN FAT_OFILE  *OFile,
+  IN UINTN      Position,
+  IN UINTN      PosLimit
+  )
+{
+  EFI_STATUS  Status;
+  FAT_VOLUME  *Volume;
+  FAT_EXTENT  *Extent;
+  UINTN       FileClusterNo;
+  UINTN       ClusterOffset;
+  UINTN       Low;
+  UINTN       High;
+  UINTN       Middle;
+  UINT64      Run;
+
+  Volume        = OFile->Volume;
+  FileClusterNo = Position >> Volume->ClusterAlignment;
+  ClusterOffset = Position & (Volume->ClusterSize - 1);
+
+  //
+  // Map the cluster chain up to the position
+  //
+  while (!OFile->ExtentsComplete &&
+         ((OFile->ExtentCount == 0) ||
+          (OFile->Extents[OFile->ExtentCount - 1].FileClusterNo + OFile->Extents[OFile->ExtentCount - 1].ClusterCount <= FileClusterNo)))
+  {
+    Status = FatMapNextCluster (OFile);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  if ((OFile->ExtentCount == 0) ||
+      (OFile->Extents[OFile->ExtentCount - 1].FileClusterNo + OFile->Extents[OFile->ExtentCount - 1].ClusterCount <= FileClusterNo))
+  {
+    DEBUG ((DEBUG_INIT | DEBUG_ERROR, "FatExtentPosition: cluster chain corrupt\n"));
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  //
+  // Find the last extent that starts at or before the position
+  //
+  Low  = 0;
+  High = OFile->ExtentCount - 1;
+  while (Low < High) {
+    Middle = (Low + High + 1) / 2;
+    if (OFile->Extents[Middle].FileClusterNo <= FileClusterNo) {
+      Low = Middle;
+    } else {
+      High = Middle - 1;
+    }
+  }
+
+  //
+  // Compute the number of consecutive clusters in the file
+  //
+  for ( ; ;) {
+    Extent = &OFile->Extents[Low];
+    Run    = LShiftU64 (Extent->FileClusterNo + Extent->ClusterCount - FileClusterNo, Volume->ClusterAlignment) - ClusterOffset;
+    if ((Low != OFile->ExtentCount - 1) || OFile->ExtentsComplete || (Run >= PosLimit)) {
+      break;
+    }
+
+    //
+    // If the extents cannot grow, the run ends with the last extent
+    //
+    Status = FatMapNextCluster (OFile);
+    if (Status == EFI_OUT_OF_RESOURCES) {
+      break;
+    }
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  OFile->PosDisk = Volume->FirstClusterPos +
+                   LShiftU64 (Extent->Cluster + FileClusterNo - Extent->FileClusterNo - FAT_MIN_CLUSTER, Volume->ClusterAlignment) +
+                   ClusterOffset;
+  OFile->PosRem = (UINTN)MIN (Run, MAX_UINTN);
+  return EFI_SUCCESS;
+}
+
 /**
 
   Seek OFile to requested position, and calculate the number of
@@ -565,6 +751,7 @@ FatOFilePosition (
   IN UINTN      PosLimit
   )
 {
+  EFI_STATUS  Status;
   FAT_VOLUME  *Volume;
   UINTN       ClusterSize;
   UINTN       Cluster;
@@ -584,6 +771,15 @@ FatOFilePosition (
     OFile->PosDisk = Volume->RootPos + Position;
     Run            = OFile->FileSize - Position;
   } else {
+    //
+    // Seek with the extents of the file, and only run the cluster chain
+    // past the last extent when the extents cannot grow
+    //
+    Status = FatExtentPosition (OFile, Position, PosLimit);
+    if (Status != EFI_OUT_OF_RESOURCES) {
+      return Status;
+    }
+
     //
     // Run the file's cluster chain to find the current position
     // If possible, run from the current cluster rather than
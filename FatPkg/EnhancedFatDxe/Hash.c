@@ -34,7 +34,7 @@ FatHashLongName (
     );
   FatStrUpr (UpCasedLongFileName);
   gBS->CalculateCrc32 (UpCasedLongFileName, StrSize (UpCasedLongFileName), &HashValue);
-  return (HashValue & HASH_TABLE_MASK);
+  return HashValue;
 }
 
 /**
@@ -55,7 +55,7 @@ FatHashShortName (
   UINT32  HashValue;
 
   gBS->CalculateCrc32 (ShortNameString, FAT_NAME_LEN, &HashValue);
-  return (HashValue & HASH_TABLE_MASK);
+  return HashValue;
 }
 
 /**
@@ -76,7 +76,7 @@ FatLongNameHashSearch (
 {
   FAT_DIRENT  **PreviousHashNode;
 
-  for (PreviousHashNode   = &ODir->LongNameHashTable[FatHashLongName (LongNameString)];
+  for (PreviousHashNode   = &ODir->LongNameHashTable[FatHashLongName (LongNameString) & (ODir->HashTableSize - 1)];
        *PreviousHashNode != NULL;
        PreviousHashNode   = &(*PreviousHashNode)->LongNameForwardLink
        )
@@ -107,7 +107,7 @@ FatShortNameHashSearch (
 {
   FAT_DIRENT  **PreviousHashNode;
 
-  for (PreviousHashNode   = &ODir->ShortNameHashTable[FatHashShortName (ShortNameString)];
+  for (PreviousHashNode   = &ODir->ShortNameHashTable[FatHashShortName (ShortNameString) & (ODir->HashTableSize - 1)];
        *PreviousHashNode != NULL;
        PreviousHashNode   = &(*PreviousHashNode)->ShortNameForwardLink
        )
@@ -122,35 +122,105 @@ FatShortNameHashSearch (
 
 /**
 
-  Insert directory entry to hash table.
+  Link directory entry to the hash tables with its hash values.
 
-  @param  ODir                  - The parent directory.
+  @param  LongNameHashTable     - The long name hash table.
+  @param  ShortNameHashTable    - The short name hash table.
+  @param  HashTableSize         - The number of buckets of each hash table.
   @param  DirEnt                - The directory entry node.
 
 **/
+STATIC
 VOID
-FatInsertToHashTable (
-  IN FAT_ODIR    *ODir,
+FatLinkToHashTable (
+  IN FAT_DIRENT  **LongNameHashTable,
+  IN FAT_DIRENT  **ShortNameHashTable,
+  IN UINTN       HashTableSize,
   IN FAT_DIRENT  *DirEnt
   )
 {
-  FAT_DIRENT  **HashTable;
-  UINT32      HashTableIndex;
+  UINTN  HashTableIndex;
 
   //
   // Insert hash table index for short name
   //
-  HashTableIndex               = FatHashShortName (DirEnt->Entry.FileName);
-  HashTable                    = ODir->ShortNameHashTable;
-  DirEnt->ShortNameForwardLink = HashTable[HashTableIndex];
-  HashTable[HashTableIndex]    = DirEnt;
+  HashTableIndex                     = DirEnt->ShortNameHash & (HashTableSize - 1);
+  DirEnt->ShortNameForwardLink       = ShortNameHashTable[HashTableIndex];
+  ShortNameHashTable[HashTableIndex] = DirEnt;
   //
   // Insert hash table index for long name
   //
-  HashTableIndex              = FatHashLongName (DirEnt->FileString);
-  HashTable                   = ODir->LongNameHashTable;
-  DirEnt->LongNameForwardLink = HashTable[HashTableIndex];
-  HashTable[HashTableIndex]   = DirEnt;
+  HashTableIndex                    = DirEnt->LongNameHash & (HashTableSize - 1);
+  DirEnt->LongNameForwardLink       = LongNameHashTable[HashTableIndex];
+  LongNameHashTable[HashTableIndex] = DirEnt;
+}
+
+/**
+
+  Double the size of the hash tables of the directory. The current hash tables
+  are kept if there is not enough memory for larger ones.
+
+  @param  ODir                  - The directory.
+
+**/
+STATIC
+VOID
+FatGrowHashTable (
+  IN FAT_ODIR  *ODir
+  )
+{
+  FAT_DIRENT  **LongNameHashTable;
+  FAT_DIRENT  **ShortNameHashTable;
+  FAT_DIRENT  *DirEnt;
+  UINTN       HashTableSize;
+  UINTN       Index;
+
+  HashTableSize     = ODir->HashTableSize * 2;
+  LongNameHashTable = AllocateZeroPool (2 * HashTableSize * sizeof (FAT_DIRENT *));
+  if (LongNameHashTable == NULL) {
+    return;
+  }
+
+  ShortNameHashTable = LongNameHashTable + HashTableSize;
+  for (Index = 0; Index < ODir->HashTableSize; Index++) {
+    //
+    // Both hash tables hold the same directory entries
+    //
+    while (ODir->ShortNameHashTable[Index] != NULL) {
+      DirEnt                          = ODir->ShortNameHashTable[Index];
+      ODir->ShortNameHashTable[Index] = DirEnt->ShortNameForwardLink;
+      FatLinkToHashTable (LongNameHashTable, ShortNameHashTable, HashTableSize, DirEnt);
+    }
+  }
+
+  FreePool (ODir->LongNameHashTable);
+  ODir->LongNameHashTable  = LongNameHashTable;
+  ODir->ShortNameHashTable = ShortNameHashTable;
+  ODir->HashTableSize      = HashTableSize;
+}
+
+/**
+
+  Insert directory entry to hash table.
+
+  @param  ODir                  - The parent directory.
+  @param  DirEnt                - The directory entry node.
+
+**/
+VOID
+FatInsertToHashTable (
+  IN FAT_ODIR    *ODir,
+  IN FAT_DIRENT  *DirEnt
+  )
+{
+  DirEnt->ShortNameHash = FatHashShortName (DirEnt->Entry.FileName);
+  DirEnt->LongNameHash  = FatHashLongName (DirEnt->FileString);
+  FatLinkToHashTable (ODir->LongNameHashTable, ODir->ShortNameHashTable, ODir->HashTableSize, DirEnt);
+
+  ODir->HashEntryCount++;
+  if ((ODir->HashEntryCount > ODir->HashTableSize) && (ODir->HashTableSize < HASH_TABLE_MAX_SIZE)) {
+    FatGrowHashTable (ODir);
+  }
 }
 
 /**
@@ -167,6 +237,20 @@ FatDeleteFromHashTable (
   IN FAT_DIRENT  *DirEnt
   )
 {
-  *FatShortNameHashSearch (ODir, DirEnt->Entry.FileName) = DirEnt->ShortNameForwardLink;
-  *FatLongNameHashSearch (ODir, DirEnt->FileString)      = DirEnt->LongNameForwardLink;
+  FAT_DIRENT  **PreviousHashNode;
+
+  PreviousHashNode = &ODir->ShortNameHashTable[DirEnt->ShortNameHash & (ODir->HashTableSize - 1)];
+  while (*PreviousHashNode != DirEnt) {
+    PreviousHashNode = &(*PreviousHashNode)->ShortNameForwardLink;
+  }
+
+  *PreviousHashNode = DirEnt->ShortNameForwardLink;
+
+  PreviousHashNode = &ODir->LongNameHashTable[DirEnt->LongNameHash & (ODir->HashTableSize - 1)];
+  while (*PreviousHashNode != DirEnt) {
+    PreviousHashNode = &(*PreviousHashNode)->LongNameForwardLink;
+  }
+
+  *PreviousHashNode = DirEnt->LongNameForwardLink;
+  ODir->HashEntryCount--;
 }
@@ -350,28 +350,46 @@ FatDiskIo (
       } else {
         //
         // Non-blocking access
+        // The subtasks are submitted by FatQueueTask (), so the last subtask is
+        // extended if this access follows it both on the disk and in memory.
         //
-        Subtask = AllocateZeroPool (sizeof (*Subtask));
-        if (Subtask == NULL) {
-          Status = EFI_OUT_OF_RESOURCES;
+        Subtask = NULL;
+        if (!IsListEmpty (&Task->Subtasks)) {
+          Subtask = CR (GetPreviousNode (&Task->Subtasks, &Task->Subtasks), FAT_SUBTASK, Link, FAT_SUBTASK_SIGNATURE);
+          if ((Subtask->Write != (BOOLEAN)(IoMode == WriteDisk)) ||
+              (Subtask->Offset + Subtask->BufferSize != Offset) ||
+              ((UINT8 *)Subtask->Buffer + Subtask->BufferSize != Buffer))
+          {
+            Subtask = NULL;
+          }
+        }
+
+        if (Subtask != NULL) {
+          Subtask->BufferSize += BufferSize;
+          Status               = EFI_SUCCESS;
         } else {
-          Subtask->Signature  = FAT_SUBTASK_SIGNATURE;
-          Subtask->Task       = Task;
-          Subtask->Write      = (BOOLEAN)(IoMode == WriteDisk);
-          Subtask->Offset     = Offset;
-          Subtask->Buffer     = Buffer;
-          Subtask->BufferSize = BufferSize;
-          Status              = gBS->CreateEvent (
-                                       EVT_NOTIFY_SIGNAL,
-                                       TPL_NOTIFY,
-                                       FatOnAccessComplete,
-                                       Subtask,
-                                       &Subtask->DiskIo2Token.Event
-                                       );
-          if (!EFI_ERROR (Status)) {
-            InsertTailList (&Task->Subtasks, &Subtask->Link);
+          Subtask = AllocateZeroPool (sizeof (*Subtask));
+          if (Subtask == NULL) {
+            Status = EFI_OUT_OF_RESOURCES;
           } else {
-            FreePool (Subtask);
+            Subtask->Signature  = FAT_SUBTASK_SIGNATURE;
+            Subtask->Task       = Task;
+            Subtask->Write      = (BOOLEAN)(IoMode == WriteDisk);
+            Subtask->Offset     = Offset;
+            Subtask->Buffer     = Buffer;
+            Subtask->BufferSize = BufferSize;
+            Status              = gBS->CreateEvent (
+                                         EVT_NOTIFY_SIGNAL,
+                                         TPL_NOTIFY,
+                                         FatOnAccessComplete,
+                                         Subtask,
+                                         &Subtask->DiskIo2Token.Event
+                                         );
+            if (!EFI_ERROR (Status)) {
+              InsertTailList (&Task->Subtasks, &Subtask->Link);
+            } else {
+              FreePool (Subtask);
+            }
           }
         }
       }
@@ -465,7 +483,7 @@ FatFreeVolume (
   // Free disk cache
   //
   if (Volume->CacheBuffer != NULL) {
-    FreePool (Volume->CacheBuffer);
+    FatFreeDiskCache (Volume);
   }
 
   //
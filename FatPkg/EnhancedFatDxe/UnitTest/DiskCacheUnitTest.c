@@ -0,0 +1,665 @@
+/** @file
+  This is a host-based unit test for the disk cache of the FAT driver.
+
+  The disk is simulated with a byte pattern. The tests check that the data
+  cache is sized from the free memory, that the pages of one set stay cached,
+  that sequential reads are read ahead through DiskIo2, and that a page that
+  is being read ahead is not used before the read completes. They also log the
+  disk reads and the cache misses of some access patterns.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../Fat.h"
+
+#define UNIT_TEST_NAME     "FAT Disk Cache Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define TEST_VOLUME_SIZE  SIZE_4GB
+#define TEST_ROOT_POS     SIZE_1MB
+#define TEST_PAGE_SIZE    ((UINTN)1 << FAT_DATACACHE_PAGE_MAX_ALIGNMENT)
+
+//
+// Number of polls of the event of a non-blocking read before it completes
+//
+#define TEST_READ_DELAY  3
+
+/// === TEST DATA ==================================================================================
+
+EFI_BOOT_SERVICES      *gBS;
+EFI_BOOT_SERVICES      mTestBootServices;
+EFI_DISK_IO2_PROTOCOL  mTestDiskIo2;
+FAT_VOLUME             *mTestVolume;
+UINT64                 mTestFreeMemorySize;
+UINTN                  mTestBlockingReadCount;
+UINTN                  mTestNonBlockingReadCount;
+UINT32                 mRandomSeed;
+
+//
+// The pending non-blocking read, its data is copied when it completes
+//
+EFI_DISK_IO2_TOKEN  *mTestPendingToken;
+UINT64              mTestPendingOffset;
+UINTN               mTestPendingSize;
+VOID                *mTestPendingBuffer;
+UINTN               mTestPendingPolls;
+
+UINT8  mTestBuffer[SIZE_1MB];
+
+/// === HELPER FUNCTIONS ===========================================================================
+
+/**
+  Fill a buffer with the content of the simulated disk.
+
+  @param  Offset             The offset on the disk
+  @param  Size               The size of the buffer
+  @param  Buffer             The buffer
+
+**/
+VOID
+TestReadDisk (
+  IN  UINT64  Offset,
+  IN  UINTN   Size,
+  OUT UINT8   *Buffer
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Size; Index++) {
+    Buffer[Index] = (UINT8)(((Offset + Index) * 131) >> 3);
+  }
+}
+
+/**
+  Check a buffer against the content of the simulated disk.
+
+  @param  Offset             The offset on the disk
+  @param  Size               The size of the buffer
+  @param  Buffer             The buffer
+
+  @retval TRUE    The buffer holds the content of the disk.
+  @retval FALSE   The buffer does not hold the content of the disk.
+
+**/
+BOOLEAN
+TestIsDiskData (
+  IN UINT64  Offset,
+  IN UINTN   Size,
+  IN UINT8   *Buffer
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Size; Index++) {
+    if (Buffer[Index] != (UINT8)(((Offset + Index) * 131) >> 3)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Return a pseudo-random number below a limit.
+
+  @param  Limit              The limit
+
+  @return The number
+
+**/
+UINT32
+TestRandom (
+  IN UINT32  Limit
+  )
+{
+  mRandomSeed = mRandomSeed * 1664525 + 1013904223;
+  return (mRandomSeed >> 8) % Limit;
+}
+
+/**
+  Simulate the disk accesses of the driver.
+
+  @param  Volume             FAT file system volume.
+  @param  IoMode             The access mode.
+  @param  Offset             The starting byte offset.
+  @param  BufferSize         Size of Buffer.
+  @param  Buffer             Buffer of the data.
+  @param  Task               The task of a non-blocking access.
+
+  @return The status of the access.
+
+**/
+EFI_STATUS
+FatDiskIo (
+  IN     FAT_VOLUME  *Volume,
+  IN     IO_MODE     IoMode,
+  IN     UINT64      Offset,
+  IN     UINTN       BufferSize,
+  IN OUT VOID        *Buffer,
+  IN     FAT_TASK    *Task
+  )
+{
+  if (CACHE_ENABLED (IoMode)) {
+    return FatAccessCache (Volume, CACHE_TYPE (IoMode), RAW_ACCESS (IoMode), Offset, BufferSize, Buffer, Task);
+  }
+
+  if (IoMode == ReadDisk) {
+    mTestBlockingReadCount++;
+    TestReadDisk (Offset, BufferSize, Buffer);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Start a non-blocking read of the simulated disk, the data is copied when the
+  event of the token is checked the TEST_READ_DELAY time.
+
+  @return EFI_SUCCESS
+
+**/
+EFI_STATUS
+EFIAPI
+TestReadDiskEx (
+  IN     EFI_DISK_IO2_PROTOCOL  *This,
+  IN     UINT32                 MediaId,
+  IN     UINT64                 Offset,
+  IN OUT EFI_DISK_IO2_TOKEN     *Token,
+  IN     UINTN                  BufferSize,
+  OUT    VOID                   *Buffer
+  )
+{
+  ASSERT (mTestPendingToken == NULL);
+
+  mTestNonBlockingReadCount++;
+  mTestPendingToken  = Token;
+  mTestPendingOffset = Offset;
+  mTestPendingSize   = BufferSize;
+  mTestPendingBuffer = Buffer;
+  mTestPendingPolls  = 0;
+  return EFI_SUCCESS;
+}
+
+/**
+  Check the event of the pending non-blocking read.
+
+  @return EFI_SUCCESS if the read completed, EFI_NOT_READY otherwise.
+
+**/
+EFI_STATUS
+EFIAPI
+TestCheckEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  if ((mTestPendingToken == NULL) || (Event != mTestPendingToken->Event)) {
+    return EFI_NOT_READY;
+  }
+
+  if (++mTestPendingPolls < TEST_READ_DELAY) {
+    return EFI_NOT_READY;
+  }
+
+  TestReadDisk (mTestPendingOffset, mTestPendingSize, mTestPendingBuffer);
+  mTestPendingToken->TransactionStatus = EFI_SUCCESS;
+  mTestPendingToken                    = NULL;
+  return EFI_SUCCESS;
+}
+
+/**
+  Create an event.
+
+  @return EFI_SUCCESS
+
+**/
+EFI_STATUS
+EFIAPI
+TestCreateEvent (
+  IN  UINT32            Type,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction,
+  IN  VOID              *NotifyContext,
+  OUT EFI_EVENT         *Event
+  )
+{
+  *Event = (EFI_EVENT)&mTestBootServices;
+  return EFI_SUCCESS;
+}
+
+/**
+  Close an event.
+
+  @return EFI_SUCCESS
+
+**/
+EFI_STATUS
+EFIAPI
+TestCloseEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Return a memory map with mTestFreeMemorySize bytes of conventional memory.
+
+  @return EFI_SUCCESS or EFI_BUFFER_TOO_SMALL
+
+**/
+EFI_STATUS
+EFIAPI
+TestGetMemoryMap (
+  IN OUT UINTN                  *MemoryMapSize,
+  OUT    EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  OUT    UINTN                  *MapKey,
+  OUT    UINTN                  *DescriptorSize,
+  OUT    UINT32                 *DescriptorVersion
+  )
+{
+  *DescriptorSize    = sizeof (EFI_MEMORY_DESCRIPTOR);
+  *DescriptorVersion = EFI_MEMORY_DESCRIPTOR_VERSION;
+  if (*MemoryMapSize < sizeof (EFI_MEMORY_DESCRIPTOR)) {
+    *MemoryMapSize = sizeof (EFI_MEMORY_DESCRIPTOR);
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *MemoryMapSize = sizeof (EFI_MEMORY_DESCRIPTOR);
+  ZeroMem (MemoryMap, sizeof (EFI_MEMORY_DESCRIPTOR));
+  MemoryMap->Type          = EfiConventionalMemory;
+  MemoryMap->NumberOfPages = EFI_SIZE_TO_PAGES (mTestFreeMemorySize);
+  return EFI_SUCCESS;
+}
+
+/**
+  Create the test volume and its disk cache.
+
+  @param  FreeMemorySize     The size of the free memory
+
+  @return The status of the initialization of the disk cache.
+
+**/
+EFI_STATUS
+CreateTestVolume (
+  IN UINT64  FreeMemorySize
+  )
+{
+  mTestFreeMemorySize = FreeMemorySize;
+  mTestVolume         = AllocateZeroPool (sizeof (FAT_VOLUME));
+  if (mTestVolume == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mTestVolume->FatType    = Fat32;
+  mTestVolume->VolumeSize = TEST_VOLUME_SIZE;
+  mTestVolume->RootPos    = TEST_ROOT_POS;
+  mTestVolume->FatPos     = SIZE_32KB;
+  mTestVolume->FatSize    = SIZE_512KB;
+  mTestVolume->NumFats    = 2;
+  mTestVolume->DiskIo2    = &mTestDiskIo2;
+  return FatInitializeDiskCache (mTestVolume);
+}
+
+/**
+  Read the data area through the data cache and check the data.
+
+  @param  Offset             The offset from the start of the data area
+  @param  Size               The size to read
+
+  @retval TRUE    The data of the disk was read.
+  @retval FALSE   The read failed or returned other data.
+
+**/
+BOOLEAN
+TestRead (
+  IN UINT64  Offset,
+  IN UINTN   Size
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = FatAccessCache (mTestVolume, CacheData, ReadDisk, TEST_ROOT_POS + Offset, Size, mTestBuffer, NULL);
+  return !EFI_ERROR (Status) && TestIsDiskData (TEST_ROOT_POS + Offset, Size, mTestBuffer);
+}
+
+/**
+  Reset the simulated disk and the boot services.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ResetTestDisk (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ZeroMem (&mTestBootServices, sizeof (mTestBootServices));
+  mTestBootServices.CreateEvent  = TestCreateEvent;
+  mTestBootServices.CloseEvent   = TestCloseEvent;
+  mTestBootServices.CheckEvent   = TestCheckEvent;
+  mTestBootServices.GetMemoryMap = TestGetMemoryMap;
+  gBS                            = &mTestBootServices;
+
+  ZeroMem (&mTestDiskIo2, sizeof (mTestDiskIo2));
+  mTestDiskIo2.ReadDiskEx = TestReadDiskEx;
+
+  mTestVolume               = NULL;
+  mTestPendingToken         = NULL;
+  mTestBlockingReadCount    = 0;
+  mTestNonBlockingReadCount = 0;
+  mRandomSeed               = 1;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the test volume.
+
+  @param[in]  Context  Unit test case context
+
+**/
+VOID
+EFIAPI
+FreeTestVolume (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mTestVolume != NULL) {
+    if (mTestVolume->CacheBuffer != NULL) {
+      FatFreeDiskCache (mTestVolume);
+    }
+
+    FreePool (mTestVolume);
+    mTestVolume = NULL;
+  }
+}
+
+/// === TEST CASES =================================================================================
+
+/**
+  The data cache grows with the volume, but is at most 1/1024 of the free
+  memory unless that is below the minimum size.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+DataCacheShouldBeSizedFromFreeMemory (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_NOT_EFI_ERROR (CreateTestVolume (SIZE_8GB));
+  UT_ASSERT_EQUAL (mTestVolume->DiskCache[CacheData].GroupCount, SIZE_8MB / TEST_PAGE_SIZE);
+  FreeTestVolume (Context);
+
+  UT_ASSERT_NOT_EFI_ERROR (CreateTestVolume (SIZE_1GB));
+  UT_ASSERT_EQUAL (mTestVolume->DiskCache[CacheData].GroupCount, FAT_DATACACHE_GROUP_MIN_COUNT);
+  FreeTestVolume (Context);
+
+  UT_ASSERT_NOT_EFI_ERROR (CreateTestVolume (SIZE_16GB));
+  UT_ASSERT_EQUAL (mTestVolume->DiskCache[CacheData].GroupCount, FAT_DATACACHE_GROUP_MAX_COUNT);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Pages that fall in the same set are each cached in a group of the set, so
+  reading them in turn only misses once per page.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PagesOfOneSetShouldStayCached (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  DISK_CACHE  *DiskCache;
+  UINTN       Round;
+  UINTN       Way;
+  UINT64      SetSize;
+
+  UT_ASSERT_NOT_EFI_ERROR (CreateTestVolume (SIZE_16GB));
+  DiskCache = &mTestVolume->DiskCache[CacheData];
+  SetSize   = (UINT64)(DiskCache->SetMask + 1) * TEST_PAGE_SIZE;
+
+  for (Round = 0; Round < 100; Round++) {
+    for (Way = 0; Way < FAT_DATACACHE_WAY_COUNT; Way++) {
+      UT_ASSERT_TRUE (TestRead (Way * SetSize * 3 + 100 + Round, 512));
+    }
+  }
+
+  UT_ASSERT_EQUAL (DiskCache->MissCount, FAT_DATACACHE_WAY_COUNT);
+  UT_ASSERT_EQUAL (mTestBlockingReadCount, FAT_DATACACHE_WAY_COUNT);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Small sequential reads read the next pages with one non-blocking read, and
+  wait for it when they reach them.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SequentialReadsShouldReadAhead (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  DISK_CACHE  *DiskCache;
+  UINT64      Offset;
+  UINTN       PageCount;
+
+  UT_ASSERT_NOT_EFI_ERROR (CreateTestVolume (SIZE_16GB));
+  DiskCache = &mTestVolume->DiskCache[CacheData];
+
+  for (Offset = 7; Offset < SIZE_16MB; Offset += 4093) {
+    UT_ASSERT_TRUE (TestRead (Offset, 4093));
+  }
+
+  PageCount = SIZE_16MB / TEST_PAGE_SIZE;
+  UT_LOG_INFO (
+    "%Lu pages: %Lu misses, %Lu blocking reads, %Lu non-blocking reads\n",
+    (UINT64)PageCount,
+    (UINT64)DiskCache->MissCount,
+    (UINT64)mTestBlockingReadCount,
+    (UINT64)mTestNonBlockingReadCount
+    );
+  UT_ASSERT_TRUE (mTestBlockingReadCount <= PageCount / FAT_DATACACHE_READ_AHEAD_COUNT + 2);
+  UT_ASSERT_TRUE (mTestNonBlockingReadCount >= PageCount / FAT_DATACACHE_READ_AHEAD_COUNT - 2);
+  UT_ASSERT_TRUE (DiskCache->ReadAheadCount + DiskCache->MissCount >= PageCount);
+  UT_ASSERT_TRUE (DiskCache->ReadAheadCount + DiskCache->MissCount <= PageCount + FAT_DATACACHE_READ_AHEAD_COUNT);
+
+  //
+  // Without DiskIo2 the pages are read ahead with one blocking read
+  //
+  FreeTestVolume (Context);
+  ResetTestDisk (Context);
+  mTestDiskIo2.ReadDiskEx = NULL;
+  UT_ASSERT_NOT_EFI_ERROR (CreateTestVolume (SIZE_16GB));
+  mTestVolume->DiskIo2 = NULL;
+  for (Offset = 7; Offset < SIZE_16MB; Offset += 4093) {
+    UT_ASSERT_TRUE (TestRead (Offset, 4093));
+  }
+
+  UT_ASSERT_TRUE (mTestBlockingReadCount <= PageCount / FAT_DATACACHE_READ_AHEAD_COUNT + 2);
+  UT_ASSERT_EQUAL (mTestNonBlockingReadCount, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A write to a page that is being read ahead waits for the read, so the read
+  does not overwrite the written data.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+WriteShouldWaitForReadAhead (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  Data[16];
+  UINT8  Read[16];
+
+  UT_ASSERT_NOT_EFI_ERROR (CreateTestVolume (SIZE_16GB));
+
+  //
+  // The second read starts the read ahead of the pages after page 1
+  //
+  UT_ASSERT_TRUE (TestRead (10, 16));
+  UT_ASSERT_TRUE (TestRead (TEST_PAGE_SIZE + 10, 16));
+  UT_ASSERT_TRUE (mTestPendingToken != NULL);
+
+  SetMem (Data, sizeof (Data), 0x5A);
+  UT_ASSERT_NOT_EFI_ERROR (FatAccessCache (mTestVolume, CacheData, WriteDisk, TEST_ROOT_POS + 3 * TEST_PAGE_SIZE + 10, sizeof (Data), Data, NULL));
+  UT_ASSERT_TRUE (mTestPendingToken == NULL);
+  UT_ASSERT_NOT_EFI_ERROR (FatAccessCache (mTestVolume, CacheData, ReadDisk, TEST_ROOT_POS + 3 * TEST_PAGE_SIZE + 10, sizeof (Read), Read, NULL));
+  UT_ASSERT_MEM_EQUAL (Read, Data, sizeof (Data));
+  UT_ASSERT_TRUE (TestRead (3 * TEST_PAGE_SIZE + 10 + sizeof (Data), 100));
+
+  //
+  // An aligned write of a page that is being read ahead waits for the read too
+  //
+  UT_ASSERT_TRUE (TestRead (20 * TEST_PAGE_SIZE + 10, 16));
+  UT_ASSERT_TRUE (TestRead (21 * TEST_PAGE_SIZE + 10, 16));
+  UT_ASSERT_TRUE (mTestPendingToken != NULL);
+  UT_ASSERT_NOT_EFI_ERROR (FatAccessCache (mTestVolume, CacheData, WriteDisk, TEST_ROOT_POS + 22 * TEST_PAGE_SIZE, TEST_PAGE_SIZE, mTestBuffer, NULL));
+  UT_ASSERT_TRUE (mTestPendingToken == NULL);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Log the misses of random reads of a working set smaller than the cache.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RandomReadsShouldMostlyHit (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  DISK_CACHE  *DiskCache;
+  UINT64      Pages[FAT_DATACACHE_GROUP_MAX_COUNT / 2];
+  UINTN       Index;
+
+  UT_ASSERT_NOT_EFI_ERROR (CreateTestVolume (SIZE_16GB));
+  DiskCache = &mTestVolume->DiskCache[CacheData];
+
+  for (Index = 0; Index < ARRAY_SIZE (Pages); Index++) {
+    Pages[Index] = TestRandom (SIZE_2GB / TEST_PAGE_SIZE);
+  }
+
+  for (Index = 0; Index < 20000; Index++) {
+    UT_ASSERT_TRUE (TestRead (Pages[TestRandom (ARRAY_SIZE (Pages))] * TEST_PAGE_SIZE + 17, 512));
+  }
+
+  UT_LOG_INFO ("%Lu random reads of %Lu pages: %Lu misses\n", (UINT64)Index, (UINT64)ARRAY_SIZE (Pages), (UINT64)DiskCache->MissCount);
+  UT_ASSERT_TRUE (DiskCache->MissCount < Index / 10);
+
+  return UNIT_TEST_PASSED;
+}
+
+/// === TEST ENGINE ================================================================================
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the disk cache
+  and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      DiskCacheTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (&DiskCacheTests, Framework, "FAT Disk Cache Tests", "DiskCache", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for DiskCache\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (DiskCacheTests, "Data cache should be sized from the free memory", "CacheSize", DataCacheShouldBeSizedFromFreeMemory, ResetTestDisk, FreeTestVolume, NULL);
+  AddTestCase (DiskCacheTests, "Pages of one set should stay cached", "SetAssociative", PagesOfOneSetShouldStayCached, ResetTestDisk, FreeTestVolume, NULL);
+  AddTestCase (DiskCacheTests, "Sequential reads should read ahead", "ReadAhead", SequentialReadsShouldReadAhead, ResetTestDisk, FreeTestVolume, NULL);
+  AddTestCase (DiskCacheTests, "Write should wait for the read ahead", "ReadAheadWrite", WriteShouldWaitForReadAhead, ResetTestDisk, FreeTestVolume, NULL);
+  AddTestCase (DiskCacheTests, "Random reads should mostly hit", "RandomReads", RandomReadsShouldMostlyHit, ResetTestDisk, FreeTestVolume, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
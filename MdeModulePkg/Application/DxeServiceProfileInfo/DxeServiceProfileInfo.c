@@ -0,0 +1,351 @@
+/** @file
+  Shell application to dump the boot service latency profile of the DXE Core.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <PiDxe.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DxeServicesLib.h>
+#include <Library/PrintLib.h>
+
+#include <Guid/DxeServiceProfile.h>
+
+CHAR8  *mServiceString[] = {
+  "gBS->RaiseTPL",
+  "gBS->RestoreTPL",
+  "gBS->AllocatePages",
+  "gBS->FreePages",
+  "gBS->GetMemoryMap",
+  "gBS->AllocatePool",
+  "gBS->FreePool",
+  "gBS->CreateEvent",
+  "gBS->CreateEventEx",
+  "gBS->SignalEvent",
+  "gBS->InstallProtocolInterface",
+  "gBS->UninstallProtocolInterface",
+  "gBS->HandleProtocol",
+  "gBS->LocateHandle",
+  "gBS->OpenProtocol",
+  "gBS->CloseProtocol",
+  "gBS->LocateHandleBuffer",
+  "gBS->LocateProtocol",
+};
+
+//
+// Number of the most recent calls that are displayed
+//
+#define PROFILE_RECENT_RECORD_COUNT  32
+
+#define PROFILE_NAME_STRING_LENGTH  64
+CHAR8  mNameString[PROFILE_NAME_STRING_LENGTH + 1];
+
+UINT64  mFrequency;
+
+/**
+  Get a human readable name for a caller.
+  The following methods will be tried orderly:
+    1. FFS UI section
+    2. Image GUID
+
+  @param[in] Caller Pointer to the boot service profile caller.
+
+  @return The resulting Ascii name string is stored in the mNameString global array.
+
+**/
+CHAR8 *
+GetCallerNameString (
+  IN DXE_SERVICE_PROFILE_CALLER  *Caller
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      *NameString;
+  UINTN       StringSize;
+
+  if (IsZeroGuid (&Caller->FileName)) {
+    AsciiStrCpyS (mNameString, sizeof (mNameString), "Unknown");
+    return mNameString;
+  }
+
+  //
+  // Try to get the image's FFS UI section by image GUID
+  //
+  NameString = NULL;
+  StringSize = 0;
+  Status     = GetSectionFromAnyFv (
+                 &Caller->FileName,
+                 EFI_SECTION_USER_INTERFACE,
+                 0,
+                 (VOID **)&NameString,
+                 &StringSize
+                 );
+  if (!EFI_ERROR (Status)) {
+    //
+    // Method 1: Get the name string from FFS UI section
+    //
+    if (StrLen (NameString) > PROFILE_NAME_STRING_LENGTH) {
+      NameString[PROFILE_NAME_STRING_LENGTH] = 0;
+    }
+
+    UnicodeStrToAsciiStrS (NameString, mNameString, sizeof (mNameString));
+    FreePool (NameString);
+    return mNameString;
+  }
+
+  //
+  // Method 2: Get the name string from image GUID
+  //
+  AsciiSPrint (mNameString, sizeof (mNameString), "%g", &Caller->FileName);
+  return mNameString;
+}
+
+/**
+  Convert performance counter ticks to nanoseconds.
+
+  @param[in] Ticks  Number of ticks.
+
+  @return The number of nanoseconds.
+
+**/
+UINT64
+TicksToNanoSeconds (
+  IN UINT64  Ticks
+  )
+{
+  UINT64  Remainder;
+  UINT64  NanoSeconds;
+
+  //
+  // Split the conversion so that Ticks * 1000000000 does not overflow
+  //
+  NanoSeconds = MultU64x32 (DivU64x64Remainder (Ticks, mFrequency, &Remainder), 1000000000);
+  return NanoSeconds + DivU64x64Remainder (MultU64x32 (Remainder, 1000000000), mFrequency, NULL);
+}
+
+/**
+  Dump the statistics of a service.
+
+  @param[in] Service     Service index.
+  @param[in] Statistics  Pointer to the statistics of the service.
+  @param[in] Histogram   TRUE to dump the latency histogram as well.
+
+**/
+VOID
+DumpStatistics (
+  IN UINTN                           Service,
+  IN DXE_SERVICE_PROFILE_STATISTICS  *Statistics,
+  IN BOOLEAN                         Histogram
+  )
+{
+  UINTN  Bucket;
+
+  Print (
+    L"    %-32a Count - %8ld  Total - %12ld ns  Average - %10ld ns  Max - %10ld ns\n",
+    mServiceString[Service],
+    Statistics->Count,
+    TicksToNanoSeconds (Statistics->TotalTicks),
+    TicksToNanoSeconds (DivU64x64Remainder (Statistics->TotalTicks, Statistics->Count, NULL)),
+    TicksToNanoSeconds (Statistics->MaxTicks)
+    );
+
+  if (!Histogram) {
+    return;
+  }
+
+  for (Bucket = 0; Bucket < DXE_SERVICE_PROFILE_BUCKET_COUNT; Bucket++) {
+    if (Statistics->Histogram[Bucket] == 0) {
+      continue;
+    }
+
+    if (Bucket == DXE_SERVICE_PROFILE_BUCKET_COUNT - 1) {
+      Print (L"      >= %10ld ns - %d\n", TicksToNanoSeconds (LShiftU64 (1, Bucket)), Statistics->Histogram[Bucket]);
+    } else {
+      Print (L"       < %10ld ns - %d\n", TicksToNanoSeconds (LShiftU64 (1, Bucket + 1)), Statistics->Histogram[Bucket]);
+    }
+  }
+}
+
+/**
+  Accumulate the statistics of a service.
+
+  @param[in, out] Total       Pointer to the accumulated statistics.
+  @param[in]      Statistics  Pointer to the statistics to add.
+
+**/
+VOID
+AddStatistics (
+  IN OUT DXE_SERVICE_PROFILE_STATISTICS  *Total,
+  IN     DXE_SERVICE_PROFILE_STATISTICS  *Statistics
+  )
+{
+  UINTN  Bucket;
+
+  Total->Count      += Statistics->Count;
+  Total->TotalTicks += Statistics->TotalTicks;
+  Total->MaxTicks    = MAX (Total->MaxTicks, Statistics->MaxTicks);
+  for (Bucket = 0; Bucket < DXE_SERVICE_PROFILE_BUCKET_COUNT; Bucket++) {
+    Total->Histogram[Bucket] += Statistics->Histogram[Bucket];
+  }
+}
+
+/**
+  Dump the boot service latency profile.
+
+  @param[in] Table  Pointer to a copy of the boot service profile table.
+
+**/
+VOID
+DumpServiceProfile (
+  IN DXE_SERVICE_PROFILE_TABLE  *Table
+  )
+{
+  DXE_SERVICE_PROFILE_CALLER      *Callers;
+  DXE_SERVICE_PROFILE_RECORD      *Records;
+  DXE_SERVICE_PROFILE_RECORD      *Record;
+  DXE_SERVICE_PROFILE_STATISTICS  Total[DXE_SERVICE_PROFILE_SERVICE_COUNT];
+  UINT64                          CallerTicks;
+  UINTN                           CallerIndex;
+  UINTN                           Service;
+  UINTN                           Index;
+  UINTN                           RecordCount;
+
+  Callers    = (DXE_SERVICE_PROFILE_CALLER *)((UINT8 *)Table + Table->CallerOffset);
+  Records    = (DXE_SERVICE_PROFILE_RECORD *)((UINT8 *)Table + Table->RecordOffset);
+  mFrequency = Table->Frequency;
+
+  Print (L"DXE_SERVICE_PROFILE_TABLE\n");
+  Print (L"  Frequency      - %ld Hz\n", Table->Frequency);
+  Print (L"  CallerCount    - %d\n", Table->CallerCount);
+  Print (L"  MaxCallerCount - %d\n", Table->MaxCallerCount);
+  Print (L"  RecordCount    - %d\n", Table->RecordCount);
+  Print (L"  RecordIndex    - %d\n", Table->RecordIndex);
+
+  //
+  // Summary of every service over all the callers
+  //
+  ZeroMem (Total, sizeof (Total));
+  for (CallerIndex = 0; CallerIndex < Table->CallerCount; CallerIndex++) {
+    for (Service = 0; Service < DXE_SERVICE_PROFILE_SERVICE_COUNT; Service++) {
+      AddStatistics (&Total[Service], &Callers[CallerIndex].Service[Service]);
+    }
+  }
+
+  Print (L"\nAll callers:\n");
+  for (Service = 0; Service < DXE_SERVICE_PROFILE_SERVICE_COUNT; Service++) {
+    if (Total[Service].Count != 0) {
+      DumpStatistics (Service, &Total[Service], TRUE);
+    }
+  }
+
+  //
+  // Statistics of every caller
+  //
+  for (CallerIndex = 0; CallerIndex < Table->CallerCount; CallerIndex++) {
+    CallerTicks = 0;
+    for (Service = 0; Service < DXE_SERVICE_PROFILE_SERVICE_COUNT; Service++) {
+      CallerTicks += Callers[CallerIndex].Service[Service].TotalTicks;
+    }
+
+    if (CallerTicks == 0) {
+      continue;
+    }
+
+    Print (
+      L"\nCaller %d - %a (ImageBase - 0x%016lx%a) Total - %ld ns\n",
+      CallerIndex,
+      GetCallerNameString (&Callers[CallerIndex]),
+      Callers[CallerIndex].ImageBase,
+      (CallerIndex != 0 && Callers[CallerIndex].ImageSize == 0) ? ", Unloaded" : "",
+      TicksToNanoSeconds (CallerTicks)
+      );
+    for (Service = 0; Service < DXE_SERVICE_PROFILE_SERVICE_COUNT; Service++) {
+      if (Callers[CallerIndex].Service[Service].Count != 0) {
+        DumpStatistics (Service, &Callers[CallerIndex].Service[Service], FALSE);
+      }
+    }
+  }
+
+  //
+  // The most recent calls, oldest first
+  //
+  RecordCount = MIN (MIN (Table->RecordIndex, Table->RecordCount), PROFILE_RECENT_RECORD_COUNT);
+  Print (L"\nMost recent %d calls:\n", RecordCount);
+  for (Index = Table->RecordIndex - RecordCount; Index < Table->RecordIndex; Index++) {
+    Record = &Records[Index % Table->RecordCount];
+    if ((Record->Service >= DXE_SERVICE_PROFILE_SERVICE_COUNT) || (Record->Caller >= Table->CallerCount)) {
+      continue;
+    }
+
+    Print (
+      L"  %016lx %-32a %10ld ns  %a\n",
+      Record->Timestamp,
+      mServiceString[Record->Service],
+      TicksToNanoSeconds (Record->Duration),
+      GetCallerNameString (&Callers[Record->Caller])
+      );
+  }
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the image goes into a library that calls this function.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The entry point is executed successfully.
+  @retval other             Some error occurs when executing this entry point.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                 Status;
+  DXE_SERVICE_PROFILE_TABLE  *Table;
+  DXE_SERVICE_PROFILE_TABLE  *Copy;
+  UINTN                      TableSize;
+
+  Status = EfiGetSystemConfigurationTable (&gEdkiiDxeServiceProfileTableGuid, (VOID **)&Table);
+  if (EFI_ERROR (Status)) {
+    Print (L"DxeServiceProfileInfo: Boot service profile is not enabled\n");
+    return EFI_SUCCESS;
+  }
+
+  if ((Table->Signature != DXE_SERVICE_PROFILE_TABLE_SIGNATURE) ||
+      (Table->Revision != DXE_SERVICE_PROFILE_TABLE_REVISION) ||
+      (Table->ServiceCount != DXE_SERVICE_PROFILE_SERVICE_COUNT) ||
+      (Table->BucketCount != DXE_SERVICE_PROFILE_BUCKET_COUNT) ||
+      (Table->Frequency == 0))
+  {
+    Print (L"DxeServiceProfileInfo: Unsupported boot service profile\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Work on a copy, as the boot services called while dumping the profile
+  // are recorded in the table.
+  //
+  TableSize = Table->RecordOffset + Table->RecordCount * sizeof (DXE_SERVICE_PROFILE_RECORD);
+  Copy      = AllocateCopyPool (TableSize, Table);
+  if (Copy == NULL) {
+    DEBUG ((DEBUG_ERROR, "DxeServiceProfileInfo: Out of resources\n"));
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  DumpServiceProfile (Copy);
+
+  FreePool (Copy);
+  return EFI_SUCCESS;
+}
@@ -51,10 +51,36 @@ LIST_ENTRY  mScheduledQueue = INITIALIZE_LIST_HEAD_VARIABLE (mScheduledQueue);
 LIST_ENTRY  mFvHandleList = INITIALIZE_LIST_HEAD_VARIABLE (mFvHandleList);           // list of KNOWN_HANDLE
 
 //
-// Lock for mDiscoveredList, mScheduledQueue, gDispatcherRunning.
+// Lock for mDiscoveredList, mScheduledQueue, gDispatcherRunning, mDepexProtocolIndex.
 //
 EFI_LOCK  mDispatcherLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 
+//
+// Every protocol GUID pushed by the dependency expression of a Dependent driver
+// is recorded in mDepexProtocolIndex, so that the installation of a protocol
+// only flags the drivers that may have become dispatchable. A dependency
+// expression that is not flagged is known to still evaluate to FALSE, as
+// CoreIsSchedulable() never reconsiders a protocol once it has been found.
+//
+#define DEPEX_PROTOCOL_HASH_BUCKET_COUNT  64
+
+#define DEPEX_PROTOCOL_REFERENCE_SIGNATURE  SIGNATURE_32('d','p','x','r')
+typedef struct {
+  UINTN                    Signature;
+  LIST_ENTRY               Link;            // mDepexProtocolIndex[]
+  EFI_GUID                 Protocol;
+  EFI_CORE_DRIVER_ENTRY    *DriverEntry;
+} DEPEX_PROTOCOL_REFERENCE;
+
+LIST_ENTRY  mDepexProtocolIndex[DEPEX_PROTOCOL_HASH_BUCKET_COUNT];
+BOOLEAN     mDepexProtocolIndexInitialized = FALSE;
+
+//
+// Number of dependency expressions evaluated and skipped by CoreDispatcher()
+//
+UINTN  mDepexEvaluationCount = 0;
+UINTN  mDepexSkippedCount    = 0;
+
 //
 // Flag for the DXE Dispacher.  TRUE if dispatcher is execuing.
 //
@@ -219,6 +245,186 @@ CoreReleaseDispatcherLock (
   CoreReleaseLock (&mDispatcherLock);
 }
 
+/**
+  Return the bucket of mDepexProtocolIndex for a protocol GUID.
+
+  @param  Protocol              The protocol GUID.
+
+  @return The index of the bucket.
+
+**/
+UINTN
+CoreDepexProtocolHashIndex (
+  IN CONST EFI_GUID  *Protocol
+  )
+{
+  return (UINTN)(CoreGuidHash (Protocol) & (DEPEX_PROTOCOL_HASH_BUCKET_COUNT - 1));
+}
+
+/**
+  Remove the protocol GUIDs of the dependency expression of a driver from
+  mDepexProtocolIndex.
+
+  @param  DriverEntry           Driver to remove from the index.
+
+**/
+VOID
+CoreUnindexDepexProtocols (
+  IN  EFI_CORE_DRIVER_ENTRY  *DriverEntry
+  )
+{
+  DEPEX_PROTOCOL_REFERENCE  *References;
+  UINTN                     Index;
+
+  if (!DriverEntry->DepexIndexed) {
+    return;
+  }
+
+  CoreAcquireDispatcherLock ();
+
+  References = DriverEntry->DepexReferences;
+  for (Index = 0; Index < DriverEntry->DepexReferenceCount; Index++) {
+    RemoveEntryList (&References[Index].Link);
+  }
+
+  DriverEntry->DepexIndexed        = FALSE;
+  DriverEntry->DepexReferences     = NULL;
+  DriverEntry->DepexReferenceCount = 0;
+
+  CoreReleaseDispatcherLock ();
+
+  if (References != NULL) {
+    FreePool (References);
+  }
+}
+
+/**
+  Record the protocol GUIDs pushed by the dependency expression of a driver in
+  mDepexProtocolIndex, in place of the ones of its previous dependency
+  expression. If the references cannot be allocated, the driver is left out of
+  the index and its dependency expression is evaluated on every pass.
+
+  @param  DriverEntry           Driver to index.
+
+**/
+VOID
+CoreIndexDepexProtocols (
+  IN  EFI_CORE_DRIVER_ENTRY  *DriverEntry
+  )
+{
+  UINT8                     *Iterator;
+  UINT8                     *End;
+  UINTN                     Count;
+  UINTN                     Index;
+  UINTN                     Bucket;
+  DEPEX_PROTOCOL_REFERENCE  *References;
+
+  CoreUnindexDepexProtocols (DriverEntry);
+  DriverEntry->DepexChanged = TRUE;
+
+  if ((DriverEntry->Depex == NULL) || DriverEntry->Before || DriverEntry->After) {
+    return;
+  }
+
+  //
+  // Count the GUIDs pushed by the expression. Opcodes other than PUSH and
+  // REPLACE_TRUE are a single byte.
+  //
+  Count    = 0;
+  Iterator = DriverEntry->Depex;
+  End      = Iterator + DriverEntry->DepexSize;
+  while (Iterator < End) {
+    if ((*Iterator == EFI_DEP_PUSH) || (*Iterator == EFI_DEP_REPLACE_TRUE)) {
+      if ((UINTN)(End - Iterator) <= sizeof (EFI_GUID)) {
+        //
+        // Malformed expression, let CoreIsSchedulable() deal with it
+        //
+        return;
+      }
+
+      Count++;
+      Iterator += sizeof (EFI_GUID);
+    } else if (*Iterator == EFI_DEP_END) {
+      break;
+    }
+
+    Iterator++;
+  }
+
+  References = NULL;
+  if (Count != 0) {
+    References = AllocatePool (Count * sizeof (DEPEX_PROTOCOL_REFERENCE));
+    if (References == NULL) {
+      return;
+    }
+  }
+
+  CoreAcquireDispatcherLock ();
+
+  if (!mDepexProtocolIndexInitialized) {
+    for (Bucket = 0; Bucket < DEPEX_PROTOCOL_HASH_BUCKET_COUNT; Bucket++) {
+      InitializeListHead (&mDepexProtocolIndex[Bucket]);
+    }
+
+    mDepexProtocolIndexInitialized = TRUE;
+  }
+
+  Index    = 0;
+  Iterator = DriverEntry->Depex;
+  while (Index < Count) {
+    if ((*Iterator == EFI_DEP_PUSH) || (*Iterator == EFI_DEP_REPLACE_TRUE)) {
+      References[Index].Signature   = DEPEX_PROTOCOL_REFERENCE_SIGNATURE;
+      References[Index].DriverEntry = DriverEntry;
+      CopyGuid (&References[Index].Protocol, (EFI_GUID *)(Iterator + 1));
+      Bucket = CoreDepexProtocolHashIndex (&References[Index].Protocol);
+      InsertTailList (&mDepexProtocolIndex[Bucket], &References[Index].Link);
+      Index++;
+      Iterator += sizeof (EFI_GUID);
+    }
+
+    Iterator++;
+  }
+
+  DriverEntry->DepexIndexed        = TRUE;
+  DriverEntry->DepexReferences     = References;
+  DriverEntry->DepexReferenceCount = Count;
+
+  CoreReleaseDispatcherLock ();
+}
+
+/**
+  Flag the drivers whose dependency expression references Protocol, so that
+  the dispatcher evaluates them again.
+
+  @param  Protocol              The protocol that has been installed.
+
+**/
+VOID
+CoreDepexProtocolInstalled (
+  IN CONST EFI_GUID  *Protocol
+  )
+{
+  LIST_ENTRY                *Link;
+  LIST_ENTRY                *Bucket;
+  DEPEX_PROTOCOL_REFERENCE  *Reference;
+
+  if (!mDepexProtocolIndexInitialized) {
+    return;
+  }
+
+  CoreAcquireDispatcherLock ();
+
+  Bucket = &mDepexProtocolIndex[CoreDepexProtocolHashIndex (Protocol)];
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    Reference = CR (Link, DEPEX_PROTOCOL_REFERENCE, Link, DEPEX_PROTOCOL_REFERENCE_SIGNATURE);
+    if (CompareGuid (&Reference->Protocol, Protocol)) {
+      Reference->DriverEntry->DepexChanged = TRUE;
+    }
+  }
+
+  CoreReleaseDispatcherLock ();
+}
+
 /**
   Read Depex and pre-process the Depex for Before and After. If Section Extraction
   protocol returns an error via ReadSection defer the reading of the Depex.
@@ -277,6 +483,7 @@ CoreGetDepexSectionAndPreProccess (
     //
     CorePreProcessDepex (DriverEntry);
     DriverEntry->DepexProtocolError = FALSE;
+    CoreIndexDepexProtocols (DriverEntry);
   }
 
   return Status;
@@ -552,6 +759,21 @@ CoreDispatcher (
       }
 
       if (DriverEntry->Dependent) {
+        if (DriverEntry->DepexIndexed && !DriverEntry->DepexChanged) {
+          //
+          // None of the protocols of the Depex was installed since it last
+          // evaluated to FALSE
+          //
+          mDepexSkippedCount++;
+          continue;
+        }
+
+        //
+        // Clear the flag first, a protocol may be installed while evaluating
+        //
+        DriverEntry->DepexChanged = FALSE;
+        mDepexEvaluationCount++;
+
         if (CoreIsSchedulable (DriverEntry)) {
           CoreInsertOnScheduledQueueWhileProcessingBeforeAndAfter (DriverEntry);
           ReadyToRun = TRUE;
@@ -566,6 +788,13 @@ CoreDispatcher (
     }
   } while (ReadyToRun);
 
+  DEBUG ((
+    DEBUG_DISPATCH,
+    "DXE DEPEX evaluations: %ld, skipped as unchanged: %ld\n",
+    (UINT64)mDepexEvaluationCount,
+    (UINT64)mDepexSkippedCount
+    ));
+
   //
   // Close DXE dispatch Event
   //
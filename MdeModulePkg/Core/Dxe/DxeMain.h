@@ -69,6 +69,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseLib.h>
 #include <Library/HobLib.h>
 #include <Library/PerformanceLib.h>
+#include <Library/TimerLib.h>
 #include <Library/UefiDecompressLib.h>
 #include <Library/ExtractGuidedSectionLib.h>
 #include <Library/CacheMaintenanceLib.h>
@@ -158,10 +159,55 @@ typedef struct {
   BOOLEAN                          Initialized;
   BOOLEAN                          DepexProtocolError;
 
+  BOOLEAN                          DepexIndexed;    // Depex GUIDs are in mDepexProtocolIndex
+  BOOLEAN                          DepexChanged;    // A Depex GUID was installed since the last evaluation
+  VOID                             *DepexReferences; // Entries of the driver in mDepexProtocolIndex
+  UINTN                            DepexReferenceCount;
+
   EFI_HANDLE                       ImageHandle;
   BOOLEAN                          IsFvImage;
 } EFI_CORE_DRIVER_ENTRY;
 
+//
+// Node of a range tree, embedded in the structure that describes a range.
+// The tree is a treap ordered by the start address of the ranges, so the
+// nodes need no allocation, and each node records the length of the largest
+// range in its subtree so that searches can skip subtrees that are too small.
+//
+typedef struct _RANGE_TREE_NODE RANGE_TREE_NODE;
+struct _RANGE_TREE_NODE {
+  RANGE_TREE_NODE    *Parent;
+  RANGE_TREE_NODE    *Left;
+  RANGE_TREE_NODE    *Right;
+  UINT32             Priority;
+  UINT64             MaxLength;
+};
+
+/**
+  Return the range described by the structure a range tree node is embedded in.
+
+  @param  Node               The range tree node
+  @param  Start              Returns the first address of the range
+  @param  End                Returns the last address of the range
+
+**/
+typedef
+VOID
+(*RANGE_TREE_GET_RANGE)(
+  IN  RANGE_TREE_NODE  *Node,
+  OUT UINT64           *Start,
+  OUT UINT64           *End
+  );
+
+//
+// A range tree indexes ranges that do not overlap.
+//
+typedef struct {
+  RANGE_TREE_NODE         *Root;
+  RANGE_TREE_GET_RANGE    GetRange;
+  UINT32                  Seed;
+} RANGE_TREE;
+
 //
 // The data structure of GCD memory map entry
 //
@@ -177,6 +223,7 @@ typedef struct {
   EFI_GCD_IO_TYPE         GcdIoType;
   EFI_HANDLE              ImageHandle;
   EFI_HANDLE              DeviceHandle;
+  RANGE_TREE_NODE         TreeNode;
 } EFI_GCD_MAP_ENTRY;
 
 #define LOADED_IMAGE_PRIVATE_DATA_SIGNATURE  SIGNATURE_32('l','d','r','i')
@@ -478,6 +525,18 @@ CoreIsSchedulable (
   IN  EFI_CORE_DRIVER_ENTRY  *DriverEntry
   );
 
+/**
+  Flag the drivers whose dependency expression references Protocol, so that
+  the dispatcher evaluates them again.
+
+  @param  Protocol              The protocol that has been installed.
+
+**/
+VOID
+CoreDepexProtocolInstalled (
+  IN CONST EFI_GUID  *Protocol
+  );
+
 /**
   Preprocess dependency expression and update DriverEntry to reflect the
   state of  Before, After, and SOR dependencies. If DriverEntry->Before
@@ -539,6 +598,27 @@ CoreNotifySignalList (
   IN EFI_GUID  *EventGroup
   );
 
+/**
+  Allocate the event group statistics table and install it as a configuration
+  table, if performance measurement is enabled.
+
+**/
+VOID
+CoreInitializeEventGroupStatistics (
+  VOID
+  );
+
+/**
+  Print the dispatch statistics of all event groups that have been signaled.
+
+  The statistics are only collected while performance measurement is enabled.
+
+**/
+VOID
+CoreDumpEventGroupStatistics (
+  VOID
+  );
+
 /**
   Boot Service called to add, modify, or remove a system configuration table from
   the EFI System Table.
@@ -2515,6 +2595,114 @@ CoreReleaseLock (
   IN EFI_LOCK  *Lock
   );
 
+/**
+  Compute a 32-bit hash of a GUID, for the hash tables of the core that are
+  indexed by GUID. The low bits depend on every byte of the GUID, so the hash
+  can be masked to a power of two bucket count.
+
+  @param  Guid               The GUID to hash
+
+  @return The hash of the GUID
+
+**/
+UINT32
+CoreGuidHash (
+  IN CONST EFI_GUID  *Guid
+  );
+
+/**
+  Insert a node into a range tree. The range of the node must not overlap the
+  ranges already in the tree.
+
+  @param  Tree               The range tree
+  @param  Node               The node to insert
+
+**/
+VOID
+CoreRangeTreeInsert (
+  IN OUT RANGE_TREE       *Tree,
+  IN OUT RANGE_TREE_NODE  *Node
+  );
+
+/**
+  Remove a node from a range tree. The range of the node is not used, so it
+  may already have been changed or emptied.
+
+  @param  Tree               The range tree
+  @param  Node               The node to remove
+
+**/
+VOID
+CoreRangeTreeRemove (
+  IN OUT RANGE_TREE       *Tree,
+  IN OUT RANGE_TREE_NODE  *Node
+  );
+
+/**
+  Update a range tree after the range of one of its nodes was resized. The
+  range must keep its position relative to the other ranges of the tree.
+
+  @param  Tree               The range tree
+  @param  Node               The node whose range was resized
+
+**/
+VOID
+CoreRangeTreeUpdate (
+  IN OUT RANGE_TREE       *Tree,
+  IN OUT RANGE_TREE_NODE  *Node
+  );
+
+/**
+  Find the node of a range tree whose range contains an address.
+
+  @param  Tree               The range tree
+  @param  Address            The address to look for
+
+  @return The node that contains Address, or NULL if there is none
+
+**/
+RANGE_TREE_NODE *
+CoreRangeTreeFind (
+  IN RANGE_TREE  *Tree,
+  IN UINT64      Address
+  );
+
+/**
+  Find the node of a range tree with the highest range that starts at or
+  below an address and is at least a given length.
+
+  @param  Tree               The range tree
+  @param  Address            The highest start address of the range
+  @param  MinLength          The minimum length of the range
+
+  @return The node found, or NULL if there is none
+
+**/
+RANGE_TREE_NODE *
+CoreRangeTreeFindLast (
+  IN RANGE_TREE  *Tree,
+  IN UINT64      Address,
+  IN UINT64      MinLength
+  );
+
+/**
+  Find the node of a range tree with the highest range below the range of a
+  node that is at least a given length.
+
+  @param  Tree               The range tree
+  @param  Node               The node to start from
+  @param  MinLength          The minimum length of the range
+
+  @return The node found, or NULL if there is none
+
+**/
+RANGE_TREE_NODE *
+CoreRangeTreeFindPrevious (
+  IN RANGE_TREE       *Tree,
+  IN RANGE_TREE_NODE  *Node,
+  IN UINT64           MinLength
+  );
+
 /**
   Read data from Firmware Block by FVB protocol Read.
   The data may cross the multi block ranges.
@@ -2802,4 +2990,39 @@ MergeMemoryMap (
   IN UINTN                      DescriptorSize
   );
 
+/**
+  Allocate the boot service profile, install it as a configuration table and
+  replace the profiled services in gBS, if PcdDxeServiceProfileRecordCount is
+  not zero.
+
+**/
+VOID
+CoreInitializeServiceProfile (
+  VOID
+  );
+
+/**
+  Register an image that is about to be started, so that the boot service
+  calls it makes are attributed to it.
+
+  @param  Image  The image that is about to be started.
+
+**/
+VOID
+CoreServiceProfileRegisterImage (
+  IN LOADED_IMAGE_PRIVATE_DATA  *Image
+  );
+
+/**
+  Unregister an image that is being unloaded. The calls it made stay in the
+  profile, but no more calls are attributed to it.
+
+  @param  Image  The image that is being unloaded.
+
+**/
+VOID
+CoreServiceProfileUnregisterImage (
+  IN LOADED_IMAGE_PRIVATE_DATA  *Image
+  );
+
 #endif
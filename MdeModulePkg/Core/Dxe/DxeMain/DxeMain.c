@@ -451,6 +451,8 @@ DxeMain (
   ASSERT_EFI_ERROR (Status);
 
   MemoryProfileInstallProtocol ();
+  CoreInitializeServiceProfile ();
+  CoreInitializeEventGroupStatistics ();
 
   CoreInitializeMemoryAttributesTable ();
   CoreInitializeMemoryProtection ();
@@ -787,6 +789,12 @@ CoreExitBootServices (
   //
   CoreNotifySignalList (&gEfiEventExitBootServicesGuid);
 
+  //
+  // Report how long each event group took to notify, including the exit boot
+  // services group that has just been signaled
+  //
+  CoreDumpEventGroupStatistics ();
+
   //
   // Report that ExitBootServices() has been called
   //
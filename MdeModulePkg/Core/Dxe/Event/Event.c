@@ -10,6 +10,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "DxeMain.h"
 #include "Event.h"
 
+#include <Guid/EventGroupStatistics.h>
+
 ///
 /// gEfiCurrentTpl - Current Task priority level
 ///
@@ -31,9 +33,26 @@ LIST_ENTRY  gEventQueue[TPL_HIGH_LEVEL + 1];
 UINTN  gEventPending = 0;
 
 ///
-/// gEventSignalQueue - A list of events to signal based on EventGroup type
+/// gEventSignalQueue - Hash buckets of the event groups, each EVENT_GROUP_ENTRY
+/// holds the list of events to signal for its EventGroup
+///
+LIST_ENTRY  gEventSignalQueue[EVENT_GROUP_HASH_BUCKET_COUNT];
+BOOLEAN     mEventSignalQueueInitialized = FALSE;
+
+///
+/// Group of the EVT_NOTIFY_SIGNAL events created without an EventGroup
 ///
-LIST_ENTRY  gEventSignalQueue = INITIALIZE_LIST_HEAD_VARIABLE (gEventSignalQueue);
+EFI_GUID  mEventGroupNone = {
+  0x00000000, 0x0000, 0x0000, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
+};
+
+///
+/// Dispatch statistics of the event groups. They are only collected, and
+/// published as a configuration table, while performance measurement is
+/// enabled. The table is protected by gEventQueueLock.
+///
+EVENT_GROUP_STATISTICS_TABLE  *mEventGroupStatistics       = NULL;
+BOOLEAN                       mEventGroupCounterCountsDown = FALSE;
 
 ///
 /// Enumerate the valid types
@@ -141,6 +160,284 @@ CoreInitializeEventServices (
   return EFI_SUCCESS;
 }
 
+/**
+  Compute the hash bucket index of an EventGroup GUID.
+
+  @param  EventGroup             The event group GUID
+
+  @return Index into gEventSignalQueue
+
+**/
+UINTN
+CoreEventGroupHashIndex (
+  IN CONST EFI_GUID  *EventGroup
+  )
+{
+  return (UINTN)(CoreGuidHash (EventGroup) & (EVENT_GROUP_HASH_BUCKET_COUNT - 1));
+}
+
+/**
+  Find the entry of an event group. The event database must be locked.
+
+  @param  EventGroup             The event group GUID
+
+  @return The event group entry, or NULL if no event was ever created in it
+
+**/
+EVENT_GROUP_ENTRY *
+CoreFindEventGroup (
+  IN CONST EFI_GUID  *EventGroup
+  )
+{
+  UINTN              Index;
+  LIST_ENTRY         *Link;
+  LIST_ENTRY         *Bucket;
+  EVENT_GROUP_ENTRY  *Group;
+
+  ASSERT_LOCKED (&gEventQueueLock);
+
+  if (!mEventSignalQueueInitialized) {
+    for (Index = 0; Index < EVENT_GROUP_HASH_BUCKET_COUNT; Index++) {
+      InitializeListHead (&gEventSignalQueue[Index]);
+    }
+
+    mEventSignalQueueInitialized = TRUE;
+  }
+
+  Bucket = &gEventSignalQueue[CoreEventGroupHashIndex (EventGroup)];
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    Group = CR (Link, EVENT_GROUP_ENTRY, Link, EVENT_GROUP_ENTRY_SIGNATURE);
+    if (CompareGuid (&Group->EventGroup, EventGroup)) {
+      return Group;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Return the dispatch statistics of an event group. The event database must be
+  locked.
+
+  @param  Group                  The event group entry
+
+  @return The statistics of the group, or NULL if the group is not measured
+
+**/
+EVENT_GROUP_STATISTICS *
+CoreGetEventGroupStatistics (
+  IN EVENT_GROUP_ENTRY  *Group
+  )
+{
+  ASSERT_LOCKED (&gEventQueueLock);
+
+  if ((mEventGroupStatistics == NULL) || (Group->StatisticsIndex >= mEventGroupStatistics->GroupCount)) {
+    return NULL;
+  }
+
+  return (EVENT_GROUP_STATISTICS *)(mEventGroupStatistics + 1) + Group->StatisticsIndex;
+}
+
+/**
+  Add a new event group to the statistics table, growing the table when it is
+  full. The event database must not be locked.
+
+  @param  Group                  The event group entry
+
+**/
+VOID
+CoreAddEventGroupStatistics (
+  IN EVENT_GROUP_ENTRY  *Group
+  )
+{
+  EVENT_GROUP_STATISTICS_TABLE  *NewTable;
+  EVENT_GROUP_STATISTICS_TABLE  *OldTable;
+  EVENT_GROUP_STATISTICS        *Statistics;
+  UINT32                        MaxGroupCount;
+
+  if (mEventGroupStatistics == NULL) {
+    return;
+  }
+
+  //
+  // Pool can not be allocated while the event lock is held
+  //
+  NewTable      = NULL;
+  OldTable      = NULL;
+  MaxGroupCount = mEventGroupStatistics->MaxGroupCount;
+  if (mEventGroupStatistics->GroupCount == MaxGroupCount) {
+    MaxGroupCount = MaxGroupCount * 2;
+    NewTable      = AllocatePool (sizeof (EVENT_GROUP_STATISTICS_TABLE) + MaxGroupCount * sizeof (EVENT_GROUP_STATISTICS));
+  }
+
+  CoreAcquireEventLock ();
+
+  //
+  // Another group may have grown the table in the meantime
+  //
+  if ((NewTable != NULL) && (mEventGroupStatistics->MaxGroupCount < MaxGroupCount)) {
+    CopyMem (
+      NewTable,
+      mEventGroupStatistics,
+      sizeof (EVENT_GROUP_STATISTICS_TABLE) + mEventGroupStatistics->GroupCount * sizeof (EVENT_GROUP_STATISTICS)
+      );
+    NewTable->MaxGroupCount = MaxGroupCount;
+    OldTable                = mEventGroupStatistics;
+    mEventGroupStatistics   = NewTable;
+    NewTable                = NULL;
+  }
+
+  if (mEventGroupStatistics->GroupCount < mEventGroupStatistics->MaxGroupCount) {
+    Group->StatisticsIndex = mEventGroupStatistics->GroupCount;
+    mEventGroupStatistics->GroupCount++;
+    Statistics = CoreGetEventGroupStatistics (Group);
+    ZeroMem (Statistics, sizeof (EVENT_GROUP_STATISTICS));
+    CopyGuid (&Statistics->EventGroup, &Group->EventGroup);
+  }
+
+  CoreReleaseEventLock ();
+
+  if (NewTable != NULL) {
+    CoreFreePool (NewTable);
+  }
+
+  if (OldTable != NULL) {
+    CoreInstallConfigurationTable (&gEdkiiEventGroupStatisticsTableGuid, mEventGroupStatistics);
+    CoreFreePool (OldTable);
+  }
+}
+
+/**
+  Allocate the event group statistics table and install it as a configuration
+  table, if performance measurement is enabled.
+
+**/
+VOID
+CoreInitializeEventGroupStatistics (
+  VOID
+  )
+{
+  EVENT_GROUP_STATISTICS_TABLE  *Table;
+  UINT64                        StartValue;
+  UINT64                        EndValue;
+  EFI_STATUS                    Status;
+  UINTN                         Index;
+  LIST_ENTRY                    *Link;
+  LIST_ENTRY                    *Bucket;
+  EVENT_GROUP_ENTRY             *Group;
+  EVENT_GROUP_STATISTICS        *Statistics;
+
+  if (!PerformanceMeasurementEnabled ()) {
+    return;
+  }
+
+  Table = AllocateZeroPool (
+            sizeof (EVENT_GROUP_STATISTICS_TABLE) +
+            EVENT_GROUP_STATISTICS_INITIAL_COUNT * sizeof (EVENT_GROUP_STATISTICS)
+            );
+  if (Table == NULL) {
+    return;
+  }
+
+  Table->Signature             = EVENT_GROUP_STATISTICS_TABLE_SIGNATURE;
+  Table->Revision              = EVENT_GROUP_STATISTICS_TABLE_REVISION;
+  Table->HeaderSize            = sizeof (EVENT_GROUP_STATISTICS_TABLE);
+  Table->Frequency             = GetPerformanceCounterProperties (&StartValue, &EndValue);
+  Table->MaxGroupCount         = EVENT_GROUP_STATISTICS_INITIAL_COUNT;
+  mEventGroupCounterCountsDown = (BOOLEAN)(StartValue > EndValue);
+
+  Status = CoreInstallConfigurationTable (&gEdkiiEventGroupStatisticsTableGuid, Table);
+  if (EFI_ERROR (Status)) {
+    CoreFreePool (Table);
+    return;
+  }
+
+  //
+  // Library constructors may already have created events in some groups
+  //
+  CoreAcquireEventLock ();
+  mEventGroupStatistics = Table;
+  if (mEventSignalQueueInitialized) {
+    for (Index = 0; Index < EVENT_GROUP_HASH_BUCKET_COUNT; Index++) {
+      Bucket = &gEventSignalQueue[Index];
+      for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+        Group = CR (Link, EVENT_GROUP_ENTRY, Link, EVENT_GROUP_ENTRY_SIGNATURE);
+        if (Table->GroupCount < Table->MaxGroupCount) {
+          Group->StatisticsIndex = Table->GroupCount;
+          Table->GroupCount++;
+          Statistics = CoreGetEventGroupStatistics (Group);
+          CopyGuid (&Statistics->EventGroup, &Group->EventGroup);
+        }
+      }
+    }
+  }
+
+  CoreReleaseEventLock ();
+}
+
+/**
+  Find the entry of an event group, creating it if it does not exist yet.
+  The event database must not be locked.
+
+  @param  EventGroup             The event group GUID
+
+  @return The event group entry, or NULL if it could not be allocated
+
+**/
+EVENT_GROUP_ENTRY *
+CoreGetEventGroup (
+  IN CONST EFI_GUID  *EventGroup
+  )
+{
+  EVENT_GROUP_ENTRY  *Group;
+  EVENT_GROUP_ENTRY  *NewGroup;
+
+  CoreAcquireEventLock ();
+  Group = CoreFindEventGroup (EventGroup);
+  CoreReleaseEventLock ();
+
+  if (Group != NULL) {
+    return Group;
+  }
+
+  //
+  // Pool can not be allocated while the event lock is held
+  //
+  NewGroup = AllocateZeroPool (sizeof (EVENT_GROUP_ENTRY));
+  if (NewGroup == NULL) {
+    return NULL;
+  }
+
+  NewGroup->Signature       = EVENT_GROUP_ENTRY_SIGNATURE;
+  NewGroup->StatisticsIndex = MAX_UINTN;
+  CopyGuid (&NewGroup->EventGroup, EventGroup);
+  InitializeListHead (&NewGroup->SignalQueue);
+
+  //
+  // Another event may have created the group in the meantime
+  //
+  CoreAcquireEventLock ();
+  Group = CoreFindEventGroup (EventGroup);
+  if (Group == NULL) {
+    InsertTailList (
+      &gEventSignalQueue[CoreEventGroupHashIndex (EventGroup)],
+      &NewGroup->Link
+      );
+    Group    = NewGroup;
+    NewGroup = NULL;
+  }
+
+  CoreReleaseEventLock ();
+
+  if (NewGroup != NULL) {
+    CoreFreePool (NewGroup);
+  } else {
+    CoreAddEventGroupStatistics (Group);
+  }
+
+  return Group;
+}
+
 /**
   Dispatches all pending events.
 
@@ -153,8 +450,12 @@ CoreDispatchEventNotifies (
   IN EFI_TPL  Priority
   )
 {
-  IEVENT      *Event;
-  LIST_ENTRY  *Head;
+  IEVENT                  *Event;
+  LIST_ENTRY              *Head;
+  EVENT_GROUP_ENTRY       *Group;
+  EVENT_GROUP_STATISTICS  *Statistics;
+  UINT64                  StartTime;
+  UINT64                  EndTime;
 
   CoreAcquireEventLock ();
   ASSERT (gEventQueueLock.OwnerTpl == Priority);
@@ -177,6 +478,17 @@ CoreDispatchEventNotifies (
       Event->SignalCount = 0;
     }
 
+    //
+    // Charge the notification time to the event group. The event may be
+    // closed by its own notification function, so keep the group aside.
+    //
+    Group     = NULL;
+    StartTime = 0;
+    if (((Event->ExFlag & EVT_EXFLAG_EVENT_GROUP) != 0) && (mEventGroupStatistics != NULL)) {
+      Group     = Event->Group;
+      StartTime = GetPerformanceCounter ();
+    }
+
     CoreReleaseEventLock ();
 
     //
@@ -185,10 +497,23 @@ CoreDispatchEventNotifies (
     ASSERT (Event->NotifyFunction != NULL);
     Event->NotifyFunction (Event, Event->NotifyContext);
 
+    EndTime = 0;
+    if (Group != NULL) {
+      EndTime = GetPerformanceCounter ();
+    }
+
     //
     // Check for next pending event
     //
     CoreAcquireEventLock ();
+
+    if (Group != NULL) {
+      Statistics = CoreGetEventGroupStatistics (Group);
+      if (Statistics != NULL) {
+        Statistics->NotifyCount++;
+        Statistics->NotifyTicks += mEventGroupCounterCountsDown ? StartTime - EndTime : EndTime - StartTime;
+      }
+    }
   }
 
   gEventPending &= ~(UINTN)(1 << Priority);
@@ -239,16 +564,24 @@ CoreNotifySignalList (
   IN EFI_GUID  *EventGroup
   )
 {
-  LIST_ENTRY  *Link;
-  LIST_ENTRY  *Head;
-  IEVENT      *Event;
+  LIST_ENTRY              *Link;
+  LIST_ENTRY              *Head;
+  IEVENT                  *Event;
+  EVENT_GROUP_ENTRY       *Group;
+  EVENT_GROUP_STATISTICS  *Statistics;
 
   CoreAcquireEventLock ();
 
-  Head = &gEventSignalQueue;
-  for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
-    Event = CR (Link, IEVENT, SignalLink, EVENT_SIGNATURE);
-    if (CompareGuid (&Event->EventGroup, EventGroup)) {
+  Group = CoreFindEventGroup (EventGroup);
+  if (Group != NULL) {
+    Statistics = CoreGetEventGroupStatistics (Group);
+    if (Statistics != NULL) {
+      Statistics->SignalCount++;
+    }
+
+    Head = &Group->SignalQueue;
+    for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
+      Event = CR (Link, IEVENT, SignalLink, EVENT_SIGNATURE);
       CoreNotifyEvent (Event);
     }
   }
@@ -256,6 +589,42 @@ CoreNotifySignalList (
   CoreReleaseEventLock ();
 }
 
+/**
+  Print the dispatch statistics of all event groups that have been signaled.
+
+  The statistics are only collected while performance measurement is enabled.
+
+**/
+VOID
+CoreDumpEventGroupStatistics (
+  VOID
+  )
+{
+  UINTN                   Index;
+  EVENT_GROUP_STATISTICS  *Statistics;
+
+  if (mEventGroupStatistics == NULL) {
+    return;
+  }
+
+  DEBUG ((DEBUG_INFO, "Event group dispatch statistics:\n"));
+  Statistics = (EVENT_GROUP_STATISTICS *)(mEventGroupStatistics + 1);
+  for (Index = 0; Index < mEventGroupStatistics->GroupCount; Index++) {
+    if (Statistics[Index].NotifyCount == 0) {
+      continue;
+    }
+
+    DEBUG ((
+      DEBUG_INFO,
+      "  %g Signaled: %ld Notified: %ld Time: %ld us\n",
+      &Statistics[Index].EventGroup,
+      Statistics[Index].SignalCount,
+      Statistics[Index].NotifyCount,
+      DivU64x32 (GetTimeInNanoSecond (Statistics[Index].NotifyTicks), 1000)
+      ));
+  }
+}
+
 /**
   Creates an event.
 
@@ -364,9 +733,10 @@ CoreCreateEventInternal (
   OUT EFI_EVENT        *Event
   )
 {
-  EFI_STATUS  Status;
-  IEVENT      *IEvent;
-  INTN        Index;
+  EFI_STATUS         Status;
+  IEVENT             *IEvent;
+  INTN               Index;
+  EVENT_GROUP_ENTRY  *Group;
 
   if (Event == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -437,6 +807,18 @@ CoreCreateEventInternal (
     NotifyContext  = NULL;
   }
 
+  //
+  // Look up the group the event will be signaled with. Events that are not
+  // part of an event group share a single group keyed by the zero GUID.
+  //
+  Group = NULL;
+  if ((Type & EVT_NOTIFY_SIGNAL) != 0x00000000) {
+    Group = CoreGetEventGroup ((EventGroup != NULL) ? EventGroup : &mEventGroupNone);
+    if (Group == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
   //
   // Allocate and initialize a new event structure.
   //
@@ -489,7 +871,8 @@ CoreCreateEventInternal (
     //
     // The Event's NotifyFunction must be queued whenever the event is signaled
     //
-    InsertHeadList (&gEventSignalQueue, &IEvent->SignalLink);
+    IEvent->Group = Group;
+    InsertHeadList (&Group->SignalQueue, &IEvent->SignalLink);
   }
 
   CoreReleaseEventLock ();
@@ -22,6 +22,37 @@ extern  UINTN  gEventPending;
 ///
 #define EVT_EXFLAG_EVENT_PROTOCOL_NOTIFICATION  0x02
 
+///
+/// Number of hash buckets used to index the event groups
+///
+#define EVENT_GROUP_HASH_BUCKET_COUNT  32
+
+///
+/// Number of event groups the statistics table is first allocated for. It is
+/// doubled whenever it is full.
+///
+#define EVENT_GROUP_STATISTICS_INITIAL_COUNT  64
+
+///
+/// Event group entry. One is created for every distinct EventGroup GUID used
+/// by an EVT_NOTIFY_SIGNAL event, and collects the members of the group so
+/// that signaling a group only visits its own events. Entries are never freed.
+///
+#define EVENT_GROUP_ENTRY_SIGNATURE  SIGNATURE_32('e','v','g','p')
+typedef struct {
+  UINTN         Signature;
+  /// Link on the EventGroup hash bucket
+  LIST_ENTRY    Link;
+  EFI_GUID      EventGroup;
+  /// All events in this group, linked by IEVENT.SignalLink
+  LIST_ENTRY    SignalQueue;
+  ///
+  /// Index of the dispatch statistics of the group in the event group
+  /// statistics table, or MAX_UINTN if the group is not measured
+  ///
+  UINTN         StatisticsIndex;
+} EVENT_GROUP_ENTRY;
+
 //
 // EFI_EVENT
 //
@@ -44,6 +75,7 @@ typedef struct {
   /// Entry if the event is registered to be signalled
   ///
   LIST_ENTRY                 SignalLink;
+  EVENT_GROUP_ENTRY          *Group;
   ///
   /// Notification information for this event
   ///
@@ -214,3 +214,19 @@ IsValidFfsFile (
       return FALSE;
   }
 }
+
+/**
+  Compute the hash bucket index of a FFS file name.
+
+  @param  NameGuid       The file name
+
+  @return Index into FV_DEVICE.FfsFileHashTable
+
+**/
+UINTN
+FfsFileNameHashIndex (
+  IN CONST EFI_GUID  *NameGuid
+  )
+{
+  return (UINTN)(CoreGuidHash (NameGuid) & (FFS_FILE_HASH_BUCKET_COUNT - 1));
+}
@@ -420,6 +420,9 @@ FvCheck (
   //
   Status = EFI_SUCCESS;
   InitializeListHead (&FvDevice->FfsFileListHeader);
+  for (Index = 0; Index < FFS_FILE_HASH_BUCKET_COUNT; Index++) {
+    InitializeListHead (&FvDevice->FfsFileHashTable[Index]);
+  }
 
   //
   // Build FFS list
@@ -537,6 +540,16 @@ FvCheck (
       FfsFileEntry->FileCached = FileCached;
       FileCached               = FALSE;
       InsertTailList (&FvDevice->FfsFileListHeader, &FfsFileEntry->Link);
+
+      //
+      // Index the file by name. Pad files can not be found by name.
+      //
+      if (CacheFfsHeader->Type != EFI_FV_FILETYPE_FFS_PAD) {
+        InsertTailList (
+          &FvDevice->FfsFileHashTable[FfsFileNameHashIndex (&CacheFfsHeader->Name)],
+          &FfsFileEntry->HashLink
+          );
+      }
     }
 
     if (IS_FFS_FILE2 (CacheFfsHeader)) {
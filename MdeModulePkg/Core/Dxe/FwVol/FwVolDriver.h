@@ -12,11 +12,17 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define FV2_DEVICE_SIGNATURE  SIGNATURE_32 ('_', 'F', 'V', '2')
 
+//
+// Number of hash buckets used to index the files of a FV by name
+//
+#define FFS_FILE_HASH_BUCKET_COUNT  64
+
 //
 // Used to track all non-deleted files
 //
 typedef struct {
   LIST_ENTRY             Link;
+  LIST_ENTRY             HashLink;
   EFI_FFS_FILE_HEADER    *FfsHeader;
   UINTN                  StreamHandle;
   BOOLEAN                FileCached;
@@ -40,6 +46,11 @@ typedef struct {
   UINT8                                 ErasePolarity;
   BOOLEAN                               IsFfs3Fv;
   BOOLEAN                               IsMemoryMapped;
+
+  //
+  // Non-pad files of FfsFileListHeader hashed by name, in FV order
+  //
+  LIST_ENTRY                            FfsFileHashTable[FFS_FILE_HASH_BUCKET_COUNT];
 } FV_DEVICE;
 
 #define FV_DEVICE_FROM_THIS(a)  CR(a, FV_DEVICE, Fv, FV2_DEVICE_SIGNATURE)
@@ -384,4 +395,17 @@ IsValidFfsFile (
   IN EFI_FFS_FILE_HEADER  *FfsHeader
   );
 
+/**
+  Compute the hash bucket index of a FFS file name.
+
+  @param  NameGuid       The file name
+
+  @return Index into FV_DEVICE.FfsFileHashTable
+
+**/
+UINTN
+FfsFileNameHashIndex (
+  IN CONST EFI_GUID  *NameGuid
+  );
+
 #endif
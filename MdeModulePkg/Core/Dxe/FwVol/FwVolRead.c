@@ -277,9 +277,10 @@ FvReadFile (
 {
   EFI_STATUS              Status;
   FV_DEVICE               *FvDevice;
-  EFI_GUID                SearchNameGuid;
-  EFI_FV_FILETYPE         LocalFoundType;
-  EFI_FV_FILE_ATTRIBUTES  LocalAttributes;
+  EFI_FV_ATTRIBUTES       FvAttributes;
+  LIST_ENTRY              *Link;
+  LIST_ENTRY              *Bucket;
+  FFS_FILE_LIST_ENTRY     *FfsFileEntry;
   UINTN                   FileSize;
   UINT8                   *SrcPtr;
   EFI_FFS_FILE_HEADER     *FfsHeader;
@@ -292,30 +293,39 @@ FvReadFile (
 
   FvDevice = FV_DEVICE_FROM_THIS (This);
 
+  Status = FvGetVolumeAttributes (This, &FvAttributes);
+  if (EFI_ERROR (Status) || ((FvAttributes & EFI_FV2_READ_STATUS) == 0)) {
+    return EFI_NOT_FOUND;
+  }
+
   //
-  // Keep looking until we find the matching NameGuid.
-  // The Key is really a FfsFileEntry
-  //
-  FvDevice->LastKey = 0;
-  do {
-    LocalFoundType = 0;
-    Status         = FvGetNextFile (
-                       This,
-                       &FvDevice->LastKey,
-                       &LocalFoundType,
-                       &SearchNameGuid,
-                       &LocalAttributes,
-                       &FileSize
-                       );
-    if (EFI_ERROR (Status)) {
-      return EFI_NOT_FOUND;
+  // Look the file up in the name index built by FvCheck(). The bucket keeps
+  // the FV order, so the first match is the file GetNextFile() would find.
+  //
+  FvDevice->LastKey = NULL;
+  Bucket            = &FvDevice->FfsFileHashTable[FfsFileNameHashIndex (NameGuid)];
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    FfsFileEntry = BASE_CR (Link, FFS_FILE_LIST_ENTRY, HashLink);
+    if (CompareGuid (&FfsFileEntry->FfsHeader->Name, NameGuid)) {
+      FvDevice->LastKey = FfsFileEntry;
+      break;
     }
-  } while (!CompareGuid (&SearchNameGuid, NameGuid));
+  }
+
+  if (FvDevice->LastKey == NULL) {
+    return EFI_NOT_FOUND;
+  }
 
   //
   // Get a pointer to the header
   //
   FfsHeader = FvDevice->LastKey->FfsHeader;
+  if (IS_FFS_FILE2 (FfsHeader)) {
+    FileSize = FFS_FILE2_SIZE (FfsHeader) - sizeof (EFI_FFS_FILE_HEADER2);
+  } else {
+    FileSize = FFS_FILE_SIZE (FfsHeader) - sizeof (EFI_FFS_FILE_HEADER);
+  }
+
   if (FvDevice->IsMemoryMapped) {
     //
     // Memory mapped FV has not been cached, so here is to cache by file.
@@ -45,6 +45,26 @@ EFI_LOCK    mGcdIoSpaceLock     = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 LIST_ENTRY  mGcdMemorySpaceMap  = INITIALIZE_LIST_HEAD_VARIABLE (mGcdMemorySpaceMap);
 LIST_ENTRY  mGcdIoSpaceMap      = INITIALIZE_LIST_HEAD_VARIABLE (mGcdIoSpaceMap);
 
+//
+// The GCD maps are also indexed by address, so that an entry can be found
+// without walking the map from its head.
+//
+VOID
+CoreGetGcdMapEntryRange (
+  IN  RANGE_TREE_NODE  *Node,
+  OUT UINT64           *Start,
+  OUT UINT64           *End
+  );
+
+RANGE_TREE  mGcdMemorySpaceTree = { NULL, CoreGetGcdMapEntryRange, 0 };
+RANGE_TREE  mGcdIoSpaceTree     = { NULL, CoreGetGcdMapEntryRange, 0 };
+
+//
+// Incremented every time the GCD memory space map changes, so that the
+// memory map returned by CoreGetMemoryMap() can be reused until then.
+//
+UINTN  mGcdMemorySpaceMapGeneration = 0;
+
 EFI_GCD_MAP_ENTRY  mGcdMemorySpaceMapEntryTemplate = {
   EFI_GCD_MAP_SIGNATURE,
   {
@@ -58,7 +78,14 @@ EFI_GCD_MAP_ENTRY  mGcdMemorySpaceMapEntryTemplate = {
   EfiGcdMemoryTypeNonExistent,
   (EFI_GCD_IO_TYPE)0,
   NULL,
-  NULL
+  NULL,
+  {
+    NULL,
+    NULL,
+    NULL,
+    0,
+    0
+  }
 };
 
 EFI_GCD_MAP_ENTRY  mGcdIoSpaceMapEntryTemplate = {
@@ -74,7 +101,14 @@ EFI_GCD_MAP_ENTRY  mGcdIoSpaceMapEntryTemplate = {
   (EFI_GCD_MEMORY_TYPE)0,
   EfiGcdIoTypeNonExistent,
   NULL,
-  NULL
+  NULL,
+  {
+    NULL,
+    NULL,
+    NULL,
+    0,
+    0
+  }
 };
 
 GCD_ATTRIBUTE_CONVERSION_ENTRY  mAttributeConversionTable[] = {
@@ -257,6 +291,51 @@ CoreValidateResourceDescriptorHobAttributes (
     );
 }
 
+/**
+  Return the range of a GCD map entry from its node on the range tree of
+  its map.
+
+  @param  Node                   The TreeNode of the entry
+  @param  Start                  Returns the base address of the entry
+  @param  End                    Returns the end address of the entry
+
+**/
+VOID
+CoreGetGcdMapEntryRange (
+  IN  RANGE_TREE_NODE  *Node,
+  OUT UINT64           *Start,
+  OUT UINT64           *End
+  )
+{
+  EFI_GCD_MAP_ENTRY  *Entry;
+
+  Entry = CR (Node, EFI_GCD_MAP_ENTRY, TreeNode, EFI_GCD_MAP_SIGNATURE);
+
+  *Start = Entry->BaseAddress;
+  *End   = Entry->EndAddress;
+}
+
+/**
+  Return the range tree that indexes a GCD map.
+
+  @param  Map                    The GCD map
+
+  @return The range tree of the map
+
+**/
+RANGE_TREE *
+CoreGetGcdMapTree (
+  IN LIST_ENTRY  *Map
+  )
+{
+  if (Map == &mGcdMemorySpaceMap) {
+    return &mGcdMemorySpaceTree;
+  }
+
+  ASSERT (Map == &mGcdIoSpaceMap);
+  return &mGcdIoSpaceTree;
+}
+
 /**
   Acquire memory lock on mGcdMemorySpaceLock.
 
@@ -423,6 +502,7 @@ CoreAllocateGcdMapEntry (
   @param  Length                 The length of the new range in bytes
   @param  TopEntry               Top pad entry to insert if needed.
   @param  BottomEntry            Bottom pad entry to insert if needed.
+  @param  Map                    The GCD map Link is on.
 
   @retval EFI_SUCCESS            The new range was inserted into the linked list
 
@@ -434,11 +514,16 @@ CoreInsertGcdMapEntry (
   IN EFI_PHYSICAL_ADDRESS  BaseAddress,
   IN UINT64                Length,
   IN EFI_GCD_MAP_ENTRY     *TopEntry,
-  IN EFI_GCD_MAP_ENTRY     *BottomEntry
+  IN EFI_GCD_MAP_ENTRY     *BottomEntry,
+  IN LIST_ENTRY            *Map
   )
 {
+  RANGE_TREE  *Tree;
+
   ASSERT (Length != 0);
 
+  Tree = CoreGetGcdMapTree (Map);
+
   if (BaseAddress > Entry->BaseAddress) {
     ASSERT (BottomEntry->Signature == 0);
 
@@ -446,6 +531,8 @@ CoreInsertGcdMapEntry (
     Entry->BaseAddress      = BaseAddress;
     BottomEntry->EndAddress = BaseAddress - 1;
     InsertTailList (Link, &BottomEntry->Link);
+    CoreRangeTreeUpdate (Tree, &Entry->TreeNode);
+    CoreRangeTreeInsert (Tree, &BottomEntry->TreeNode);
   }
 
   if ((BaseAddress + Length - 1) < Entry->EndAddress) {
@@ -455,6 +542,8 @@ CoreInsertGcdMapEntry (
     TopEntry->BaseAddress = BaseAddress + Length;
     Entry->EndAddress     = BaseAddress + Length - 1;
     InsertHeadList (Link, &TopEntry->Link);
+    CoreRangeTreeUpdate (Tree, &Entry->TreeNode);
+    CoreRangeTreeInsert (Tree, &TopEntry->TreeNode);
   }
 
   return EFI_SUCCESS;
@@ -526,12 +615,16 @@ CoreMergeGcdMapEntry (
     return EFI_UNSUPPORTED;
   }
 
+  CoreRangeTreeRemove (CoreGetGcdMapTree (Map), &AdjacentEntry->TreeNode);
+
   if (Forward) {
     Entry->EndAddress = AdjacentEntry->EndAddress;
   } else {
     Entry->BaseAddress = AdjacentEntry->BaseAddress;
   }
 
+  CoreRangeTreeUpdate (CoreGetGcdMapTree (Map), &Entry->TreeNode);
+
   RemoveEntryList (AdjacentLink);
   CoreFreePool (AdjacentEntry);
 
@@ -577,6 +670,10 @@ CoreCleanupGcdMapEntry (
 
   CoreMergeGcdMapEntry (EndLink, TRUE, Map);
 
+  if (Map == &mGcdMemorySpaceMap) {
+    mGcdMemorySpaceMapGeneration++;
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -605,6 +702,7 @@ CoreSearchGcdMapEntry (
   )
 {
   LIST_ENTRY         *Link;
+  RANGE_TREE_NODE    *Node;
   EFI_GCD_MAP_ENTRY  *Entry;
 
   ASSERT (Length != 0);
@@ -612,20 +710,26 @@ CoreSearchGcdMapEntry (
   *StartLink = NULL;
   *EndLink   = NULL;
 
-  Link = Map->ForwardLink;
+  //
+  // Look up the entry that contains BaseAddress in the index of the map, the
+  // entries that follow it on the map cover the rest of the segment.
+  //
+  Node = CoreRangeTreeFind (CoreGetGcdMapTree (Map), BaseAddress);
+  if (Node == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  Entry      = CR (Node, EFI_GCD_MAP_ENTRY, TreeNode, EFI_GCD_MAP_SIGNATURE);
+  *StartLink = &Entry->Link;
+
+  Link = *StartLink;
   while (Link != Map) {
     Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    if ((BaseAddress >= Entry->BaseAddress) && (BaseAddress <= Entry->EndAddress)) {
-      *StartLink = Link;
-    }
-
-    if (*StartLink != NULL) {
-      if (((BaseAddress + Length - 1) >= Entry->BaseAddress) &&
-          ((BaseAddress + Length - 1) <= Entry->EndAddress))
-      {
-        *EndLink = Link;
-        return EFI_SUCCESS;
-      }
+    if (((BaseAddress + Length - 1) >= Entry->BaseAddress) &&
+        ((BaseAddress + Length - 1) <= Entry->EndAddress))
+    {
+      *EndLink = Link;
+      return EFI_SUCCESS;
     }
 
     Link = Link->ForwardLink;
@@ -934,7 +1038,7 @@ CoreConvertSpace (
   Link = StartLink;
   while (Link != EndLink->ForwardLink) {
     Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    CoreInsertGcdMapEntry (Link, Entry, BaseAddress, Length, TopEntry, BottomEntry);
+    CoreInsertGcdMapEntry (Link, Entry, BaseAddress, Length, TopEntry, BottomEntry, Map);
     switch (Operation) {
       //
       // Add operations
@@ -1322,7 +1426,7 @@ CoreAllocateSpace (
   Link = StartLink;
   while (Link != EndLink->ForwardLink) {
     Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    CoreInsertGcdMapEntry (Link, Entry, *BaseAddress, Length, TopEntry, BottomEntry);
+    CoreInsertGcdMapEntry (Link, Entry, *BaseAddress, Length, TopEntry, BottomEntry, Map);
     Entry->ImageHandle  = ImageHandle;
     Entry->DeviceHandle = DeviceHandle;
     Link                = Link->ForwardLink;
@@ -2547,6 +2651,7 @@ CoreInitializeGcdServices (
   Entry->EndAddress = LShiftU64 (1, SizeOfMemorySpace) - 1;
 
   InsertHeadList (&mGcdMemorySpaceMap, &Entry->Link);
+  CoreRangeTreeInsert (&mGcdMemorySpaceTree, &Entry->TreeNode);
 
   CoreDumpGcdMemorySpaceMap (TRUE);
 
@@ -2559,6 +2664,7 @@ CoreInitializeGcdServices (
   Entry->EndAddress = LShiftU64 (1, SizeOfIoSpace) - 1;
 
   InsertHeadList (&mGcdIoSpaceMap, &Entry->Link);
+  CoreRangeTreeInsert (&mGcdIoSpaceTree, &Entry->TreeNode);
 
   CoreDumpGcdIoSpaceMap (TRUE);
 
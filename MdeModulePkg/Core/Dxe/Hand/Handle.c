@@ -20,6 +20,121 @@ LIST_ENTRY  gHandleList           = INITIALIZE_LIST_HEAD_VARIABLE (gHandleList);
 EFI_LOCK    gProtocolDatabaseLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 UINT64      gHandleDatabaseKey    = 0;
 
+//
+// mProtocolHashTable    - Protocol entries bucketed by protocol GUID
+// mHandleHashTable      - Handles bucketed by handle address
+//
+// mProtocolDatabase and gHandleList keep the insertion order used by
+// LocateHandle(), the hash tables only index the same entries for lookup.
+//
+LIST_ENTRY  mProtocolHashTable[PROTOCOL_HASH_BUCKET_COUNT];
+LIST_ENTRY  mHandleHashTable[HANDLE_HASH_BUCKET_COUNT];
+BOOLEAN     mHandleDatabaseIndexInitialized = FALSE;
+
+/**
+  Initialize the hash buckets of the handle and protocol indexes on first use.
+
+**/
+VOID
+CoreInitializeHandleDatabaseIndex (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  if (mHandleDatabaseIndexInitialized) {
+    return;
+  }
+
+  for (Index = 0; Index < PROTOCOL_HASH_BUCKET_COUNT; Index++) {
+    InitializeListHead (&mProtocolHashTable[Index]);
+  }
+
+  for (Index = 0; Index < HANDLE_HASH_BUCKET_COUNT; Index++) {
+    InitializeListHead (&mHandleHashTable[Index]);
+  }
+
+  mHandleDatabaseIndexInitialized = TRUE;
+}
+
+/**
+  Compute the protocol hash bucket index of a GUID.
+
+  @param  Protocol               The ID of the protocol
+
+  @return Index into mProtocolHashTable
+
+**/
+UINTN
+CoreProtocolHashIndex (
+  IN EFI_GUID  *Protocol
+  )
+{
+  return (UINTN)(CoreGuidHash (Protocol) & (PROTOCOL_HASH_BUCKET_COUNT - 1));
+}
+
+/**
+  Compute the handle hash bucket index of a handle address.
+
+  @param  UserHandle             The handle value
+
+  @return Index into mHandleHashTable
+
+**/
+UINTN
+CoreHandleHashIndex (
+  IN EFI_HANDLE  UserHandle
+  )
+{
+  UINTN  Hash;
+
+  //
+  // Handles come from pool allocations, so the low bits carry no information
+  //
+  Hash = (UINTN)UserHandle >> 3;
+  Hash = Hash ^ (Hash >> 8) ^ (Hash >> 16);
+
+  return Hash & (HANDLE_HASH_BUCKET_COUNT - 1);
+}
+
+/**
+  Adds a newly created handle to the handle database.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle to add
+
+**/
+VOID
+CoreInsertHandle (
+  IN IHANDLE  *Handle
+  )
+{
+  ASSERT_LOCKED (&gProtocolDatabaseLock);
+
+  CoreInitializeHandleDatabaseIndex ();
+
+  InsertTailList (&gHandleList, &Handle->AllHandles);
+  InsertTailList (&mHandleHashTable[CoreHandleHashIndex (Handle)], &Handle->HashLink);
+}
+
+/**
+  Removes a handle from the handle database.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle to remove
+
+**/
+VOID
+CoreRemoveHandle (
+  IN IHANDLE  *Handle
+  )
+{
+  ASSERT_LOCKED (&gProtocolDatabaseLock);
+
+  RemoveEntryList (&Handle->AllHandles);
+  RemoveEntryList (&Handle->HashLink);
+}
+
 /**
   Acquire lock on gProtocolDatabaseLock.
 
@@ -60,6 +175,7 @@ CoreValidateHandle (
   )
 {
   IHANDLE     *Handle;
+  LIST_ENTRY  *Bucket;
   LIST_ENTRY  *Link;
 
   if (UserHandle == NULL) {
@@ -68,8 +184,17 @@ CoreValidateHandle (
 
   ASSERT_LOCKED (&gProtocolDatabaseLock);
 
-  for (Link = gHandleList.BackLink; Link != &gHandleList; Link = Link->BackLink) {
-    Handle = CR (Link, IHANDLE, AllHandles, EFI_HANDLE_SIGNATURE);
+  if (!mHandleDatabaseIndexInitialized) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Only compare addresses, UserHandle must not be dereferenced before it
+  // is known to be one of the handles in the database
+  //
+  Bucket = &mHandleHashTable[CoreHandleHashIndex (UserHandle)];
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    Handle = CR (Link, IHANDLE, HashLink, EFI_HANDLE_SIGNATURE);
     if (Handle == (IHANDLE *)UserHandle) {
       return EFI_SUCCESS;
     }
@@ -94,22 +219,23 @@ CoreFindProtocolEntry (
   IN BOOLEAN   Create
   )
 {
+  LIST_ENTRY      *Bucket;
   LIST_ENTRY      *Link;
   PROTOCOL_ENTRY  *Item;
   PROTOCOL_ENTRY  *ProtEntry;
 
   ASSERT_LOCKED (&gProtocolDatabaseLock);
 
+  CoreInitializeHandleDatabaseIndex ();
+
   //
-  // Search the database for the matching GUID
+  // Search the hash bucket of the GUID for the matching entry
   //
 
   ProtEntry = NULL;
-  for (Link = mProtocolDatabase.ForwardLink;
-       Link != &mProtocolDatabase;
-       Link = Link->ForwardLink)
-  {
-    Item = CR (Link, PROTOCOL_ENTRY, AllEntries, PROTOCOL_ENTRY_SIGNATURE);
+  Bucket    = &mProtocolHashTable[CoreProtocolHashIndex (Protocol)];
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    Item = CR (Link, PROTOCOL_ENTRY, HashLink, PROTOCOL_ENTRY_SIGNATURE);
     if (CompareGuid (&Item->ProtocolID, Protocol)) {
       //
       // This is the protocol entry
@@ -140,6 +266,7 @@ CoreFindProtocolEntry (
       // Add it to protocol database
       //
       InsertTailList (&mProtocolDatabase, &ProtEntry->AllEntries);
+      InsertTailList (Bucket, &ProtEntry->HashLink);
     }
   }
 
@@ -408,7 +535,7 @@ CoreInstallProtocolInterfaceNotify (
     // Add this handle to the list global list of all handles
     // in the system
     //
-    InsertTailList (&gHandleList, &Handle->AllHandles);
+    CoreInsertHandle (Handle);
   } else {
     Status = CoreValidateHandle (Handle);
     if (EFI_ERROR (Status)) {
@@ -448,6 +575,11 @@ CoreInstallProtocolInterfaceNotify (
   //
   InsertTailList (&ProtEntry->Protocols, &Prot->ByProtocol);
 
+  //
+  // Let the dispatcher know which drivers may have become dispatchable
+  //
+  CoreDepexProtocolInstalled (Protocol);
+
   //
   // Notify the notification list for this protocol
   //
@@ -770,7 +902,7 @@ CoreUninstallProtocolInterface (
   //
   if (IsListEmpty (&Handle->Protocols)) {
     Handle->Signature = 0;
-    RemoveEntryList (&Handle->AllHandles);
+    CoreRemoveHandle (Handle);
     CoreFreePool (Handle);
   }
 
@@ -11,6 +11,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define EFI_HANDLE_SIGNATURE  SIGNATURE_32('h','n','d','l')
 
+///
+/// Number of buckets in the handle and protocol hash indexes. Both must be a
+/// power of 2.
+///
+#define HANDLE_HASH_BUCKET_COUNT    256
+#define PROTOCOL_HASH_BUCKET_COUNT  128
+
 ///
 /// IHANDLE - contains a list of protocol handles
 ///
@@ -18,6 +25,8 @@ typedef struct {
   UINTN         Signature;
   /// All handles list of IHANDLE
   LIST_ENTRY    AllHandles;
+  /// Link on the handle hash bucket selected by the handle address
+  LIST_ENTRY    HashLink;
   /// List of PROTOCOL_INTERFACE's for this handle
   LIST_ENTRY    Protocols;
   UINTN         LocateRequest;
@@ -38,6 +47,8 @@ typedef struct {
   UINTN         Signature;
   /// Link Entry inserted to mProtocolDatabase
   LIST_ENTRY    AllEntries;
+  /// Link on the protocol hash bucket selected by ProtocolID
+  LIST_ENTRY    HashLink;
   /// ID of the protocol
   EFI_GUID      ProtocolID;
   /// All protocol interfaces
@@ -114,6 +125,30 @@ CoreFindProtocolEntry (
   IN BOOLEAN   Create
   );
 
+/**
+  Adds a newly created handle to the handle database.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle to add
+
+**/
+VOID
+CoreInsertHandle (
+  IN IHANDLE  *Handle
+  );
+
+/**
+  Removes a handle from the handle database.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle to remove
+
+**/
+VOID
+CoreRemoveHandle (
+  IN IHANDLE  *Handle
+  );
+
 /**
   Signal event for every protocol in protocol entry.
 
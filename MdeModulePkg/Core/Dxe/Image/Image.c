@@ -958,6 +958,7 @@ CoreUnloadAndCloseImage (
 
   if (Image->Started) {
     UnregisterMemoryProfileImage (Image);
+    CoreServiceProfileUnregisterImage (Image);
   }
 
   UnprotectUefiImage (&Image->Info, Image->LoadedImageDevicePath);
@@ -1684,6 +1685,7 @@ CoreStartImage (
   //
   if (SetJumpFlag == 0) {
     RegisterMemoryProfileImage (Image, (Image->ImageContext.ImageType == EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION ? EFI_FV_FILETYPE_APPLICATION : EFI_FV_FILETYPE_DRIVER));
+    CoreServiceProfileRegisterImage (Image);
     //
     // Call the image's entry point
     //
@@ -92,3 +92,30 @@ CoreReleaseLock (
 
   CoreRestoreTpl (Tpl);
 }
+
+/**
+  Compute a 32-bit hash of a GUID, for the hash tables of the core that are
+  indexed by GUID. The low bits depend on every byte of the GUID, so the hash
+  can be masked to a power of two bucket count.
+
+  @param  Guid               The GUID to hash
+
+  @return The hash of the GUID
+
+**/
+UINT32
+CoreGuidHash (
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  CONST UINT32  *Data;
+  UINT32        Hash;
+
+  Data = (CONST UINT32 *)Guid;
+  Hash = ReadUnaligned32 (&Data[0]) ^ ReadUnaligned32 (&Data[1]) ^
+         ReadUnaligned32 (&Data[2]) ^ ReadUnaligned32 (&Data[3]);
+  Hash = Hash ^ (Hash >> 16);
+  Hash = Hash ^ (Hash >> 8);
+
+  return Hash;
+}
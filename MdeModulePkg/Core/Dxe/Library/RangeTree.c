@@ -0,0 +1,391 @@
+/** @file
+  Range tree of the DXE core: an ordered index of ranges that do not overlap,
+  such as the free ranges of the memory map and the entries of the GCD maps.
+
+  The tree is a treap ordered by the start address of the ranges. Its nodes
+  are embedded in the structures that describe the ranges, so the tree can be
+  changed while the memory lock is held. Each node records the length of the
+  largest range of its subtree, so a search for a range of a minimum length
+  skips the subtrees in which no range is long enough.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+
+/**
+  Return the length of the range of a node.
+
+  @param  Tree               The range tree
+  @param  Node               The node
+
+  @return The length of the range in bytes
+
+**/
+UINT64
+RangeTreeGetLength (
+  IN RANGE_TREE       *Tree,
+  IN RANGE_TREE_NODE  *Node
+  )
+{
+  UINT64  Start;
+  UINT64  End;
+
+  Tree->GetRange (Node, &Start, &End);
+  return End - Start + 1;
+}
+
+/**
+  Recompute the length of the largest range in the subtree of a node from
+  its own range and its children.
+
+  @param  Tree               The range tree
+  @param  Node               The node
+
+**/
+VOID
+RangeTreeUpdateMaxLength (
+  IN     RANGE_TREE       *Tree,
+  IN OUT RANGE_TREE_NODE  *Node
+  )
+{
+  UINT64  MaxLength;
+
+  MaxLength = RangeTreeGetLength (Tree, Node);
+  if ((Node->Left != NULL) && (Node->Left->MaxLength > MaxLength)) {
+    MaxLength = Node->Left->MaxLength;
+  }
+
+  if ((Node->Right != NULL) && (Node->Right->MaxLength > MaxLength)) {
+    MaxLength = Node->Right->MaxLength;
+  }
+
+  Node->MaxLength = MaxLength;
+}
+
+/**
+  Recompute the length of the largest range in the subtree of a node and of
+  all its ancestors.
+
+  @param  Tree               The range tree
+  @param  Node               The node to start from, may be NULL
+
+**/
+VOID
+RangeTreeUpdateAncestors (
+  IN     RANGE_TREE       *Tree,
+  IN OUT RANGE_TREE_NODE  *Node
+  )
+{
+  while (Node != NULL) {
+    RangeTreeUpdateMaxLength (Tree, Node);
+    Node = Node->Parent;
+  }
+}
+
+/**
+  Rotate a node above its parent, keeping the order of the tree.
+
+  @param  Tree               The range tree
+  @param  Node               The node to rotate, which must have a parent
+
+**/
+VOID
+RangeTreeRotateUp (
+  IN OUT RANGE_TREE       *Tree,
+  IN OUT RANGE_TREE_NODE  *Node
+  )
+{
+  RANGE_TREE_NODE  *Parent;
+  RANGE_TREE_NODE  *Child;
+
+  Parent = Node->Parent;
+  ASSERT (Parent != NULL);
+
+  if (Parent->Left == Node) {
+    Child        = Node->Right;
+    Parent->Left = Child;
+    Node->Right  = Parent;
+  } else {
+    Child         = Node->Left;
+    Parent->Right = Child;
+    Node->Left    = Parent;
+  }
+
+  if (Child != NULL) {
+    Child->Parent = Parent;
+  }
+
+  Node->Parent = Parent->Parent;
+  if (Node->Parent == NULL) {
+    Tree->Root = Node;
+  } else if (Node->Parent->Left == Parent) {
+    Node->Parent->Left = Node;
+  } else {
+    Node->Parent->Right = Node;
+  }
+
+  Parent->Parent = Node;
+
+  RangeTreeUpdateMaxLength (Tree, Parent);
+  RangeTreeUpdateMaxLength (Tree, Node);
+}
+
+/**
+  Insert a node into a range tree. The range of the node must not overlap the
+  ranges already in the tree.
+
+  @param  Tree               The range tree
+  @param  Node               The node to insert
+
+**/
+VOID
+CoreRangeTreeInsert (
+  IN OUT RANGE_TREE       *Tree,
+  IN OUT RANGE_TREE_NODE  *Node
+  )
+{
+  RANGE_TREE_NODE  *Parent;
+  RANGE_TREE_NODE  **Link;
+  UINT64           Start;
+  UINT64           End;
+  UINT64           ParentStart;
+  UINT64           ParentEnd;
+
+  Tree->GetRange (Node, &Start, &End);
+
+  //
+  // Insert the node as a leaf at its ordered position
+  //
+  Parent = NULL;
+  Link   = &Tree->Root;
+  while (*Link != NULL) {
+    Parent = *Link;
+    Tree->GetRange (Parent, &ParentStart, &ParentEnd);
+    ASSERT ((End < ParentStart) || (Start > ParentEnd));
+    if (Start < ParentStart) {
+      Link = &Parent->Left;
+    } else {
+      Link = &Parent->Right;
+    }
+  }
+
+  *Link        = Node;
+  Node->Parent = Parent;
+  Node->Left   = NULL;
+  Node->Right  = NULL;
+  RangeTreeUpdateAncestors (Tree, Node);
+
+  //
+  // Give the node a pseudo-random priority and rotate it up until its parent
+  // has a higher one, which keeps the expected depth of the tree logarithmic.
+  //
+  Tree->Seed     = Tree->Seed * 1103515245 + 12345;
+  Node->Priority = Tree->Seed;
+  while ((Node->Parent != NULL) && (Node->Parent->Priority < Node->Priority)) {
+    RangeTreeRotateUp (Tree, Node);
+  }
+}
+
+/**
+  Remove a node from a range tree. The range of the node is not used, so it
+  may already have been changed or emptied.
+
+  @param  Tree               The range tree
+  @param  Node               The node to remove
+
+**/
+VOID
+CoreRangeTreeRemove (
+  IN OUT RANGE_TREE       *Tree,
+  IN OUT RANGE_TREE_NODE  *Node
+  )
+{
+  RANGE_TREE_NODE  *Child;
+  RANGE_TREE_NODE  *Parent;
+
+  //
+  // Rotate the child with the higher priority above the node until the node
+  // is a leaf
+  //
+  while ((Node->Left != NULL) || (Node->Right != NULL)) {
+    if (Node->Left == NULL) {
+      Child = Node->Right;
+    } else if (Node->Right == NULL) {
+      Child = Node->Left;
+    } else if (Node->Left->Priority > Node->Right->Priority) {
+      Child = Node->Left;
+    } else {
+      Child = Node->Right;
+    }
+
+    RangeTreeRotateUp (Tree, Child);
+  }
+
+  Parent = Node->Parent;
+  if (Parent == NULL) {
+    Tree->Root = NULL;
+  } else if (Parent->Left == Node) {
+    Parent->Left = NULL;
+  } else {
+    Parent->Right = NULL;
+  }
+
+  Node->Parent = NULL;
+  RangeTreeUpdateAncestors (Tree, Parent);
+}
+
+/**
+  Update a range tree after the range of one of its nodes was resized. The
+  range must keep its position relative to the other ranges of the tree.
+
+  @param  Tree               The range tree
+  @param  Node               The node whose range was resized
+
+**/
+VOID
+CoreRangeTreeUpdate (
+  IN OUT RANGE_TREE       *Tree,
+  IN OUT RANGE_TREE_NODE  *Node
+  )
+{
+  RangeTreeUpdateAncestors (Tree, Node);
+}
+
+/**
+  Find the node of a range tree whose range contains an address.
+
+  @param  Tree               The range tree
+  @param  Address            The address to look for
+
+  @return The node that contains Address, or NULL if there is none
+
+**/
+RANGE_TREE_NODE *
+CoreRangeTreeFind (
+  IN RANGE_TREE  *Tree,
+  IN UINT64      Address
+  )
+{
+  RANGE_TREE_NODE  *Node;
+  UINT64           Start;
+  UINT64           End;
+
+  Node = Tree->Root;
+  while (Node != NULL) {
+    Tree->GetRange (Node, &Start, &End);
+    if (Address < Start) {
+      Node = Node->Left;
+    } else if (Address > End) {
+      Node = Node->Right;
+    } else {
+      break;
+    }
+  }
+
+  return Node;
+}
+
+/**
+  Find the node of a range tree with the highest range below the range of a
+  node that is at least a given length.
+
+  @param  Tree               The range tree
+  @param  Node               The node to start from
+  @param  MinLength          The minimum length of the range
+
+  @return The node found, or NULL if there is none
+
+**/
+RANGE_TREE_NODE *
+CoreRangeTreeFindPrevious (
+  IN RANGE_TREE       *Tree,
+  IN RANGE_TREE_NODE  *Node,
+  IN UINT64           MinLength
+  )
+{
+  while (TRUE) {
+    if ((Node->Left != NULL) && (Node->Left->MaxLength >= MinLength)) {
+      //
+      // The left subtree holds a range long enough, find the highest one
+      //
+      Node = Node->Left;
+      while (TRUE) {
+        if ((Node->Right != NULL) && (Node->Right->MaxLength >= MinLength)) {
+          Node = Node->Right;
+        } else if (RangeTreeGetLength (Tree, Node) >= MinLength) {
+          return Node;
+        } else {
+          ASSERT (Node->Left != NULL && Node->Left->MaxLength >= MinLength);
+          Node = Node->Left;
+        }
+      }
+    }
+
+    //
+    // Climb to the closest ancestor that is below the node
+    //
+    while ((Node->Parent != NULL) && (Node->Parent->Left == Node)) {
+      Node = Node->Parent;
+    }
+
+    Node = Node->Parent;
+    if (Node == NULL) {
+      return NULL;
+    }
+
+    if (RangeTreeGetLength (Tree, Node) >= MinLength) {
+      return Node;
+    }
+  }
+}
+
+/**
+  Find the node of a range tree with the highest range that starts at or
+  below an address and is at least a given length.
+
+  @param  Tree               The range tree
+  @param  Address            The highest start address of the range
+  @param  MinLength          The minimum length of the range
+
+  @return The node found, or NULL if there is none
+
+**/
+RANGE_TREE_NODE *
+CoreRangeTreeFindLast (
+  IN RANGE_TREE  *Tree,
+  IN UINT64      Address,
+  IN UINT64      MinLength
+  )
+{
+  RANGE_TREE_NODE  *Node;
+  RANGE_TREE_NODE  *Last;
+  UINT64           Start;
+  UINT64           End;
+
+  //
+  // Find the highest range that starts at or below Address
+  //
+  Last = NULL;
+  Node = Tree->Root;
+  while (Node != NULL) {
+    Tree->GetRange (Node, &Start, &End);
+    if (Start > Address) {
+      Node = Node->Left;
+    } else {
+      Last = Node;
+      Node = Node->Right;
+    }
+  }
+
+  if (Last == NULL) {
+    return NULL;
+  }
+
+  if (RangeTreeGetLength (Tree, Last) >= MinLength) {
+    return Last;
+  }
+
+  return CoreRangeTreeFindPrevious (Tree, Last, MinLength);
+}
@@ -41,12 +41,33 @@ typedef struct {
 
   UINT64             VirtualStart;
   UINT64             Attribute;
+
+  ///
+  /// Node on the range tree of EfiConventionalMemory entries
+  ///
+  RANGE_TREE_NODE    FreeNode;
 } MEMORY_MAP;
 
 //
 // Internal prototypes
 //
 
+/**
+  Internal function.  Returns the range of an EfiConventionalMemory entry
+  from its node on the range tree of free memory.
+
+  @param  Node                   The FreeNode of the entry
+  @param  Start                  Returns the start of the entry
+  @param  End                    Returns the end of the entry
+
+**/
+VOID
+CoreGetFreeRange (
+  IN  RANGE_TREE_NODE  *Node,
+  OUT UINT64           *Start,
+  OUT UINT64           *End
+  );
+
 /**
   Internal function.  Used by the pool functions to allocate pages
   to back pool allocation requests.
@@ -169,4 +190,5 @@ CoreInternalAllocatePages (
 extern EFI_LOCK    gMemoryLock;
 extern LIST_ENTRY  gMemoryMap;
 extern LIST_ENTRY  mGcdMemorySpaceMap;
+extern UINTN       mGcdMemorySpaceMapGeneration;
 #endif
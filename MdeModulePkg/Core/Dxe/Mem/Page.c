@@ -29,6 +29,40 @@ typedef struct {
 //
 UINTN  mMemoryMapKey = 0;
 
+///
+/// mMemoryMapGeneration - incremented every time gMemoryMap or the memory type
+/// bins change. Unlike mMemoryMapKey it also changes when pages are removed
+/// from the map by the freed-memory guard.
+///
+UINTN  mMemoryMapGeneration = 0;
+
+///
+/// The memory map built by CoreGetMemoryMap(). It is kept as long as the GCD
+/// memory space map does not change, and the ranges of gMemoryMap changed
+/// since it was built are patched into it by the next CoreGetMemoryMap() call.
+///
+EFI_MEMORY_DESCRIPTOR  *mMemoryMapCache             = NULL;
+UINTN                  mMemoryMapCacheCapacity      = 0;
+UINTN                  mMemoryMapCacheSize          = 0;
+UINTN                  mMemoryMapCacheBufferSize    = 0;
+UINTN                  mMemoryMapCacheGcdEntries    = 0;
+UINTN                  mMemoryMapCacheGeneration    = 0;
+UINTN                  mMemoryMapCacheGcdGeneration = 0;
+BOOLEAN                mMemoryMapCacheValid         = FALSE;
+BOOLEAN                mMemoryMapCacheGrowing       = FALSE;
+
+///
+/// The ranges of gMemoryMap changed since the copy of the memory map was built
+/// or patched. A count above MEMORY_MAP_CACHE_MAX_CHANGES means that more
+/// ranges changed, or that the memory type bins changed, and the copy must be
+/// built again.
+///
+#define MEMORY_MAP_CACHE_MAX_CHANGES  8
+
+EFI_PHYSICAL_ADDRESS  mMemoryMapCacheChangeStart[MEMORY_MAP_CACHE_MAX_CHANGES];
+EFI_PHYSICAL_ADDRESS  mMemoryMapCacheChangeEnd[MEMORY_MAP_CACHE_MAX_CHANGES];
+UINTN                 mMemoryMapCacheChangeCount = 0;
+
 #define MAX_MAP_DEPTH  6
 
 ///
@@ -45,6 +79,12 @@ UINTN       mFreeMapStack = 0;
 ///
 LIST_ENTRY  mFreeMemoryMapEntryList           = INITIALIZE_LIST_HEAD_VARIABLE (mFreeMemoryMapEntryList);
 BOOLEAN     mMemoryTypeInformationInitialized = FALSE;
+///
+/// This tree indexes the EfiConventionalMemory entries of gMemoryMap by
+/// address and by size, so free page searches never visit allocated ranges
+/// nor free ranges that are too small.
+///
+RANGE_TREE  mFreeRangeTree = { NULL, CoreGetFreeRange, 0 };
 
 EFI_MEMORY_TYPE_STATISTICS  mMemoryTypeStatistics[EfiMaxMemoryType + 1] = {
   { 0, MAX_ALLOC_ADDRESS, 0, 0, EfiMaxMemoryType, TRUE,  FALSE },  // EfiReservedMemoryType
@@ -119,6 +159,31 @@ CoreReleaseMemoryLock (
   CoreReleaseLock (&gMemoryLock);
 }
 
+/**
+  Internal function.  Returns the range of an EfiConventionalMemory entry
+  from its node on the range tree of free memory.
+
+  @param  Node                   The FreeNode of the entry
+  @param  Start                  Returns the start of the entry
+  @param  End                    Returns the end of the entry
+
+**/
+VOID
+CoreGetFreeRange (
+  IN  RANGE_TREE_NODE  *Node,
+  OUT UINT64           *Start,
+  OUT UINT64           *End
+  )
+{
+  MEMORY_MAP  *Entry;
+
+  Entry = CR (Node, MEMORY_MAP, FreeNode, MEMORY_MAP_SIGNATURE);
+  ASSERT (Entry->Type == EfiConventionalMemory);
+
+  *Start = Entry->Start;
+  *End   = Entry->End;
+}
+
 /**
   Internal function.  Removes a descriptor entry.
 
@@ -133,6 +198,10 @@ RemoveMemoryMapEntry (
   RemoveEntryList (&Entry->Link);
   Entry->Link.ForwardLink = NULL;
 
+  if (Entry->Type == EfiConventionalMemory) {
+    CoreRangeTreeRemove (&mFreeRangeTree, &Entry->FreeNode);
+  }
+
   if (Entry->FromPages) {
     //
     // Insert the free memory map descriptor to the end of mFreeMemoryMapEntryList
@@ -141,6 +210,45 @@ RemoveMemoryMapEntry (
   }
 }
 
+/**
+  Internal function.  Records that a range of the memory map changed, so that
+  the next CoreGetMemoryMap() call patches it into its copy of the map.
+
+  @param  Start                  The first address of the range
+  @param  End                    The last address of the range
+
+**/
+STATIC
+VOID
+CoreMemoryMapRangeChanged (
+  IN EFI_PHYSICAL_ADDRESS  Start,
+  IN EFI_PHYSICAL_ADDRESS  End
+  )
+{
+  UINTN  Index;
+
+  mMemoryMapGeneration++;
+
+  if (mMemoryMapCacheChangeCount > MEMORY_MAP_CACHE_MAX_CHANGES) {
+    return;
+  }
+
+  for (Index = 0; Index < mMemoryMapCacheChangeCount; Index++) {
+    if ((Start >= mMemoryMapCacheChangeStart[Index]) && (End <= mMemoryMapCacheChangeEnd[Index])) {
+      return;
+    }
+  }
+
+  if (mMemoryMapCacheChangeCount == MEMORY_MAP_CACHE_MAX_CHANGES) {
+    mMemoryMapCacheChangeCount++;
+    return;
+  }
+
+  mMemoryMapCacheChangeStart[mMemoryMapCacheChangeCount] = Start;
+  mMemoryMapCacheChangeEnd[mMemoryMapCacheChangeCount]   = End;
+  mMemoryMapCacheChangeCount++;
+}
+
 /**
   Internal function.  Adds a ranges to the memory map.
   The range must not already exist in the map.
@@ -190,6 +298,7 @@ CoreAddRange (
   // Memory map being altered so updated key
   //
   mMemoryMapKey += 1;
+  CoreMemoryMapRangeChanged (Start, End);
 
   //
   // UEFI 2.0 added an event group for notificaiton on memory map changes.
@@ -245,6 +354,10 @@ CoreAddRange (
   mMapStack[mMapDepth].Attribute    = Attribute;
   InsertTailList (&gMemoryMap, &mMapStack[mMapDepth].Link);
 
+  if (Type == EfiConventionalMemory) {
+    CoreRangeTreeInsert (&mFreeRangeTree, &mMapStack[mMapDepth].FreeNode);
+  }
+
   mMapDepth += 1;
   ASSERT (mMapDepth < MAX_MAP_DEPTH);
 
@@ -353,9 +466,17 @@ CoreFreeMemoryMapStack (
       RemoveEntryList (&mMapStack[mMapDepth].Link);
       mMapStack[mMapDepth].Link.ForwardLink = NULL;
 
+      if (mMapStack[mMapDepth].Type == EfiConventionalMemory) {
+        CoreRangeTreeRemove (&mFreeRangeTree, &mMapStack[mMapDepth].FreeNode);
+      }
+
       CopyMem (Entry, &mMapStack[mMapDepth], sizeof (MEMORY_MAP));
       Entry->FromPages = TRUE;
 
+      if (Entry->Type == EfiConventionalMemory) {
+        CoreRangeTreeInsert (&mFreeRangeTree, &Entry->FreeNode);
+      }
+
       //
       // Find insertion location
       //
@@ -422,6 +543,8 @@ PromoteMemoryResource (
       Entry->ImageHandle   = gDxeCoreImageHandle;
       Entry->DeviceHandle  = NULL;
 
+      mGcdMemorySpaceMapGeneration++;
+
       //
       // Add to allocable system memory resource
       //
@@ -702,6 +825,13 @@ CoreAddMemoryDescriptor (
     }
   }
 
+  //
+  // The memory type bins decide the type reported for free memory, so the
+  // copy of the memory map must be built again
+  //
+  mMemoryMapGeneration++;
+  mMemoryMapCacheChangeCount = MEMORY_MAP_CACHE_MAX_CHANGES + 1;
+
   mMemoryTypeInformationInitialized = TRUE;
 }
 
@@ -757,6 +887,8 @@ CoreConvertPagesEx (
     return EFI_INVALID_PARAMETER;
   }
 
+  CoreMemoryMapRangeChanged (Start, End);
+
   //
   // Convert the entire range
   //
@@ -859,11 +991,17 @@ CoreConvertPagesEx (
       // Clip start
       //
       Entry->Start = RangeEnd + 1;
+      if (Entry->Type == EfiConventionalMemory) {
+        CoreRangeTreeUpdate (&mFreeRangeTree, &Entry->FreeNode);
+      }
     } else if (Entry->End == RangeEnd) {
       //
       // Clip end
       //
       Entry->End = Start - 1;
+      if (Entry->Type == EfiConventionalMemory) {
+        CoreRangeTreeUpdate (&mFreeRangeTree, &Entry->FreeNode);
+      }
     } else {
       //
       // Pull it out of the center, clip current
@@ -886,6 +1024,11 @@ CoreConvertPagesEx (
       Entry->End = Start - 1;
       ASSERT (Entry->Start < Entry->End);
 
+      if (Entry->Type == EfiConventionalMemory) {
+        CoreRangeTreeUpdate (&mFreeRangeTree, &Entry->FreeNode);
+        CoreRangeTreeInsert (&mFreeRangeTree, &mMapStack[mMapDepth].FreeNode);
+      }
+
       Entry = &mMapStack[mMapDepth];
       InsertTailList (&gMemoryMap, &Entry->Link);
 
@@ -1034,13 +1177,13 @@ CoreFindFreePagesI (
   IN BOOLEAN          NeedGuard
   )
 {
-  UINT64      NumberOfBytes;
-  UINT64      Target;
-  UINT64      DescStart;
-  UINT64      DescEnd;
-  UINT64      DescNumberOfBytes;
-  LIST_ENTRY  *Link;
-  MEMORY_MAP  *Entry;
+  UINT64           NumberOfBytes;
+  UINT64           Target;
+  UINT64           DescStart;
+  UINT64           DescEnd;
+  UINT64           DescNumberOfBytes;
+  RANGE_TREE_NODE  *Node;
+  MEMORY_MAP       *Entry;
 
   if ((MaxAddress < EFI_PAGE_MASK) || (NumberOfPages == 0)) {
     return 0;
@@ -1070,24 +1213,26 @@ CoreFindFreePagesI (
   NumberOfBytes = LShiftU64 (NumberOfPages, EFI_PAGE_SHIFT);
   Target        = 0;
 
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-
-    //
-    // If it's not a free entry, don't bother with it
-    //
-    if (Entry->Type != EfiConventionalMemory) {
-      continue;
-    }
+  //
+  // Walk the free ranges that start below MaxAddress and hold at least
+  // NumberOfBytes from the highest address down. Ranges do not overlap, so
+  // the first range that satisfies the request gives the highest target.
+  //
+  for (Node = CoreRangeTreeFindLast (&mFreeRangeTree, MaxAddress, NumberOfBytes);
+       Node != NULL;
+       Node = CoreRangeTreeFindPrevious (&mFreeRangeTree, Node, NumberOfBytes))
+  {
+    Entry = CR (Node, MEMORY_MAP, FreeNode, MEMORY_MAP_SIGNATURE);
+    ASSERT (Entry->Type == EfiConventionalMemory);
 
     DescStart = Entry->Start;
     DescEnd   = Entry->End;
 
     //
-    // If desc is past max allowed address or below min allowed address, skip it
+    // If desc is below min allowed address, so are all the remaining ones.
     //
-    if ((DescStart >= MaxAddress) || (DescEnd < MinAddress)) {
-      continue;
+    if (DescEnd < MinAddress) {
+      break;
     }
 
     //
@@ -1118,23 +1263,19 @@ CoreFindFreePagesI (
         continue;
       }
 
-      //
-      // If this is the best match so far remember it
-      //
-      if (DescEnd > Target) {
-        if (NeedGuard) {
-          DescEnd = AdjustMemoryS (
-                      DescEnd + 1 - DescNumberOfBytes,
-                      DescNumberOfBytes,
-                      NumberOfBytes
-                      );
-          if (DescEnd == 0) {
-            continue;
-          }
+      if (NeedGuard) {
+        DescEnd = AdjustMemoryS (
+                    DescEnd + 1 - DescNumberOfBytes,
+                    DescNumberOfBytes,
+                    NumberOfBytes
+                    );
+        if (DescEnd == 0) {
+          continue;
         }
-
-        Target = DescEnd;
       }
+
+      Target = DescEnd;
+      break;
     }
   }
 
@@ -1720,6 +1861,348 @@ MergeMemoryMapDescriptor (
   return NEXT_MEMORY_DESCRIPTOR (MemoryMapDescriptor, DescriptorSize);
 }
 
+/**
+  Internal function.  Computes the size of the buffer needed to hold the memory
+  map before its descriptors are merged. The caller must hold the GCD memory
+  lock and the memory lock.
+
+  @param  DescriptorSize         The size, in bytes, of a descriptor.
+  @param  GcdEntries             If not NULL, returns the number of descriptors
+                                 built from the GCD memory space map.
+
+  @return The size of the buffer in bytes
+
+**/
+STATIC
+UINTN
+CoreGetMemoryMapBufferSize (
+  IN  UINTN  DescriptorSize,
+  OUT UINTN  *GcdEntries OPTIONAL
+  )
+{
+  UINTN              NumberOfEntries;
+  UINTN              BufferSize;
+  LIST_ENTRY         *Link;
+  EFI_GCD_MAP_ENTRY  *GcdMapEntry;
+
+  //
+  // Count the number of Reserved and runtime MMIO entries
+  // And, count the number of Persistent entries.
+  //
+  NumberOfEntries = 0;
+  for (Link = mGcdMemorySpaceMap.ForwardLink; Link != &mGcdMemorySpaceMap; Link = Link->ForwardLink) {
+    GcdMapEntry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
+    if ((GcdMapEntry->GcdMemoryType == EfiGcdMemoryTypePersistent) ||
+        (GcdMapEntry->GcdMemoryType == EfiGcdMemoryTypeReserved) ||
+        ((GcdMapEntry->GcdMemoryType == EfiGcdMemoryTypeMemoryMappedIo) &&
+         ((GcdMapEntry->Attributes & EFI_MEMORY_RUNTIME) == EFI_MEMORY_RUNTIME)))
+    {
+      NumberOfEntries++;
+    }
+  }
+
+  if (GcdEntries != NULL) {
+    *GcdEntries = NumberOfEntries;
+  }
+
+  //
+  // Compute the buffer size needed to fit the entire map
+  //
+  BufferSize = DescriptorSize * NumberOfEntries;
+  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
+    BufferSize += DescriptorSize;
+  }
+
+  return BufferSize;
+}
+
+/**
+  Internal function.  Converts an entry of gMemoryMap into the descriptor
+  returned for it by CoreGetMemoryMap().
+
+  @param  Entry                  The entry of gMemoryMap.
+  @param  MemoryMap              The descriptor to fill.
+
+**/
+STATIC
+VOID
+CoreMemoryMapEntryToDescriptor (
+  IN  MEMORY_MAP             *Entry,
+  OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap
+  )
+{
+  EFI_MEMORY_TYPE  Type;
+
+  ASSERT (Entry->VirtualStart == 0);
+
+  //
+  // Convert internal map into an EFI_MEMORY_DESCRIPTOR
+  //
+  MemoryMap->Type          = Entry->Type;
+  MemoryMap->PhysicalStart = Entry->Start;
+  MemoryMap->VirtualStart  = Entry->VirtualStart;
+  MemoryMap->NumberOfPages = RShiftU64 (Entry->End - Entry->Start + 1, EFI_PAGE_SHIFT);
+  //
+  // If the memory type is EfiConventionalMemory, then determine if the range is part of a
+  // memory type bin and needs to be converted to the same memory type as the rest of the
+  // memory type bin in order to minimize EFI Memory Map changes across reboots.  This
+  // improves the chances for a successful S4 resume in the presence of minor page allocation
+  // differences across reboots.
+  //
+  if (MemoryMap->Type == EfiConventionalMemory) {
+    for (Type = (EFI_MEMORY_TYPE)0; Type < EfiMaxMemoryType; Type++) {
+      if (mMemoryTypeStatistics[Type].Special                        &&
+          (mMemoryTypeStatistics[Type].NumberOfPages > 0) &&
+          (Entry->Start >= mMemoryTypeStatistics[Type].BaseAddress) &&
+          (Entry->End   <= mMemoryTypeStatistics[Type].MaximumAddress))
+      {
+        MemoryMap->Type = Type;
+      }
+    }
+  }
+
+  MemoryMap->Attribute = Entry->Attribute;
+  if (MemoryMap->Type < EfiMaxMemoryType) {
+    if (mMemoryTypeStatistics[MemoryMap->Type].Runtime) {
+      MemoryMap->Attribute |= EFI_MEMORY_RUNTIME;
+    }
+  }
+}
+
+/**
+  Internal function.  Removes a range from the copy of the memory map kept by
+  CoreGetMemoryMap(), clipping or splitting the descriptors that overlap it.
+
+  @param  Start                  The first address of the range.
+  @param  End                    The last address of the range.
+  @param  DescriptorSize         The size, in bytes, of a descriptor.
+
+  @retval TRUE                   The range was removed.
+  @retval FALSE                  The copy has no room to split a descriptor.
+
+**/
+STATIC
+BOOLEAN
+CoreRemoveMemoryMapCacheRange (
+  IN EFI_PHYSICAL_ADDRESS  Start,
+  IN EFI_PHYSICAL_ADDRESS  End,
+  IN UINTN                 DescriptorSize
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
+  EFI_MEMORY_DESCRIPTOR  *MemoryMapEnd;
+  EFI_MEMORY_DESCRIPTOR  *NextMemoryMap;
+  EFI_PHYSICAL_ADDRESS   MemoryMapLast;
+
+  MemoryMap    = mMemoryMapCache;
+  MemoryMapEnd = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)mMemoryMapCache + mMemoryMapCacheSize);
+  while (MemoryMap < MemoryMapEnd) {
+    NextMemoryMap = NEXT_MEMORY_DESCRIPTOR (MemoryMap, DescriptorSize);
+    MemoryMapLast = MemoryMap->PhysicalStart + LShiftU64 (MemoryMap->NumberOfPages, EFI_PAGE_SHIFT) - 1;
+    if ((MemoryMapLast < Start) || (MemoryMap->PhysicalStart > End)) {
+      MemoryMap = NextMemoryMap;
+      continue;
+    }
+
+    if (MemoryMap->PhysicalStart < Start) {
+      if (MemoryMapLast > End) {
+        //
+        // Keep the part above the range in a new descriptor at the end
+        //
+        if (mMemoryMapCacheSize + DescriptorSize > mMemoryMapCacheCapacity) {
+          return FALSE;
+        }
+
+        CopyMem (MemoryMapEnd, MemoryMap, DescriptorSize);
+        MemoryMapEnd->PhysicalStart = End + 1;
+        MemoryMapEnd->NumberOfPages = RShiftU64 (MemoryMapLast - End, EFI_PAGE_SHIFT);
+        MemoryMapEnd                = NEXT_MEMORY_DESCRIPTOR (MemoryMapEnd, DescriptorSize);
+        mMemoryMapCacheSize        += DescriptorSize;
+      }
+
+      MemoryMap->NumberOfPages = RShiftU64 (Start - MemoryMap->PhysicalStart, EFI_PAGE_SHIFT);
+    } else if (MemoryMapLast > End) {
+      MemoryMap->PhysicalStart = End + 1;
+      MemoryMap->NumberOfPages = RShiftU64 (MemoryMapLast - End, EFI_PAGE_SHIFT);
+    } else {
+      //
+      // The descriptor is within the range, drop it
+      //
+      CopyMem (MemoryMap, NextMemoryMap, (UINTN)MemoryMapEnd - (UINTN)NextMemoryMap);
+      MemoryMapEnd         = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MemoryMapEnd - DescriptorSize);
+      mMemoryMapCacheSize -= DescriptorSize;
+      continue;
+    }
+
+    MemoryMap = NextMemoryMap;
+  }
+
+  return TRUE;
+}
+
+/**
+  Internal function.  Brings the copy of the memory map kept by
+  CoreGetMemoryMap() up to date. The descriptors of the entries of gMemoryMap
+  that overlap or adjoin a changed range are removed from the copy and added
+  again, so the rest of the copy is not rebuilt. The adjoining entries are
+  included because clipping an entry may move it into a memory type bin, which
+  changes the type reported for it. The caller must hold the GCD memory lock
+  and the memory lock.
+
+  @param  DescriptorSize         The size, in bytes, of a descriptor.
+
+  @retval TRUE                   The copy describes the current memory map.
+  @retval FALSE                  The copy must be built again.
+
+**/
+STATIC
+BOOLEAN
+CoreUpdateMemoryMapCache (
+  IN UINTN  DescriptorSize
+  )
+{
+  UINTN                  Index;
+  UINTN                  NumberOfEntries;
+  LIST_ENTRY             *Link;
+  MEMORY_MAP             *Entry;
+  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
+  EFI_PHYSICAL_ADDRESS   Start;
+  EFI_PHYSICAL_ADDRESS   End;
+
+  if (!mMemoryMapCacheValid || (mMemoryMapCacheGcdGeneration != mGcdMemorySpaceMapGeneration)) {
+    return FALSE;
+  }
+
+  if (mMemoryMapCacheGeneration == mMemoryMapGeneration) {
+    return TRUE;
+  }
+
+  if (mMemoryMapCacheChangeCount > MEMORY_MAP_CACHE_MAX_CHANGES) {
+    mMemoryMapCacheValid = FALSE;
+    return FALSE;
+  }
+
+  NumberOfEntries = 0;
+  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
+    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
+    NumberOfEntries++;
+
+    for (Index = 0; Index < mMemoryMapCacheChangeCount; Index++) {
+      Start = mMemoryMapCacheChangeStart[Index];
+      End   = mMemoryMapCacheChangeEnd[Index];
+      if (((Entry->Start <= End) || (Entry->Start - End == 1)) &&
+          ((Entry->End >= Start) || (Start - Entry->End == 1)))
+      {
+        break;
+      }
+    }
+
+    if (Index == mMemoryMapCacheChangeCount) {
+      continue;
+    }
+
+    //
+    // Leave room for the descriptor after the last one, which MergeMemoryMap()
+    // reads
+    //
+    if (!CoreRemoveMemoryMapCacheRange (Entry->Start, Entry->End, DescriptorSize) ||
+        (mMemoryMapCacheSize + 2 * DescriptorSize > mMemoryMapCacheCapacity))
+    {
+      mMemoryMapCacheValid = FALSE;
+      return FALSE;
+    }
+
+    MemoryMap = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)mMemoryMapCache + mMemoryMapCacheSize);
+    ZeroMem (MemoryMap, DescriptorSize);
+    CoreMemoryMapEntryToDescriptor (Entry, MemoryMap);
+    MemoryMap->Attribute &= ~(UINT64)EFI_MEMORY_ACCESS_MASK;
+
+    MemoryMap           = MergeMemoryMapDescriptor (mMemoryMapCache, MemoryMap, DescriptorSize);
+    mMemoryMapCacheSize = (UINTN)MemoryMap - (UINTN)mMemoryMapCache;
+  }
+
+  MergeMemoryMap (mMemoryMapCache, &mMemoryMapCacheSize, DescriptorSize);
+
+  mMemoryMapCacheBufferSize  = DescriptorSize * (mMemoryMapCacheGcdEntries + NumberOfEntries);
+  mMemoryMapCacheGeneration  = mMemoryMapGeneration;
+  mMemoryMapCacheChangeCount = 0;
+  return TRUE;
+}
+
+/**
+  Internal function.  Grows the copy of the memory map kept by
+  CoreGetMemoryMap() if the map no longer fits in it.
+
+  The copy is allocated from pool, which changes the memory map, so this is
+  called by CoreGetMemoryMap() before it computes the size of the map. The
+  size returned to the caller then accounts for the allocation.
+
+  @param  DescriptorSize         The size, in bytes, of a descriptor.
+
+**/
+STATIC
+VOID
+CoreGrowMemoryMapCache (
+  IN UINTN  DescriptorSize
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *NewCache;
+  EFI_MEMORY_DESCRIPTOR  *OldCache;
+  UINTN                  RequiredSize;
+  UINTN                  Capacity;
+
+  //
+  // Nothing changed since the copy was built, or the pool allocation below
+  // came back here through the memory attributes table
+  //
+  if ((mMemoryMapCacheValid &&
+       (mMemoryMapCacheGeneration == mMemoryMapGeneration) &&
+       (mMemoryMapCacheGcdGeneration == mGcdMemorySpaceMapGeneration)) ||
+      mMemoryMapCacheGrowing)
+  {
+    return;
+  }
+
+  CoreAcquireGcdMemoryLock ();
+  CoreAcquireMemoryLock ();
+  RequiredSize = CoreGetMemoryMapBufferSize (DescriptorSize, NULL);
+  CoreReleaseMemoryLock ();
+  CoreReleaseGcdMemoryLock ();
+
+  if (RequiredSize <= mMemoryMapCacheCapacity) {
+    return;
+  }
+
+  //
+  // Leave room for the descriptors added by later allocations
+  //
+  Capacity               = RequiredSize + RequiredSize / 2;
+  mMemoryMapCacheGrowing = TRUE;
+  NewCache               = AllocatePool (Capacity);
+  mMemoryMapCacheGrowing = FALSE;
+  if (NewCache == NULL) {
+    return;
+  }
+
+  //
+  // Keep the copy built so far, so that it can still be patched
+  //
+  OldCache = NewCache;
+  CoreAcquireMemoryLock ();
+  if (Capacity > mMemoryMapCacheCapacity) {
+    CopyMem (NewCache, mMemoryMapCache, mMemoryMapCacheSize);
+    OldCache                = mMemoryMapCache;
+    mMemoryMapCache         = NewCache;
+    mMemoryMapCacheCapacity = Capacity;
+  }
+
+  CoreReleaseMemoryLock ();
+
+  if (OldCache != NULL) {
+    FreePool (OldCache);
+  }
+}
+
 /**
   This function returns a copy of the current memory map. The map is an array of
   memory descriptors, each of which describes a contiguous block of memory.
@@ -1763,14 +2246,15 @@ CoreGetMemoryMap (
   EFI_STATUS             Status;
   UINTN                  Size;
   UINTN                  BufferSize;
+  UINTN                  RequiredSize;
   UINTN                  NumberOfEntries;
   LIST_ENTRY             *Link;
   MEMORY_MAP             *Entry;
   EFI_GCD_MAP_ENTRY      *GcdMapEntry;
   EFI_GCD_MAP_ENTRY      MergeGcdMapEntry;
-  EFI_MEMORY_TYPE        Type;
   EFI_MEMORY_DESCRIPTOR  *MemoryMapStart;
   EFI_MEMORY_DESCRIPTOR  *MemoryMapEnd;
+  BOOLEAN                UseCache;
 
   //
   // Make sure the parameters are valid
@@ -1779,23 +2263,12 @@ CoreGetMemoryMap (
     return EFI_INVALID_PARAMETER;
   }
 
-  CoreAcquireGcdMemoryLock ();
-
   //
-  // Count the number of Reserved and runtime MMIO entries
-  // And, count the number of Persistent entries.
+  // The freed-memory guard merges guard pages into the map based on a bitmap
+  // that is updated outside of the memory lock, so the map is always rebuilt
+  // then.
   //
-  NumberOfEntries = 0;
-  for (Link = mGcdMemorySpaceMap.ForwardLink; Link != &mGcdMemorySpaceMap; Link = Link->ForwardLink) {
-    GcdMapEntry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    if ((GcdMapEntry->GcdMemoryType == EfiGcdMemoryTypePersistent) ||
-        (GcdMapEntry->GcdMemoryType == EfiGcdMemoryTypeReserved) ||
-        ((GcdMapEntry->GcdMemoryType == EfiGcdMemoryTypeMemoryMappedIo) &&
-         ((GcdMapEntry->Attributes & EFI_MEMORY_RUNTIME) == EFI_MEMORY_RUNTIME)))
-    {
-      NumberOfEntries++;
-    }
-  }
+  UseCache = !IsHeapGuardEnabled (GUARD_HEAP_TYPE_FREED);
 
   Size = sizeof (EFI_MEMORY_DESCRIPTOR);
 
@@ -1814,16 +2287,44 @@ CoreGetMemoryMap (
     *DescriptorVersion = EFI_MEMORY_DESCRIPTOR_VERSION;
   }
 
+  //
+  // Grow the copy of the map first, as that changes the map being returned
+  //
+  if (UseCache) {
+    CoreGrowMemoryMapCache (Size);
+  }
+
+  CoreAcquireGcdMemoryLock ();
+
   CoreAcquireMemoryLock ();
 
   //
-  // Compute the buffer size needed to fit the entire map
+  // Return the map built by a previous call, with the ranges changed since
+  // patched in, if the GCD memory space map did not change. The buffer size
+  // required is the one computed for that map, so callers see the same results
+  // as when the map is rebuilt.
   //
-  BufferSize = Size * NumberOfEntries;
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    BufferSize += Size;
+  if (UseCache && CoreUpdateMemoryMapCache (Size)) {
+    BufferSize = mMemoryMapCacheBufferSize;
+    if (*MemoryMapSize < BufferSize) {
+      Status = EFI_BUFFER_TOO_SMALL;
+      goto Done;
+    }
+
+    if (MemoryMap == NULL) {
+      Status = EFI_INVALID_PARAMETER;
+      goto Done;
+    }
+
+    CopyMem (MemoryMap, mMemoryMapCache, mMemoryMapCacheSize);
+    BufferSize = mMemoryMapCacheSize;
+    Status     = EFI_SUCCESS;
+    goto Done;
   }
 
+  BufferSize   = CoreGetMemoryMapBufferSize (Size, &NumberOfEntries);
+  RequiredSize = BufferSize;
+
   if (*MemoryMapSize < BufferSize) {
     Status = EFI_BUFFER_TOO_SMALL;
     goto Done;
@@ -1841,40 +2342,7 @@ CoreGetMemoryMap (
   MemoryMapStart = MemoryMap;
   for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
     Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-    ASSERT (Entry->VirtualStart == 0);
-
-    //
-    // Convert internal map into an EFI_MEMORY_DESCRIPTOR
-    //
-    MemoryMap->Type          = Entry->Type;
-    MemoryMap->PhysicalStart = Entry->Start;
-    MemoryMap->VirtualStart  = Entry->VirtualStart;
-    MemoryMap->NumberOfPages = RShiftU64 (Entry->End - Entry->Start + 1, EFI_PAGE_SHIFT);
-    //
-    // If the memory type is EfiConventionalMemory, then determine if the range is part of a
-    // memory type bin and needs to be converted to the same memory type as the rest of the
-    // memory type bin in order to minimize EFI Memory Map changes across reboots.  This
-    // improves the chances for a successful S4 resume in the presence of minor page allocation
-    // differences across reboots.
-    //
-    if (MemoryMap->Type == EfiConventionalMemory) {
-      for (Type = (EFI_MEMORY_TYPE)0; Type < EfiMaxMemoryType; Type++) {
-        if (mMemoryTypeStatistics[Type].Special                        &&
-            (mMemoryTypeStatistics[Type].NumberOfPages > 0) &&
-            (Entry->Start >= mMemoryTypeStatistics[Type].BaseAddress) &&
-            (Entry->End   <= mMemoryTypeStatistics[Type].MaximumAddress))
-        {
-          MemoryMap->Type = Type;
-        }
-      }
-    }
-
-    MemoryMap->Attribute = Entry->Attribute;
-    if (MemoryMap->Type < EfiMaxMemoryType) {
-      if (mMemoryTypeStatistics[MemoryMap->Type].Runtime) {
-        MemoryMap->Attribute |= EFI_MEMORY_RUNTIME;
-      }
-    }
+    CoreMemoryMapEntryToDescriptor (Entry, MemoryMap);
 
     //
     // Check to see if the new Memory Map Descriptor can be merged with an
@@ -2031,6 +2499,20 @@ CoreGetMemoryMap (
   MergeMemoryMap (MemoryMapStart, &BufferSize, Size);
   MemoryMapEnd = (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MemoryMapStart + BufferSize);
 
+  //
+  // Keep a copy of the map for the next calls
+  //
+  if (UseCache && (BufferSize <= mMemoryMapCacheCapacity)) {
+    CopyMem (mMemoryMapCache, MemoryMapStart, BufferSize);
+    mMemoryMapCacheSize          = BufferSize;
+    mMemoryMapCacheBufferSize    = RequiredSize;
+    mMemoryMapCacheGcdEntries    = NumberOfEntries;
+    mMemoryMapCacheGeneration    = mMemoryMapGeneration;
+    mMemoryMapCacheGcdGeneration = mGcdMemorySpaceMapGeneration;
+    mMemoryMapCacheValid         = TRUE;
+    mMemoryMapCacheChangeCount   = 0;
+  }
+
   Status = EFI_SUCCESS;
 
 Done:
@@ -9,6 +9,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "DxeMain.h"
 #include "Imem.h"
 #include "HeapGuard.h"
+#include "PoolSlab.h"
 
 STATIC EFI_LOCK  mPoolMemoryLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 
@@ -59,6 +60,22 @@ STATIC CONST UINT16  mPoolSizeTable[] = {
 
 #define MAX_POOL_SIZE  (MAX_ADDRESS - POOL_OVERHEAD)
 
+//
+// Slab allocator for small pool requests, enabled by BIT0 of
+// PcdPoolSlabPropertyMask, see PoolSlab.h. Each slab is one pool page.
+//
+#define POOL_SLAB_ENABLED  ((PcdGet8 (PcdPoolSlabPropertyMask) & BIT0) != 0)
+
+//
+// Object sizes of the slab classes, including the POOL_SLAB_OBJECT header.
+// The largest class matches what the smallest regular pool block can hold.
+//
+STATIC CONST UINT16  mPoolSlabSizeTable[] = {
+  32, 48, 64, 96
+};
+
+#define MAX_POOL_SLAB_LIST  (ARRAY_SIZE (mPoolSlabSizeTable))
+
 //
 // Globals
 //
@@ -69,6 +86,7 @@ typedef struct {
   UINTN              Used;
   EFI_MEMORY_TYPE    MemoryType;
   LIST_ENTRY         FreeList[MAX_POOL_LIST];
+  LIST_ENTRY         SlabList[MAX_POOL_SLAB_LIST];
   LIST_ENTRY         Link;
 } POOL;
 
@@ -126,6 +144,10 @@ CoreInitializePool (
     for (Index = 0; Index < MAX_POOL_LIST; Index++) {
       InitializeListHead (&mPoolHead[Type].FreeList[Index]);
     }
+
+    for (Index = 0; Index < MAX_POOL_SLAB_LIST; Index++) {
+      InitializeListHead (&mPoolHead[Type].SlabList[Index]);
+    }
   }
 }
 
@@ -175,6 +197,10 @@ LookupPoolHead (
       InitializeListHead (&Pool->FreeList[Index]);
     }
 
+    for (Index = 0; Index < MAX_POOL_SLAB_LIST; Index++) {
+      InitializeListHead (&Pool->SlabList[Index]);
+    }
+
     InsertHeadList (&mPoolHeadList, &Pool->Link);
 
     return Pool;
@@ -336,6 +362,94 @@ CoreAllocatePoolPagesI (
   return Buffer;
 }
 
+/**
+  Get slab size table index from the specified object size.
+
+  @param  Size          The object size including the POOL_SLAB_OBJECT header.
+
+  @return               The index of slab size table, or MAX_POOL_SLAB_LIST if
+                        the size is too large for any slab class.
+
+**/
+STATIC
+UINTN
+GetPoolSlabIndexFromSize (
+  UINTN  Size
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < MAX_POOL_SLAB_LIST; Index++) {
+    if (mPoolSlabSizeTable[Index] >= Size) {
+      return Index;
+    }
+  }
+
+  return MAX_POOL_SLAB_LIST;
+}
+
+/**
+  Internal function to allocate an object from the slabs of a pool.
+  Caller must have the memory lock held
+
+  @param  Pool                   The pool head of the memory type to allocate
+  @param  Index                  The slab size table index
+
+  @return The allocated object buffer, or NULL
+
+**/
+STATIC
+VOID *
+CoreAllocatePoolSlabI (
+  IN POOL   *Pool,
+  IN UINTN  Index
+  )
+{
+  POOL_SLAB  *Slab;
+  VOID       *Buffer;
+
+  ASSERT_LOCKED (&mPoolMemoryLock);
+
+  Slab = PoolSlabGetFree (&Pool->SlabList[Index]);
+  if (Slab == NULL) {
+    Slab = CoreAllocatePoolPagesI (
+             Pool->MemoryType,
+             EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION_GRANULARITY),
+             DEFAULT_PAGE_ALLOCATION_GRANULARITY,
+             FALSE
+             );
+    if (Slab == NULL) {
+      return NULL;
+    }
+
+    PoolSlabInitialize (
+      &Pool->SlabList[Index],
+      Slab,
+      DEFAULT_PAGE_ALLOCATION_GRANULARITY,
+      Index,
+      mPoolSlabSizeTable[Index],
+      Pool->MemoryType
+      );
+  }
+
+  Buffer = PoolSlabAllocateObject (&Pool->SlabList[Index], Slab);
+
+  Pool->Used += mPoolSlabSizeTable[Index];
+
+  DEBUG_CLEAR_MEMORY (Buffer, mPoolSlabSizeTable[Index] - sizeof (POOL_SLAB_OBJECT));
+
+  DEBUG ((
+    DEBUG_POOL,
+    "AllocatePoolI: Type %x, Addr %p (slab len %lx) %,ld\n",
+    Pool->MemoryType,
+    Buffer,
+    (UINT64)(mPoolSlabSizeTable[Index] - sizeof (POOL_SLAB_OBJECT)),
+    (UINT64)Pool->Used
+    ));
+
+  return Buffer;
+}
+
 /**
   Internal function to allocate pool of a particular type.
   Caller must have the memory lock held
@@ -395,6 +509,20 @@ CoreAllocatePoolI (
   //
   Size = ALIGN_VARIABLE (Size);
 
+  //
+  // Serve small requests from the slabs, unless the heap guard needs to
+  // track the allocation
+  //
+  if (POOL_SLAB_ENABLED && !NeedGuard && !PageAsPool &&
+      ((UINT32)PoolType < EfiMaxMemoryType) &&
+      (Granularity == DEFAULT_PAGE_ALLOCATION_GRANULARITY))
+  {
+    Index = GetPoolSlabIndexFromSize (Size + sizeof (POOL_SLAB_OBJECT));
+    if (Index < MAX_POOL_SLAB_LIST) {
+      return CoreAllocatePoolSlabI (&mPoolHead[PoolType], Index);
+    }
+  }
+
   Size += POOL_OVERHEAD;
   Index = SIZE_TO_LIST (Size);
   Pool  = LookupPoolHead (PoolType);
@@ -665,6 +793,58 @@ CoreFreePoolPagesWithGuard (
   }
 }
 
+/**
+  Internal function to free a slab object.
+  Caller must have the memory lock held
+
+  @param  Slab                   The slab holding Buffer
+  @param  Buffer                 The object buffer to free
+
+  @retval EFI_INVALID_PARAMETER  Buffer is not an allocated object.
+  @retval EFI_SUCCESS            Buffer successfully freed.
+
+**/
+STATIC
+EFI_STATUS
+CoreFreePoolSlabI (
+  IN POOL_SLAB  *Slab,
+  IN VOID       *Buffer
+  )
+{
+  POOL        *Pool;
+  UINTN       Index;
+  BOOLEAN     Release;
+  EFI_STATUS  Status;
+
+  ASSERT_LOCKED (&mPoolMemoryLock);
+
+  Index = Slab->Index;
+  Pool  = LookupPoolHead (Slab->Type);
+  if (Pool == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = PoolSlabFreeObject (&Pool->SlabList[Index], Slab, Buffer, &Release);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Pool->Used -= mPoolSlabSizeTable[Index];
+  DEBUG ((DEBUG_POOL, "FreePool: %p (slab len %lx) %,ld\n", Buffer, (UINT64)(mPoolSlabSizeTable[Index] - sizeof (POOL_SLAB_OBJECT)), (UINT64)Pool->Used));
+
+  DEBUG_CLEAR_MEMORY (Buffer, mPoolSlabSizeTable[Index] - sizeof (POOL_SLAB_OBJECT));
+
+  if (Release) {
+    CoreFreePoolPagesI (
+      Pool->MemoryType,
+      (EFI_PHYSICAL_ADDRESS)(UINTN)Slab,
+      EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION_GRANULARITY)
+      );
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Internal function to free a pool entry.
   Caller must have the memory lock held
@@ -696,8 +876,26 @@ CoreFreePoolI (
   BOOLEAN    IsGuarded;
   BOOLEAN    HasPoolTail;
   BOOLEAN    PageAsPool;
+  POOL_SLAB  *Slab;
 
   ASSERT (Buffer != NULL);
+
+  if (POOL_SLAB_ENABLED) {
+    Slab = PoolSlabLookup (
+             Buffer,
+             DEFAULT_PAGE_ALLOCATION_GRANULARITY,
+             mPoolSlabSizeTable,
+             MAX_POOL_SLAB_LIST
+             );
+    if (Slab != NULL) {
+      if (PoolType != NULL) {
+        *PoolType = Slab->Type;
+      }
+
+      return CoreFreePoolSlabI (Slab, Buffer);
+    }
+  }
+
   //
   // Get the head & tail of the pool entry
   //
@@ -0,0 +1,1059 @@
+/** @file
+  Boot service latency profile.
+
+  When PcdDxeServiceProfileRecordCount is not zero, the boot services in
+  gBS that are listed in Guid/DxeServiceProfile.h are replaced by wrappers
+  that measure the time spent in the DXE Core service. Every call is counted
+  in a latency histogram of the image that made the call, and appended to a
+  ring buffer of the most recent calls. Both are published in the
+  gEdkiiDxeServiceProfileTableGuid configuration table.
+
+  The DXE Core itself calls its services directly, so only the calls made
+  through gBS are measured.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+
+#include <Guid/DxeServiceProfile.h>
+
+//
+// Number of images calls can be attributed to, including the unknown caller,
+// when the profile is allocated. It is doubled whenever it is full.
+//
+#define DXE_SERVICE_PROFILE_INITIAL_CALLERS  64
+
+DXE_SERVICE_PROFILE_TABLE   *mServiceProfile   = NULL;
+DXE_SERVICE_PROFILE_CALLER  *mServiceCallers   = NULL;
+DXE_SERVICE_PROFILE_RECORD  *mServiceRecords   = NULL;
+UINT32                      mLastServiceCaller = 0;
+BOOLEAN                     mCounterCountsDown = FALSE;
+
+//
+// Indexes of the callers whose image is loaded, sorted by image base. The
+// callers themselves keep their index, which the records refer to.
+//
+UINT32  *mSortedServiceCallers    = NULL;
+UINT32  mSortedServiceCallerCount = 0;
+
+/**
+  Find the position of an address in the callers sorted by image base.
+
+  @param  Address  An address.
+
+  @return The number of sorted callers whose image base is not above Address.
+
+**/
+UINT32
+ServiceProfileSortedPosition (
+  IN UINTN  Address
+  )
+{
+  UINT32  Low;
+  UINT32  High;
+  UINT32  Middle;
+
+  Low  = 0;
+  High = mSortedServiceCallerCount;
+  while (Low < High) {
+    Middle = (Low + High) / 2;
+    if (mServiceCallers[mSortedServiceCallers[Middle]].ImageBase <= (EFI_PHYSICAL_ADDRESS)Address) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  return Low;
+}
+
+/**
+  Find the image that contains an address.
+
+  @param  Address  The return address of a boot service call.
+
+  @return The index of the caller of the boot service, or 0 if the address
+          is not in an image that was registered.
+
+**/
+UINT32
+ServiceProfileFindCaller (
+  IN UINTN  Address
+  )
+{
+  DXE_SERVICE_PROFILE_CALLER  *Caller;
+  UINT32                      Position;
+  UINT32                      Index;
+
+  //
+  // Consecutive calls are usually made by the same image
+  //
+  Caller = &mServiceCallers[mLastServiceCaller];
+  if ((Address - (UINTN)Caller->ImageBase) < Caller->ImageSize) {
+    return mLastServiceCaller;
+  }
+
+  //
+  // Images do not overlap, so only the last image that starts at or below
+  // the address can contain it
+  //
+  Position = ServiceProfileSortedPosition (Address);
+  if (Position > 0) {
+    Index  = mSortedServiceCallers[Position - 1];
+    Caller = &mServiceCallers[Index];
+    if ((Address - (UINTN)Caller->ImageBase) < Caller->ImageSize) {
+      mLastServiceCaller = Index;
+      return Index;
+    }
+  }
+
+  return 0;
+}
+
+/**
+  Insert a caller whose image was just loaded in the sorted callers.
+  Interrupts must be disabled.
+
+  @param  Index  The index of the caller.
+
+**/
+VOID
+ServiceProfileInsertSortedCaller (
+  IN UINT32  Index
+  )
+{
+  UINT32  Position;
+
+  Position = ServiceProfileSortedPosition ((UINTN)mServiceCallers[Index].ImageBase);
+  CopyMem (
+    &mSortedServiceCallers[Position + 1],
+    &mSortedServiceCallers[Position],
+    (mSortedServiceCallerCount - Position) * sizeof (UINT32)
+    );
+  mSortedServiceCallers[Position] = Index;
+  mSortedServiceCallerCount++;
+}
+
+/**
+  Record a call to a boot service.
+
+  This runs on every profiled call, so it must not call any boot service.
+
+  @param  Service  The DXE_SERVICE_PROFILE_* index of the service.
+  @param  Caller   The return address of the call.
+  @param  Start    The performance counter before the call.
+  @param  End      The performance counter after the call.
+
+**/
+VOID
+ServiceProfileRecord (
+  IN UINT16  Service,
+  IN VOID    *Caller,
+  IN UINT64  Start,
+  IN UINT64  End
+  )
+{
+  DXE_SERVICE_PROFILE_STATISTICS  *Statistics;
+  DXE_SERVICE_PROFILE_RECORD      *Record;
+  UINT64                          Ticks;
+  UINT32                          CallerIndex;
+  UINTN                           Bucket;
+  BOOLEAN                         InterruptState;
+
+  Ticks = mCounterCountsDown ? Start - End : End - Start;
+
+  //
+  // The timer interrupt handler calls RaiseTPL and RestoreTPL through gBS as
+  // well, so keep it from updating the statistics at the same time.
+  //
+  InterruptState = SaveAndDisableInterrupts ();
+
+  CallerIndex = ServiceProfileFindCaller ((UINTN)Caller);
+  Statistics  = &mServiceCallers[CallerIndex].Service[Service];
+  Statistics->Count++;
+  Statistics->TotalTicks += Ticks;
+  if (Ticks > Statistics->MaxTicks) {
+    Statistics->MaxTicks = Ticks;
+  }
+
+  Bucket = (Ticks == 0) ? 0 : (UINTN)HighBitSet64 (Ticks);
+  if (Bucket >= DXE_SERVICE_PROFILE_BUCKET_COUNT) {
+    Bucket = DXE_SERVICE_PROFILE_BUCKET_COUNT - 1;
+  }
+
+  Statistics->Histogram[Bucket]++;
+
+  Record            = &mServiceRecords[mServiceProfile->RecordIndex % mServiceProfile->RecordCount];
+  Record->Timestamp = Start;
+  Record->Duration  = (UINT32)MIN (Ticks, MAX_UINT32);
+  Record->Service   = Service;
+  Record->Caller    = (UINT16)CallerIndex;
+  mServiceProfile->RecordIndex++;
+
+  SetInterruptState (InterruptState);
+}
+
+/**
+  Raise the task priority level to the new level, and record the call.
+
+  @param  NewTpl  New task priority level
+
+  @return The previous task priority level
+
+**/
+EFI_TPL
+EFIAPI
+ServiceProfileRaiseTpl (
+  IN EFI_TPL  NewTpl
+  )
+{
+  UINT64   Start;
+  EFI_TPL  OldTpl;
+
+  Start  = GetPerformanceCounter ();
+  OldTpl = CoreRaiseTpl (NewTpl);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_RAISE_TPL, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return OldTpl;
+}
+
+/**
+  Lowers the task priority to the previous value, and record the call.
+
+  @param  NewTpl  New, lower, task priority
+
+**/
+VOID
+EFIAPI
+ServiceProfileRestoreTpl (
+  IN EFI_TPL  NewTpl
+  )
+{
+  UINT64  Start;
+
+  Start = GetPerformanceCounter ();
+  CoreRestoreTpl (NewTpl);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_RESTORE_TPL, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+}
+
+/**
+  Allocates pages from the memory map, and record the call.
+
+  @param  Type                   The type of allocation to perform
+  @param  MemoryType             The type of memory to turn the allocated pages
+                                 into
+  @param  NumberOfPages          The number of pages to allocate
+  @param  Memory                 A pointer to receive the base allocated memory
+                                 address
+
+  @return Status of CoreAllocatePages().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileAllocatePages (
+  IN EFI_ALLOCATE_TYPE         Type,
+  IN EFI_MEMORY_TYPE           MemoryType,
+  IN UINTN                     NumberOfPages,
+  IN OUT EFI_PHYSICAL_ADDRESS  *Memory
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreAllocatePages (Type, MemoryType, NumberOfPages, Memory);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_ALLOCATE_PAGES, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Frees previous allocated pages, and record the call.
+
+  @param  Memory                 Base address of memory being freed
+  @param  NumberOfPages          The number of pages to free
+
+  @return Status of CoreFreePages().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileFreePages (
+  IN EFI_PHYSICAL_ADDRESS  Memory,
+  IN UINTN                 NumberOfPages
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreFreePages (Memory, NumberOfPages);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_FREE_PAGES, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Returns the current memory map, and record the call.
+
+  @param  MemoryMapSize          A pointer to the size, in bytes, of the
+                                 MemoryMap buffer
+  @param  MemoryMap              A pointer to the buffer in which firmware places
+                                 the current memory map
+  @param  MapKey                 A pointer to the location in which firmware
+                                 returns the key for the current memory map
+  @param  DescriptorSize         A pointer to the location in which firmware
+                                 returns the size, in bytes, of an individual
+                                 EFI_MEMORY_DESCRIPTOR
+  @param  DescriptorVersion      A pointer to the location in which firmware
+                                 returns the version number associated with the
+                                 EFI_MEMORY_DESCRIPTOR
+
+  @return Status of CoreGetMemoryMap().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileGetMemoryMap (
+  IN OUT UINTN                  *MemoryMapSize,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  OUT UINTN                     *MapKey,
+  OUT UINTN                     *DescriptorSize,
+  OUT UINT32                    *DescriptorVersion
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreGetMemoryMap (MemoryMapSize, MemoryMap, MapKey, DescriptorSize, DescriptorVersion);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_GET_MEMORY_MAP, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Allocate pool of a particular type, and record the call.
+
+  @param  PoolType               Type of pool to allocate
+  @param  Size                   The amount of pool to allocate
+  @param  Buffer                 The address to return a pointer to the allocated
+                                 pool
+
+  @return Status of CoreAllocatePool().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileAllocatePool (
+  IN EFI_MEMORY_TYPE  PoolType,
+  IN UINTN            Size,
+  OUT VOID            **Buffer
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreAllocatePool (PoolType, Size, Buffer);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_ALLOCATE_POOL, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Frees pool, and record the call.
+
+  @param  Buffer                 The allocated pool entry to free
+
+  @return Status of CoreFreePool().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileFreePool (
+  IN VOID  *Buffer
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreFreePool (Buffer);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_FREE_POOL, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Creates an event, and record the call.
+
+  @param  Type                   The type of event to create and its mode and
+                                 attributes
+  @param  NotifyTpl              The task priority level of event notifications
+  @param  NotifyFunction         Pointer to the events notification function
+  @param  NotifyContext          Pointer to the notification functions context;
+                                 corresponds to parameter "Context" in the
+                                 notification function
+  @param  Event                  Pointer to the newly created event if the call
+                                 succeeds; undefined otherwise
+
+  @return Status of CoreCreateEvent().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileCreateEvent (
+  IN UINT32            Type,
+  IN EFI_TPL           NotifyTpl,
+  IN EFI_EVENT_NOTIFY  NotifyFunction  OPTIONAL,
+  IN VOID              *NotifyContext  OPTIONAL,
+  OUT EFI_EVENT        *Event
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreCreateEvent (Type, NotifyTpl, NotifyFunction, NotifyContext, Event);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_CREATE_EVENT, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Creates an event in a group, and record the call.
+
+  @param  Type                   The type of event to create and its mode and
+                                 attributes
+  @param  NotifyTpl              The task priority level of event notifications
+  @param  NotifyFunction         Pointer to the events notification function
+  @param  NotifyContext          Pointer to the notification functions context;
+                                 corresponds to parameter "Context" in the
+                                 notification function
+  @param  EventGroup             GUID for EventGroup if NULL act the same as
+                                 gBS->CreateEvent().
+  @param  Event                  Pointer to the newly created event if the call
+                                 succeeds; undefined otherwise
+
+  @return Status of CoreCreateEventEx().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileCreateEventEx (
+  IN UINT32            Type,
+  IN EFI_TPL           NotifyTpl,
+  IN EFI_EVENT_NOTIFY  NotifyFunction  OPTIONAL,
+  IN CONST VOID        *NotifyContext  OPTIONAL,
+  IN CONST EFI_GUID    *EventGroup     OPTIONAL,
+  OUT EFI_EVENT        *Event
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreCreateEventEx (Type, NotifyTpl, NotifyFunction, NotifyContext, EventGroup, Event);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_CREATE_EVENT_EX, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Signals the event, and record the call.
+
+  @param  UserEvent              The event to signal .
+
+  @return Status of CoreSignalEvent().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileSignalEvent (
+  IN EFI_EVENT  UserEvent
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreSignalEvent (UserEvent);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_SIGNAL_EVENT, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Installs a protocol interface into the boot services environment, and
+  record the call.
+
+  @param  UserHandle             The handle to install the protocol handler on,
+                                 or NULL if a new handle is to be allocated
+  @param  Protocol               The protocol to add to the handle
+  @param  InterfaceType          Indicates whether Interface is supplied in
+                                 native form.
+  @param  Interface              The interface for the protocol being added
+
+  @return Status of CoreInstallProtocolInterface().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileInstallProtocolInterface (
+  IN OUT EFI_HANDLE      *UserHandle,
+  IN EFI_GUID            *Protocol,
+  IN EFI_INTERFACE_TYPE  InterfaceType,
+  IN VOID                *Interface
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreInstallProtocolInterface (UserHandle, Protocol, InterfaceType, Interface);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_INSTALL_PROTOCOL_INTERFACE, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Uninstalls protocol interface from the handle, and record the call.
+
+  @param  UserHandle             The handle to remove the protocol handler from
+  @param  Protocol               The protocol, of protocol:interface, to remove
+  @param  Interface              The interface, of protocol:interface, to remove
+
+  @return Status of CoreUninstallProtocolInterface().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileUninstallProtocolInterface (
+  IN EFI_HANDLE  UserHandle,
+  IN EFI_GUID    *Protocol,
+  IN VOID        *Interface
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreUninstallProtocolInterface (UserHandle, Protocol, Interface);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_UNINSTALL_PROTOCOL_INTERFACE, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Queries a handle to determine if it supports a specified protocol, and
+  record the call.
+
+  @param  UserHandle             The handle being queried.
+  @param  Protocol               The published unique identifier of the protocol.
+  @param  Interface              Supplies the address where a pointer to the
+                                 corresponding Protocol Interface is returned.
+
+  @return Status of CoreHandleProtocol().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileHandleProtocol (
+  IN EFI_HANDLE  UserHandle,
+  IN EFI_GUID    *Protocol,
+  OUT VOID       **Interface
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreHandleProtocol (UserHandle, Protocol, Interface);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_HANDLE_PROTOCOL, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Locates the requested handle(s) and returns them in Buffer, and record the
+  call.
+
+  @param  SearchType             The type of search to perform to locate the
+                                 handles
+  @param  Protocol               The protocol to search for
+  @param  SearchKey              Dependant on SearchType
+  @param  BufferSize             On input the size of Buffer.  On output the
+                                 size of data returned.
+  @param  Buffer                 The buffer to return the results in
+
+  @return Status of CoreLocateHandle().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileLocateHandle (
+  IN EFI_LOCATE_SEARCH_TYPE  SearchType,
+  IN EFI_GUID                *Protocol   OPTIONAL,
+  IN VOID                    *SearchKey  OPTIONAL,
+  IN OUT UINTN               *BufferSize,
+  OUT EFI_HANDLE             *Buffer
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreLocateHandle (SearchType, Protocol, SearchKey, BufferSize, Buffer);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_LOCATE_HANDLE, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Locates the installed protocol handler for the handle, and invokes it to
+  obtain the protocol interface, and record the call.
+
+  @param  UserHandle             The handle to obtain the protocol interface on
+  @param  Protocol               The ID of the protocol
+  @param  Interface              The location to return the protocol interface
+  @param  ImageHandle            The handle of the Image that is opening the
+                                 protocol interface specified by Protocol and
+                                 Interface.
+  @param  ControllerHandle       The controller handle that is requiring this
+                                 interface.
+  @param  Attributes             The open mode of the protocol interface
+                                 specified by Handle and Protocol.
+
+  @return Status of CoreOpenProtocol().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileOpenProtocol (
+  IN  EFI_HANDLE  UserHandle,
+  IN  EFI_GUID    *Protocol,
+  OUT VOID        **Interface OPTIONAL,
+  IN  EFI_HANDLE  ImageHandle,
+  IN  EFI_HANDLE  ControllerHandle,
+  IN  UINT32      Attributes
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreOpenProtocol (UserHandle, Protocol, Interface, ImageHandle, ControllerHandle, Attributes);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_OPEN_PROTOCOL, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Closes a protocol on a handle that was opened using OpenProtocol(), and
+  record the call.
+
+  @param  UserHandle             The handle for the protocol interface that was
+                                 previously opened with OpenProtocol(), and is
+                                 now being closed.
+  @param  Protocol               The published unique identifier of the protocol.
+  @param  AgentHandle            The handle of the agent that is closing the
+                                 protocol interface.
+  @param  ControllerHandle       If the agent that opened a protocol is a driver
+                                 that follows the EFI Driver Model, then this
+                                 parameter is the controller handle that required
+                                 the protocol interface.
+
+  @return Status of CoreCloseProtocol().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileCloseProtocol (
+  IN  EFI_HANDLE  UserHandle,
+  IN  EFI_GUID    *Protocol,
+  IN  EFI_HANDLE  AgentHandle,
+  IN  EFI_HANDLE  ControllerHandle
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreCloseProtocol (UserHandle, Protocol, AgentHandle, ControllerHandle);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_CLOSE_PROTOCOL, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Function returns an array of handles that support the requested protocol
+  in a buffer allocated from pool, and record the call.
+
+  @param  SearchType             Specifies which handle(s) are to be returned.
+  @param  Protocol               Provides the protocol to search by.
+                                 This parameter is only valid for SearchType
+                                 ByProtocol.
+  @param  SearchKey              Supplies the search key depending on the
+                                 SearchType.
+  @param  NumberHandles          The number of handles returned in Buffer.
+  @param  Buffer                 A pointer to the buffer to return the requested
+                                 array of  handles that support Protocol.
+
+  @return Status of CoreLocateHandleBuffer().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileLocateHandleBuffer (
+  IN EFI_LOCATE_SEARCH_TYPE  SearchType,
+  IN EFI_GUID                *Protocol OPTIONAL,
+  IN VOID                    *SearchKey OPTIONAL,
+  IN OUT UINTN               *NumberHandles,
+  OUT EFI_HANDLE             **Buffer
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreLocateHandleBuffer (SearchType, Protocol, SearchKey, NumberHandles, Buffer);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_LOCATE_HANDLE_BUFFER, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Return the first Protocol Interface that matches the Protocol GUID, and
+  record the call.
+
+  @param  Protocol               The protocol to search for
+  @param  Registration           Optional Registration Key returned from
+                                 RegisterProtocolNotify()
+  @param  Interface              Return the Protocol interface (instance).
+
+  @return Status of CoreLocateProtocol().
+
+**/
+EFI_STATUS
+EFIAPI
+ServiceProfileLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+
+  Start  = GetPerformanceCounter ();
+  Status = CoreLocateProtocol (Protocol, Registration, Interface);
+  ServiceProfileRecord (DXE_SERVICE_PROFILE_LOCATE_PROTOCOL, RETURN_ADDRESS (0), Start, GetPerformanceCounter ());
+  return Status;
+}
+
+/**
+  Double the number of callers the profile has room for. The profile is
+  reallocated and installed again as the configuration table.
+
+  @retval TRUE   The profile has room for more callers.
+  @retval FALSE  The profile could not be reallocated.
+
+**/
+BOOLEAN
+ServiceProfileGrowCallers (
+  VOID
+  )
+{
+  DXE_SERVICE_PROFILE_TABLE  *OldProfile;
+  DXE_SERVICE_PROFILE_TABLE  *NewProfile;
+  UINT32                     *OldSorted;
+  UINT32                     *NewSorted;
+  UINTN                      MaxCallerCount;
+  UINTN                      RecordOffset;
+  BOOLEAN                    InterruptState;
+
+  //
+  // The records refer to the callers with 16-bit indexes
+  //
+  OldProfile     = mServiceProfile;
+  MaxCallerCount = (UINTN)OldProfile->MaxCallerCount * 2;
+  if (MaxCallerCount > MAX_UINT16 + 1) {
+    return FALSE;
+  }
+
+  RecordOffset = OldProfile->CallerOffset + MaxCallerCount * sizeof (DXE_SERVICE_PROFILE_CALLER);
+  NewProfile   = AllocateZeroPool (RecordOffset + OldProfile->RecordCount * sizeof (DXE_SERVICE_PROFILE_RECORD));
+  NewSorted    = AllocatePool (MaxCallerCount * sizeof (UINT32));
+  if ((NewProfile == NULL) || (NewSorted == NULL)) {
+    if (NewProfile != NULL) {
+      FreePool (NewProfile);
+    }
+
+    if (NewSorted != NULL) {
+      FreePool (NewSorted);
+    }
+
+    return FALSE;
+  }
+
+  //
+  // Calls must not be recorded in the old profile once it has been copied
+  //
+  InterruptState = SaveAndDisableInterrupts ();
+
+  CopyMem (
+    NewProfile,
+    OldProfile,
+    OldProfile->CallerOffset + OldProfile->CallerCount * sizeof (DXE_SERVICE_PROFILE_CALLER)
+    );
+  CopyMem (
+    (UINT8 *)NewProfile + RecordOffset,
+    mServiceRecords,
+    OldProfile->RecordCount * sizeof (DXE_SERVICE_PROFILE_RECORD)
+    );
+  CopyMem (NewSorted, mSortedServiceCallers, mSortedServiceCallerCount * sizeof (UINT32));
+  OldSorted                  = mSortedServiceCallers;
+  NewProfile->MaxCallerCount = (UINT32)MaxCallerCount;
+  NewProfile->RecordOffset   = (UINT32)RecordOffset;
+  mServiceProfile            = NewProfile;
+  mServiceCallers            = (DXE_SERVICE_PROFILE_CALLER *)((UINT8 *)NewProfile + NewProfile->CallerOffset);
+  mServiceRecords            = (DXE_SERVICE_PROFILE_RECORD *)((UINT8 *)NewProfile + RecordOffset);
+  mSortedServiceCallers      = NewSorted;
+
+  SetInterruptState (InterruptState);
+
+  CoreInstallConfigurationTable (&gEdkiiDxeServiceProfileTableGuid, NewProfile);
+  FreePool (OldProfile);
+  FreePool (OldSorted);
+  return TRUE;
+}
+
+/**
+  Add an image to the callers the boot service calls are attributed to.
+
+  An image that was unloaded gets its previous caller back when an image from
+  the same FFS file is started again, so that running an application several
+  times does not use up a caller every time.
+
+  @param  FileName   The FFS file name of the image. Optional.
+  @param  ImageBase  The base address of the image.
+  @param  ImageSize  The size of the image.
+
+**/
+VOID
+ServiceProfileAddCaller (
+  IN CONST EFI_GUID        *FileName  OPTIONAL,
+  IN EFI_PHYSICAL_ADDRESS  ImageBase,
+  IN UINT64                ImageSize
+  )
+{
+  DXE_SERVICE_PROFILE_CALLER  *Caller;
+  UINT32                      Index;
+  BOOLEAN                     InterruptState;
+
+  if (FileName != NULL) {
+    for (Index = 1; Index < mServiceProfile->CallerCount; Index++) {
+      Caller = &mServiceCallers[Index];
+      if ((Caller->ImageSize == 0) && CompareGuid (&Caller->FileName, FileName)) {
+        InterruptState    = SaveAndDisableInterrupts ();
+        Caller->ImageBase = ImageBase;
+        Caller->ImageSize = ImageSize;
+        if (ImageSize != 0) {
+          ServiceProfileInsertSortedCaller (Index);
+        }
+
+        SetInterruptState (InterruptState);
+        return;
+      }
+    }
+  }
+
+  if ((mServiceProfile->CallerCount >= mServiceProfile->MaxCallerCount) && !ServiceProfileGrowCallers ()) {
+    DEBUG ((DEBUG_WARN, "Boot service profile: No room for image at 0x%lx\n", ImageBase));
+    return;
+  }
+
+  InterruptState = SaveAndDisableInterrupts ();
+
+  Caller            = &mServiceCallers[mServiceProfile->CallerCount];
+  Caller->ImageBase = ImageBase;
+  Caller->ImageSize = ImageSize;
+  if (FileName != NULL) {
+    CopyGuid (&Caller->FileName, FileName);
+  }
+
+  if (ImageSize != 0) {
+    ServiceProfileInsertSortedCaller (mServiceProfile->CallerCount);
+  }
+
+  mServiceProfile->CallerCount++;
+
+  SetInterruptState (InterruptState);
+}
+
+/**
+  Register an image that is about to be started, so that the boot service
+  calls it makes are attributed to it.
+
+  @param  Image  The image that is about to be started.
+
+**/
+VOID
+CoreServiceProfileRegisterImage (
+  IN LOADED_IMAGE_PRIVATE_DATA  *Image
+  )
+{
+  MEDIA_FW_VOL_FILEPATH_DEVICE_PATH  *FilePath;
+  EFI_GUID                           *FileName;
+
+  if (mServiceProfile == NULL) {
+    return;
+  }
+
+  FileName = NULL;
+  FilePath = (MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *)Image->Info.FilePath;
+  if (FilePath != NULL) {
+    while (!IsDevicePathEnd (FilePath)) {
+      FileName = EfiGetNameGuidFromFwVolDevicePathNode (FilePath);
+      if (FileName != NULL) {
+        break;
+      }
+
+      FilePath = (MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *)NextDevicePathNode (FilePath);
+    }
+  }
+
+  ServiceProfileAddCaller (FileName, (EFI_PHYSICAL_ADDRESS)(UINTN)Image->Info.ImageBase, Image->Info.ImageSize);
+}
+
+/**
+  Unregister an image that is being unloaded. The calls it made stay in the
+  profile, but no more calls are attributed to it.
+
+  @param  Image  The image that is being unloaded.
+
+**/
+VOID
+CoreServiceProfileUnregisterImage (
+  IN LOADED_IMAGE_PRIVATE_DATA  *Image
+  )
+{
+  UINT32   Position;
+  UINT32   Index;
+  BOOLEAN  InterruptState;
+
+  if (mServiceProfile == NULL) {
+    return;
+  }
+
+  Position = ServiceProfileSortedPosition ((UINTN)Image->Info.ImageBase);
+  if (Position == 0) {
+    return;
+  }
+
+  Index = mSortedServiceCallers[Position - 1];
+  if (mServiceCallers[Index].ImageBase != (EFI_PHYSICAL_ADDRESS)(UINTN)Image->Info.ImageBase) {
+    return;
+  }
+
+  InterruptState = SaveAndDisableInterrupts ();
+
+  mServiceCallers[Index].ImageSize = 0;
+  CopyMem (
+    &mSortedServiceCallers[Position - 1],
+    &mSortedServiceCallers[Position],
+    (mSortedServiceCallerCount - Position) * sizeof (UINT32)
+    );
+  mSortedServiceCallerCount--;
+
+  SetInterruptState (InterruptState);
+}
+
+/**
+  Allocate the boot service profile, install it as a configuration table and
+  replace the profiled services in gBS, if PcdDxeServiceProfileRecordCount is
+  not zero.
+
+**/
+VOID
+CoreInitializeServiceProfile (
+  VOID
+  )
+{
+  UINTN       RecordCount;
+  UINTN       CallerOffset;
+  UINTN       RecordOffset;
+  UINT64      StartValue;
+  UINT64      EndValue;
+  EFI_STATUS  Status;
+
+  RecordCount = PcdGet32 (PcdDxeServiceProfileRecordCount);
+  if (RecordCount == 0) {
+    return;
+  }
+
+  CallerOffset = ALIGN_VALUE (sizeof (DXE_SERVICE_PROFILE_TABLE), sizeof (UINT64));
+  RecordOffset = CallerOffset + DXE_SERVICE_PROFILE_INITIAL_CALLERS * sizeof (DXE_SERVICE_PROFILE_CALLER);
+
+  mServiceProfile       = AllocateZeroPool (RecordOffset + RecordCount * sizeof (DXE_SERVICE_PROFILE_RECORD));
+  mSortedServiceCallers = AllocatePool (DXE_SERVICE_PROFILE_INITIAL_CALLERS * sizeof (UINT32));
+  if ((mServiceProfile == NULL) || (mSortedServiceCallers == NULL)) {
+    DEBUG ((DEBUG_ERROR, "Boot service profile: Out of resources\n"));
+    if (mServiceProfile != NULL) {
+      FreePool (mServiceProfile);
+      mServiceProfile = NULL;
+    }
+
+    if (mSortedServiceCallers != NULL) {
+      FreePool (mSortedServiceCallers);
+      mSortedServiceCallers = NULL;
+    }
+
+    return;
+  }
+
+  mServiceProfile->Signature      = DXE_SERVICE_PROFILE_TABLE_SIGNATURE;
+  mServiceProfile->Revision       = DXE_SERVICE_PROFILE_TABLE_REVISION;
+  mServiceProfile->HeaderSize     = sizeof (DXE_SERVICE_PROFILE_TABLE);
+  mServiceProfile->Frequency      = GetPerformanceCounterProperties (&StartValue, &EndValue);
+  mServiceProfile->ServiceCount   = DXE_SERVICE_PROFILE_SERVICE_COUNT;
+  mServiceProfile->BucketCount    = DXE_SERVICE_PROFILE_BUCKET_COUNT;
+  mServiceProfile->MaxCallerCount = DXE_SERVICE_PROFILE_INITIAL_CALLERS;
+  mServiceProfile->RecordCount    = (UINT32)RecordCount;
+  mServiceProfile->CallerOffset   = (UINT32)CallerOffset;
+  mServiceProfile->RecordOffset   = (UINT32)RecordOffset;
+  mServiceCallers                 = (DXE_SERVICE_PROFILE_CALLER *)((UINT8 *)mServiceProfile + CallerOffset);
+  mServiceRecords                 = (DXE_SERVICE_PROFILE_RECORD *)((UINT8 *)mServiceProfile + RecordOffset);
+  mCounterCountsDown              = (BOOLEAN)(StartValue > EndValue);
+
+  //
+  // Caller 0 is the unknown caller. The DXE Core also calls its own services
+  // through gBS from the libraries it is linked with.
+  //
+  mServiceProfile->CallerCount = 1;
+  ServiceProfileAddCaller (
+    &gEfiCallerIdGuid,
+    (EFI_PHYSICAL_ADDRESS)(UINTN)gDxeCoreLoadedImage->ImageBase,
+    gDxeCoreLoadedImage->ImageSize
+    );
+
+  Status = CoreInstallConfigurationTable (&gEdkiiDxeServiceProfileTableGuid, mServiceProfile);
+  if (EFI_ERROR (Status)) {
+    FreePool (mServiceProfile);
+    FreePool (mSortedServiceCallers);
+    mServiceProfile       = NULL;
+    mSortedServiceCallers = NULL;
+    return;
+  }
+
+  //
+  // The CRC of gBS is calculated again when the architectural protocols are
+  // installed.
+  //
+  gBS->RaiseTPL                   = ServiceProfileRaiseTpl;
+  gBS->RestoreTPL                 = ServiceProfileRestoreTpl;
+  gBS->AllocatePages              = ServiceProfileAllocatePages;
+  gBS->FreePages                  = ServiceProfileFreePages;
+  gBS->GetMemoryMap               = ServiceProfileGetMemoryMap;
+  gBS->AllocatePool               = ServiceProfileAllocatePool;
+  gBS->FreePool                   = ServiceProfileFreePool;
+  gBS->CreateEvent                = ServiceProfileCreateEvent;
+  gBS->CreateEventEx              = ServiceProfileCreateEventEx;
+  gBS->SignalEvent                = ServiceProfileSignalEvent;
+  gBS->InstallProtocolInterface   = ServiceProfileInstallProtocolInterface;
+  gBS->UninstallProtocolInterface = ServiceProfileUninstallProtocolInterface;
+  gBS->HandleProtocol             = ServiceProfileHandleProtocol;
+  gBS->LocateHandle               = ServiceProfileLocateHandle;
+  gBS->OpenProtocol               = ServiceProfileOpenProtocol;
+  gBS->CloseProtocol              = ServiceProfileCloseProtocol;
+  gBS->LocateHandleBuffer         = ServiceProfileLocateHandleBuffer;
+  gBS->LocateProtocol             = ServiceProfileLocateProtocol;
+}
@@ -27,6 +27,13 @@
   3) A support protocol is not found, and the data is not available to be read
      without it.  This results in EFI_PROTOCOL_ERROR.
 
+  The payloads produced by decompression and by GUIDed extraction can be kept
+  in a cache, so that opening the same encapsulation again from another stream
+  does not decode it again. Entries are keyed by the content of the input, so
+  that identical encapsulations found at different addresses share an entry.
+  They are kept in least recently used order within
+  PcdSectionExtractionCacheSize bytes, and released at ReadyToBoot.
+
 Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -86,6 +93,33 @@ typedef struct {
 
 #define NULL_STREAM_HANDLE  0
 
+#define SECTION_CACHE_ENTRY_SIGNATURE  SIGNATURE_32('S','X','C','E')
+#define SECTION_CACHE_ENTRY_FROM_LINK(Node) \
+  CR (Node, SECTION_CACHE_ENTRY, Link, SECTION_CACHE_ENTRY_SIGNATURE)
+
+typedef struct {
+  UINT32        Signature;
+  LIST_ENTRY    Link;
+  //
+  // The decoding algorithm and a copy of its input, which identify the entry.
+  // The CRC32 of the input only skips most entries before the full compare.
+  //
+  EFI_GUID      Algorithm;
+  UINT32        SourceCrc;
+  UINTN         SourceSize;
+  UINT8         *Source;
+  //
+  // The decoded payload and the authentication status reported for it.
+  //
+  UINTN         OutputSize;
+  UINT8         *Output;
+  UINT32        AuthenticationStatus;
+  //
+  // Size of the whole entry, charged to the cache budget.
+  //
+  UINTN         EntrySize;
+} SECTION_CACHE_ENTRY;
+
 typedef struct {
   CORE_SECTION_CHILD_NODE     *ChildNode;
   CORE_SECTION_STREAM_NODE    *ParentStream;
@@ -196,6 +230,200 @@ EFI_GUIDED_SECTION_EXTRACTION_PROTOCOL  mCustomGuidedSectionExtractionProtocol =
   CustomGuidedSectionExtract
 };
 
+//
+// Decoded section cache, most recently used entry first
+//
+LIST_ENTRY  mSectionCache = INITIALIZE_LIST_HEAD_VARIABLE (mSectionCache);
+UINTN       mSectionCacheUsage;
+UINTN       mSectionCacheHits;
+UINTN       mSectionCacheMisses;
+UINTN       mSectionCacheEvictions;
+
+/**
+  Remove an entry from the decoded section cache and free it.
+
+  @param  Entry          The cache entry to free
+
+**/
+VOID
+FreeSectionCacheEntry (
+  IN SECTION_CACHE_ENTRY  *Entry
+  )
+{
+  RemoveEntryList (&Entry->Link);
+  mSectionCacheUsage -= Entry->EntrySize;
+  CoreFreePool (Entry);
+}
+
+/**
+  Look up the decoded payload of a section in the cache.
+
+  @param  Algorithm              The GUID of the decoding algorithm
+  @param  Source                 The input of the decoding algorithm
+  @param  SourceSize             The size of Source in bytes
+  @param  Output                 On input, NULL to have a buffer allocated or
+                                 a buffer of *OutputSize bytes. On output,
+                                 the buffer holding a copy of the payload.
+  @param  OutputSize             On input, the size of a caller buffer. On
+                                 output, the size of the payload.
+  @param  AuthenticationStatus   The authentication status of the payload
+  @param  SourceCrc              The CRC32 of Source, to be passed to
+                                 AddCachedSection after a miss
+
+  @retval TRUE                   The payload was found and copied
+  @retval FALSE                  The payload must be decoded by the caller
+
+**/
+BOOLEAN
+GetCachedSection (
+  IN     CONST EFI_GUID  *Algorithm,
+  IN     CONST VOID      *Source,
+  IN     UINTN           SourceSize,
+  IN OUT VOID            **Output,
+  IN OUT UINTN           *OutputSize,
+  OUT    UINT32          *AuthenticationStatus,
+  OUT    UINT32          *SourceCrc
+  )
+{
+  LIST_ENTRY           *Link;
+  SECTION_CACHE_ENTRY  *Entry;
+
+  *SourceCrc = 0;
+  if (PcdGet32 (PcdSectionExtractionCacheSize) == 0) {
+    return FALSE;
+  }
+
+  *SourceCrc = CalculateCrc32 ((VOID *)Source, SourceSize);
+  for (Link = mSectionCache.ForwardLink; Link != &mSectionCache; Link = Link->ForwardLink) {
+    Entry = SECTION_CACHE_ENTRY_FROM_LINK (Link);
+    if ((Entry->SourceCrc != *SourceCrc) ||
+        (Entry->SourceSize != SourceSize) ||
+        !CompareGuid (&Entry->Algorithm, Algorithm) ||
+        (CompareMem (Entry->Source, Source, SourceSize) != 0))
+    {
+      continue;
+    }
+
+    if (*Output == NULL) {
+      *Output = AllocateCopyPool (Entry->OutputSize, Entry->Output);
+      if (*Output == NULL) {
+        return FALSE;
+      }
+    } else if (*OutputSize == Entry->OutputSize) {
+      CopyMem (*Output, Entry->Output, Entry->OutputSize);
+    } else {
+      break;
+    }
+
+    *OutputSize           = Entry->OutputSize;
+    *AuthenticationStatus = Entry->AuthenticationStatus;
+
+    RemoveEntryList (&Entry->Link);
+    InsertHeadList (&mSectionCache, &Entry->Link);
+    mSectionCacheHits++;
+    return TRUE;
+  }
+
+  mSectionCacheMisses++;
+  return FALSE;
+}
+
+/**
+  Add the decoded payload of a section to the cache, evicting the least
+  recently used entries to stay within PcdSectionExtractionCacheSize.
+
+  @param  Algorithm              The GUID of the decoding algorithm
+  @param  Source                 The input of the decoding algorithm
+  @param  SourceSize             The size of Source in bytes
+  @param  Output                 The decoded payload
+  @param  OutputSize             The size of Output in bytes
+  @param  AuthenticationStatus   The authentication status of the payload
+  @param  SourceCrc              The CRC32 of Source returned by
+                                 GetCachedSection
+
+**/
+VOID
+AddCachedSection (
+  IN CONST EFI_GUID  *Algorithm,
+  IN CONST VOID      *Source,
+  IN UINTN           SourceSize,
+  IN CONST VOID      *Output,
+  IN UINTN           OutputSize,
+  IN UINT32          AuthenticationStatus,
+  IN UINT32          SourceCrc
+  )
+{
+  UINTN                CacheSize;
+  UINTN                EntrySize;
+  SECTION_CACHE_ENTRY  *Entry;
+
+  CacheSize = PcdGet32 (PcdSectionExtractionCacheSize);
+  if ((SourceSize > CacheSize) || (OutputSize > CacheSize - SourceSize)) {
+    return;
+  }
+
+  EntrySize = sizeof (SECTION_CACHE_ENTRY) + SourceSize + OutputSize;
+  if (EntrySize > CacheSize) {
+    return;
+  }
+
+  while ((mSectionCacheUsage + EntrySize > CacheSize) && !IsListEmpty (&mSectionCache)) {
+    FreeSectionCacheEntry (SECTION_CACHE_ENTRY_FROM_LINK (mSectionCache.BackLink));
+    mSectionCacheEvictions++;
+  }
+
+  Entry = AllocatePool (EntrySize);
+  if (Entry == NULL) {
+    return;
+  }
+
+  Entry->Signature = SECTION_CACHE_ENTRY_SIGNATURE;
+  CopyGuid (&Entry->Algorithm, Algorithm);
+  Entry->SourceCrc            = SourceCrc;
+  Entry->SourceSize           = SourceSize;
+  Entry->Source               = (UINT8 *)(Entry + 1);
+  Entry->OutputSize           = OutputSize;
+  Entry->Output               = Entry->Source + SourceSize;
+  Entry->AuthenticationStatus = AuthenticationStatus;
+  Entry->EntrySize            = EntrySize;
+  CopyMem (Entry->Source, Source, SourceSize);
+  CopyMem (Entry->Output, Output, OutputSize);
+
+  InsertHeadList (&mSectionCache, &Entry->Link);
+  mSectionCacheUsage += EntrySize;
+}
+
+/**
+  Report the statistics of the decoded section cache and release it at
+  ReadyToBoot, after which few sections are expected to be opened.
+
+  @param  Event                  The ReadyToBoot event
+  @param  Context                Not used
+
+**/
+VOID
+EFIAPI
+FlushSectionCacheOnReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  DEBUG ((
+    DEBUG_INFO,
+    "Section cache: %Lu hits, %Lu misses, %Lu evictions, %Lu bytes in use\n",
+    (UINT64)mSectionCacheHits,
+    (UINT64)mSectionCacheMisses,
+    (UINT64)mSectionCacheEvictions,
+    (UINT64)mSectionCacheUsage
+    ));
+
+  while (!IsListEmpty (&mSectionCache)) {
+    FreeSectionCacheEntry (SECTION_CACHE_ENTRY_FROM_LINK (mSectionCache.ForwardLink));
+  }
+
+  CoreCloseEvent (Event);
+}
+
 /**
   Entry point of the section extraction code. Initializes an instance of the
   section extraction interface and installs it on a new handle.
@@ -217,6 +445,19 @@ InitializeSectionExtraction (
   EFI_STATUS  Status;
   EFI_GUID    *ExtractHandlerGuidTable;
   UINTN       ExtractHandlerNumber;
+  EFI_EVENT   ReadyToBootEvent;
+
+  if (PcdGet32 (PcdSectionExtractionCacheSize) != 0) {
+    Status = CoreCreateEventInternal (
+               EVT_NOTIFY_SIGNAL,
+               TPL_CALLBACK,
+               FlushSectionCacheOnReadyToBoot,
+               NULL,
+               &gEfiEventReadyToBootGuid,
+               &ReadyToBootEvent
+               );
+    ASSERT_EFI_ERROR (Status);
+  }
 
   //
   // Get custom extract guided section method guid list
@@ -679,11 +920,13 @@ CreateChildNode (
   UINT32                                  ScratchSize;
   UINTN                                   NewStreamBufferSize;
   UINT32                                  AuthenticationStatus;
+  UINT32                                  SourceCrc;
   VOID                                    *CompressionSource;
   UINT32                                  CompressionSourceSize;
   UINT32                                  UncompressedLength;
   UINT8                                   CompressionType;
   UINT16                                  GuidedSectionAttributes;
+  BOOLEAN                                 CacheSection;
 
   CORE_SECTION_CHILD_NODE  *Node;
 
@@ -756,7 +999,17 @@ CreateChildNode (
           // stream is not actually compressed, just encapsulated.  So just copy it.
           //
           CopyMem (NewStreamBuffer, CompressionSource, NewStreamBufferSize);
-        } else if (CompressionType == EFI_STANDARD_COMPRESSION) {
+        } else if ((CompressionType == EFI_STANDARD_COMPRESSION) &&
+                   !GetCachedSection (
+                      &gEfiDecompressProtocolGuid,
+                      CompressionSource,
+                      CompressionSourceSize,
+                      &NewStreamBuffer,
+                      &NewStreamBufferSize,
+                      &AuthenticationStatus,
+                      &SourceCrc
+                      ))
+        {
           //
           // Only support the EFI_SATNDARD_COMPRESSION algorithm.
           //
@@ -807,6 +1060,16 @@ CreateChildNode (
             CoreFreePool (NewStreamBuffer);
             return Status;
           }
+
+          AddCachedSection (
+            &gEfiDecompressProtocolGuid,
+            CompressionSource,
+            CompressionSourceSize,
+            NewStreamBuffer,
+            NewStreamBufferSize,
+            0,
+            SourceCrc
+            );
         }
       } else {
         NewStreamBuffer     = NULL;
@@ -840,19 +1103,49 @@ CreateChildNode (
 
       if (VerifyGuidedSectionGuid (Node->EncapsulationGuid, &GuidedExtraction)) {
         //
-        // NewStreamBuffer is always allocated by ExtractSection... No caller
-        // allocation here.
+        // Sections that carry authentication data are always extracted, so
+        // that they are verified again under the current security policy.
         //
-        Status = GuidedExtraction->ExtractSection (
-                                     GuidedExtraction,
-                                     GuidedHeader,
-                                     &NewStreamBuffer,
-                                     &NewStreamBufferSize,
-                                     &AuthenticationStatus
-                                     );
-        if (EFI_ERROR (Status)) {
-          CoreFreePool (*ChildNode);
-          return EFI_PROTOCOL_ERROR;
+        CacheSection    = (BOOLEAN)((GuidedSectionAttributes & EFI_GUIDED_SECTION_AUTH_STATUS_VALID) == 0);
+        NewStreamBuffer = NULL;
+        if (!CacheSection ||
+            !GetCachedSection (
+               Node->EncapsulationGuid,
+               GuidedHeader,
+               Node->Size,
+               &NewStreamBuffer,
+               &NewStreamBufferSize,
+               &AuthenticationStatus,
+               &SourceCrc
+               ))
+        {
+          //
+          // NewStreamBuffer is always allocated by ExtractSection... No caller
+          // allocation here.
+          //
+          Status = GuidedExtraction->ExtractSection (
+                                       GuidedExtraction,
+                                       GuidedHeader,
+                                       &NewStreamBuffer,
+                                       &NewStreamBufferSize,
+                                       &AuthenticationStatus
+                                       );
+          if (EFI_ERROR (Status)) {
+            CoreFreePool (*ChildNode);
+            return EFI_PROTOCOL_ERROR;
+          }
+
+          if (CacheSection) {
+            AddCachedSection (
+              Node->EncapsulationGuid,
+              GuidedHeader,
+              Node->Size,
+              NewStreamBuffer,
+              NewStreamBufferSize,
+              AuthenticationStatus,
+              SourceCrc
+              );
+          }
         }
 
         //
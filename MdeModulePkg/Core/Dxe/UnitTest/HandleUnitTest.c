@@ -0,0 +1,848 @@
+/** @file
+  This is a host-based unit test for the handle database of the DXE core,
+  whose handles and protocol entries are indexed by hash tables.
+
+  The tests install, reinstall and uninstall protocol interfaces on a set of
+  handles in different orders, and compare every lookup with a model of the
+  database. They also check that a lookup only scans a small share of the
+  handles and protocols, where the lists they replace were walked in full.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../DxeMain.h"
+#include "../Hand/Handle.h"
+
+#define UNIT_TEST_NAME     "DXE Core Handle Database Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+//
+// Each test handle holds any of TEST_PROTOCOL_COUNT protocols, recorded in
+// the bits of its protocol mask.
+//
+#define TEST_HANDLE_COUNT     1024
+#define TEST_PROTOCOL_COUNT   64
+#define TEST_OPERATION_COUNT  20000
+#define TEST_CHECK_INTERVAL   500
+
+typedef struct {
+  EFI_HANDLE    Handle;
+  UINT64        ProtocolMask;
+  ///
+  /// Which of the two interfaces of each protocol is installed
+  ///
+  UINT64        InterfaceMask;
+} TEST_HANDLE;
+
+/// === TEST DATA ==================================================================================
+
+EFI_HANDLE   gDxeCoreImageHandle;
+EFI_GUID     mTestImageProtocol = {
+  0x5c7a1d32, 0x1e94, 0x4b5f, { 0x9a, 0x0c, 0x61, 0x2d, 0x83, 0x4e, 0xb7, 0x19 }
+};
+UINT8        mTestImageInterface;
+EFI_GUID     mTestProtocols[TEST_PROTOCOL_COUNT];
+UINT8        mTestInterfaces[2][TEST_HANDLE_COUNT][TEST_PROTOCOL_COUNT];
+TEST_HANDLE  mTestHandles[TEST_HANDLE_COUNT];
+UINT32       mRandomSeed;
+
+extern LIST_ENTRY  mProtocolDatabase;
+extern LIST_ENTRY  gHandleList;
+extern LIST_ENTRY  mProtocolHashTable[PROTOCOL_HASH_BUCKET_COUNT];
+extern LIST_ENTRY  mHandleHashTable[HANDLE_HASH_BUCKET_COUNT];
+
+/// === DXE CORE SERVICES ==========================================================================
+
+//
+// The handle database only needs the services below from the rest of the
+// core. Drivers never open the test protocols BY_DRIVER, so there is nothing
+// to connect or disconnect, and nothing registers protocol notifications.
+//
+
+EFI_TPL
+EFIAPI
+CoreRaiseTpl (
+  IN EFI_TPL  NewTpl
+  )
+{
+  return TPL_APPLICATION;
+}
+
+VOID
+EFIAPI
+CoreRestoreTpl (
+  IN EFI_TPL  NewTpl
+  )
+{
+}
+
+EFI_STATUS
+EFIAPI
+CoreFreePool (
+  IN VOID  *Buffer
+  )
+{
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+CoreSignalEvent (
+  IN EFI_EVENT  UserEvent
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+CoreConnectController (
+  IN  EFI_HANDLE                ControllerHandle,
+  IN  EFI_HANDLE                *DriverImageHandle    OPTIONAL,
+  IN  EFI_DEVICE_PATH_PROTOCOL  *RemainingDevicePath  OPTIONAL,
+  IN  BOOLEAN                   Recursive
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+CoreDisconnectController (
+  IN  EFI_HANDLE  ControllerHandle,
+  IN  EFI_HANDLE  DriverImageHandle  OPTIONAL,
+  IN  EFI_HANDLE  ChildHandle        OPTIONAL
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+CoreLocateDevicePath (
+  IN EFI_GUID                      *Protocol,
+  IN OUT EFI_DEVICE_PATH_PROTOCOL  **DevicePath,
+  OUT EFI_HANDLE                   *Device
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+VOID
+CoreDepexProtocolInstalled (
+  IN CONST EFI_GUID  *Protocol
+  )
+{
+}
+
+/// === HELPER FUNCTIONS ===========================================================================
+
+/**
+  Return a pseudo-random number below a limit.
+
+  @param  Limit              The limit
+
+  @return The number
+
+**/
+UINT32
+TestRandom (
+  IN UINT32  Limit
+  )
+{
+  mRandomSeed = mRandomSeed * 1664525 + 1013904223;
+  return (mRandomSeed >> 8) % Limit;
+}
+
+/**
+  Return the interface of a protocol on a test handle.
+
+  @param  Index              The index of the test handle
+  @param  Protocol           The index of the protocol
+  @param  Alternate          TRUE for the interface not currently installed
+
+  @return The interface
+
+**/
+VOID *
+TestInterface (
+  IN UINTN    Index,
+  IN UINTN    Protocol,
+  IN BOOLEAN  Alternate
+  )
+{
+  UINTN  Which;
+
+  Which = (UINTN)RShiftU64 (mTestHandles[Index].InterfaceMask, Protocol) & 1;
+  if (Alternate) {
+    Which ^= 1;
+  }
+
+  return &mTestInterfaces[Which][Index][Protocol];
+}
+
+/**
+  Install a protocol on a test handle, creating the handle if it has none.
+
+  @param  Index              The index of the test handle
+  @param  Protocol           The index of the protocol
+
+  @return The status of CoreInstallProtocolInterface()
+
+**/
+EFI_STATUS
+TestInstall (
+  IN UINTN  Index,
+  IN UINTN  Protocol
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = CoreInstallProtocolInterface (
+             &mTestHandles[Index].Handle,
+             &mTestProtocols[Protocol],
+             EFI_NATIVE_INTERFACE,
+             TestInterface (Index, Protocol, FALSE)
+             );
+  if (!EFI_ERROR (Status)) {
+    mTestHandles[Index].ProtocolMask |= LShiftU64 (1, Protocol);
+  }
+
+  return Status;
+}
+
+/**
+  Check whether a handle is in the handle database.
+
+  @param  Handle             The handle
+
+  @retval TRUE    CoreValidateHandle() accepts the handle.
+  @retval FALSE   CoreValidateHandle() rejects the handle.
+
+**/
+BOOLEAN
+IsValidHandle (
+  IN EFI_HANDLE  Handle
+  )
+{
+  EFI_STATUS  Status;
+
+  CoreAcquireProtocolLock ();
+  Status = CoreValidateHandle (Handle);
+  CoreReleaseProtocolLock ();
+
+  return (BOOLEAN)!EFI_ERROR (Status);
+}
+
+/**
+  Uninstall a protocol from a test handle. The handle must be gone from the
+  database once its last protocol is uninstalled.
+
+  @param  Index              The index of the test handle
+  @param  Protocol           The index of the protocol
+
+  @retval TRUE    The protocol was uninstalled.
+  @retval FALSE   The protocol was not uninstalled, or the handle is left over.
+
+**/
+BOOLEAN
+TestUninstall (
+  IN UINTN  Index,
+  IN UINTN  Protocol
+  )
+{
+  EFI_STATUS  Status;
+  EFI_HANDLE  Handle;
+
+  Handle = mTestHandles[Index].Handle;
+  Status = CoreUninstallProtocolInterface (Handle, &mTestProtocols[Protocol], TestInterface (Index, Protocol, FALSE));
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  mTestHandles[Index].ProtocolMask &= ~LShiftU64 (1, Protocol);
+  if (mTestHandles[Index].ProtocolMask == 0) {
+    //
+    // The handle was freed but not reused yet, it must not validate
+    //
+    mTestHandles[Index].Handle = NULL;
+    if (IsValidHandle (Handle)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Reinstall a protocol of a test handle with its other interface.
+
+  @param  Index              The index of the test handle
+  @param  Protocol           The index of the protocol
+
+  @return The status of CoreReinstallProtocolInterface()
+
+**/
+EFI_STATUS
+TestReinstall (
+  IN UINTN  Index,
+  IN UINTN  Protocol
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = CoreReinstallProtocolInterface (
+             mTestHandles[Index].Handle,
+             &mTestProtocols[Protocol],
+             TestInterface (Index, Protocol, FALSE),
+             TestInterface (Index, Protocol, TRUE)
+             );
+  if (!EFI_ERROR (Status)) {
+    mTestHandles[Index].InterfaceMask ^= LShiftU64 (1, Protocol);
+  }
+
+  return Status;
+}
+
+/**
+  Compare the handle database with the test handles.
+
+  Every test handle must validate and return the interfaces of exactly its
+  protocols, every handle of gHandleList must be a test handle or the image
+  handle of the core, and every protocol entry must be found from its GUID.
+
+  @retval TRUE    The database matches the test handles.
+  @retval FALSE   The database does not match the test handles.
+
+**/
+BOOLEAN
+IsDatabaseValid (
+  VOID
+  )
+{
+  UINTN           Index;
+  UINTN           Protocol;
+  UINTN           HandleCount;
+  UINTN           ListCount;
+  UINTN           InterfaceCount;
+  EFI_STATUS      Status;
+  VOID            *Interface;
+  LIST_ENTRY      *Link;
+  PROTOCOL_ENTRY  *ProtEntry;
+  PROTOCOL_ENTRY  *Found;
+
+  HandleCount = 1;
+  for (Index = 0; Index < TEST_HANDLE_COUNT; Index++) {
+    if (mTestHandles[Index].Handle == NULL) {
+      continue;
+    }
+
+    HandleCount++;
+    if (!IsValidHandle (mTestHandles[Index].Handle)) {
+      return FALSE;
+    }
+
+    for (Protocol = 0; Protocol < TEST_PROTOCOL_COUNT; Protocol++) {
+      Status = CoreHandleProtocol (mTestHandles[Index].Handle, &mTestProtocols[Protocol], &Interface);
+      if ((RShiftU64 (mTestHandles[Index].ProtocolMask, Protocol) & 1) != 0) {
+        if (EFI_ERROR (Status) || (Interface != TestInterface (Index, Protocol, FALSE))) {
+          return FALSE;
+        }
+      } else if (Status != EFI_UNSUPPORTED) {
+        return FALSE;
+      }
+    }
+  }
+
+  ListCount = 0;
+  for (Link = gHandleList.ForwardLink; Link != &gHandleList; Link = Link->ForwardLink) {
+    ListCount++;
+  }
+
+  if (ListCount != HandleCount) {
+    return FALSE;
+  }
+
+  CoreAcquireProtocolLock ();
+  for (Link = mProtocolDatabase.ForwardLink; Link != &mProtocolDatabase; Link = Link->ForwardLink) {
+    ProtEntry = CR (Link, PROTOCOL_ENTRY, AllEntries, PROTOCOL_ENTRY_SIGNATURE);
+    Found     = CoreFindProtocolEntry (&ProtEntry->ProtocolID, FALSE);
+    if (Found != ProtEntry) {
+      break;
+    }
+  }
+
+  CoreReleaseProtocolLock ();
+  if (Link != &mProtocolDatabase) {
+    return FALSE;
+  }
+
+  //
+  // Every installed interface is on the protocol entry of its protocol
+  //
+  for (Protocol = 0; Protocol < TEST_PROTOCOL_COUNT; Protocol++) {
+    InterfaceCount = 0;
+    for (Index = 0; Index < TEST_HANDLE_COUNT; Index++) {
+      InterfaceCount += (UINTN)RShiftU64 (mTestHandles[Index].ProtocolMask, Protocol) & 1;
+    }
+
+    CoreAcquireProtocolLock ();
+    ProtEntry = CoreFindProtocolEntry (&mTestProtocols[Protocol], FALSE);
+    CoreReleaseProtocolLock ();
+    if (ProtEntry == NULL) {
+      if (InterfaceCount != 0) {
+        return FALSE;
+      }
+
+      continue;
+    }
+
+    for (Link = ProtEntry->Protocols.ForwardLink; Link != &ProtEntry->Protocols; Link = Link->ForwardLink) {
+      InterfaceCount--;
+    }
+
+    if (InterfaceCount != 0) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Install a random set of protocols on every test handle, some on handles of
+  their own and some on handles that already hold other protocols.
+
+**/
+VOID
+InstallRandomProtocols (
+  VOID
+  )
+{
+  UINTN  Index;
+  UINTN  Count;
+  UINTN  Protocol;
+
+  for (Index = 0; Index < TEST_HANDLE_COUNT; Index++) {
+    for (Count = TestRandom (4) + 1; Count > 0; Count--) {
+      Protocol = TestRandom (TEST_PROTOCOL_COUNT);
+      if ((RShiftU64 (mTestHandles[Index].ProtocolMask, Protocol) & 1) == 0) {
+        TestInstall (Index, Protocol);
+      }
+    }
+  }
+}
+
+/**
+  Create the image handle of the core, pick the test protocol GUIDs and empty
+  the test handles.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ResetTestHandles (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+  UINTN  Byte;
+
+  //
+  // CoreHandleProtocol() opens the interfaces for the image handle of the
+  // core, which must be a valid handle
+  //
+  if (gDxeCoreImageHandle == NULL) {
+    CoreInstallProtocolInterface (&gDxeCoreImageHandle, &mTestImageProtocol, EFI_NATIVE_INTERFACE, &mTestImageInterface);
+  }
+
+  //
+  // Random GUIDs, which differ from each other in any of their bytes
+  //
+  mRandomSeed = 1;
+  for (Index = 0; Index < TEST_PROTOCOL_COUNT; Index++) {
+    for (Byte = 0; Byte < sizeof (EFI_GUID); Byte++) {
+      ((UINT8 *)&mTestProtocols[Index])[Byte] = (UINT8)TestRandom (0x100);
+    }
+  }
+
+  ZeroMem (mTestHandles, sizeof (mTestHandles));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Uninstall every protocol left on the test handles.
+
+  @param[in]  Context  Unit test case context
+
+**/
+VOID
+EFIAPI
+FreeTestHandles (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+  UINTN  Protocol;
+
+  for (Index = 0; Index < TEST_HANDLE_COUNT; Index++) {
+    for (Protocol = 0; Protocol < TEST_PROTOCOL_COUNT; Protocol++) {
+      if ((RShiftU64 (mTestHandles[Index].ProtocolMask, Protocol) & 1) != 0) {
+        TestUninstall (Index, Protocol);
+      }
+    }
+  }
+}
+
+/// === TEST CASES =================================================================================
+
+/**
+  Install protocols on new and existing handles. Every handle and interface
+  must then be found, and handles that are not in the database, including a
+  copy of a valid handle, must be rejected without being used.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+InstallShouldIndexHandlesAndProtocols (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  IHANDLE  Copy;
+  VOID     *Interface;
+
+  InstallRandomProtocols ();
+  UT_ASSERT_TRUE (IsDatabaseValid ());
+
+  //
+  // Installing a protocol twice on a handle fails
+  //
+  UT_ASSERT_EQUAL (TestInstall (0, (UINTN)HighBitSet64 (mTestHandles[0].ProtocolMask)), EFI_INVALID_PARAMETER);
+
+  CopyMem (&Copy, mTestHandles[0].Handle, sizeof (Copy));
+  UT_ASSERT_FALSE (IsValidHandle (&Copy));
+  UT_ASSERT_FALSE (IsValidHandle ((EFI_HANDLE)&mTestHandles[0]));
+  UT_ASSERT_FALSE (IsValidHandle (NULL));
+  UT_ASSERT_EQUAL (CoreHandleProtocol (&Copy, &mTestProtocols[0], &Interface), EFI_INVALID_PARAMETER);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Uninstall every protocol, in the order of installation, in the reverse
+  order and in a random order. A handle must leave the database with its last
+  protocol, while the other handles of its hash bucket stay valid.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+UninstallShouldRemoveHandles (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Pass;
+  UINTN  Step;
+  UINTN  Index;
+  UINTN  Protocol;
+
+  for (Pass = 0; Pass < 3; Pass++) {
+    InstallRandomProtocols ();
+    UT_ASSERT_TRUE (IsDatabaseValid ());
+
+    for (Step = 0; Step < TEST_HANDLE_COUNT; Step++) {
+      if (Pass == 0) {
+        Index = Step;
+      } else if (Pass == 1) {
+        Index = TEST_HANDLE_COUNT - 1 - Step;
+      } else {
+        Index = TestRandom (TEST_HANDLE_COUNT);
+      }
+
+      while (mTestHandles[Index].ProtocolMask != 0) {
+        Protocol = (UINTN)LowBitSet64 (mTestHandles[Index].ProtocolMask);
+        if (Pass == 1) {
+          Protocol = (UINTN)HighBitSet64 (mTestHandles[Index].ProtocolMask);
+        }
+
+        UT_ASSERT_TRUE (TestUninstall (Index, Protocol));
+      }
+
+      if (Step % TEST_CHECK_INTERVAL == 0) {
+        UT_ASSERT_TRUE (IsDatabaseValid ());
+      }
+    }
+
+    FreeTestHandles (NULL);
+    UT_ASSERT_TRUE (IsDatabaseValid ());
+    UT_ASSERT_TRUE (gHandleList.ForwardLink == &((IHANDLE *)gDxeCoreImageHandle)->AllHandles);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Reinstall protocols with their other interface. The handles must keep
+  their place in the database and return the new interfaces, and a reinstall
+  with an interface that is not installed must fail.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ReinstallShouldKeepHandles (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN       Index;
+  UINTN       Protocol;
+  UINT64      Mask;
+  EFI_HANDLE  FirstHandle;
+  EFI_STATUS  Status;
+
+  InstallRandomProtocols ();
+  FirstHandle = mTestHandles[0].Handle;
+
+  for (Index = 0; Index < TEST_HANDLE_COUNT; Index++) {
+    for (Mask = mTestHandles[Index].ProtocolMask; Mask != 0; Mask &= Mask - 1) {
+      Protocol = (UINTN)LowBitSet64 (Mask);
+      UT_ASSERT_NOT_EFI_ERROR (TestReinstall (Index, Protocol));
+    }
+  }
+
+  UT_ASSERT_TRUE (IsDatabaseValid ());
+  UT_ASSERT_TRUE (mTestHandles[0].Handle == FirstHandle);
+  UT_ASSERT_TRUE (gHandleList.ForwardLink->ForwardLink == &((IHANDLE *)FirstHandle)->AllHandles);
+
+  Protocol = (UINTN)LowBitSet64 (mTestHandles[0].ProtocolMask);
+  Status   = CoreReinstallProtocolInterface (
+               mTestHandles[0].Handle,
+               &mTestProtocols[Protocol],
+               TestInterface (0, Protocol, TRUE),
+               TestInterface (0, Protocol, FALSE)
+               );
+  UT_ASSERT_EQUAL (Status, EFI_NOT_FOUND);
+  UT_ASSERT_TRUE (IsDatabaseValid ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Apply random installs, reinstalls and uninstalls, and compare the database
+  with the test handles at regular intervals.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RandomChangesShouldMatchModel (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Operation;
+  UINTN  Index;
+  UINTN  Protocol;
+
+  for (Operation = 0; Operation < TEST_OPERATION_COUNT; Operation++) {
+    Index    = TestRandom (TEST_HANDLE_COUNT);
+    Protocol = TestRandom (TEST_PROTOCOL_COUNT);
+    if ((RShiftU64 (mTestHandles[Index].ProtocolMask, Protocol) & 1) == 0) {
+      UT_ASSERT_NOT_EFI_ERROR (TestInstall (Index, Protocol));
+    } else if (TestRandom (3) == 0) {
+      UT_ASSERT_NOT_EFI_ERROR (TestReinstall (Index, Protocol));
+    } else {
+      UT_ASSERT_TRUE (TestUninstall (Index, Protocol));
+    }
+
+    if (Operation % TEST_CHECK_INTERVAL == 0) {
+      UT_ASSERT_TRUE (IsDatabaseValid ());
+    }
+  }
+
+  UT_ASSERT_TRUE (IsDatabaseValid ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Count the entries a lookup of every handle and every protocol compares in
+  the hash buckets, and the entries a walk of gHandleList and of
+  mProtocolDatabase compared before them. The buckets must hold a few entries
+  each, so that a lookup does not depend on the number of handles.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LookupsShouldScanFewEntries (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN       Bucket;
+  UINTN       Position;
+  UINTN       HandleCount;
+  UINTN       ProtocolCount;
+  UINT64      BucketCompares;
+  UINT64      ListCompares;
+  UINT64      ProtocolBucketCompares;
+  UINT64      ProtocolListCompares;
+  LIST_ENTRY  *Link;
+
+  InstallRandomProtocols ();
+
+  //
+  // A lookup compares the entries of the bucket up to the one it looks for,
+  // a walk compares the entries of the list up to the same one
+  //
+  BucketCompares = 0;
+  HandleCount    = 0;
+  for (Bucket = 0; Bucket < HANDLE_HASH_BUCKET_COUNT; Bucket++) {
+    Position = 0;
+    for (Link = mHandleHashTable[Bucket].ForwardLink; Link != &mHandleHashTable[Bucket]; Link = Link->ForwardLink) {
+      BucketCompares += ++Position;
+    }
+
+    HandleCount += Position;
+  }
+
+  ListCompares = (UINT64)HandleCount * (HandleCount + 1) / 2;
+
+  ProtocolBucketCompares = 0;
+  ProtocolCount          = 0;
+  for (Bucket = 0; Bucket < PROTOCOL_HASH_BUCKET_COUNT; Bucket++) {
+    Position = 0;
+    for (Link = mProtocolHashTable[Bucket].ForwardLink; Link != &mProtocolHashTable[Bucket]; Link = Link->ForwardLink) {
+      ProtocolBucketCompares += ++Position;
+    }
+
+    ProtocolCount += Position;
+  }
+
+  ProtocolListCompares = (UINT64)ProtocolCount * (ProtocolCount + 1) / 2;
+
+  UT_LOG_INFO (
+    "%Lu handles: %Lu compares per lookup, %Lu per list walk\n",
+    (UINT64)HandleCount,
+    DivU64x64Remainder (BucketCompares, HandleCount, NULL),
+    DivU64x64Remainder (ListCompares, HandleCount, NULL)
+    );
+  UT_LOG_INFO (
+    "%Lu protocols: %Lu compares per lookup, %Lu per list walk\n",
+    (UINT64)ProtocolCount,
+    DivU64x64Remainder (ProtocolBucketCompares, ProtocolCount, NULL),
+    DivU64x64Remainder (ProtocolListCompares, ProtocolCount, NULL)
+    );
+
+  //
+  // Allow twice the average bucket load of a uniform hash
+  //
+  UT_ASSERT_TRUE (BucketCompares <= (UINT64)HandleCount * (HandleCount / HANDLE_HASH_BUCKET_COUNT + 1) * 2);
+  UT_ASSERT_TRUE (ProtocolBucketCompares <= (UINT64)ProtocolCount * (ProtocolCount / PROTOCOL_HASH_BUCKET_COUNT + 1) * 2);
+  UT_ASSERT_TRUE (BucketCompares * 32 < ListCompares);
+
+  return UNIT_TEST_PASSED;
+}
+
+/// === TEST ENGINE ================================================================================
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the handle
+  database and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      HandleTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (&HandleTests, Framework, "DXE Core Handle Database Tests", "Handle", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for Handle\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (HandleTests, "Install should index handles and protocols", "Install", InstallShouldIndexHandlesAndProtocols, ResetTestHandles, FreeTestHandles, NULL);
+  AddTestCase (HandleTests, "Uninstall should remove handles", "Uninstall", UninstallShouldRemoveHandles, ResetTestHandles, FreeTestHandles, NULL);
+  AddTestCase (HandleTests, "Reinstall should keep handles", "Reinstall", ReinstallShouldKeepHandles, ResetTestHandles, FreeTestHandles, NULL);
+  AddTestCase (HandleTests, "Random changes should match the model", "RandomChanges", RandomChangesShouldMatchModel, ResetTestHandles, FreeTestHandles, NULL);
+  AddTestCase (HandleTests, "Lookups should scan few entries", "Lookups", LookupsShouldScanFewEntries, ResetTestHandles, FreeTestHandles, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,432 @@
+/** @file
+  This is a host-based unit test for the range tree of the DXE core, which
+  indexes the free ranges of the memory map and the entries of the GCD maps.
+
+  The tests apply random inserts, removes and resizes to a set of ranges and
+  compare every search with a linear scan of the ranges, and check that a
+  search for a long range does not visit the short ranges of the tree.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../DxeMain.h"
+
+#define UNIT_TEST_NAME     "DXE Core Range Tree Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+//
+// Each test range lives in its own slot of the address space, so ranges never
+// overlap. A range holds 1 to TEST_SLOT_PAGES pages of its slot.
+//
+#define TEST_RANGE_COUNT      512
+#define TEST_SLOT_SIZE        0x100000
+#define TEST_SLOT_PAGES       16
+#define TEST_OPERATION_COUNT  4000
+
+//
+// A fragmented memory map: many one page ranges above a long one.
+//
+#define TEST_SHORT_RANGE_COUNT  4096
+#define TEST_LONG_RANGE_PAGES   64
+#define TEST_MAX_VISITS         200
+
+typedef struct {
+  UINT64             Start;
+  UINT64             End;
+  BOOLEAN            InTree;
+  RANGE_TREE_NODE    Node;
+} TEST_RANGE;
+
+/// === TEST DATA ==================================================================================
+
+TEST_RANGE  mTestRanges[TEST_SHORT_RANGE_COUNT + 1];
+RANGE_TREE  mTestTree;
+UINTN       mVisitCount;
+UINT32      mRandomSeed;
+
+/// === HELPER FUNCTIONS ===========================================================================
+
+/**
+  Return the range of a test range from its node, and count the visit.
+
+  @param  Node               The node of the test range
+  @param  Start              Returns the start of the range
+  @param  End                Returns the end of the range
+
+**/
+VOID
+TestGetRange (
+  IN  RANGE_TREE_NODE  *Node,
+  OUT UINT64           *Start,
+  OUT UINT64           *End
+  )
+{
+  TEST_RANGE  *Range;
+
+  Range  = BASE_CR (Node, TEST_RANGE, Node);
+  *Start = Range->Start;
+  *End   = Range->End;
+  mVisitCount++;
+}
+
+/**
+  Return a pseudo-random number below a limit.
+
+  @param  Limit              The limit
+
+  @return The number
+
+**/
+UINT32
+TestRandom (
+  IN UINT32  Limit
+  )
+{
+  mRandomSeed = mRandomSeed * 1664525 + 1013904223;
+  return (mRandomSeed >> 8) % Limit;
+}
+
+/**
+  Give a test range a random length in its slot.
+
+  @param  Index              The index of the test range
+
+**/
+VOID
+SetRandomRange (
+  IN UINTN  Index
+  )
+{
+  mTestRanges[Index].Start = Index * TEST_SLOT_SIZE + TestRandom (TEST_SLOT_PAGES) * EFI_PAGE_SIZE;
+  mTestRanges[Index].End   = mTestRanges[Index].Start + (TestRandom (TEST_SLOT_PAGES) + 1) * EFI_PAGE_SIZE - 1;
+}
+
+/**
+  Check the order, the priorities, the links and the largest lengths of a
+  subtree.
+
+  @param  Node               The root of the subtree
+  @param  Count              Incremented by the number of nodes of the subtree
+
+  @retval TRUE    The subtree is valid.
+  @retval FALSE   The subtree is not valid.
+
+**/
+BOOLEAN
+IsValidSubtree (
+  IN     RANGE_TREE_NODE  *Node,
+  IN OUT UINTN            *Count
+  )
+{
+  TEST_RANGE  *Range;
+  UINT64      MaxLength;
+
+  if (Node == NULL) {
+    return TRUE;
+  }
+
+  Range     = BASE_CR (Node, TEST_RANGE, Node);
+  MaxLength = Range->End - Range->Start + 1;
+  (*Count)++;
+
+  if (Node->Left != NULL) {
+    if ((Node->Left->Parent != Node) || (Node->Left->Priority > Node->Priority) ||
+        (BASE_CR (Node->Left, TEST_RANGE, Node)->End >= Range->Start))
+    {
+      return FALSE;
+    }
+
+    MaxLength = MAX (MaxLength, Node->Left->MaxLength);
+  }
+
+  if (Node->Right != NULL) {
+    if ((Node->Right->Parent != Node) || (Node->Right->Priority > Node->Priority) ||
+        (BASE_CR (Node->Right, TEST_RANGE, Node)->Start <= Range->End))
+    {
+      return FALSE;
+    }
+
+    MaxLength = MAX (MaxLength, Node->Right->MaxLength);
+  }
+
+  if (Node->MaxLength != MaxLength) {
+    return FALSE;
+  }
+
+  return IsValidSubtree (Node->Left, Count) && IsValidSubtree (Node->Right, Count);
+}
+
+/**
+  Find the highest test range in the tree that starts at or below an address
+  and is at least a given length, by scanning all test ranges.
+
+  @param  Address            The highest start address of the range
+  @param  MinLength          The minimum length of the range
+
+  @return The node of the test range, or NULL if there is none
+
+**/
+RANGE_TREE_NODE *
+ScanLast (
+  IN UINT64  Address,
+  IN UINT64  MinLength
+  )
+{
+  UINTN       Index;
+  TEST_RANGE  *Last;
+
+  Last = NULL;
+  for (Index = 0; Index < TEST_RANGE_COUNT; Index++) {
+    if (mTestRanges[Index].InTree &&
+        (mTestRanges[Index].Start <= Address) &&
+        (mTestRanges[Index].End - mTestRanges[Index].Start + 1 >= MinLength) &&
+        ((Last == NULL) || (mTestRanges[Index].Start > Last->Start)))
+    {
+      Last = &mTestRanges[Index];
+    }
+  }
+
+  return (Last == NULL) ? NULL : &Last->Node;
+}
+
+/**
+  Reset the test tree and the test ranges.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ResetTestTree (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ZeroMem (mTestRanges, sizeof (mTestRanges));
+  mTestTree.Root     = NULL;
+  mTestTree.GetRange = TestGetRange;
+  mTestTree.Seed     = 0;
+  mRandomSeed        = 1;
+
+  return UNIT_TEST_PASSED;
+}
+
+/// === TEST CASES =================================================================================
+
+/**
+  Insert, remove and resize random ranges. After each change the tree must be
+  valid, and the searches must return the ranges a linear scan finds.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RandomChangesShouldMatchLinearScan (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN            Operation;
+  UINTN            Index;
+  UINTN            Count;
+  UINTN            TreeCount;
+  UINT64           Address;
+  UINT64           MinLength;
+  RANGE_TREE_NODE  *Node;
+  RANGE_TREE_NODE  *Expected;
+  TEST_RANGE       *Range;
+
+  TreeCount = 0;
+  for (Operation = 0; Operation < TEST_OPERATION_COUNT; Operation++) {
+    Index = TestRandom (TEST_RANGE_COUNT);
+    Range = &mTestRanges[Index];
+    if (!Range->InTree) {
+      SetRandomRange (Index);
+      CoreRangeTreeInsert (&mTestTree, &Range->Node);
+      Range->InTree = TRUE;
+      TreeCount++;
+    } else if (TestRandom (2) == 0) {
+      //
+      // Removed ranges may have been emptied first, as the memory map does
+      //
+      Range->Start = Range->End + 1;
+      CoreRangeTreeRemove (&mTestTree, &Range->Node);
+      Range->InTree = FALSE;
+      TreeCount--;
+    } else {
+      SetRandomRange (Index);
+      CoreRangeTreeUpdate (&mTestTree, &Range->Node);
+    }
+
+    Count = 0;
+    UT_ASSERT_TRUE (IsValidSubtree (mTestTree.Root, &Count));
+    UT_ASSERT_EQUAL (Count, TreeCount);
+    UT_ASSERT_TRUE (mTestTree.Root == NULL || mTestTree.Root->Parent == NULL);
+
+    //
+    // Look up an address, which may be in a range or between ranges
+    //
+    Address  = (UINT64)TestRandom (TEST_RANGE_COUNT) * TEST_SLOT_SIZE + TestRandom (TEST_SLOT_SIZE);
+    Expected = NULL;
+    Range    = &mTestRanges[Address / TEST_SLOT_SIZE];
+    if (Range->InTree && (Address >= Range->Start) && (Address <= Range->End)) {
+      Expected = &Range->Node;
+    }
+
+    UT_ASSERT_TRUE (CoreRangeTreeFind (&mTestTree, Address) == Expected);
+
+    //
+    // Walk the ranges of a minimum length down from the address
+    //
+    MinLength = (TestRandom (TEST_SLOT_PAGES) + 1) * EFI_PAGE_SIZE;
+    Node      = CoreRangeTreeFindLast (&mTestTree, Address, MinLength);
+    UT_ASSERT_TRUE (Node == ScanLast (Address, MinLength));
+    while (Node != NULL) {
+      Range = BASE_CR (Node, TEST_RANGE, Node);
+      Node  = CoreRangeTreeFindPrevious (&mTestTree, Node, MinLength);
+      if (Range->Start == 0) {
+        UT_ASSERT_TRUE (Node == NULL);
+      } else {
+        UT_ASSERT_TRUE (Node == ScanLast (Range->Start - 1, MinLength));
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Search a fragmented map for a range that only the lowest range can hold.
+  The search must skip the subtrees of short ranges instead of visiting every
+  range from the top as a walk of an address ordered list does.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SearchShouldSkipShortRanges (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN            Index;
+  RANGE_TREE_NODE  *Node;
+
+  mTestRanges[0].Start = 0;
+  mTestRanges[0].End   = TEST_LONG_RANGE_PAGES * EFI_PAGE_SIZE - 1;
+  CoreRangeTreeInsert (&mTestTree, &mTestRanges[0].Node);
+  for (Index = 1; Index <= TEST_SHORT_RANGE_COUNT; Index++) {
+    mTestRanges[Index].Start = (TEST_LONG_RANGE_PAGES + 2 * Index) * EFI_PAGE_SIZE;
+    mTestRanges[Index].End   = mTestRanges[Index].Start + EFI_PAGE_SIZE - 1;
+    CoreRangeTreeInsert (&mTestTree, &mTestRanges[Index].Node);
+  }
+
+  mVisitCount = 0;
+  Node        = CoreRangeTreeFindLast (&mTestTree, MAX_UINT64, TEST_LONG_RANGE_PAGES * EFI_PAGE_SIZE);
+  UT_ASSERT_TRUE (Node == &mTestRanges[0].Node);
+  UT_ASSERT_TRUE (mVisitCount <= TEST_MAX_VISITS);
+  UT_ASSERT_TRUE (CoreRangeTreeFindPrevious (&mTestTree, Node, EFI_PAGE_SIZE) == NULL);
+
+  //
+  // Short ranges are found from the top of the map
+  //
+  mVisitCount = 0;
+  Node        = CoreRangeTreeFindLast (&mTestTree, MAX_UINT64, EFI_PAGE_SIZE);
+  UT_ASSERT_TRUE (Node == &mTestRanges[TEST_SHORT_RANGE_COUNT].Node);
+  Node = CoreRangeTreeFindPrevious (&mTestTree, Node, EFI_PAGE_SIZE);
+  UT_ASSERT_TRUE (Node == &mTestRanges[TEST_SHORT_RANGE_COUNT - 1].Node);
+  UT_ASSERT_TRUE (mVisitCount <= TEST_MAX_VISITS);
+
+  return UNIT_TEST_PASSED;
+}
+
+/// === TEST ENGINE ================================================================================
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the range
+  tree and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      RangeTreeTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (&RangeTreeTests, Framework, "DXE Core Range Tree Tests", "RangeTree", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for RangeTree\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (RangeTreeTests, "Random changes should match a linear scan", "RandomChanges", RandomChangesShouldMatchLinearScan, ResetTestTree, NULL, NULL);
+  AddTestCase (RangeTreeTests, "Search should skip short ranges", "SkipShortRanges", SearchShouldSkipShortRanges, ResetTestTree, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -798,6 +798,7 @@ ProcessSection (
   VOID                                   *PpiOutput;
   UINTN                                  PpiOutputSize;
   UINTN                                  Index;
+  UINTN                                  CacheIndex;
   UINT32                                 Authentication;
   PEI_CORE_INSTANCE                      *PrivateData;
   EFI_GUID                               *SectionDefinitionGuid;
@@ -871,6 +872,9 @@ ProcessSection (
       SectionCached = FALSE;
       for (Index = 0; Index < PrivateData->CacheSection.AllSectionCount; Index++) {
         if (Section == PrivateData->CacheSection.Section[Index]) {
+          PrivateData->CacheSection.LastUsed[Index] = ++PrivateData->CacheSection.UseCount;
+          PrivateData->CacheSection.Hits++;
+
           SectionCached  = TRUE;
           PpiOutput      = PrivateData->CacheSection.SectionData[Index];
           PpiOutputSize  = PrivateData->CacheSection.SectionSize[Index];
@@ -901,6 +905,8 @@ ProcessSection (
       // If SectionCached is TRUE, the section data has been cached and scanned.
       //
       if (!SectionCached) {
+        PrivateData->CacheSection.Misses++;
+
         Status         = EFI_NOT_FOUND;
         Authentication = 0;
         if (Section->Type == EFI_SECTION_GUID_DEFINED) {
@@ -952,17 +958,25 @@ ProcessSection (
         if (!EFI_ERROR (Status)) {
           if ((Authentication & EFI_AUTH_STATUS_NOT_TESTED) == 0) {
             //
-            // Update cache section data.
+            // Update cache section data. Use a free entry if there is one,
+            // otherwise replace the least recently used entry.
             //
             if (PrivateData->CacheSection.AllSectionCount < CACHE_SETION_MAX_NUMBER) {
-              PrivateData->CacheSection.AllSectionCount++;
+              CacheIndex = PrivateData->CacheSection.AllSectionCount++;
+            } else {
+              CacheIndex = 0;
+              for (Index = 1; Index < CACHE_SETION_MAX_NUMBER; Index++) {
+                if (PrivateData->CacheSection.LastUsed[Index] < PrivateData->CacheSection.LastUsed[CacheIndex]) {
+                  CacheIndex = Index;
+                }
+              }
             }
 
-            PrivateData->CacheSection.Section[PrivateData->CacheSection.SectionIndex]              = Section;
-            PrivateData->CacheSection.SectionData[PrivateData->CacheSection.SectionIndex]          = PpiOutput;
-            PrivateData->CacheSection.SectionSize[PrivateData->CacheSection.SectionIndex]          = PpiOutputSize;
-            PrivateData->CacheSection.AuthenticationStatus[PrivateData->CacheSection.SectionIndex] = Authentication;
-            PrivateData->CacheSection.SectionIndex                                                 = (PrivateData->CacheSection.SectionIndex + 1)%CACHE_SETION_MAX_NUMBER;
+            PrivateData->CacheSection.Section[CacheIndex]              = Section;
+            PrivateData->CacheSection.SectionData[CacheIndex]          = PpiOutput;
+            PrivateData->CacheSection.SectionSize[CacheIndex]          = PpiOutputSize;
+            PrivateData->CacheSection.AuthenticationStatus[CacheIndex] = Authentication;
+            PrivateData->CacheSection.LastUsed[CacheIndex]             = ++PrivateData->CacheSection.UseCount;
           }
 
           TempAuthenticationStatus = 0;
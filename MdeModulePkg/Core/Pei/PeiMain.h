@@ -162,8 +162,15 @@ typedef struct {
   VOID                         *SectionData[CACHE_SETION_MAX_NUMBER];
   UINTN                        SectionSize[CACHE_SETION_MAX_NUMBER];
   UINT32                       AuthenticationStatus[CACHE_SETION_MAX_NUMBER];
+  ///
+  /// Value of UseCount when the entry was last used, the entry with the
+  /// smallest value is replaced once all entries are in use.
+  ///
+  UINTN                        LastUsed[CACHE_SETION_MAX_NUMBER];
   UINTN                        AllSectionCount;
-  UINTN                        SectionIndex;
+  UINTN                        UseCount;
+  UINTN                        Hits;
+  UINTN                        Misses;
 } CACHE_SECTION_DATA;
 
 #define HOLE_MAX_NUMBER  0x3
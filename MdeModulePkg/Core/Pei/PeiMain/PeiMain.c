@@ -522,6 +522,13 @@ PeiCore (
     CpuDeadLoop ();
   }
 
+  DEBUG ((
+    DEBUG_INFO,
+    "PEI section cache: %Lu hits, %Lu misses\n",
+    (UINT64)PrivateData.CacheSection.Hits,
+    (UINT64)PrivateData.CacheSection.Misses
+    ));
+
   //
   // Enter DxeIpl to load Dxe core.
   //
@@ -1279,7 +1279,14 @@ typedef enum {
   SmmPoolTypeMax,
 } SMM_POOL_TYPE;
 
+//
+// Number of slab size classes of the slab allocator for small pool requests,
+// see mSmmPoolSlabSizeTable and PoolSlab.h
+//
+#define MAX_POOL_SLAB_INDEX  4
+
 extern LIST_ENTRY  mSmmPoolLists[SmmPoolTypeMax][MAX_POOL_INDEX];
+extern LIST_ENTRY  mSmmPoolSlabLists[SmmPoolTypeMax][MAX_POOL_SLAB_INDEX];
 
 /**
   Internal Function. Allocate n pages from given free page node.
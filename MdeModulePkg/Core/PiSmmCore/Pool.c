@@ -7,8 +7,18 @@
 **/
 
 #include "PiSmmCore.h"
+#include "PoolSlab.h"
 
 LIST_ENTRY  mSmmPoolLists[SmmPoolTypeMax][MAX_POOL_INDEX];
+LIST_ENTRY  mSmmPoolSlabLists[SmmPoolTypeMax][MAX_POOL_SLAB_INDEX];
+
+//
+// Object sizes of the slab classes, including the POOL_SLAB_OBJECT header.
+// Requests of these sizes would otherwise take a MIN_POOL_SIZE or larger block.
+//
+CONST UINT16  mSmmPoolSlabSizeTable[MAX_POOL_SLAB_INDEX] = {
+  16, 32, 48, 64
+};
 //
 // To cache the SMRAM base since when Loading modules At fixed address feature is enabled,
 // all module is assigned an offset relative the SMRAM base in build time.
@@ -63,6 +73,10 @@ SmmInitializeMemoryServices (
     for (Index = 0; Index < ARRAY_SIZE (mSmmPoolLists[SmmPoolTypeIndex]); Index++) {
       InitializeListHead (&mSmmPoolLists[SmmPoolTypeIndex][Index]);
     }
+
+    for (Index = 0; Index < ARRAY_SIZE (mSmmPoolSlabLists[SmmPoolTypeIndex]); Index++) {
+      InitializeListHead (&mSmmPoolSlabLists[SmmPoolTypeIndex][Index]);
+    }
   }
 
   Status = EfiGetSystemConfigurationTable (
@@ -217,6 +231,91 @@ InternalFreePoolByIndex (
   return EFI_SUCCESS;
 }
 
+/**
+  Internal Function. Allocate an object from the slabs of the specified class.
+
+  @param  PoolType              Type of pool to allocate.
+  @param  SlabIndex             Index which indicates the object size.
+  @param  Buffer                The returned object buffer.
+
+  @retval EFI_OUT_OF_RESOURCES   Allocation failed.
+  @retval EFI_SUCCESS            Object successfully allocated.
+
+**/
+EFI_STATUS
+InternalAllocPoolSlab (
+  IN  EFI_MEMORY_TYPE  PoolType,
+  IN  UINTN            SlabIndex,
+  OUT VOID             **Buffer
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  Address;
+  LIST_ENTRY            *SlabList;
+  POOL_SLAB             *Slab;
+
+  SlabList = &mSmmPoolSlabLists[UefiMemoryTypeToSmmPoolType (PoolType)][SlabIndex];
+
+  Slab = PoolSlabGetFree (SlabList);
+  if (Slab == NULL) {
+    Status = SmmInternalAllocatePages (
+               AllocateAnyPages,
+               PoolType,
+               1,
+               &Address,
+               FALSE
+               );
+    if (EFI_ERROR (Status)) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Slab = (POOL_SLAB *)(UINTN)Address;
+    PoolSlabInitialize (
+      SlabList,
+      Slab,
+      EFI_PAGE_SIZE,
+      SlabIndex,
+      mSmmPoolSlabSizeTable[SlabIndex],
+      PoolType
+      );
+  }
+
+  *Buffer = PoolSlabAllocateObject (SlabList, Slab);
+  return EFI_SUCCESS;
+}
+
+/**
+  Internal Function. Free a slab object.
+
+  @param  Slab                  The slab holding Buffer.
+  @param  Buffer                The object buffer to free.
+
+  @retval EFI_INVALID_PARAMETER Buffer is not an allocated object.
+  @retval EFI_SUCCESS           Object successfully freed.
+
+**/
+EFI_STATUS
+InternalFreePoolSlab (
+  IN POOL_SLAB  *Slab,
+  IN VOID       *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  BOOLEAN     Release;
+
+  Status = PoolSlabFreeObject (
+             &mSmmPoolSlabLists[UefiMemoryTypeToSmmPoolType (Slab->Type)][Slab->Index],
+             Slab,
+             Buffer,
+             &Release
+             );
+  if (EFI_ERROR (Status) || !Release) {
+    return Status;
+  }
+
+  return SmmInternalFreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Slab, 1, FALSE);
+}
+
 /**
   Allocate pool of a particular type.
 
@@ -260,6 +359,18 @@ SmmInternalAllocatePool (
   HasPoolTail = !(NeedGuard &&
                   ((PcdGet8 (PcdHeapGuardPropertyMask) & BIT7) == 0));
 
+  //
+  // Serve small requests from the slabs, unless the heap guard needs to
+  // track the allocation
+  //
+  if (((PcdGet8 (PcdPoolSlabPropertyMask) & BIT1) != 0) && !NeedGuard) {
+    for (PoolIndex = 0; PoolIndex < MAX_POOL_SLAB_INDEX; PoolIndex++) {
+      if (ALIGN_VALUE (Size, 8) + sizeof (POOL_SLAB_OBJECT) <= mSmmPoolSlabSizeTable[PoolIndex]) {
+        return InternalAllocPoolSlab (PoolType, PoolIndex, Buffer);
+      }
+    }
+  }
+
   //
   // Adjust the size by the pool header & tail overhead
   //
@@ -377,11 +488,19 @@ SmmInternalFreePool (
   POOL_TAIL         *PoolTail;
   BOOLEAN           HasPoolTail;
   BOOLEAN           MemoryGuarded;
+  POOL_SLAB         *Slab;
 
   if (Buffer == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
+  if ((PcdGet8 (PcdPoolSlabPropertyMask) & BIT1) != 0) {
+    Slab = PoolSlabLookup (Buffer, EFI_PAGE_SIZE, mSmmPoolSlabSizeTable, MAX_POOL_SLAB_INDEX);
+    if (Slab != NULL) {
+      return InternalFreePoolSlab (Slab, Buffer);
+    }
+  }
+
   FreePoolHdr = (FREE_POOL_HEADER *)((POOL_HEADER *)Buffer - 1);
   ASSERT (FreePoolHdr->Header.Signature == POOL_HEAD_SIGNATURE);
   ASSERT (!FreePoolHdr->Header.Available);
@@ -0,0 +1,258 @@
+/** @file
+  Slab allocator for small pool requests, shared by the DXE core and the SMM
+  core.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+
+#include "PoolSlab.h"
+
+/**
+  Get the number of objects a slab holds.
+
+  @param  SlabSize              The size of the slab, a power of two.
+  @param  ObjectSize            The object size including the POOL_SLAB_OBJECT
+                                header.
+
+  @return The number of objects in one slab.
+
+**/
+UINTN
+PoolSlabGetCapacity (
+  IN UINTN  SlabSize,
+  IN UINTN  ObjectSize
+  )
+{
+  return MIN ((SlabSize - POOL_SLAB_OBJECTS_OFFSET) / ObjectSize, POOL_SLAB_MAX_OBJECTS);
+}
+
+/**
+  Initialize a slab and insert it at the head of the list of its size class.
+
+  @param  SlabList              The list of the slabs of the size class.
+  @param  Slab                  The slab, aligned on SlabSize.
+  @param  SlabSize              The size of the slab, a power of two.
+  @param  Index                 The index of the size class.
+  @param  ObjectSize            The object size including the POOL_SLAB_OBJECT
+                                header.
+  @param  Type                  The memory type of the slab.
+
+**/
+VOID
+PoolSlabInitialize (
+  IN OUT LIST_ENTRY       *SlabList,
+  OUT    POOL_SLAB        *Slab,
+  IN     UINTN            SlabSize,
+  IN     UINTN            Index,
+  IN     UINTN            ObjectSize,
+  IN     EFI_MEMORY_TYPE  Type
+  )
+{
+  ASSERT (((UINTN)Slab & (SlabSize - 1)) == 0);
+  ASSERT (ObjectSize >= sizeof (POOL_SLAB_OBJECT) && (ObjectSize % 8) == 0);
+
+  ZeroMem (Slab, POOL_SLAB_OBJECTS_OFFSET);
+  Slab->Signature  = POOL_SLAB_SIGNATURE;
+  Slab->Index      = (UINT16)Index;
+  Slab->Type       = Type;
+  Slab->ObjectSize = (UINT16)ObjectSize;
+  Slab->Capacity   = (UINT16)PoolSlabGetCapacity (SlabSize, ObjectSize);
+  Slab->FreeCount  = Slab->Capacity;
+  InsertHeadList (SlabList, &Slab->Link);
+}
+
+/**
+  Get a slab with a free object from the list of a size class.
+
+  @param  SlabList              The list of the slabs of the size class.
+
+  @return The slab at the head of the list, or NULL if no slab of the list
+          has a free object.
+
+**/
+POOL_SLAB *
+PoolSlabGetFree (
+  IN LIST_ENTRY  *SlabList
+  )
+{
+  POOL_SLAB  *Slab;
+
+  //
+  // Slabs with free objects are kept at the head of the list
+  //
+  if (IsListEmpty (SlabList)) {
+    return NULL;
+  }
+
+  Slab = CR (GetFirstNode (SlabList), POOL_SLAB, Link, POOL_SLAB_SIGNATURE);
+  if (Slab->FreeCount == 0) {
+    return NULL;
+  }
+
+  return Slab;
+}
+
+/**
+  Allocate an object from a slab. A slab that becomes full is moved to the
+  tail of its list.
+
+  @param  SlabList              The list holding Slab.
+  @param  Slab                  The slab, which must have a free object.
+
+  @return The object buffer, after its POOL_SLAB_OBJECT header.
+
+**/
+VOID *
+PoolSlabAllocateObject (
+  IN OUT LIST_ENTRY  *SlabList,
+  IN OUT POOL_SLAB   *Slab
+  )
+{
+  POOL_SLAB_OBJECT  *Object;
+  UINTN             Slot;
+  UINTN             Word;
+  UINTN             Bit;
+
+  ASSERT (Slab->FreeCount != 0);
+
+  //
+  // Find the first free slot in the bitmap
+  //
+  for (Word = 0; Slab->Bitmap[Word] == MAX_UINT64; Word++) {
+    ASSERT (Word < ARRAY_SIZE (Slab->Bitmap));
+  }
+
+  Bit  = (UINTN)LowBitSet64 (~Slab->Bitmap[Word]);
+  Slot = Word * 64 + Bit;
+  ASSERT (Slot < Slab->Capacity);
+
+  Slab->Bitmap[Word] |= LShiftU64 (1, Bit);
+  Slab->FreeCount--;
+
+  //
+  // Move a full slab behind the ones that still have free objects
+  //
+  if (Slab->FreeCount == 0) {
+    RemoveEntryList (&Slab->Link);
+    InsertTailList (SlabList, &Slab->Link);
+  }
+
+  Object            = (POOL_SLAB_OBJECT *)((UINT8 *)Slab + POOL_SLAB_OBJECTS_OFFSET + Slot * Slab->ObjectSize);
+  Object->Signature = POOL_SLAB_OBJECT_SIGNATURE;
+  Object->Slot      = (UINT16)Slot;
+  Object->Reserved  = 0;
+
+  return Object + 1;
+}
+
+/**
+  Look up the slab holding a buffer returned by PoolSlabAllocateObject().
+
+  The 8 bytes before a regular pool buffer are the tail of the pool header,
+  which never holds the object signature, so any pool buffer may be looked up.
+
+  @param  Buffer                The buffer to look up.
+  @param  SlabSize              The size of the slabs, a power of two.
+  @param  SizeTable             The object sizes of the size classes.
+  @param  SizeCount             The number of size classes.
+
+  @return The slab holding Buffer, or NULL if Buffer is not a slab object.
+
+**/
+POOL_SLAB *
+PoolSlabLookup (
+  IN VOID          *Buffer,
+  IN UINTN         SlabSize,
+  IN CONST UINT16  *SizeTable,
+  IN UINTN         SizeCount
+  )
+{
+  POOL_SLAB_OBJECT  *Object;
+  POOL_SLAB         *Slab;
+  UINTN             Offset;
+
+  Object = (POOL_SLAB_OBJECT *)Buffer - 1;
+  if (Object->Signature != POOL_SLAB_OBJECT_SIGNATURE) {
+    return NULL;
+  }
+
+  Slab = (POOL_SLAB *)((UINTN)Object & ~(SlabSize - 1));
+  if ((Slab->Signature != POOL_SLAB_SIGNATURE) ||
+      (Slab->Index >= SizeCount) ||
+      (Slab->ObjectSize != SizeTable[Slab->Index]) ||
+      ((UINTN)Object < (UINTN)Slab + POOL_SLAB_OBJECTS_OFFSET))
+  {
+    return NULL;
+  }
+
+  Offset = (UINTN)Object - (UINTN)Slab - POOL_SLAB_OBJECTS_OFFSET;
+  if (((Offset % Slab->ObjectSize) != 0) ||
+      ((Offset / Slab->ObjectSize) != Object->Slot) ||
+      (Object->Slot >= Slab->Capacity))
+  {
+    return NULL;
+  }
+
+  return Slab;
+}
+
+/**
+  Free an object of a slab. The slab is moved to the head of its list, or
+  removed from it when the slab is empty and not the only one of the list.
+  The caller frees the pages of a removed slab.
+
+  @param  SlabList              The list holding Slab.
+  @param  Slab                  The slab holding Buffer.
+  @param  Buffer                The object buffer to free.
+  @param  Release               Return TRUE if the slab was removed from the
+                                list.
+
+  @retval EFI_INVALID_PARAMETER Buffer is not an allocated object.
+  @retval EFI_SUCCESS           Object successfully freed.
+
+**/
+EFI_STATUS
+PoolSlabFreeObject (
+  IN OUT LIST_ENTRY  *SlabList,
+  IN OUT POOL_SLAB   *Slab,
+  IN     VOID        *Buffer,
+  OUT    BOOLEAN     *Release
+  )
+{
+  POOL_SLAB_OBJECT  *Object;
+  UINTN             Slot;
+  UINT64            Mask;
+
+  *Release = FALSE;
+
+  Object = (POOL_SLAB_OBJECT *)Buffer - 1;
+  Slot   = Object->Slot;
+  Mask   = LShiftU64 (1, Slot % 64);
+
+  ASSERT ((Slab->Bitmap[Slot / 64] & Mask) != 0);
+  if ((Slab->Bitmap[Slot / 64] & Mask) == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Object->Signature        = 0;
+  Slab->Bitmap[Slot / 64] &= ~Mask;
+  Slab->FreeCount++;
+
+  RemoveEntryList (&Slab->Link);
+  if ((Slab->FreeCount == Slab->Capacity) && !IsListEmpty (SlabList)) {
+    //
+    // Release an empty slab, unless it is the only one of its class
+    //
+    Slab->Signature = 0;
+    *Release        = TRUE;
+  } else {
+    InsertHeadList (SlabList, &Slab->Link);
+  }
+
+  return EFI_SUCCESS;
+}
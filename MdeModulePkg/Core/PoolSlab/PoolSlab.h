@@ -0,0 +1,158 @@
+/** @file
+  Slab allocator for small pool requests, shared by the DXE core and the SMM
+  core.
+
+  Each slab is one page holding objects of a single size class, tracked by an
+  in-use bitmap. Every object only carries a POOL_SLAB_OBJECT header instead
+  of the pool header and tail. The slabs of a size class are kept on a list,
+  with the slabs that have free objects at its head. Each core allocates and
+  frees the slab pages and keeps the lists and size classes of its pools.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef POOL_SLAB_H_
+#define POOL_SLAB_H_
+
+#include <Uefi.h>
+
+#define POOL_SLAB_OBJECT_SIGNATURE  SIGNATURE_32('p','s','o','0')
+
+typedef struct {
+  UINT32    Signature;
+  UINT16    Slot;
+  UINT16    Reserved;
+} POOL_SLAB_OBJECT;
+
+#define POOL_SLAB_MAX_OBJECTS  128
+
+#define POOL_SLAB_SIGNATURE  SIGNATURE_32('p','s','l','b')
+
+typedef struct {
+  UINT32             Signature;
+  UINT16             Index;
+  UINT16             FreeCount;
+  EFI_MEMORY_TYPE    Type;
+  UINT16             ObjectSize;
+  UINT16             Capacity;
+  LIST_ENTRY         Link;
+  UINT64             Bitmap[POOL_SLAB_MAX_OBJECTS / 64];
+} POOL_SLAB;
+
+#define POOL_SLAB_OBJECTS_OFFSET  ALIGN_VALUE (sizeof (POOL_SLAB), 8)
+
+/**
+  Get the number of objects a slab holds.
+
+  @param  SlabSize              The size of the slab, a power of two.
+  @param  ObjectSize            The object size including the POOL_SLAB_OBJECT
+                                header.
+
+  @return The number of objects in one slab.
+
+**/
+UINTN
+PoolSlabGetCapacity (
+  IN UINTN  SlabSize,
+  IN UINTN  ObjectSize
+  );
+
+/**
+  Initialize a slab and insert it at the head of the list of its size class.
+
+  @param  SlabList              The list of the slabs of the size class.
+  @param  Slab                  The slab, aligned on SlabSize.
+  @param  SlabSize              The size of the slab, a power of two.
+  @param  Index                 The index of the size class.
+  @param  ObjectSize            The object size including the POOL_SLAB_OBJECT
+                                header.
+  @param  Type                  The memory type of the slab.
+
+**/
+VOID
+PoolSlabInitialize (
+  IN OUT LIST_ENTRY       *SlabList,
+  OUT    POOL_SLAB        *Slab,
+  IN     UINTN            SlabSize,
+  IN     UINTN            Index,
+  IN     UINTN            ObjectSize,
+  IN     EFI_MEMORY_TYPE  Type
+  );
+
+/**
+  Get a slab with a free object from the list of a size class.
+
+  @param  SlabList              The list of the slabs of the size class.
+
+  @return The slab at the head of the list, or NULL if no slab of the list
+          has a free object.
+
+**/
+POOL_SLAB *
+PoolSlabGetFree (
+  IN LIST_ENTRY  *SlabList
+  );
+
+/**
+  Allocate an object from a slab. A slab that becomes full is moved to the
+  tail of its list.
+
+  @param  SlabList              The list holding Slab.
+  @param  Slab                  The slab, which must have a free object.
+
+  @return The object buffer, after its POOL_SLAB_OBJECT header.
+
+**/
+VOID *
+PoolSlabAllocateObject (
+  IN OUT LIST_ENTRY  *SlabList,
+  IN OUT POOL_SLAB   *Slab
+  );
+
+/**
+  Look up the slab holding a buffer returned by PoolSlabAllocateObject().
+
+  The 8 bytes before a regular pool buffer are the tail of the pool header,
+  which never holds the object signature, so any pool buffer may be looked up.
+
+  @param  Buffer                The buffer to look up.
+  @param  SlabSize              The size of the slabs, a power of two.
+  @param  SizeTable             The object sizes of the size classes.
+  @param  SizeCount             The number of size classes.
+
+  @return The slab holding Buffer, or NULL if Buffer is not a slab object.
+
+**/
+POOL_SLAB *
+PoolSlabLookup (
+  IN VOID          *Buffer,
+  IN UINTN         SlabSize,
+  IN CONST UINT16  *SizeTable,
+  IN UINTN         SizeCount
+  );
+
+/**
+  Free an object of a slab. The slab is moved to the head of its list, or
+  removed from it when the slab is empty and not the only one of the list.
+  The caller frees the pages of a removed slab.
+
+  @param  SlabList              The list holding Slab.
+  @param  Slab                  The slab holding Buffer.
+  @param  Buffer                The object buffer to free.
+  @param  Release               Return TRUE if the slab was removed from the
+                                list.
+
+  @retval EFI_INVALID_PARAMETER Buffer is not an allocated object.
+  @retval EFI_SUCCESS           Object successfully freed.
+
+**/
+EFI_STATUS
+PoolSlabFreeObject (
+  IN OUT LIST_ENTRY  *SlabList,
+  IN OUT POOL_SLAB   *Slab,
+  IN     VOID        *Buffer,
+  OUT    BOOLEAN     *Release
+  );
+
+#endif
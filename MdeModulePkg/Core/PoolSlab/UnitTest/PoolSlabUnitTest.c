@@ -0,0 +1,430 @@
+/** @file
+  This is a host-based unit test for the slab allocator for small pool
+  requests, which the DXE core and the SMM core share.
+
+  The tests fill and empty slabs of every size class, check the order of the
+  slabs on their list and the release of empty slabs, and check that only
+  allocated objects are recognized as slab objects.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/UnitTestLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+
+#include "../PoolSlab.h"
+
+#define UNIT_TEST_NAME     "Pool Slab Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define TEST_SLAB_SIZE   EFI_PAGE_SIZE
+#define TEST_SLAB_COUNT  2
+
+/// === TEST DATA ==================================================================================
+
+//
+// The size classes of both cores
+//
+CONST UINT16  mTestSizeTable[] = {
+  16, 32, 48, 64, 96
+};
+
+UINT8       mTestMemory[(TEST_SLAB_COUNT + 1) * TEST_SLAB_SIZE];
+POOL_SLAB   *mTestSlabs[TEST_SLAB_COUNT];
+LIST_ENTRY  mTestSlabList;
+
+/// === HELPER FUNCTIONS ===========================================================================
+
+/**
+  Return the buffer of an object of a slab.
+
+  @param  Slab               The slab
+  @param  Slot               The slot of the object
+
+  @return The object buffer, after its POOL_SLAB_OBJECT header
+
+**/
+VOID *
+GetObjectBuffer (
+  IN POOL_SLAB  *Slab,
+  IN UINTN      Slot
+  )
+{
+  return (UINT8 *)Slab + POOL_SLAB_OBJECTS_OFFSET + Slot * Slab->ObjectSize + sizeof (POOL_SLAB_OBJECT);
+}
+
+/**
+  Check whether a slab is on the slab list.
+
+  @param  Slab               The slab
+
+  @retval TRUE    The slab is on the list.
+  @retval FALSE   The slab is not on the list.
+
+**/
+BOOLEAN
+IsSlabInList (
+  IN POOL_SLAB  *Slab
+  )
+{
+  LIST_ENTRY  *Link;
+
+  for (Link = GetFirstNode (&mTestSlabList); !IsNull (&mTestSlabList, Link); Link = GetNextNode (&mTestSlabList, Link)) {
+    if (Link == &Slab->Link) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Reset the test memory and the slab list.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ResetTestSlabs (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  ZeroMem (mTestMemory, sizeof (mTestMemory));
+  for (Index = 0; Index < TEST_SLAB_COUNT; Index++) {
+    mTestSlabs[Index] = (POOL_SLAB *)(ALIGN_VALUE ((UINTN)mTestMemory, TEST_SLAB_SIZE) + Index * TEST_SLAB_SIZE);
+  }
+
+  InitializeListHead (&mTestSlabList);
+
+  return UNIT_TEST_PASSED;
+}
+
+/// === TEST CASES =================================================================================
+
+/**
+  The objects of a slab must fit after the slab header, and a slab must hold
+  as many objects as fit, up to the size of the bitmap.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CapacityShouldFillSlab (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+  UINTN  Size;
+  UINTN  Capacity;
+
+  for (Index = 0; Index < ARRAY_SIZE (mTestSizeTable); Index++) {
+    Size     = mTestSizeTable[Index];
+    Capacity = PoolSlabGetCapacity (TEST_SLAB_SIZE, Size);
+    UT_ASSERT_TRUE (Capacity <= POOL_SLAB_MAX_OBJECTS);
+    UT_ASSERT_TRUE (POOL_SLAB_OBJECTS_OFFSET + Capacity * Size <= TEST_SLAB_SIZE);
+    UT_ASSERT_TRUE ((Capacity == POOL_SLAB_MAX_OBJECTS) || (POOL_SLAB_OBJECTS_OFFSET + (Capacity + 1) * Size > TEST_SLAB_SIZE));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Fill two slabs of every size class. The objects must be allocated in slot
+  order and be recognized as objects of their slab, and a full slab must not
+  be returned as a slab with a free object.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+AllocateShouldFillSlabInOrder (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN      Index;
+  UINTN      Count;
+  UINTN      Slot;
+  POOL_SLAB  *Slab;
+  VOID       *Buffer;
+
+  for (Index = 0; Index < ARRAY_SIZE (mTestSizeTable); Index++) {
+    ResetTestSlabs (NULL);
+    UT_ASSERT_TRUE (PoolSlabGetFree (&mTestSlabList) == NULL);
+
+    for (Count = 0; Count < TEST_SLAB_COUNT; Count++) {
+      PoolSlabInitialize (&mTestSlabList, mTestSlabs[Count], TEST_SLAB_SIZE, Index, mTestSizeTable[Index], EfiBootServicesData);
+    }
+
+    //
+    // New slabs go to the head of the list, and a full slab moves behind the
+    // slabs that still have free objects
+    //
+    for (Count = TEST_SLAB_COUNT; Count > 0; Count--) {
+      Slab = mTestSlabs[Count - 1];
+      UT_ASSERT_EQUAL (Slab->FreeCount, PoolSlabGetCapacity (TEST_SLAB_SIZE, mTestSizeTable[Index]));
+
+      for (Slot = 0; Slot < Slab->Capacity; Slot++) {
+        UT_ASSERT_TRUE (PoolSlabGetFree (&mTestSlabList) == Slab);
+        Buffer = PoolSlabAllocateObject (&mTestSlabList, Slab);
+        UT_ASSERT_TRUE (Buffer == GetObjectBuffer (Slab, Slot));
+        UT_ASSERT_EQUAL ((UINTN)Buffer % 8, 0);
+        UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == Slab);
+        UT_ASSERT_EQUAL (Slab->FreeCount, Slab->Capacity - Slot - 1);
+      }
+
+      UT_ASSERT_TRUE (IsSlabInList (Slab));
+    }
+
+    UT_ASSERT_TRUE (PoolSlabGetFree (&mTestSlabList) == NULL);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free objects of two slabs. A freed slot must be allocated again, an empty
+  slab must be released, and the last slab of a list must be kept.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FreeShouldReuseAndReleaseSlabs (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN       Slot;
+  POOL_SLAB   *Full;
+  POOL_SLAB   *Partial;
+  VOID        *Buffer;
+  BOOLEAN     Release;
+  EFI_STATUS  Status;
+
+  Full    = mTestSlabs[0];
+  Partial = mTestSlabs[1];
+  PoolSlabInitialize (&mTestSlabList, Full, TEST_SLAB_SIZE, 1, mTestSizeTable[1], EfiRuntimeServicesData);
+  for (Slot = 0; Slot < Full->Capacity; Slot++) {
+    PoolSlabAllocateObject (&mTestSlabList, Full);
+  }
+
+  PoolSlabInitialize (&mTestSlabList, Partial, TEST_SLAB_SIZE, 1, mTestSizeTable[1], EfiRuntimeServicesData);
+  Buffer = PoolSlabAllocateObject (&mTestSlabList, Partial);
+
+  //
+  // A slab with a freed object moves to the head of the list
+  //
+  Status = PoolSlabFreeObject (&mTestSlabList, Full, GetObjectBuffer (Full, 5), &Release);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_FALSE (Release);
+  UT_ASSERT_TRUE (PoolSlabLookup (GetObjectBuffer (Full, 5), TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == NULL);
+  UT_ASSERT_TRUE (PoolSlabGetFree (&mTestSlabList) == Full);
+  UT_ASSERT_TRUE (PoolSlabAllocateObject (&mTestSlabList, Full) == GetObjectBuffer (Full, 5));
+
+  //
+  // An empty slab is released while another slab is on the list
+  //
+  Status = PoolSlabFreeObject (&mTestSlabList, Partial, Buffer, &Release);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (Release);
+  UT_ASSERT_FALSE (IsSlabInList (Partial));
+  UT_ASSERT_NOT_EQUAL (Partial->Signature, POOL_SLAB_SIGNATURE);
+  UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == NULL);
+
+  //
+  // The last slab of the list is kept when it becomes empty
+  //
+  for (Slot = 0; Slot < Full->Capacity; Slot++) {
+    Status = PoolSlabFreeObject (&mTestSlabList, Full, GetObjectBuffer (Full, Slot), &Release);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_FALSE (Release);
+  }
+
+  UT_ASSERT_EQUAL (Full->FreeCount, Full->Capacity);
+  UT_ASSERT_TRUE (PoolSlabGetFree (&mTestSlabList) == Full);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Buffers that were not returned by PoolSlabAllocateObject(), or that were
+  freed, must not be recognized as slab objects, even when the 8 bytes before
+  them hold the object signature.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LookupShouldRejectOtherBuffers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN             Index;
+  POOL_SLAB         *Slab;
+  POOL_SLAB_OBJECT  *Object;
+  UINT8             *Buffer;
+
+  //
+  // Use the largest class, which leaves room for an object header after the
+  // last slot
+  //
+  Index = ARRAY_SIZE (mTestSizeTable) - 1;
+  Slab  = mTestSlabs[0];
+  PoolSlabInitialize (&mTestSlabList, Slab, TEST_SLAB_SIZE, Index, mTestSizeTable[Index], EfiBootServicesData);
+  PoolSlabAllocateObject (&mTestSlabList, Slab);
+  PoolSlabAllocateObject (&mTestSlabList, Slab);
+  UT_ASSERT_TRUE (POOL_SLAB_OBJECTS_OFFSET + Slab->Capacity * Slab->ObjectSize + sizeof (POOL_SLAB_OBJECT) <= TEST_SLAB_SIZE);
+
+  //
+  // A slot that was never allocated
+  //
+  UT_ASSERT_TRUE (PoolSlabLookup (GetObjectBuffer (Slab, 2), TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == NULL);
+
+  //
+  // An object signature inside an object, or with the slot of another object
+  //
+  Buffer            = (UINT8 *)GetObjectBuffer (Slab, 1) + 8;
+  Object            = (POOL_SLAB_OBJECT *)Buffer - 1;
+  Object->Signature = POOL_SLAB_OBJECT_SIGNATURE;
+  Object->Slot      = 1;
+  UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == NULL);
+
+  Buffer            = GetObjectBuffer (Slab, 3);
+  Object            = (POOL_SLAB_OBJECT *)Buffer - 1;
+  Object->Signature = POOL_SLAB_OBJECT_SIGNATURE;
+  Object->Slot      = 4;
+  UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == NULL);
+
+  //
+  // An object signature after the last slot, and in the slab header
+  //
+  Buffer            = GetObjectBuffer (Slab, Slab->Capacity);
+  Object            = (POOL_SLAB_OBJECT *)Buffer - 1;
+  Object->Signature = POOL_SLAB_OBJECT_SIGNATURE;
+  Object->Slot      = Slab->Capacity;
+  UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == NULL);
+
+  Buffer            = (UINT8 *)Slab + POOL_SLAB_OBJECTS_OFFSET;
+  Object            = (POOL_SLAB_OBJECT *)Buffer - 1;
+  Object->Signature = POOL_SLAB_OBJECT_SIGNATURE;
+  Object->Slot      = 0;
+  UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == NULL);
+
+  //
+  // A slab whose size class does not match the size table
+  //
+  Buffer = GetObjectBuffer (Slab, 0);
+  UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == Slab);
+  UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, Index) == NULL);
+  Slab->Index = 0;
+  UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == NULL);
+  Slab->Index = (UINT16)Index;
+
+  //
+  // A page without the slab signature
+  //
+  Slab->Signature = 0;
+  UT_ASSERT_TRUE (PoolSlabLookup (Buffer, TEST_SLAB_SIZE, mTestSizeTable, ARRAY_SIZE (mTestSizeTable)) == NULL);
+
+  return UNIT_TEST_PASSED;
+}
+
+/// === TEST ENGINE ================================================================================
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the pool
+  slabs and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      PoolSlabTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (&PoolSlabTests, Framework, "Pool Slab Tests", "PoolSlab", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PoolSlab\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (PoolSlabTests, "Capacity should fill a slab", "Capacity", CapacityShouldFillSlab, NULL, NULL, NULL);
+  AddTestCase (PoolSlabTests, "Allocate should fill a slab in order", "Allocate", AllocateShouldFillSlabInOrder, ResetTestSlabs, NULL, NULL);
+  AddTestCase (PoolSlabTests, "Free should reuse and release slabs", "Free", FreeShouldReuseAndReleaseSlabs, ResetTestSlabs, NULL, NULL);
+  AddTestCase (PoolSlabTests, "Lookup should reject other buffers", "Lookup", LookupShouldRejectOtherBuffers, ResetTestSlabs, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,115 @@
+/** @file
+  Boot service latency profile data structure.
+
+  When PcdDxeServiceProfileRecordCount is not zero, the DXE Core measures the
+  time spent in the boot services listed below, attributes each call to the
+  image that made it, and publishes the result as a configuration table.
+
+  The table starts with a DXE_SERVICE_PROFILE_TABLE header, followed by
+  MaxCallerCount DXE_SERVICE_PROFILE_CALLER entries at CallerOffset, and a
+  ring buffer of RecordCount DXE_SERVICE_PROFILE_RECORD entries at
+  RecordOffset. Caller 0 collects the calls from unknown addresses.
+
+  The table is reallocated and installed again when MaxCallerCount images
+  have been started, so the configuration table must be looked up again to
+  see the images started later.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _DXE_SERVICE_PROFILE_H_
+#define _DXE_SERVICE_PROFILE_H_
+
+#define EDKII_DXE_SERVICE_PROFILE_TABLE_GUID \
+  { \
+    0x5b8d4a3e, 0x2c71, 0x4f06, { 0x9a, 0xe4, 0x61, 0x0b, 0xd3, 0x7c, 0x58, 0x92 } \
+  }
+
+//
+// Profiled boot services
+//
+#define DXE_SERVICE_PROFILE_RAISE_TPL                     0
+#define DXE_SERVICE_PROFILE_RESTORE_TPL                   1
+#define DXE_SERVICE_PROFILE_ALLOCATE_PAGES                2
+#define DXE_SERVICE_PROFILE_FREE_PAGES                    3
+#define DXE_SERVICE_PROFILE_GET_MEMORY_MAP                4
+#define DXE_SERVICE_PROFILE_ALLOCATE_POOL                 5
+#define DXE_SERVICE_PROFILE_FREE_POOL                     6
+#define DXE_SERVICE_PROFILE_CREATE_EVENT                  7
+#define DXE_SERVICE_PROFILE_CREATE_EVENT_EX               8
+#define DXE_SERVICE_PROFILE_SIGNAL_EVENT                  9
+#define DXE_SERVICE_PROFILE_INSTALL_PROTOCOL_INTERFACE    10
+#define DXE_SERVICE_PROFILE_UNINSTALL_PROTOCOL_INTERFACE  11
+#define DXE_SERVICE_PROFILE_HANDLE_PROTOCOL               12
+#define DXE_SERVICE_PROFILE_LOCATE_HANDLE                 13
+#define DXE_SERVICE_PROFILE_OPEN_PROTOCOL                 14
+#define DXE_SERVICE_PROFILE_CLOSE_PROTOCOL                15
+#define DXE_SERVICE_PROFILE_LOCATE_HANDLE_BUFFER          16
+#define DXE_SERVICE_PROFILE_LOCATE_PROTOCOL               17
+#define DXE_SERVICE_PROFILE_SERVICE_COUNT                 18
+
+//
+// Calls are counted in the histogram bucket of the highest bit set in their
+// duration in ticks. The last bucket also counts all the longer calls.
+//
+#define DXE_SERVICE_PROFILE_BUCKET_COUNT  24
+
+typedef struct {
+  UINT64    Count;
+  UINT64    TotalTicks;
+  UINT64    MaxTicks;
+  UINT32    Histogram[DXE_SERVICE_PROFILE_BUCKET_COUNT];
+} DXE_SERVICE_PROFILE_STATISTICS;
+
+typedef struct {
+  //
+  // FFS file name of the image, or zero for the unknown caller
+  //
+  EFI_GUID                          FileName;
+  PHYSICAL_ADDRESS                  ImageBase;
+  //
+  // Zero once the image is unloaded. Its statistics are kept.
+  //
+  UINT64                            ImageSize;
+  DXE_SERVICE_PROFILE_STATISTICS    Service[DXE_SERVICE_PROFILE_SERVICE_COUNT];
+} DXE_SERVICE_PROFILE_CALLER;
+
+typedef struct {
+  UINT64    Timestamp;
+  //
+  // Duration of the call in ticks, saturated at MAX_UINT32
+  //
+  UINT32    Duration;
+  UINT16    Service;
+  UINT16    Caller;
+} DXE_SERVICE_PROFILE_RECORD;
+
+#define DXE_SERVICE_PROFILE_TABLE_SIGNATURE  SIGNATURE_32 ('D','S','P','T')
+#define DXE_SERVICE_PROFILE_TABLE_REVISION   0x0001
+
+typedef struct {
+  UINT32    Signature;
+  UINT16    Revision;
+  UINT16    HeaderSize;
+  //
+  // Frequency of the performance counter the ticks are counted with, in Hz
+  //
+  UINT64    Frequency;
+  UINT32    ServiceCount;
+  UINT32    BucketCount;
+  UINT32    CallerCount;
+  UINT32    MaxCallerCount;
+  UINT32    RecordCount;
+  //
+  // Number of records ever written. The newest record is at index
+  // (RecordIndex - 1) % RecordCount in the ring buffer.
+  //
+  UINT32    RecordIndex;
+  UINT32    CallerOffset;
+  UINT32    RecordOffset;
+} DXE_SERVICE_PROFILE_TABLE;
+
+extern EFI_GUID  gEdkiiDxeServiceProfileTableGuid;
+
+#endif
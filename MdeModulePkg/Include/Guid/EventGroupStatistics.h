@@ -0,0 +1,56 @@
+/** @file
+  Event group dispatch statistics data structure.
+
+  When performance measurement is enabled, the DXE Core counts how often each
+  event group is signaled and how many notification functions it dispatches
+  for it, and accumulates the time spent in those notification functions. The
+  result is published as a configuration table.
+
+  The table starts with an EVENT_GROUP_STATISTICS_TABLE header, followed by
+  MaxGroupCount EVENT_GROUP_STATISTICS entries, of which the first GroupCount
+  are in use. The table is reallocated and installed again when it is full,
+  so the configuration table must be looked up again to see new groups.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _EVENT_GROUP_STATISTICS_H_
+#define _EVENT_GROUP_STATISTICS_H_
+
+#define EDKII_EVENT_GROUP_STATISTICS_TABLE_GUID \
+  { \
+    0x417f0110, 0xec6b, 0x4fa8, { 0xb3, 0xeb, 0xed, 0x32, 0xb6, 0xc0, 0xe0, 0xd5 } \
+  }
+
+typedef struct {
+  //
+  // Event group GUID, or zero for the events created without an event group
+  //
+  EFI_GUID    EventGroup;
+  UINT64      SignalCount;
+  UINT64      NotifyCount;
+  //
+  // Time spent in the notification functions, in performance counter ticks
+  //
+  UINT64      NotifyTicks;
+} EVENT_GROUP_STATISTICS;
+
+#define EVENT_GROUP_STATISTICS_TABLE_SIGNATURE  SIGNATURE_32 ('E','G','S','T')
+#define EVENT_GROUP_STATISTICS_TABLE_REVISION   0x0001
+
+typedef struct {
+  UINT32    Signature;
+  UINT16    Revision;
+  UINT16    HeaderSize;
+  //
+  // Frequency of the performance counter the ticks are counted with, in Hz
+  //
+  UINT64    Frequency;
+  UINT32    GroupCount;
+  UINT32    MaxGroupCount;
+} EVENT_GROUP_STATISTICS_TABLE;
+
+extern EFI_GUID  gEdkiiEventGroupStatisticsTableGuid;
+
+#endif
@@ -23,7 +23,33 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define LZMAF86_CUSTOM_DECOMPRESS_GUID  \
   { 0xD42AE6BD, 0x1352, 0x4bfb, { 0x90, 0x9A, 0xCA, 0x72, 0xA6, 0xEA, 0xE8, 0x89 } }
 
+///
+/// The Global ID used to identify a section of an FFS file of type
+/// EFI_SECTION_GUID_DEFINED, whose contents have been split into blocks that
+/// are compressed independently using LZMA, so that they can be decompressed
+/// in parallel.
+///
+#define LZMA_CHUNKED_CUSTOM_DECOMPRESS_GUID  \
+  { 0xEA57D8E0, 0xDEFE, 0x4D6F, { 0xBF, 0xB1, 0xDD, 0x12, 0x61, 0x2A, 0x44, 0x93 } }
+
+#define LZMA_CHUNKED_SIGNATURE  SIGNATURE_32 ('L', 'Z', 'M', 'C')
+
+///
+/// Header of the data of a LZMA_CHUNKED_CUSTOM_DECOMPRESS_GUID section. It is
+/// followed by a UINT32 array holding the compressed size of every block, and
+/// then by the blocks. Each block is a regular LZMA stream, including its own
+/// header, that decodes to BlockSize bytes, except the last block which decodes
+/// to the remainder of UncompressedSize.
+///
+typedef struct {
+  UINT32    Signature;
+  UINT32    BlockSize;
+  UINT32    BlockCount;
+  UINT32    UncompressedSize;
+} LZMA_CHUNKED_HEADER;
+
 extern GUID  gLzmaCustomDecompressGuid;
 extern GUID  gLzmaF86CustomDecompressGuid;
+extern GUID  gLzmaChunkedCustomDecompressGuid;
 
 #endif
@@ -48,6 +48,21 @@ typedef UINT64 SKU_ID;
 
 #define PCD_DATABASE_OFFSET_MASK  (~(PCD_TYPE_ALL_SET | PCD_DATUM_TYPE_ALL_SET | PCD_DATUM_TYPE_UINT8_BOOLEAN))
 
+//
+// Number of local tokens described by one entry of the SizeIndexTable.
+//
+#define PCD_SIZE_INDEX_TABLE_STRIDE  32
+
+//
+// First PCD database version with a sorted ExMapTable and a SizeIndexTable.
+// Older databases keep the ExMapTable in generation order, and the
+// SizeIndexTableOffset field is a pad.
+//
+#define PCD_DATABASE_INDEXED_VERSION  8
+
+//
+// The ExMapTable is sorted by ExGuidIndex, then by ExTokenNumber.
+//
 typedef struct  {
   UINT32    ExTokenNumber;
   UINT16    TokenNumber;        // Token Number for Dynamic-Ex PCD.
@@ -72,6 +87,12 @@ typedef UINT32 STRING_HEAD;
 
 typedef UINT16 SIZE_INFO;
 
+//
+// Index in SizeTable of the first PCD_DATUM_TYPE_POINTER PCD at or after the
+// local token PCD_SIZE_INDEX_TABLE_STRIDE * (index of the SIZE_INDEX entry).
+//
+typedef UINT32 SIZE_INDEX;
+
 typedef struct {
   UINT32    TokenSpaceCNameIndex; // Offset in String Table in units of UINT8.
   UINT32    PcdCNameIndex;        // Offset in String Table in units of UINT8.
@@ -93,10 +114,11 @@ typedef struct {
   TABLE_OFFSET    SizeTableOffset;
   TABLE_OFFSET    SkuIdTableOffset;
   TABLE_OFFSET    PcdNameTableOffset;
+  TABLE_OFFSET    SizeIndexTableOffset;
   UINT16          LocalTokenCount;              // LOCAL_TOKEN_NUMBER for all.
   UINT16          ExTokenCount;                 // EX_TOKEN_NUMBER for DynamicEx.
   UINT16          GuidTableCount;               // The Number of Guid in GuidTable.
-  UINT8           Pad[6];                       // Pad bytes to satisfy the alignment.
+  UINT8           Pad[2];                       // Pad bytes to satisfy the alignment.
 
   //
   // Default initialized external PCD database binary structure
@@ -109,6 +131,7 @@ typedef struct {
   // VPD_HEAD                       VpdHead[];               // VPD Offset
   // DYNAMICEX_MAPPING              ExMapTable[];            // DynamicEx PCD mapped to LocalIndex in LocalTokenNumberTable. It can be accessed by the ExMapTableOffset.
   // UINT32                         LocalTokenNumberTable[]; // Offset | DataType | PCD Type. It can be accessed by LocalTokenNumberTableOffset.
+  // SIZE_INDEX                     SizeIndexTable[];        // SizeTable index of every PCD_SIZE_INDEX_TABLE_STRIDE local tokens. It can be accessed by SizeIndexTableOffset.
   // GUID                           GuidTable[];             // GUID for DynamicEx and HII PCD variable Guid. It can be accessed by the GuidTableOffset.
   // STRING_HEAD                    StringHead[];            // String PCD
   // PCD_NAME_INDEX                 PcdNameTable[];          // PCD name index info. It can be accessed by the PcdNameTableOffset.
@@ -77,6 +77,10 @@ typedef struct {
 // The payload for this function is SMM_VARIABLE_COMMUNICATE_GET_RUNTIME_CACHE_INFO
 //
 #define SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO  14
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_SET_VARIABLES.
+//
+#define SMM_VARIABLE_FUNCTION_SET_VARIABLES  15
 
 ///
 /// Size of SMM communicate header, without including the payload.
@@ -131,13 +135,61 @@ typedef struct {
   UINTN    VariablePayloadSize;
 } SMM_VARIABLE_COMMUNICATE_GET_PAYLOAD_SIZE;
 
+///
+/// Size of the log of the runtime cache updates, including its header.
+///
+#define SMM_VARIABLE_RUNTIME_CACHE_LOG_SIZE  SIZE_64KB
+
+///
+/// This structure is the header of the log of the runtime cache updates. SMM
+/// appends the updates of its variable stores to the log, with their data, and
+/// the SMM variable wrapper module applies them to its runtime caches before it
+/// reads them. The records follow the header, each record is aligned on a UINT64
+/// boundary.
+///
+typedef struct {
+  ///
+  /// Size of the log, including this header.
+  ///
+  UINT32     Size;
+  ///
+  /// Size of the records. It is reset by the SMM variable wrapper module when it
+  /// has applied them.
+  ///
+  UINT32     UsedSize;
+  ///
+  /// Some updates did not fit in the log. The SMM variable wrapper module must
+  /// apply the log, then request SMM_VARIABLE_FUNCTION_SYNC_RUNTIME_CACHE.
+  ///
+  BOOLEAN    Incomplete;
+} SMM_VARIABLE_RUNTIME_CACHE_LOG;
+
+typedef struct {
+  UINT32    StoreType;  // 0: Volatile, 1: HOB, 2: Non-Volatile
+  UINT32    Offset;     // Offset of the update in the runtime cache
+  UINT32    Length;     // Length of the data that follows this record
+} SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD;
+
+///
+/// Offset of the first record of SMM_VARIABLE_RUNTIME_CACHE_LOG.
+///
+#define SMM_VARIABLE_RUNTIME_CACHE_LOG_HEADER_SIZE \
+  ALIGN_VALUE (sizeof (SMM_VARIABLE_RUNTIME_CACHE_LOG), sizeof (UINT64))
+
+///
+/// Size of a record of SMM_VARIABLE_RUNTIME_CACHE_LOG.
+///
+#define SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD_SIZE(Length) \
+  ALIGN_VALUE (sizeof (SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD) + (Length), sizeof (UINT64))
+
 typedef struct {
-  BOOLEAN                  *ReadLock;
-  BOOLEAN                  *PendingUpdate;
-  BOOLEAN                  *HobFlushComplete;
-  VARIABLE_STORE_HEADER    *RuntimeHobCache;
-  VARIABLE_STORE_HEADER    *RuntimeNvCache;
-  VARIABLE_STORE_HEADER    *RuntimeVolatileCache;
+  BOOLEAN                           *ReadLock;
+  BOOLEAN                           *PendingUpdate;
+  BOOLEAN                           *HobFlushComplete;
+  VARIABLE_STORE_HEADER             *RuntimeHobCache;
+  VARIABLE_STORE_HEADER             *RuntimeNvCache;
+  VARIABLE_STORE_HEADER             *RuntimeVolatileCache;
+  SMM_VARIABLE_RUNTIME_CACHE_LOG    *RuntimeCacheLog;
 } SMM_VARIABLE_COMMUNICATE_RUNTIME_VARIABLE_CACHE_CONTEXT;
 
 typedef struct {
@@ -147,4 +199,27 @@ typedef struct {
   BOOLEAN    AuthenticatedVariableUsage;
 } SMM_VARIABLE_COMMUNICATE_GET_RUNTIME_CACHE_INFO;
 
+///
+/// This structure is used to communicate with SMI handler by SetVariables. The entries
+/// follow the header, each entry is aligned on a UINT64 boundary.
+///
+typedef struct {
+  UINTN    EntryCount;
+} SMM_VARIABLE_COMMUNICATE_SET_VARIABLES;
+
+typedef struct {
+  EFI_GUID      Guid;
+  UINTN         DataSize;
+  UINTN         NameSize;
+  UINT32        Attributes;
+  EFI_STATUS    Status;     // Return status of the operation
+  CHAR16        Name[1];
+} SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY;
+
+///
+/// Size of an entry of SMM_VARIABLE_COMMUNICATE_SET_VARIABLES.
+///
+#define SMM_VARIABLE_SET_VARIABLES_ENTRY_SIZE(NameSize, DataSize) \
+  ALIGN_VALUE (OFFSET_OF (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY, Name) + (NameSize) + (DataSize), sizeof (UINT64))
+
 #endif // _SMM_VARIABLE_COMMON_H_
@@ -0,0 +1,56 @@
+/** @file
+  The hash index of the non-volatile variable store built by the PEI variable
+  driver, and published as a HOB so that the DXE variable drivers can reuse it.
+
+  The index has one entry for each variable in the VAR_ADDED state, or in the
+  VAR_IN_DELETED_TRANSITION state, found in the store. The entries are sorted
+  by hash, then by offset.
+
+  The hash of a variable is the 32-bit FNV-1a hash of the bytes of its name,
+  including the null terminator, computed with an offset basis of 0x811C9DC5
+  XORed with the first 32 bits of its vendor GUID.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_HASH_INDEX_TABLE_H__
+#define __VARIABLE_HASH_INDEX_TABLE_H__
+
+#define EDKII_VARIABLE_HASH_INDEX_TABLE_GUID \
+  { 0x3c1d9a57, 0x6e2b, 0x4b8f, { 0xa4, 0x0d, 0x97, 0x2e, 0x1f, 0x68, 0xc5, 0x3b } }
+
+extern EFI_GUID  gEdkiiVariableHashIndexTableGuid;
+
+#define VARIABLE_HASH_INDEX_FNV_BASIS  0x811C9DC5
+#define VARIABLE_HASH_INDEX_FNV_PRIME  0x01000193
+
+typedef struct {
+  UINT32    Hash;
+  ///
+  /// Offset of the variable header from the variable store header.
+  ///
+  UINT32    Offset;
+} VARIABLE_HASH_INDEX_ENTRY;
+
+typedef struct {
+  ///
+  /// Address of the variable store header in the non-volatile storage.
+  ///
+  EFI_PHYSICAL_ADDRESS         StoreBase;
+  UINT32                       StoreSize;
+  ///
+  /// Offset of the end of the last variable in the store, where new
+  /// variables are added.
+  ///
+  UINT32                       EndOffset;
+  UINT32                       EntryCount;
+  ///
+  /// Non-zero if the store has more variables than the index can hold. The
+  /// index is then empty, and the store must be searched linearly.
+  ///
+  UINT32                       Overflow;
+  VARIABLE_HASH_INDEX_ENTRY    Entry[0];
+} VARIABLE_HASH_INDEX_TABLE;
+
+#endif // __VARIABLE_HASH_INDEX_TABLE_H__
@@ -0,0 +1,87 @@
+/** @file
+  Variable Batch Protocol is related to EDK II-specific implementation of variables
+  and intended for use as a means to set many variables with a single update of
+  the non-volatile variable storage.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_BATCH_H__
+#define __VARIABLE_BATCH_H__
+
+#define EDKII_VARIABLE_BATCH_PROTOCOL_GUID \
+  { \
+    0x66ce9683, 0x96e0, 0x46b4, { 0xa2, 0x7f, 0x13, 0xef, 0xde, 0xdc, 0x72, 0x54 } \
+  }
+
+typedef struct _EDKII_VARIABLE_BATCH_PROTOCOL EDKII_VARIABLE_BATCH_PROTOCOL;
+
+///
+/// One SetVariable operation of a batch. The fields have the same meaning as the
+/// parameters of the SetVariable() runtime service.
+///
+typedef struct {
+  CHAR16        *VariableName;
+  EFI_GUID      *VendorGuid;
+  UINT32        Attributes;
+  UINTN         DataSize;
+  VOID          *Data;
+  ///
+  /// On output, the status SetVariable() would have returned for this operation.
+  ///
+  EFI_STATUS    Status;
+} EDKII_VARIABLE_BATCH_ENTRY;
+
+/**
+  Set a batch of variables.
+
+  The operations are processed in order, each one with the checks of SetVariable(),
+  including authentication and the variable check handlers. An operation that
+  fails its checks does not modify any variable and its status is reported in the
+  Status field of its entry. The non-volatile variables set by the other operations
+  are written to the storage at once, with at most one fault tolerant write.
+
+  When the variables are set in SMM, the whole batch is sent to SMM at once. A
+  batch that does not fit in the SMM communicate buffer is not processed, and
+  EFI_BAD_BUFFER_SIZE is returned.
+
+  @param[in]      This          The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      EntryCount    Number of entries in Entries.
+  @param[in, out] Entries       The SetVariable operations to process.
+
+  @retval EFI_SUCCESS           All the operations were processed, the Status field of
+                                each entry reports the result of the operation.
+  @retval EFI_INVALID_PARAMETER EntryCount is 0, or Entries is NULL.
+  @retval EFI_BAD_BUFFER_SIZE   The batch is too large to be processed at once.
+                                None of the operations was processed.
+  @retval EFI_UNSUPPORTED       ExitBootServices() has already been called.
+  @retval EFI_NOT_AVAILABLE_YET The variable write service is not ready yet.
+  @retval EFI_DEVICE_ERROR      The non-volatile variable storage could not be updated.
+                                None of the non-volatile variables was set, and the Status
+                                field of the entries that would have set one is
+                                EFI_DEVICE_ERROR.
+  @return Others                The batch could not be processed. The Status field of
+                                the entries that were not processed is the returned
+                                error.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_VARIABLE_BATCH_SET_VARIABLES)(
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL  *This,
+  IN       UINTN                          EntryCount,
+  IN OUT   EDKII_VARIABLE_BATCH_ENTRY     *Entries
+  );
+
+///
+/// Variable Batch Protocol is related to EDK II-specific implementation of variables
+/// and intended for use as a means to set many variables with a single update of
+/// the non-volatile variable storage.
+///
+struct _EDKII_VARIABLE_BATCH_PROTOCOL {
+  EDKII_VARIABLE_BATCH_SET_VARIABLES    SetVariables;
+};
+
+extern EFI_GUID  gEdkiiVariableBatchProtocolGuid;
+
+#endif
@@ -0,0 +1,26 @@
+/** @file
+  Decode the blocks of a chunked LZMA section on the calling processor only.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "LzmaDecompressLibInternal.h"
+
+/**
+  Run Procedure on every processor that can help decoding the blocks of a
+  chunked LZMA section, including the calling processor. Return once every
+  processor has returned from Procedure.
+
+  @param  Procedure   The block decoder to run.
+  @param  Context     The LZMA_CHUNKED_CONTEXT passed to Procedure.
+
+**/
+VOID
+InternalLzmaChunkedStartWorkers (
+  IN EFI_AP_PROCEDURE      Procedure,
+  IN LZMA_CHUNKED_CONTEXT  *Context
+  )
+{
+  Procedure (Context);
+}
@@ -0,0 +1,105 @@
+/** @file
+  Decode the blocks of a chunked LZMA section on all processors in DXE.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include "LzmaDecompressLibInternal.h"
+#include <Protocol/MpService.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+/**
+  Run Procedure on every processor that can help decoding the blocks of a
+  chunked LZMA section, including the calling processor. Return once every
+  processor has returned from Procedure.
+
+  @param  Procedure   The block decoder to run.
+  @param  Context     The LZMA_CHUNKED_CONTEXT passed to Procedure.
+
+**/
+VOID
+InternalLzmaChunkedStartWorkers (
+  IN EFI_AP_PROCEDURE      Procedure,
+  IN LZMA_CHUNKED_CONTEXT  *Context
+  )
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpServices;
+  UINTN                     NumberOfProcessors;
+  UINTN                     NumberOfEnabledProcessors;
+  EFI_TPL                   OldTpl;
+  EFI_EVENT                 WaitEvent;
+
+  //
+  // The application processors are only used when the MP Services protocol
+  // has been installed. Errors such as EFI_NOT_READY when the application
+  // processors are busy leave all the blocks to the calling processor.
+  //
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **)&MpServices);
+  if (!EFI_ERROR (Status)) {
+    Status = MpServices->GetNumberOfProcessors (MpServices, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  }
+
+  if (EFI_ERROR (Status) || (NumberOfEnabledProcessors < 2)) {
+    Procedure (Context);
+    return;
+  }
+
+  //
+  // The MP Services signal the end of a non-blocking request from a timer
+  // event at TPL_NOTIFY, so it can only be waited for below that level.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  gBS->RestoreTPL (OldTpl);
+
+  WaitEvent = NULL;
+  Status    = EFI_UNSUPPORTED;
+  if (OldTpl < TPL_NOTIFY) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &WaitEvent);
+  }
+
+  //
+  // In non-blocking mode StartupAllAPs() returns right away, so that the
+  // calling processor decodes blocks at the same time. It then waits for the
+  // request to complete, so that the application processors are done with
+  // the context on the stack of the caller and are idle for the next request.
+  //
+  if (!EFI_ERROR (Status)) {
+    Status = MpServices->StartupAllAPs (
+                           MpServices,
+                           Procedure,
+                           FALSE,
+                           WaitEvent,
+                           0,
+                           Context,
+                           NULL
+                           );
+    Procedure (Context);
+    if (!EFI_ERROR (Status)) {
+      while (gBS->CheckEvent (WaitEvent) == EFI_NOT_READY) {
+        CpuPause ();
+      }
+    }
+
+    gBS->CloseEvent (WaitEvent);
+    return;
+  }
+
+  //
+  // Non-blocking mode is not supported any more after ReadyToBoot, nor from
+  // TPL_NOTIFY. The application processors then decode the blocks while the
+  // calling processor waits, and it finishes the blocks left over, if any.
+  //
+  MpServices->StartupAllAPs (
+                MpServices,
+                Procedure,
+                FALSE,
+                NULL,
+                0,
+                Context,
+                NULL
+                );
+  Procedure (Context);
+}
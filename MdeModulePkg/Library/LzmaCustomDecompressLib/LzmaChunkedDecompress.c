@@ -0,0 +1,313 @@
+/** @file
+  Chunked LZMA GUIDed Section Extraction.
+
+  The data of a chunked LZMA section is split into blocks that are compressed
+  independently, so that the blocks can be decoded on several processors at
+  the same time. See LZMA_CHUNKED_HEADER for the layout.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "LzmaDecompressLibInternal.h"
+
+//
+// Size of the header at the beginning of every LZMA stream
+//
+#define LZMA_STREAM_HEADER_SIZE  (5 + 8)
+
+/**
+  Locate the data of a chunked LZMA GUIDed section and check its index.
+
+  @param[in]  InputSection       A pointer to a GUIDed section of an FFS formatted file.
+  @param[out] Context            The header, the block index and the blocks of the section.
+  @param[out] BlockOffset        The array that receives the offset of every block. Optional.
+  @param[out] ScratchSize        The size of the scratch buffer of a single block decoder.
+  @param[out] SectionAttribute   The attributes of the GUIDed section. Optional.
+
+  @retval  RETURN_SUCCESS            The section is a valid chunked LZMA section.
+  @retval  RETURN_INVALID_PARAMETER  The section is not a valid chunked LZMA section.
+
+**/
+RETURN_STATUS
+LzmaChunkedParseSection (
+  IN  CONST VOID            *InputSection,
+  OUT LZMA_CHUNKED_CONTEXT  *Context,
+  OUT UINT32                *BlockOffset  OPTIONAL,
+  OUT UINT32                *ScratchSize,
+  OUT UINT16                *SectionAttribute  OPTIONAL
+  )
+{
+  RETURN_STATUS               Status;
+  CONST EFI_GUID              *SectionDefinitionGuid;
+  CONST UINT8                 *Data;
+  UINT32                      DataSize;
+  UINT16                      Attributes;
+  CONST LZMA_CHUNKED_HEADER   *Header;
+  UINT64                      BlocksSize;
+  UINT32                      Index;
+  UINT32                      ExpectedSize;
+  UINT32                      DecodedSize;
+  UINT32                      BlockScratchSize;
+
+  if (IS_SECTION2 (InputSection)) {
+    SectionDefinitionGuid = &((EFI_GUID_DEFINED_SECTION2 *)InputSection)->SectionDefinitionGuid;
+    Attributes            = ((EFI_GUID_DEFINED_SECTION2 *)InputSection)->Attributes;
+    Data                  = (UINT8 *)InputSection + ((EFI_GUID_DEFINED_SECTION2 *)InputSection)->DataOffset;
+    DataSize              = SECTION2_SIZE (InputSection) - ((EFI_GUID_DEFINED_SECTION2 *)InputSection)->DataOffset;
+  } else {
+    SectionDefinitionGuid = &((EFI_GUID_DEFINED_SECTION *)InputSection)->SectionDefinitionGuid;
+    Attributes            = ((EFI_GUID_DEFINED_SECTION *)InputSection)->Attributes;
+    Data                  = (UINT8 *)InputSection + ((EFI_GUID_DEFINED_SECTION *)InputSection)->DataOffset;
+    DataSize              = SECTION_SIZE (InputSection) - ((EFI_GUID_DEFINED_SECTION *)InputSection)->DataOffset;
+  }
+
+  if (!CompareGuid (&gLzmaChunkedCustomDecompressGuid, SectionDefinitionGuid)) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  if (SectionAttribute != NULL) {
+    *SectionAttribute = Attributes;
+  }
+
+  //
+  // Check the header and that the block index fits in the section
+  //
+  Header = (CONST LZMA_CHUNKED_HEADER *)Data;
+  if ((DataSize < sizeof (LZMA_CHUNKED_HEADER)) ||
+      (ReadUnaligned32 (&Header->Signature) != LZMA_CHUNKED_SIGNATURE))
+  {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  if ((Header->BlockCount > (DataSize - sizeof (LZMA_CHUNKED_HEADER)) / sizeof (UINT32)) ||
+      ((Header->BlockCount == 0) != (Header->UncompressedSize == 0)) ||
+      ((Header->BlockCount != 0) && (Header->BlockSize == 0)))
+  {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  if ((Header->BlockCount != 0) &&
+      (Header->BlockCount != DivU64x32 ((UINT64)Header->UncompressedSize + Header->BlockSize - 1, Header->BlockSize)))
+  {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  Context->Header         = Header;
+  Context->CompressedSize = (CONST UINT32 *)(Header + 1);
+  Context->Blocks         = (CONST UINT8 *)(Context->CompressedSize + Header->BlockCount);
+  Context->BlockOffset    = BlockOffset;
+  DataSize               -= (UINT32)((UINTN)Context->Blocks - (UINTN)Data);
+
+  //
+  // Every block must lie in the section and decode to its share of the data
+  //
+  *ScratchSize = 0;
+  BlocksSize   = 0;
+  for (Index = 0; Index < Header->BlockCount; Index++) {
+    if ((ReadUnaligned32 (&Context->CompressedSize[Index]) < LZMA_STREAM_HEADER_SIZE) ||
+        (BlocksSize + ReadUnaligned32 (&Context->CompressedSize[Index]) > DataSize))
+    {
+      return RETURN_INVALID_PARAMETER;
+    }
+
+    Status = LzmaUefiDecompressGetInfo (
+               Context->Blocks + BlocksSize,
+               ReadUnaligned32 (&Context->CompressedSize[Index]),
+               &DecodedSize,
+               &BlockScratchSize
+               );
+    if (RETURN_ERROR (Status)) {
+      return RETURN_INVALID_PARAMETER;
+    }
+
+    if (Index == Header->BlockCount - 1) {
+      ExpectedSize = Header->UncompressedSize - Index * Header->BlockSize;
+    } else {
+      ExpectedSize = Header->BlockSize;
+    }
+
+    if (DecodedSize != ExpectedSize) {
+      return RETURN_INVALID_PARAMETER;
+    }
+
+    if (BlockOffset != NULL) {
+      BlockOffset[Index] = (UINT32)BlocksSize;
+    }
+
+    *ScratchSize = MAX (*ScratchSize, BlockScratchSize);
+    BlocksSize  += ReadUnaligned32 (&Context->CompressedSize[Index]);
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Decode blocks of a chunked LZMA section until there is none left.
+
+  This runs on every processor taking part in the decoding, so it must not
+  use any service that is not safe to call from an application processor.
+
+  @param[in, out]  Buffer   The LZMA_CHUNKED_CONTEXT of the section.
+
+**/
+VOID
+EFIAPI
+LzmaChunkedDecodeBlocks (
+  IN OUT VOID  *Buffer
+  )
+{
+  LZMA_CHUNKED_CONTEXT  *Context;
+  UINT32                Worker;
+  UINT32                Block;
+  RETURN_STATUS         Status;
+
+  Context = (LZMA_CHUNKED_CONTEXT *)Buffer;
+
+  //
+  // Claim a scratch buffer. Processors beyond the number of scratch buffers
+  // have nothing to do.
+  //
+  Worker = InterlockedIncrement (&Context->NextWorker) - 1;
+  if (Worker < Context->WorkerCount) {
+    for ( ; ;) {
+      Block = InterlockedIncrement (&Context->NextBlock) - 1;
+      if ((Block >= Context->Header->BlockCount) || RETURN_ERROR (Context->Status)) {
+        break;
+      }
+
+      Status = LzmaUefiDecompress (
+                 Context->Blocks + Context->BlockOffset[Block],
+                 ReadUnaligned32 (&Context->CompressedSize[Block]),
+                 Context->Destination + (UINTN)Block * Context->Header->BlockSize,
+                 Context->Scratch + (UINTN)Worker * Context->ScratchSize
+                 );
+      if (RETURN_ERROR (Status)) {
+        Context->Status = Status;
+      }
+    }
+  }
+}
+
+/**
+  Examines a chunked LZMA GUIDed section and returns the size of the decoded
+  buffer and the size of the scratch buffer required to decode it.
+
+  @param[in]  InputSection       A pointer to a GUIDed section of an FFS formatted file.
+  @param[out] OutputBufferSize   A pointer to the size, in bytes, of an output buffer required
+                                 if the buffer specified by InputSection were decoded.
+  @param[out] ScratchBufferSize  A pointer to the size, in bytes, required as scratch space
+                                 if the buffer specified by InputSection were decoded.
+  @param[out] SectionAttribute   A pointer to the attributes of the GUIDed section.
+
+  @retval  RETURN_SUCCESS            The information about InputSection was returned.
+  @retval  RETURN_INVALID_PARAMETER  The information can not be retrieved from the section specified by InputSection.
+
+**/
+RETURN_STATUS
+EFIAPI
+LzmaChunkedGuidedSectionGetInfo (
+  IN  CONST VOID  *InputSection,
+  OUT UINT32      *OutputBufferSize,
+  OUT UINT32      *ScratchBufferSize,
+  OUT UINT16      *SectionAttribute
+  )
+{
+  RETURN_STATUS         Status;
+  LZMA_CHUNKED_CONTEXT  Context;
+  UINT32                ScratchSize;
+  UINT64                TotalScratchSize;
+
+  ASSERT (InputSection != NULL);
+  ASSERT (OutputBufferSize != NULL);
+  ASSERT (ScratchBufferSize != NULL);
+  ASSERT (SectionAttribute != NULL);
+
+  Status = LzmaChunkedParseSection (InputSection, &Context, NULL, &ScratchSize, SectionAttribute);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // The scratch buffer holds the block offsets, followed by the scratch
+  // buffers of the block decoders
+  //
+  TotalScratchSize = LZMA_CHUNKED_OFFSETS_SIZE (Context.Header->BlockCount) +
+                     MultU64x32 (ScratchSize, MIN (Context.Header->BlockCount, LZMA_CHUNKED_MAX_WORKERS));
+  if (TotalScratchSize > MAX_UINT32) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  *OutputBufferSize  = Context.Header->UncompressedSize;
+  *ScratchBufferSize = (UINT32)TotalScratchSize;
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Decompress a chunked LZMA GUIDed section into a caller allocated output buffer.
+
+  @param[in]  InputSection  A pointer to a GUIDed section of an FFS formatted file.
+  @param[out] OutputBuffer  A pointer to a buffer that contains the result of a decode operation.
+  @param[out] ScratchBuffer A caller allocated buffer used as scratch buffer by the block decoders.
+  @param[out] AuthenticationStatus
+                            A pointer to the authentication status of the decoded output buffer.
+
+  @retval  RETURN_SUCCESS            The buffer specified by InputSection was decoded.
+  @retval  RETURN_INVALID_PARAMETER  The section specified by InputSection can not be decoded.
+
+**/
+RETURN_STATUS
+EFIAPI
+LzmaChunkedGuidedSectionExtraction (
+  IN CONST  VOID    *InputSection,
+  OUT       VOID    **OutputBuffer,
+  OUT       VOID    *ScratchBuffer         OPTIONAL,
+  OUT       UINT32  *AuthenticationStatus
+  )
+{
+  RETURN_STATUS         Status;
+  LZMA_CHUNKED_CONTEXT  Context;
+
+  ASSERT (OutputBuffer != NULL);
+  ASSERT (InputSection != NULL);
+
+  //
+  // The scratch buffer was sized by LzmaChunkedGuidedSectionGetInfo() for
+  // the same section, so it has room for the offsets of all the blocks
+  //
+  Status = LzmaChunkedParseSection (InputSection, &Context, ScratchBuffer, &Context.ScratchSize, NULL);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Authentication is set to Zero, which may be ignored.
+  //
+  *AuthenticationStatus = 0;
+
+  if (Context.Header->BlockCount == 0) {
+    return RETURN_SUCCESS;
+  }
+
+  ASSERT (ScratchBuffer != NULL);
+
+  Context.Destination = *OutputBuffer;
+  Context.Scratch     = (UINT8 *)ScratchBuffer + LZMA_CHUNKED_OFFSETS_SIZE (Context.Header->BlockCount);
+  Context.WorkerCount = MIN (Context.Header->BlockCount, LZMA_CHUNKED_MAX_WORKERS);
+  Context.NextWorker  = 0;
+  Context.NextBlock   = 0;
+  Context.Status      = RETURN_SUCCESS;
+
+  InternalLzmaChunkedStartWorkers (LzmaChunkedDecodeBlocks, &Context);
+
+  //
+  // The calling processor runs the decoder as well, so every block has been
+  // claimed. Make sure they were all decoded.
+  //
+  if (Context.NextBlock < Context.Header->BlockCount) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  return Context.Status;
+}
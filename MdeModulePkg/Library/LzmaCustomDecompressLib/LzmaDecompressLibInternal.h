@@ -15,8 +15,40 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/ExtractGuidedSectionLib.h>
+#include <Library/SynchronizationLib.h>
 #include <Guid/LzmaDecompress.h>
 
+///
+/// Maximum number of blocks of a chunked LZMA section that are decoded at the
+/// same time. Every concurrent decoder needs its own scratch buffer.
+///
+#define LZMA_CHUNKED_MAX_WORKERS  16
+
+///
+/// Size of the block offsets kept at the beginning of the scratch buffer
+///
+#define LZMA_CHUNKED_OFFSETS_SIZE(BlockCount)  ALIGN_VALUE ((UINTN)(BlockCount) * sizeof (UINT32), 8)
+
+///
+/// State shared by the processors decoding the blocks of a chunked LZMA section.
+///
+typedef struct {
+  CONST LZMA_CHUNKED_HEADER    *Header;
+  CONST UINT32                 *CompressedSize;
+  CONST UINT8                  *Blocks;
+  ///
+  /// Offset of every block from Blocks, computed when the index is checked
+  ///
+  UINT32                       *BlockOffset;
+  UINT8                        *Destination;
+  UINT8                        *Scratch;
+  UINT32                       ScratchSize;
+  UINT32                       WorkerCount;
+  volatile UINT32              NextWorker;
+  volatile UINT32              NextBlock;
+  volatile RETURN_STATUS       Status;
+} LZMA_CHUNKED_CONTEXT;
+
 /**
   Given a Lzma compressed source buffer, this function retrieves the size of
   the uncompressed buffer and the size of the scratch buffer required
@@ -91,4 +123,65 @@ LzmaUefiDecompress (
   IN OUT VOID    *Scratch
   );
 
+/**
+  Run Procedure on every processor that can help decoding the blocks of a
+  chunked LZMA section, including the calling processor. Return once every
+  processor has returned from Procedure.
+
+  @param  Procedure   The block decoder to run.
+  @param  Context     The LZMA_CHUNKED_CONTEXT passed to Procedure.
+
+**/
+VOID
+InternalLzmaChunkedStartWorkers (
+  IN EFI_AP_PROCEDURE      Procedure,
+  IN LZMA_CHUNKED_CONTEXT  *Context
+  );
+
+/**
+  Examines a chunked LZMA GUIDed section and returns the size of the decoded
+  buffer and the size of the scratch buffer required to decode it.
+
+  @param[in]  InputSection       A pointer to a GUIDed section of an FFS formatted file.
+  @param[out] OutputBufferSize   A pointer to the size, in bytes, of an output buffer required
+                                 if the buffer specified by InputSection were decoded.
+  @param[out] ScratchBufferSize  A pointer to the size, in bytes, required as scratch space
+                                 if the buffer specified by InputSection were decoded.
+  @param[out] SectionAttribute   A pointer to the attributes of the GUIDed section.
+
+  @retval  RETURN_SUCCESS            The information about InputSection was returned.
+  @retval  RETURN_INVALID_PARAMETER  The information can not be retrieved from the section specified by InputSection.
+
+**/
+RETURN_STATUS
+EFIAPI
+LzmaChunkedGuidedSectionGetInfo (
+  IN  CONST VOID  *InputSection,
+  OUT UINT32      *OutputBufferSize,
+  OUT UINT32      *ScratchBufferSize,
+  OUT UINT16      *SectionAttribute
+  );
+
+/**
+  Decompress a chunked LZMA GUIDed section into a caller allocated output buffer.
+
+  @param[in]  InputSection  A pointer to a GUIDed section of an FFS formatted file.
+  @param[out] OutputBuffer  A pointer to a buffer that contains the result of a decode operation.
+  @param[out] ScratchBuffer A caller allocated buffer used as scratch buffer by the block decoders.
+  @param[out] AuthenticationStatus
+                            A pointer to the authentication status of the decoded output buffer.
+
+  @retval  RETURN_SUCCESS            The buffer specified by InputSection was decoded.
+  @retval  RETURN_INVALID_PARAMETER  The section specified by InputSection can not be decoded.
+
+**/
+RETURN_STATUS
+EFIAPI
+LzmaChunkedGuidedSectionExtraction (
+  IN CONST  VOID    *InputSection,
+  OUT       VOID    **OutputBuffer,
+  OUT       VOID    *ScratchBuffer         OPTIONAL,
+  OUT       UINT32  *AuthenticationStatus
+  );
+
 #endif
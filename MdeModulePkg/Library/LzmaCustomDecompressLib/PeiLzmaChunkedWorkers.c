@@ -0,0 +1,68 @@
+/** @file
+  Decode the blocks of a chunked LZMA section on all processors in PEI.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "LzmaDecompressLibInternal.h"
+#include <Ppi/MpServices.h>
+#include <Ppi/MpServices2.h>
+#include <Library/PeiServicesLib.h>
+#include <Library/PeiServicesTablePointerLib.h>
+
+/**
+  Run Procedure on every processor that can help decoding the blocks of a
+  chunked LZMA section, including the calling processor. Return once every
+  processor has returned from Procedure.
+
+  @param  Procedure   The block decoder to run.
+  @param  Context     The LZMA_CHUNKED_CONTEXT passed to Procedure.
+
+**/
+VOID
+InternalLzmaChunkedStartWorkers (
+  IN EFI_AP_PROCEDURE      Procedure,
+  IN LZMA_CHUNKED_CONTEXT  *Context
+  )
+{
+  EFI_STATUS                  Status;
+  EDKII_PEI_MP_SERVICES2_PPI  *MpServices2;
+  EFI_PEI_MP_SERVICES_PPI     *MpServices;
+
+  //
+  // StartupAllCPUs() of the EDKII MP Services 2 PPI runs Procedure on the
+  // calling processor while the application processors run it, and returns
+  // once they are all done. Errors such as EFI_NOT_READY when application
+  // processors are busy leave all the blocks to the calling processor.
+  //
+  Status = PeiServicesLocatePpi (&gEdkiiPeiMpServices2PpiGuid, 0, NULL, (VOID **)&MpServices2);
+  if (!EFI_ERROR (Status)) {
+    Status = MpServices2->StartupAllCPUs (MpServices2, Procedure, 0, Context);
+    if (EFI_ERROR (Status)) {
+      Procedure (Context);
+    }
+
+    return;
+  }
+
+  //
+  // StartupAllAPs() of the PI MP Services PPI only has a blocking mode, so
+  // the calling processor finishes the blocks left over, if any, once it
+  // returns. Errors such as EFI_NOT_STARTED when there is no enabled
+  // application processor leave all the blocks to the calling processor.
+  //
+  Status = PeiServicesLocatePpi (&gEfiPeiMpServicesPpiGuid, 0, NULL, (VOID **)&MpServices);
+  if (!EFI_ERROR (Status)) {
+    MpServices->StartupAllAPs (
+                  GetPeiServicesTablePointer (),
+                  MpServices,
+                  Procedure,
+                  FALSE,
+                  0,
+                  Context
+                  );
+  }
+
+  Procedure (Context);
+}
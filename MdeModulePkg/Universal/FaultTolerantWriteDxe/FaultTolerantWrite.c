@@ -529,14 +529,21 @@ FtwWrite (
   //
   // Write the memory buffer to spare block
   // Do not assume Spare Block and Target Block have same block size
+  // The spare block does not need to be erased again if the previous write
+  // of this boot left it erased. A spare block that only reads as erased may
+  // come from an interrupted erase, so it is still erased after a reset.
   //
-  Status = FtwEraseSpareBlock (FtwDevice);
-  if (EFI_ERROR (Status)) {
-    FreePool (MyBuffer);
-    FreePool (SpareBuffer);
-    return EFI_ABORTED;
+  if (!FtwDevice->SpareErased || !IsErasedFlashBuffer (SpareBuffer, SpareBufferSize)) {
+    Status = FtwEraseSpareBlock (FtwDevice);
+    if (EFI_ERROR (Status)) {
+      FreePool (MyBuffer);
+      FreePool (SpareBuffer);
+      return EFI_ABORTED;
+    }
   }
 
+  FtwDevice->SpareErased = FALSE;
+
   Ptr = MyBuffer;
   for (Index = 0; MyBufferSize > 0; Index += 1) {
     if (MyBufferSize > FtwDevice->SpareBlockSize) {
@@ -604,16 +611,24 @@ FtwWrite (
     return EFI_ABORTED;
   }
 
+  //
+  // Erased spare blocks are already restored by the erase.
+  //
   Ptr = SpareBuffer;
   for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
     MyLength = FtwDevice->SpareBlockSize;
-    Status   = FtwDevice->FtwBackupFvb->Write (
-                                          FtwDevice->FtwBackupFvb,
-                                          FtwDevice->FtwSpareLba + Index,
-                                          0,
-                                          &MyLength,
-                                          Ptr
-                                          );
+    if (IsErasedFlashBuffer (Ptr, MyLength)) {
+      Ptr += MyLength;
+      continue;
+    }
+
+    Status = FtwDevice->FtwBackupFvb->Write (
+                                        FtwDevice->FtwBackupFvb,
+                                        FtwDevice->FtwSpareLba + Index,
+                                        0,
+                                        &MyLength,
+                                        Ptr
+                                        );
     if (EFI_ERROR (Status)) {
       FreePool (SpareBuffer);
       return EFI_ABORTED;
@@ -625,6 +640,7 @@ FtwWrite (
   //
   // All success.
   //
+  FtwDevice->SpareErased = IsErasedFlashBuffer (SpareBuffer, SpareBufferSize);
   FreePool (SpareBuffer);
 
   DEBUG (
@@ -731,6 +747,8 @@ FtwRestart (
     return EFI_ABORTED;
   }
 
+  FtwDevice->SpareErased = TRUE;
+
   DEBUG ((DEBUG_INFO, "%a(): success\n", __FUNCTION__));
   return EFI_SUCCESS;
 }
@@ -78,6 +78,7 @@ typedef struct {
   EFI_LBA                                    FtwWorkSpaceLbaInSpare;  // Start LBA of working space in spare block.
   UINTN                                      FtwWorkSpaceBaseInSpare; // Offset into the FtwWorkSpaceLbaInSpare block.
   UINT8                                      *FtwWorkSpace;           // Point to Work Space in memory buffer
+  BOOLEAN                                    SpareErased;             // Spare block is erased by an erase completed in this boot.
   //
   // Following a buffer of FtwWorkSpace[FTW_WORK_SPACE_SIZE],
   // Allocated with EFI_FTW_DEVICE.
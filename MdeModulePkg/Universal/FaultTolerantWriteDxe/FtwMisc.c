@@ -92,6 +92,12 @@ FtwEraseSpareBlock (
   IN EFI_FTW_DEVICE  *FtwDevice
   )
 {
+  //
+  // The spare block is programmed after it is erased, or is partially erased
+  // if the erase fails.
+  //
+  FtwDevice->SpareErased = FALSE;
+
   return FtwDevice->FtwBackupFvb->EraseBlocks (
                                     FtwDevice->FtwBackupFvb,
                                     FtwDevice->FtwSpareLba,
@@ -1292,9 +1298,11 @@ InitFtwProtocol (
 
   //
   // Refresh the working space data from working block
+  // It fails for a full work space that is not valid, which is recovered
+  // from the spare block below.
   //
   Status = WorkSpaceRefresh (FtwDevice);
-  ASSERT_EFI_ERROR (Status);
+  ASSERT (!EFI_ERROR (Status) || !IsValidWorkSpace (FtwDevice->FtwWorkSpaceHeader));
   //
   // If the working block workspace is not valid, try the spare block
   //
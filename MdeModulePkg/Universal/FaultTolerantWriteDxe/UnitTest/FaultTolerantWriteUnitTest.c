@@ -0,0 +1,811 @@
+/** @file
+  This is a host-based unit test for the fault tolerant write.
+
+  The FTW driver runs on a flash device emulated in memory. The device can
+  lose power at any write or erase operation: the interrupted operation only
+  changes a part of its range, and every later write or erase fails until the
+  driver is started again. The tests check that a write interrupted at any
+  operation leaves the target block with either the old or the new data once
+  the driver recovers, and that an erased spare block is not erased twice.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../FaultTolerantWrite.h"
+
+#define UNIT_TEST_NAME     "Fault Tolerant Write Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+//
+// Layout of the test flash device:
+//   LBA 0-1   Target blocks of the test writes.
+//   LBA 2-3   Working block. The work space is at the end of LBA 3, the rest
+//             of the working block holds data that the FTW must keep.
+//   LBA 4-5   Spare blocks.
+//
+#define TEST_BLOCK_SIZE         0x1000
+#define TEST_BLOCK_COUNT        6
+#define TEST_FLASH_BASE         0xFFF00000
+#define TEST_FLASH_SIZE         (TEST_BLOCK_COUNT * TEST_BLOCK_SIZE)
+#define TEST_TARGET_SIZE        (2 * TEST_BLOCK_SIZE)
+#define TEST_DATA_OFFSET        (2 * TEST_BLOCK_SIZE)
+#define TEST_WORK_SPACE_OFFSET  (4 * TEST_BLOCK_SIZE - TEST_WORK_SPACE_SIZE)
+#define TEST_WORK_SPACE_SIZE    0x200
+#define TEST_SPARE_LBA          4
+#define TEST_SPARE_OFFSET       (TEST_SPARE_LBA * TEST_BLOCK_SIZE)
+#define TEST_SPARE_SIZE         (2 * TEST_BLOCK_SIZE)
+
+//
+// Each test write updates a range of both target blocks. The work space
+// holds a few writes only, so a sequence of test writes reclaims it.
+//
+#define TEST_WRITE_OFFSET  0x400
+#define TEST_WRITE_LENGTH  0x1800
+#define TEST_WRITE_COUNT   12
+
+/// === TEST DATA ==================================================================================
+
+UINT8  mFlash[TEST_FLASH_SIZE];
+UINT8  mFormattedFlash[TEST_FLASH_SIZE];
+UINT8  mWriteData[TEST_WRITE_COUNT + 1][TEST_WRITE_LENGTH];
+UINT8  mTargetImage[TEST_WRITE_COUNT + 1][TEST_TARGET_SIZE];
+
+//
+// Write and erase operations since the count was reset, and the operation
+// that loses power. Erases of the spare blocks are counted separately.
+//
+UINTN    mFlashOperationCount;
+UINTN    mPowerLossOperation;
+BOOLEAN  mPowerLost;
+UINTN    mSpareEraseCount;
+
+EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  mTestFvb;
+EFI_FTW_DEVICE                      *mFtwDevice;
+
+/// === HELPER FUNCTIONS ===========================================================================
+
+/**
+  Check if the next write or erase of the test flash is interrupted.
+
+  @retval TRUE    The operation loses power. It only changes a part of its
+                  range, and the later operations fail.
+  @retval FALSE   The operation completes.
+
+**/
+BOOLEAN
+IsPowerLost (
+  VOID
+  )
+{
+  if (mFlashOperationCount++ == mPowerLossOperation) {
+    mPowerLost = TRUE;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/**
+  Retrieves the attributes of the test flash.
+
+  @param[in]  This        The FVB protocol instance.
+  @param[out] Attributes  The attributes of the flash.
+
+  @retval EFI_SUCCESS   The attributes were returned.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbGetAttributes (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  OUT EFI_FVB_ATTRIBUTES_2                     *Attributes
+  )
+{
+  *Attributes = EFI_FVB2_READ_STATUS | EFI_FVB2_WRITE_STATUS | EFI_FVB2_ERASE_POLARITY;
+  return EFI_SUCCESS;
+}
+
+/**
+  Sets the attributes of the test flash.
+
+  @param[in]      This        The FVB protocol instance.
+  @param[in, out] Attributes  The attributes to set.
+
+  @retval EFI_UNSUPPORTED   The attributes of the test flash are fixed.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbSetAttributes (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN OUT EFI_FVB_ATTRIBUTES_2                  *Attributes
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  Retrieves the base address of the test flash.
+
+  @param[in]  This      The FVB protocol instance.
+  @param[out] Address   The base address of the flash.
+
+  @retval EFI_SUCCESS   The address was returned.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbGetPhysicalAddress (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  OUT EFI_PHYSICAL_ADDRESS                     *Address
+  )
+{
+  *Address = TEST_FLASH_BASE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Retrieves the size of the blocks of the test flash.
+
+  @param[in]  This            The FVB protocol instance.
+  @param[in]  Lba             The first block.
+  @param[out] BlockSize       The size of the block.
+  @param[out] NumberOfBlocks  The number of blocks from Lba to the end of the flash.
+
+  @retval EFI_SUCCESS             The block size was returned.
+  @retval EFI_INVALID_PARAMETER   Lba is not a block of the flash.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbGetBlockSize (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN EFI_LBA                                   Lba,
+  OUT UINTN                                    *BlockSize,
+  OUT UINTN                                    *NumberOfBlocks
+  )
+{
+  if (Lba >= TEST_BLOCK_COUNT) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *BlockSize      = TEST_BLOCK_SIZE;
+  *NumberOfBlocks = TEST_BLOCK_COUNT - (UINTN)Lba;
+  return EFI_SUCCESS;
+}
+
+/**
+  Reads from a block of the test flash.
+
+  @param[in]      This      The FVB protocol instance.
+  @param[in]      Lba       The block to read from.
+  @param[in]      Offset    The offset in the block.
+  @param[in, out] NumBytes  The number of bytes to read.
+  @param[out]     Buffer    The data read.
+
+  @retval EFI_SUCCESS             The data was read.
+  @retval EFI_INVALID_PARAMETER   The range is not in a block of the flash.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbRead (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN EFI_LBA                                   Lba,
+  IN UINTN                                     Offset,
+  IN OUT UINTN                                 *NumBytes,
+  IN OUT UINT8                                 *Buffer
+  )
+{
+  if ((Lba >= TEST_BLOCK_COUNT) || (Offset + *NumBytes > TEST_BLOCK_SIZE)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CopyMem (Buffer, mFlash + (UINTN)Lba * TEST_BLOCK_SIZE + Offset, *NumBytes);
+  return EFI_SUCCESS;
+}
+
+/**
+  Writes to a block of the test flash. Like NOR flash, a write only clears
+  bits, so data written to a block that was not erased is corrupted.
+
+  @param[in]      This      The FVB protocol instance.
+  @param[in]      Lba       The block to write to.
+  @param[in]      Offset    The offset in the block.
+  @param[in, out] NumBytes  The number of bytes to write.
+  @param[in]      Buffer    The data to write.
+
+  @retval EFI_SUCCESS             The data was written.
+  @retval EFI_INVALID_PARAMETER   The range is not in a block of the flash.
+  @retval EFI_DEVICE_ERROR        The flash lost power.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbWrite (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN EFI_LBA                                   Lba,
+  IN UINTN                                     Offset,
+  IN OUT UINTN                                 *NumBytes,
+  IN UINT8                                     *Buffer
+  )
+{
+  UINT8  *Ptr;
+  UINTN  Length;
+  UINTN  Index;
+
+  if ((Lba >= TEST_BLOCK_COUNT) || (Offset + *NumBytes > TEST_BLOCK_SIZE)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mPowerLost) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  Length = *NumBytes;
+  if (IsPowerLost ()) {
+    Length /= 2;
+  }
+
+  Ptr = mFlash + (UINTN)Lba * TEST_BLOCK_SIZE + Offset;
+  for (Index = 0; Index < Length; Index++) {
+    Ptr[Index] &= Buffer[Index];
+  }
+
+  return mPowerLost ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+}
+
+/**
+  Erases blocks of the test flash.
+
+  @param[in] This   The FVB protocol instance.
+  @param[in] ...    The list of the first block and number of blocks of each
+                    range, ended by EFI_LBA_LIST_TERMINATOR.
+
+  @retval EFI_SUCCESS             The blocks were erased.
+  @retval EFI_INVALID_PARAMETER   A range is not in the flash.
+  @retval EFI_DEVICE_ERROR        The flash lost power.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbEraseBlocks (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  ...
+  )
+{
+  VA_LIST  Args;
+  EFI_LBA  Lba;
+  UINTN    NumberOfBlocks;
+  UINTN    Length;
+
+  if (mPowerLost) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  VA_START (Args, This);
+  for (Lba = VA_ARG (Args, EFI_LBA); Lba != EFI_LBA_LIST_TERMINATOR; Lba = VA_ARG (Args, EFI_LBA)) {
+    NumberOfBlocks = VA_ARG (Args, UINTN);
+    if ((Lba >= TEST_BLOCK_COUNT) || (NumberOfBlocks > TEST_BLOCK_COUNT - Lba)) {
+      VA_END (Args);
+      return EFI_INVALID_PARAMETER;
+    }
+
+    if (Lba == TEST_SPARE_LBA) {
+      mSpareEraseCount++;
+    }
+
+    Length = NumberOfBlocks * TEST_BLOCK_SIZE;
+    if (IsPowerLost ()) {
+      Length /= 2;
+    }
+
+    SetMem (mFlash + (UINTN)Lba * TEST_BLOCK_SIZE, Length, FTW_ERASED_BYTE);
+    if (mPowerLost) {
+      break;
+    }
+  }
+
+  VA_END (Args);
+  return mPowerLost ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+}
+
+/**
+  Retrieve the FVB protocol interface by HANDLE.
+
+  @param[in]  FvBlockHandle     The handle of FVB protocol.
+  @param[out] FvBlock           The interface of FVB protocol
+
+  @retval EFI_SUCCESS           The interface of the test flash was returned.
+  @retval EFI_UNSUPPORTED       The handle is not the one of the test flash.
+
+**/
+EFI_STATUS
+FtwGetFvbByHandle (
+  IN  EFI_HANDLE                          FvBlockHandle,
+  OUT EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  **FvBlock
+  )
+{
+  if (FvBlockHandle != (EFI_HANDLE)&mTestFvb) {
+    return EFI_UNSUPPORTED;
+  }
+
+  *FvBlock = &mTestFvb;
+  return EFI_SUCCESS;
+}
+
+/**
+  Retrieve the Swap Address Range protocol interface.
+
+  @param[out] SarProtocol       The interface of SAR protocol
+
+  @retval EFI_NOT_FOUND         The test does not update a boot block.
+
+**/
+EFI_STATUS
+FtwGetSarProtocol (
+  OUT VOID  **SarProtocol
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Return the handle of the test flash in a buffer allocated from pool.
+
+  @param[out]  NumberHandles    The number of handles returned in Buffer.
+  @param[out]  Buffer           The array of handles.
+
+  @retval EFI_SUCCESS           The handle of the test flash was returned.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough pool memory for Buffer.
+
+**/
+EFI_STATUS
+GetFvbCountAndBuffer (
+  OUT UINTN       *NumberHandles,
+  OUT EFI_HANDLE  **Buffer
+  )
+{
+  *Buffer = AllocatePool (sizeof (EFI_HANDLE));
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  (*Buffer)[0]   = (EFI_HANDLE)&mTestFvb;
+  *NumberHandles = 1;
+  return EFI_SUCCESS;
+}
+
+/**
+  Internal implementation of CRC32.
+
+  @param[in]  Buffer       A pointer to the buffer on which the 32-bit CRC is
+                           to be computed.
+  @param[in]  Length       The number of bytes in the buffer Data.
+
+  @retval Crc32            The 32-bit CRC was computed for the data buffer.
+
+**/
+UINT32
+FtwCalculateCrc32 (
+  IN  VOID   *Buffer,
+  IN  UINTN  Length
+  )
+{
+  return CalculateCrc32 (Buffer, Length);
+}
+
+/**
+  Get the FTW working area of the test flash.
+
+  @param[out] BaseAddress   The base address of the working area.
+  @param[out] Length        The length of the working area.
+
+  @retval EFI_SUCCESS       The working area was returned.
+
+**/
+EFI_STATUS
+EFIAPI
+GetVariableFlashFtwWorkingInfo (
+  OUT EFI_PHYSICAL_ADDRESS  *BaseAddress,
+  OUT UINT64                *Length
+  )
+{
+  *BaseAddress = TEST_FLASH_BASE + TEST_WORK_SPACE_OFFSET;
+  *Length      = TEST_WORK_SPACE_SIZE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the FTW spare area of the test flash.
+
+  @param[out] BaseAddress   The base address of the spare area.
+  @param[out] Length        The length of the spare area.
+
+  @retval EFI_SUCCESS       The spare area was returned.
+
+**/
+EFI_STATUS
+EFIAPI
+GetVariableFlashFtwSpareInfo (
+  OUT EFI_PHYSICAL_ADDRESS  *BaseAddress,
+  OUT UINT64                *Length
+  )
+{
+  *BaseAddress = TEST_FLASH_BASE + TEST_SPARE_OFFSET;
+  *Length      = TEST_SPARE_SIZE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Start the FTW driver on the test flash, the way it starts after a reset.
+  The power is back on, and any interrupted write is recovered.
+
+  @return The status returned by InitFtwDevice() or InitFtwProtocol().
+
+**/
+EFI_STATUS
+StartFtw (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  if (mFtwDevice != NULL) {
+    FreePool (mFtwDevice);
+    mFtwDevice = NULL;
+  }
+
+  mPowerLossOperation = MAX_UINTN;
+  mPowerLost          = FALSE;
+
+  Status = InitFtwDevice (&mFtwDevice);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return InitFtwProtocol (mFtwDevice);
+}
+
+/**
+  Update the target blocks with the data of a test write.
+
+  @param[in] Number   Number of the test write, from 1 to TEST_WRITE_COUNT.
+
+  @return The status returned by the Write() service.
+
+**/
+EFI_STATUS
+WriteTarget (
+  IN UINTN  Number
+  )
+{
+  return mFtwDevice->FtwInstance.Write (
+                                   &mFtwDevice->FtwInstance,
+                                   0,
+                                   TEST_WRITE_OFFSET,
+                                   TEST_WRITE_LENGTH,
+                                   NULL,
+                                   (EFI_HANDLE)&mTestFvb,
+                                   mWriteData[Number]
+                                   );
+}
+
+/**
+  Check the content of the target blocks.
+
+  @param[in] Number   Number of the last test write, 0 for the initial content.
+
+  @retval TRUE    The target blocks hold the data of the test write.
+  @retval FALSE   The target blocks hold other data.
+
+**/
+BOOLEAN
+IsTargetImage (
+  IN UINTN  Number
+  )
+{
+  return (BOOLEAN)(CompareMem (mFlash, mTargetImage[Number], TEST_TARGET_SIZE) == 0);
+}
+
+/**
+  Check the data of the working block that is not in the work space.
+
+  @retval TRUE    The data was kept.
+  @retval FALSE   The data was changed.
+
+**/
+BOOLEAN
+IsWorkingBlockDataKept (
+  VOID
+  )
+{
+  return (BOOLEAN)(CompareMem (
+                     mFlash + TEST_DATA_OFFSET,
+                     mFormattedFlash + TEST_DATA_OFFSET,
+                     TEST_WORK_SPACE_OFFSET - TEST_DATA_OFFSET
+                     ) == 0);
+}
+
+/**
+  Fill the test flash with the initial target data and the working block
+  data, erase the work space and the spare blocks, and start the FTW driver
+  once to format the work space.
+
+  @param[in]  Context  Unit test case context
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+FormatTestFlash (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Number;
+  UINTN  Index;
+
+  for (Index = 0; Index < TEST_FLASH_SIZE; Index++) {
+    mFlash[Index] = (UINT8)(Index * 13 + (Index >> 8));
+  }
+
+  SetMem (mFlash + TEST_WORK_SPACE_OFFSET, TEST_FLASH_SIZE - TEST_WORK_SPACE_OFFSET, FTW_ERASED_BYTE);
+
+  CopyMem (mTargetImage[0], mFlash, TEST_TARGET_SIZE);
+  for (Number = 1; Number <= TEST_WRITE_COUNT; Number++) {
+    for (Index = 0; Index < TEST_WRITE_LENGTH; Index++) {
+      mWriteData[Number][Index] = (UINT8)(Number * 0x3B + Index * 7 + (Index >> 8));
+    }
+
+    CopyMem (mTargetImage[Number], mTargetImage[Number - 1], TEST_TARGET_SIZE);
+    CopyMem (mTargetImage[Number] + TEST_WRITE_OFFSET, mWriteData[Number], TEST_WRITE_LENGTH);
+  }
+
+  if (EFI_ERROR (StartFtw ())) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  CopyMem (mFormattedFlash, mFlash, TEST_FLASH_SIZE);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the FTW device.
+
+  @param[in]  Context  Unit test case context
+
+**/
+STATIC
+VOID
+EFIAPI
+FreeFtwDevice (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mFtwDevice != NULL) {
+    FreePool (mFtwDevice);
+    mFtwDevice = NULL;
+  }
+}
+
+/// === TEST CASES =================================================================================
+
+/**
+  Writes must update the target blocks and keep the content of the spare
+  blocks. A spare block left erased by the previous write is not erased
+  again, but one that only reads as erased after a reset is.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ErasedSpareShouldBeErasedOncePerWrite (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  SpareData[0x100];
+
+  //
+  // After a reset, an erased spare block may come from an interrupted erase.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (StartFtw ());
+  mSpareEraseCount = 0;
+  UT_ASSERT_NOT_EFI_ERROR (WriteTarget (1));
+  UT_ASSERT_TRUE (IsTargetImage (1));
+  UT_ASSERT_EQUAL (mSpareEraseCount, 2);
+
+  mSpareEraseCount = 0;
+  UT_ASSERT_NOT_EFI_ERROR (WriteTarget (2));
+  UT_ASSERT_TRUE (IsTargetImage (2));
+  UT_ASSERT_EQUAL (mSpareEraseCount, 1);
+  UT_ASSERT_TRUE (IsErasedFlashBuffer (mFlash + TEST_SPARE_OFFSET, TEST_SPARE_SIZE));
+
+  //
+  // Data in the spare block is kept, and the next write erases it again.
+  //
+  SetMem (SpareData, sizeof (SpareData), 0x5A);
+  CopyMem (mFlash + TEST_SPARE_OFFSET + TEST_BLOCK_SIZE, SpareData, sizeof (SpareData));
+  mSpareEraseCount = 0;
+  UT_ASSERT_NOT_EFI_ERROR (WriteTarget (3));
+  UT_ASSERT_TRUE (IsTargetImage (3));
+  UT_ASSERT_EQUAL (mSpareEraseCount, 2);
+  UT_ASSERT_MEM_EQUAL (mFlash + TEST_SPARE_OFFSET + TEST_BLOCK_SIZE, SpareData, sizeof (SpareData));
+
+  mSpareEraseCount = 0;
+  UT_ASSERT_NOT_EFI_ERROR (WriteTarget (4));
+  UT_ASSERT_TRUE (IsTargetImage (4));
+  UT_ASSERT_EQUAL (mSpareEraseCount, 2);
+  UT_ASSERT_TRUE (IsWorkingBlockDataKept ());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Lose power at each write and erase of a sequence of writes, including the
+  state changes of the write records and the reclaims of the work space.
+  After a reset, the target blocks must hold the data of the interrupted
+  write or of the write before it, the other data of the working block must
+  be kept, and the rest of the sequence must complete.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PowerLossShouldKeepOldOrNewData (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  PowerLossOperation;
+  UINTN  Number;
+  UINTN  NewDataCount;
+
+  NewDataCount = 0;
+  for (PowerLossOperation = 0; ; PowerLossOperation++) {
+    CopyMem (mFlash, mFormattedFlash, TEST_FLASH_SIZE);
+    UT_ASSERT_NOT_EFI_ERROR (StartFtw ());
+
+    mFlashOperationCount = 0;
+    mPowerLossOperation  = PowerLossOperation;
+    for (Number = 1; Number <= TEST_WRITE_COUNT; Number++) {
+      if (EFI_ERROR (WriteTarget (Number))) {
+        break;
+      }
+    }
+
+    if (!mPowerLost) {
+      //
+      // The sequence completed before the operation that loses power.
+      //
+      UT_ASSERT_EQUAL (Number, TEST_WRITE_COUNT + 1);
+      UT_ASSERT_TRUE (IsTargetImage (TEST_WRITE_COUNT));
+      break;
+    }
+
+    UT_ASSERT_TRUE (Number <= TEST_WRITE_COUNT);
+
+    UT_ASSERT_NOT_EFI_ERROR (StartFtw ());
+    UT_ASSERT_TRUE (IsTargetImage (Number - 1) || IsTargetImage (Number));
+    UT_ASSERT_TRUE (IsWorkingBlockDataKept ());
+    if (IsTargetImage (Number)) {
+      NewDataCount++;
+    }
+
+    for ( ; Number <= TEST_WRITE_COUNT; Number++) {
+      UT_ASSERT_NOT_EFI_ERROR (WriteTarget (Number));
+      UT_ASSERT_TRUE (IsTargetImage (Number));
+    }
+
+    UT_ASSERT_TRUE (IsWorkingBlockDataKept ());
+  }
+
+  UT_LOG_INFO (
+    "%d writes: power lost at %d operations, %d recovered with the new data\n",
+    TEST_WRITE_COUNT,
+    (UINT32)PowerLossOperation,
+    (UINT32)NewDataCount
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  fault tolerant write and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      FtwTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  mTestFvb.GetAttributes      = TestFvbGetAttributes;
+  mTestFvb.SetAttributes      = TestFvbSetAttributes;
+  mTestFvb.GetPhysicalAddress = TestFvbGetPhysicalAddress;
+  mTestFvb.GetBlockSize       = TestFvbGetBlockSize;
+  mTestFvb.Read               = TestFvbRead;
+  mTestFvb.Write              = TestFvbWrite;
+  mTestFvb.EraseBlocks        = TestFvbEraseBlocks;
+  mPowerLossOperation         = MAX_UINTN;
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (&FtwTests, Framework, "Fault Tolerant Write Tests", "Ftw", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for Ftw\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (FtwTests, "Erased spare block should be erased once per write", "SpareErase", ErasedSpareShouldBeErasedOncePerWrite, FormatTestFlash, FreeFtwDevice, NULL);
+  AddTestCase (FtwTests, "Power loss should keep the old or the new data", "PowerLoss", PowerLossShouldKeepOldOrNewData, FormatTestFlash, FreeFtwDevice, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
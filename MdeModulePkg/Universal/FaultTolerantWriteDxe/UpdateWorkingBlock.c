@@ -303,6 +303,15 @@ WorkSpaceRefresh (
   // it needs to reclaim work space.
   //
   if (EFI_ERROR (Status) || (RemainingSpaceSize < sizeof (EFI_FAULT_TOLERANT_WRITE_HEADER) + sizeof (EFI_FAULT_TOLERANT_WRITE_RECORD))) {
+    //
+    // The work space is not valid if a reclaim of the working block was
+    // interrupted. The spare block then holds the only copy of the working
+    // block, another reclaim would overwrite it with the partly erased one.
+    //
+    if (!IsValidWorkSpace (FtwDevice->FtwWorkSpaceHeader)) {
+      return EFI_ABORTED;
+    }
+
     //
     // reclaim work space in working block.
     //
@@ -617,6 +626,7 @@ FtwReclaimWorkSpace (
     Ptr += Length;
   }
 
+  FtwDevice->SpareErased = IsErasedFlashBuffer (SpareBuffer, SpareBufferSize);
   FreePool (SpareBuffer);
 
   DEBUG ((DEBUG_INFO, "Ftw: reclaim work space successfully\n"));
@@ -933,6 +933,10 @@ BuildPcdDxeDataBase (
   mDxeExMapTableEmpty = (mPcdDatabase.DxeDb->ExTokenCount == 0) ? TRUE : FALSE;
   mPeiDatabaseEmpty   = (mPeiLocalTokenCount == 0) ? TRUE : FALSE;
 
+  if (!mPeiDatabaseEmpty && (mPcdDatabase.PeiDb->BuildVersion < PCD_DATABASE_INDEXED_VERSION)) {
+    DEBUG ((DEBUG_INFO, "PCD: PEI database version %d is not indexed, use linear lookups\n", mPcdDatabase.PeiDb->BuildVersion));
+  }
+
   TmpTokenSpaceBufferCount = mPcdDatabase.PeiDb->ExTokenCount + mPcdDatabase.DxeDb->ExTokenCount;
   TmpTokenSpaceBuffer      = (EFI_GUID **)AllocateZeroPool (TmpTokenSpaceBufferCount * sizeof (EFI_GUID *));
 
@@ -1568,6 +1572,75 @@ SetHiiVariable (
   return Status;
 }
 
+/**
+  Find the Token Number of a dynamic-ex PCD in the ExMapTable of a PCD database.
+
+  The ExMapTable is sorted by ExGuidIndex, then by ExTokenNumber, unless the
+  database is older than PCD_DATABASE_INDEXED_VERSION.
+
+  @param Database        PCD database.
+  @param GuidTableIdx    Index of the token space guid in the GuidTable of the PCD database.
+  @param ExTokenNumber   Dynamic-ex PCD token number.
+
+  @return Token Number for dynamic-ex PCD, or PCD_INVALID_TOKEN_NUMBER if the PCD
+          is not in the PCD database.
+
+**/
+STATIC
+UINTN
+FindExMapTokenNumber (
+  IN PCD_DATABASE_INIT  *Database,
+  IN UINTN              GuidTableIdx,
+  IN UINTN              ExTokenNumber
+  )
+{
+  DYNAMICEX_MAPPING  *ExMap;
+  UINTN              Index;
+  UINTN              Low;
+  UINTN              High;
+  UINTN              Middle;
+
+  ExMap = (DYNAMICEX_MAPPING *)((UINT8 *)Database + Database->ExMapTableOffset);
+
+  if (Database->BuildVersion < PCD_DATABASE_INDEXED_VERSION) {
+    //
+    // A PEI PCD database built separately from this driver, for example the one
+    // UefiPayloadPkg combines with the DXE one, may not be sorted.
+    //
+    for (Index = 0; Index < Database->ExTokenCount; Index++) {
+      if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
+          (GuidTableIdx == ExMap[Index].ExGuidIndex))
+      {
+        return ExMap[Index].TokenNumber;
+      }
+    }
+
+    return PCD_INVALID_TOKEN_NUMBER;
+  }
+
+  Low   = 0;
+  High  = Database->ExTokenCount;
+  while (Low < High) {
+    Middle = (Low + High) / 2;
+    if ((ExMap[Middle].ExGuidIndex < GuidTableIdx) ||
+        ((ExMap[Middle].ExGuidIndex == GuidTableIdx) && (ExMap[Middle].ExTokenNumber < ExTokenNumber)))
+    {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if ((Low < Database->ExTokenCount) &&
+      (ExMap[Low].ExGuidIndex == GuidTableIdx) &&
+      (ExMap[Low].ExTokenNumber == ExTokenNumber))
+  {
+    return ExMap[Low].TokenNumber;
+  }
+
+  return PCD_INVALID_TOKEN_NUMBER;
+}
+
 /**
   Get Token Number according to dynamic-ex PCD's {token space guid:token number}
 
@@ -1587,14 +1660,12 @@ GetExPcdTokenNumber (
   IN UINT32          ExTokenNumber
   )
 {
-  UINT32             Index;
-  DYNAMICEX_MAPPING  *ExMap;
-  EFI_GUID           *GuidTable;
-  EFI_GUID           *MatchGuid;
-  UINTN              MatchGuidIdx;
+  UINTN     TokenNumber;
+  EFI_GUID  *GuidTable;
+  EFI_GUID  *MatchGuid;
+  UINTN     MatchGuidIdx;
 
   if (!mPeiDatabaseEmpty) {
-    ExMap     = (DYNAMICEX_MAPPING *)((UINT8 *)mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->ExMapTableOffset);
     GuidTable = (EFI_GUID *)((UINT8 *)mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->GuidTableOffset);
 
     MatchGuid = ScanGuid (GuidTable, mPeiGuidTableSize, Guid);
@@ -1602,17 +1673,13 @@ GetExPcdTokenNumber (
     if (MatchGuid != NULL) {
       MatchGuidIdx = MatchGuid - GuidTable;
 
-      for (Index = 0; Index < mPcdDatabase.PeiDb->ExTokenCount; Index++) {
-        if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
-            (MatchGuidIdx == ExMap[Index].ExGuidIndex))
-        {
-          return ExMap[Index].TokenNumber;
-        }
+      TokenNumber = FindExMapTokenNumber (mPcdDatabase.PeiDb, MatchGuidIdx, ExTokenNumber);
+      if (TokenNumber != PCD_INVALID_TOKEN_NUMBER) {
+        return TokenNumber;
       }
     }
   }
 
-  ExMap     = (DYNAMICEX_MAPPING *)((UINT8 *)mPcdDatabase.DxeDb + mPcdDatabase.DxeDb->ExMapTableOffset);
   GuidTable = (EFI_GUID *)((UINT8 *)mPcdDatabase.DxeDb + mPcdDatabase.DxeDb->GuidTableOffset);
 
   MatchGuid = ScanGuid (GuidTable, mDxeGuidTableSize, Guid);
@@ -1624,12 +1691,9 @@ GetExPcdTokenNumber (
 
   MatchGuidIdx = MatchGuid - GuidTable;
 
-  for (Index = 0; Index < mPcdDatabase.DxeDb->ExTokenCount; Index++) {
-    if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
-        (MatchGuidIdx == ExMap[Index].ExGuidIndex))
-    {
-      return ExMap[Index].TokenNumber;
-    }
+  TokenNumber = FindExMapTokenNumber (mPcdDatabase.DxeDb, MatchGuidIdx, ExTokenNumber);
+  if (TokenNumber != PCD_INVALID_TOKEN_NUMBER) {
+    return TokenNumber;
   }
 
   DEBUG ((DEBUG_ERROR, "%a: Failed to find PCD with GUID: %g and token number: %d\n", __FUNCTION__, Guid, ExTokenNumber));
@@ -1653,20 +1717,33 @@ GetSizeTableIndex (
   IN    BOOLEAN  IsPeiDb
   )
 {
-  UINT32  *LocalTokenNumberTable;
-  UINTN   LocalTokenNumber;
-  UINTN   Index;
-  UINTN   SizeTableIdx;
+  PCD_DATABASE_INIT  *Database;
+  UINT32             *LocalTokenNumberTable;
+  SIZE_INDEX         *SizeIndexTable;
+  UINTN              LocalTokenNumber;
+  UINTN              Index;
+  UINTN              SizeTableIdx;
 
-  if (IsPeiDb) {
-    LocalTokenNumberTable = (UINT32 *)((UINT8 *)mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->LocalTokenNumberTableOffset);
+  Database              = IsPeiDb ? mPcdDatabase.PeiDb : mPcdDatabase.DxeDb;
+  LocalTokenNumberTable = (UINT32 *)((UINT8 *)Database + Database->LocalTokenNumberTableOffset);
+
+  if (Database->BuildVersion < PCD_DATABASE_INDEXED_VERSION) {
+    //
+    // No SizeIndexTable, count from the first local token.
+    //
+    SizeTableIdx = 0;
+    Index        = 0;
   } else {
-    LocalTokenNumberTable = (UINT32 *)((UINT8 *)mPcdDatabase.DxeDb + mPcdDatabase.DxeDb->LocalTokenNumberTableOffset);
+    //
+    // The SizeIndexTable gives the SizeTable index of every PCD_SIZE_INDEX_TABLE_STRIDE
+    // local tokens, only the local tokens following the closest one are counted.
+    //
+    SizeIndexTable = (SIZE_INDEX *)((UINT8 *)Database + Database->SizeIndexTableOffset);
+    SizeTableIdx   = SizeIndexTable[LocalTokenNumberTableIdx / PCD_SIZE_INDEX_TABLE_STRIDE];
+    Index          = LocalTokenNumberTableIdx - LocalTokenNumberTableIdx % PCD_SIZE_INDEX_TABLE_STRIDE;
   }
 
-  SizeTableIdx = 0;
-
-  for (Index = 0; Index < LocalTokenNumberTableIdx; Index++) {
+  for ( ; Index < LocalTokenNumberTableIdx; Index++) {
     LocalTokenNumber = LocalTokenNumberTable[Index];
 
     if ((LocalTokenNumber & PCD_DATUM_TYPE_ALL_SET) == PCD_DATUM_TYPE_POINTER) {
@@ -33,7 +33,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 // Please make sure the PCD Serivce DXE Version is consistent with
 // the version of the generated DXE PCD Database by build tool.
 //
-#define PCD_SERVICE_DXE_VERSION  7
+#define PCD_SERVICE_DXE_VERSION  8
 
 //
 // PCD_DXE_SERVICE_DRIVER_VERSION is defined in Autogen.h.
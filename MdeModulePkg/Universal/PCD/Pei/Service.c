@@ -959,6 +959,56 @@ GetWorker (
   return NULL;
 }
 
+/**
+  Find the Token Number of a dynamic-ex PCD in the ExMapTable of a PCD database.
+
+  The ExMapTable is sorted by ExGuidIndex, then by ExTokenNumber.
+
+  @param Database        PCD database.
+  @param GuidTableIdx    Index of the token space guid in the GuidTable of the PCD database.
+  @param ExTokenNumber   Dynamic-ex PCD token number.
+
+  @return Token Number for dynamic-ex PCD, or PCD_INVALID_TOKEN_NUMBER if the PCD
+          is not in the PCD database.
+
+**/
+STATIC
+UINTN
+FindExMapTokenNumber (
+  IN PCD_DATABASE_INIT  *Database,
+  IN UINTN              GuidTableIdx,
+  IN UINTN              ExTokenNumber
+  )
+{
+  DYNAMICEX_MAPPING  *ExMap;
+  UINTN              Low;
+  UINTN              High;
+  UINTN              Middle;
+
+  ExMap = (DYNAMICEX_MAPPING *)((UINT8 *)Database + Database->ExMapTableOffset);
+  Low   = 0;
+  High  = Database->ExTokenCount;
+  while (Low < High) {
+    Middle = (Low + High) / 2;
+    if ((ExMap[Middle].ExGuidIndex < GuidTableIdx) ||
+        ((ExMap[Middle].ExGuidIndex == GuidTableIdx) && (ExMap[Middle].ExTokenNumber < ExTokenNumber)))
+    {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if ((Low < Database->ExTokenCount) &&
+      (ExMap[Low].ExGuidIndex == GuidTableIdx) &&
+      (ExMap[Low].ExTokenNumber == ExTokenNumber))
+  {
+    return ExMap[Low].TokenNumber;
+  }
+
+  return PCD_INVALID_TOKEN_NUMBER;
+}
+
 /**
   Get Token Number according to dynamic-ex PCD's {token space guid:token number}
 
@@ -978,16 +1028,13 @@ GetExPcdTokenNumber (
   IN UINTN           ExTokenNumber
   )
 {
-  UINT32             Index;
-  DYNAMICEX_MAPPING  *ExMap;
-  EFI_GUID           *GuidTable;
-  EFI_GUID           *MatchGuid;
-  UINTN              MatchGuidIdx;
-  PEI_PCD_DATABASE   *PeiPcdDb;
+  EFI_GUID          *GuidTable;
+  EFI_GUID          *MatchGuid;
+  UINTN             MatchGuidIdx;
+  PEI_PCD_DATABASE  *PeiPcdDb;
 
   PeiPcdDb = GetPcdDatabase ();
 
-  ExMap     = (DYNAMICEX_MAPPING *)((UINT8 *)PeiPcdDb + PeiPcdDb->ExMapTableOffset);
   GuidTable = (EFI_GUID *)((UINT8 *)PeiPcdDb + PeiPcdDb->GuidTableOffset);
 
   MatchGuid = ScanGuid (GuidTable, PeiPcdDb->GuidTableCount * sizeof (EFI_GUID), Guid);
@@ -999,15 +1046,7 @@ GetExPcdTokenNumber (
 
   MatchGuidIdx = MatchGuid - GuidTable;
 
-  for (Index = 0; Index < PeiPcdDb->ExTokenCount; Index++) {
-    if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
-        (MatchGuidIdx == ExMap[Index].ExGuidIndex))
-    {
-      return ExMap[Index].TokenNumber;
-    }
-  }
-
-  return PCD_INVALID_TOKEN_NUMBER;
+  return FindExMapTokenNumber (PeiPcdDb, MatchGuidIdx, ExTokenNumber);
 }
 
 /**
@@ -1044,13 +1083,19 @@ GetSizeTableIndex (
   IN    PEI_PCD_DATABASE  *Database
   )
 {
-  UINTN  Index;
-  UINTN  SizeTableIdx;
-  UINTN  LocalTokenNumber;
+  UINTN       Index;
+  UINTN       SizeTableIdx;
+  UINTN       LocalTokenNumber;
+  SIZE_INDEX  *SizeIndexTable;
 
-  SizeTableIdx = 0;
+  //
+  // The SizeIndexTable gives the SizeTable index of every PCD_SIZE_INDEX_TABLE_STRIDE
+  // local tokens, only the local tokens following the closest one are counted.
+  //
+  SizeIndexTable = (SIZE_INDEX *)((UINT8 *)Database + Database->SizeIndexTableOffset);
+  SizeTableIdx   = SizeIndexTable[LocalTokenNumberTableIdx / PCD_SIZE_INDEX_TABLE_STRIDE];
 
-  for (Index = 0; Index < LocalTokenNumberTableIdx; Index++) {
+  for (Index = LocalTokenNumberTableIdx - LocalTokenNumberTableIdx % PCD_SIZE_INDEX_TABLE_STRIDE; Index < LocalTokenNumberTableIdx; Index++) {
     LocalTokenNumber = *((UINT32 *)((UINT8 *)Database + Database->LocalTokenNumberTableOffset) + Index);
 
     if ((LocalTokenNumber & PCD_DATUM_TYPE_ALL_SET) == PCD_DATUM_TYPE_POINTER) {
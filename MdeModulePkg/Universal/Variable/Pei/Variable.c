@@ -578,6 +578,7 @@ GetVariableStore (
   UINT32                                BackUpOffset;
 
   StoreInfo->IndexTable       = NULL;
+  StoreInfo->HashIndexTable   = NULL;
   StoreInfo->FtwLastWriteData = NULL;
   StoreInfo->AuthFlag         = FALSE;
   VariableStoreHeader         = NULL;
@@ -661,6 +662,11 @@ GetVariableStore (
           StoreInfo->IndexTable->EndPtr      = GetEndPointer (VariableStoreHeader);
           StoreInfo->IndexTable->GoneThrough = 0;
         }
+
+        GuidHob = GetFirstGuidHob (&gEdkiiVariableHashIndexTableGuid);
+        if (GuidHob != NULL) {
+          StoreInfo->HashIndexTable = GET_GUID_HOB_DATA (GuidHob);
+        }
       }
 
       break;
@@ -798,6 +804,236 @@ GetVariableNameOrData (
   CopyMem (Buffer, NameOrData, Size);
 }
 
+/**
+  Compare two entries of the variable hash index, by hash, then by offset.
+
+  @param  Buffer1   Pointer to the first entry.
+  @param  Buffer2   Pointer to the second entry.
+
+  @retval <0    The first entry is before the second one.
+  @retval 0     The entries are identical.
+  @retval >0    The first entry is after the second one.
+
+**/
+INTN
+EFIAPI
+CompareVariableHashIndexEntry (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST VARIABLE_HASH_INDEX_ENTRY  *Entry1;
+  CONST VARIABLE_HASH_INDEX_ENTRY  *Entry2;
+
+  Entry1 = (CONST VARIABLE_HASH_INDEX_ENTRY *)Buffer1;
+  Entry2 = (CONST VARIABLE_HASH_INDEX_ENTRY *)Buffer2;
+  if (Entry1->Hash != Entry2->Hash) {
+    return (Entry1->Hash < Entry2->Hash) ? -1 : 1;
+  }
+
+  if (Entry1->Offset != Entry2->Offset) {
+    return (Entry1->Offset < Entry2->Offset) ? -1 : 1;
+  }
+
+  return 0;
+}
+
+/**
+  Build the hash index HOB of the variables in the non-volatile variable store.
+
+  The store is walked twice, once to count the variables and once to hash
+  them, so that the HOB is no larger than needed in temporary memory.
+
+  @param  StoreInfo     Pointer to the store info structure of a valid store,
+                        not partially backed up in the spare block.
+
+  @return Pointer to the hash index, or NULL if the HOB could not be built.
+
+**/
+VARIABLE_HASH_INDEX_TABLE *
+BuildVariableHashIndex (
+  IN VARIABLE_STORE_INFO  *StoreInfo
+  )
+{
+  VARIABLE_STORE_HEADER      *VariableStoreHeader;
+  VARIABLE_HASH_INDEX_TABLE  *HashIndexTable;
+  VARIABLE_HASH_INDEX_ENTRY  TempEntry;
+  VARIABLE_HEADER            *Variable;
+  VARIABLE_HEADER            *VariableHeader;
+  UINT8                      *Name;
+  UINTN                      NameSize;
+  UINTN                      Count;
+  UINTN                      MaxCount;
+  UINTN                      Index;
+  BOOLEAN                    Overflow;
+
+  ASSERT (StoreInfo->FtwLastWriteData == NULL);
+
+  PERF_INMODULE_BEGIN ("PeiVariableHashIndex");
+
+  VariableStoreHeader = StoreInfo->VariableStoreHeader;
+  Overflow            = FALSE;
+  Count               = 0;
+  for ( Variable = GetStartPointer (VariableStoreHeader)
+        ; GetVariableHeader (StoreInfo, Variable, &VariableHeader)
+        ; Variable = GetNextVariablePtr (StoreInfo, Variable, VariableHeader)
+        )
+  {
+    if ((VariableHeader->State != VAR_ADDED) && (VariableHeader->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      continue;
+    }
+
+    Name     = (UINT8 *)GetVariableNamePtr (Variable, StoreInfo->AuthFlag);
+    NameSize = NameSizeOfVariable (VariableHeader, StoreInfo->AuthFlag);
+    if ((NameSize == 0) || ((UINTN)Name >= (UINTN)GetEndPointer (VariableStoreHeader)) ||
+        (NameSize > (UINTN)GetEndPointer (VariableStoreHeader) - (UINTN)Name))
+    {
+      Overflow = TRUE;
+      break;
+    }
+
+    Count++;
+  }
+
+  //
+  // The index must also fit in a single HOB.
+  //
+  MaxCount = MIN (
+               PcdGet32 (PcdPeiVariableHashIndexMaxEntryCount),
+               (0xFFF8 - sizeof (EFI_HOB_GUID_TYPE) - sizeof (VARIABLE_HASH_INDEX_TABLE)) / sizeof (VARIABLE_HASH_INDEX_ENTRY)
+               );
+  if (Count > MaxCount) {
+    Overflow = TRUE;
+  }
+
+  if (Overflow) {
+    Count = 0;
+  }
+
+  HashIndexTable = BuildGuidHob (
+                     &gEdkiiVariableHashIndexTableGuid,
+                     sizeof (VARIABLE_HASH_INDEX_TABLE) + Count * sizeof (VARIABLE_HASH_INDEX_ENTRY)
+                     );
+  if (HashIndexTable == NULL) {
+    PERF_INMODULE_END ("PeiVariableHashIndex");
+    return NULL;
+  }
+
+  HashIndexTable->StoreBase  = (EFI_PHYSICAL_ADDRESS)(UINTN)VariableStoreHeader;
+  HashIndexTable->StoreSize  = VariableStoreHeader->Size;
+  HashIndexTable->EndOffset  = (UINT32)((UINTN)Variable - (UINTN)VariableStoreHeader);
+  HashIndexTable->EntryCount = (UINT32)Count;
+  HashIndexTable->Overflow   = Overflow;
+
+  Index = 0;
+  if (Count != 0) {
+    for ( Variable = GetStartPointer (VariableStoreHeader)
+          ; GetVariableHeader (StoreInfo, Variable, &VariableHeader)
+          ; Variable = GetNextVariablePtr (StoreInfo, Variable, VariableHeader)
+          )
+    {
+      if ((VariableHeader->State == VAR_ADDED) || (VariableHeader->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+        HashIndexTable->Entry[Index].Hash = VariableIndexHash (
+                                              GetVariableNamePtr (Variable, StoreInfo->AuthFlag),
+                                              NameSizeOfVariable (VariableHeader, StoreInfo->AuthFlag),
+                                              GetVendorGuidPtr (VariableHeader, StoreInfo->AuthFlag)
+                                              );
+        HashIndexTable->Entry[Index].Offset = (UINT32)((UINTN)Variable - (UINTN)VariableStoreHeader);
+        Index++;
+      }
+    }
+
+    ASSERT (Index == Count);
+    QuickSort (HashIndexTable->Entry, Count, sizeof (VARIABLE_HASH_INDEX_ENTRY), CompareVariableHashIndexEntry, &TempEntry);
+  }
+
+  PERF_INMODULE_END ("PeiVariableHashIndex");
+
+  DEBUG ((
+    DEBUG_INFO,
+    "PeiVariable: Hash index of %d variables in %d bytes%a\n",
+    (UINT32)Count,
+    (UINT32)(sizeof (VARIABLE_HASH_INDEX_TABLE) + Count * sizeof (VARIABLE_HASH_INDEX_ENTRY)),
+    Overflow ? ", store not indexed" : ""
+    ));
+
+  return HashIndexTable;
+}
+
+/**
+  Find the variable in the non-volatile variable store with its hash index.
+
+  @param  StoreInfo           Pointer to the store info structure.
+  @param  VariableName        Name of the variable to be found, not an empty string.
+  @param  VendorGuid          Vendor GUID to be found.
+  @param  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+
+  @retval  EFI_SUCCESS            Variable found successfully
+  @retval  EFI_NOT_FOUND          Variable not found
+
+**/
+EFI_STATUS
+FindVariableInHashIndex (
+  IN VARIABLE_STORE_INFO      *StoreInfo,
+  IN CONST CHAR16             *VariableName,
+  IN CONST EFI_GUID           *VendorGuid,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  VARIABLE_HASH_INDEX_TABLE  *HashIndexTable;
+  VARIABLE_HEADER            *Variable;
+  VARIABLE_HEADER            *VariableHeader;
+  VARIABLE_HEADER            *InDeletedVariable;
+  UINT32                     Hash;
+  UINTN                      Low;
+  UINTN                      High;
+  UINTN                      Middle;
+
+  HashIndexTable = StoreInfo->HashIndexTable;
+  Hash           = VariableIndexHash (VariableName, StrSize (VariableName), VendorGuid);
+
+  //
+  // Binary search of the first entry with the hash.
+  //
+  Low  = 0;
+  High = HashIndexTable->EntryCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (HashIndexTable->Entry[Middle].Hash < Hash) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  //
+  // The entries with the same hash are in variable store order.
+  //
+  InDeletedVariable = NULL;
+  for ( ; (Low < HashIndexTable->EntryCount) && (HashIndexTable->Entry[Low].Hash == Hash); Low++) {
+    Variable = (VARIABLE_HEADER *)((UINTN)StoreInfo->VariableStoreHeader + HashIndexTable->Entry[Low].Offset);
+    if (!GetVariableHeader (StoreInfo, Variable, &VariableHeader)) {
+      continue;
+    }
+
+    if ((VariableHeader->State != VAR_ADDED) && (VariableHeader->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      continue;
+    }
+
+    if (CompareWithValidVariable (StoreInfo, Variable, VariableHeader, VariableName, VendorGuid, PtrTrack) == EFI_SUCCESS) {
+      if (VariableHeader->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+        InDeletedVariable = PtrTrack->CurrPtr;
+      } else {
+        return EFI_SUCCESS;
+      }
+    }
+  }
+
+  PtrTrack->CurrPtr = InDeletedVariable;
+
+  return (PtrTrack->CurrPtr == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
+
 /**
   Find the variable in the specified variable store.
 
@@ -848,6 +1084,21 @@ FindVariableEx (
   PtrTrack->StartPtr = GetStartPointer (VariableStoreHeader);
   PtrTrack->EndPtr   = GetEndPointer (VariableStoreHeader);
 
+  //
+  // The hash index is built once, when the variable region in flash is
+  // searched for the first time. Stores partially backed up in the spare
+  // block are not indexed.
+  //
+  if ((IndexTable != NULL) && (StoreInfo->HashIndexTable == NULL) &&
+      (PcdGet32 (PcdPeiVariableHashIndexMaxEntryCount) != 0) && (StoreInfo->FtwLastWriteData == NULL))
+  {
+    StoreInfo->HashIndexTable = BuildVariableHashIndex (StoreInfo);
+  }
+
+  if ((StoreInfo->HashIndexTable != NULL) && (StoreInfo->HashIndexTable->Overflow == 0) && (VariableName[0] != 0)) {
+    return FindVariableInHashIndex (StoreInfo, VariableName, VendorGuid, PtrTrack);
+  }
+
   InDeletedVariable = NULL;
 
   //
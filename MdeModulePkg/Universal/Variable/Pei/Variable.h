@@ -22,12 +22,17 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/PeiServicesLib.h>
 #include <Library/SafeIntLib.h>
 #include <Library/VariableFlashInfoLib.h>
+#include <Library/BaseLib.h>
+#include <Library/PerformanceLib.h>
 
 #include <Guid/VariableFormat.h>
 #include <Guid/VariableIndexTable.h>
+#include <Guid/VariableHashIndexTable.h>
 #include <Guid/SystemNvDataGuid.h>
 #include <Guid/FaultTolerantWrite.h>
 
+#include "../RuntimeDxe/VariableIndexHash.h"
+
 typedef enum {
   VariableStoreTypeHob,
   VariableStoreTypeNv,
@@ -37,6 +42,7 @@ typedef enum {
 typedef struct {
   VARIABLE_STORE_HEADER                   *VariableStoreHeader;
   VARIABLE_INDEX_TABLE                    *IndexTable;
+  VARIABLE_HASH_INDEX_TABLE               *HashIndexTable;
   //
   // If it is not NULL, it means there may be an inconsecutive variable whose
   // partial content is still in NV storage, but another partial content is backed up
@@ -8,6 +8,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "Variable.h"
+#include "VariableParsing.h"
 
 /**
   Gets LBA of block and offset by given address.
@@ -92,6 +93,15 @@ GetLbaAndOffsetByAddress (
   volume block device. The destination is specified by parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
 
+  If PcdEnableIncrementalVariableReclaim is TRUE, the storage is compared
+  with the buffer block by block, and only the blocks from the first to the
+  last one that differ are written, so that the others are not erased. The
+  write is a single fault tolerant write, so that an interrupted update is
+  restored as a whole. The recovery of an interrupted fault tolerant write
+  reads the storage from its first written block to its end from the spare
+  block, which is erased beyond the written blocks, so trailing blocks are
+  only skipped when they are past the last variable of the buffer.
+
   @param  VariableBase   Base address of variable to write
   @param  VariableBuffer Point to the variable data buffer.
 
@@ -106,12 +116,22 @@ FtwVariableSpace (
   IN VARIABLE_STORE_HEADER  *VariableBuffer
   )
 {
-  EFI_STATUS                         Status;
-  EFI_HANDLE                         FvbHandle;
-  EFI_LBA                            VarLba;
-  UINTN                              VarOffset;
-  UINTN                              FtwBufferSize;
-  EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *FtwProtocol;
+  EFI_STATUS                          Status;
+  EFI_HANDLE                          FvbHandle;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
+  EFI_LBA                             VarLba;
+  UINTN                               VarOffset;
+  UINTN                               BlockSize;
+  UINTN                               NumberOfBlocks;
+  UINTN                               BlockStart;
+  UINTN                               BlockEnd;
+  EFI_LBA                             WriteLba;
+  UINTN                               WriteLbaOffset;
+  UINTN                               WriteOffset;
+  UINTN                               WriteEnd;
+  UINTN                               FtwBufferSize;
+  VARIABLE_HEADER                     *Variable;
+  EFI_FAULT_TOLERANT_WRITE_PROTOCOL   *FtwProtocol;
 
   //
   // Locate fault tolerant write protocol.
@@ -124,7 +144,7 @@ FtwVariableSpace (
   //
   // Locate Fvb handle by address.
   //
-  Status = GetFvbInfoByAddress (VariableBase, &FvbHandle, NULL);
+  Status = GetFvbInfoByAddress (VariableBase, &FvbHandle, &Fvb);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -140,18 +160,74 @@ FtwVariableSpace (
   FtwBufferSize = ((VARIABLE_STORE_HEADER *)((UINTN)VariableBase))->Size;
   ASSERT (FtwBufferSize == VariableBuffer->Size);
 
+  WriteLba       = VarLba;
+  WriteLbaOffset = VarOffset;
+  WriteOffset    = 0;
+  WriteEnd       = FtwBufferSize;
+  if (FeaturePcdGet (PcdEnableIncrementalVariableReclaim)) {
+    Status = Fvb->GetBlockSize (Fvb, VarLba, &BlockSize, &NumberOfBlocks);
+    if (EFI_ERROR (Status) || (VarOffset >= BlockSize)) {
+      return EFI_ABORTED;
+    }
+
+    //
+    // Find the first and the last block that differ between the buffer and
+    // the storage. The first block of the storage starts at VarOffset.
+    //
+    WriteEnd = 0;
+    for (BlockStart = 0; BlockStart < FtwBufferSize; BlockStart = BlockEnd) {
+      BlockEnd = MIN (FtwBufferSize, ((BlockStart + VarOffset) / BlockSize + 1) * BlockSize - VarOffset);
+      if (CompareMem ((UINT8 *)(UINTN)VariableBase + BlockStart, (UINT8 *)VariableBuffer + BlockStart, BlockEnd - BlockStart) != 0) {
+        if (WriteEnd == 0) {
+          WriteOffset = BlockStart;
+        }
+
+        WriteEnd = BlockEnd;
+      }
+    }
+
+    if (WriteEnd == 0) {
+      return EFI_SUCCESS;
+    }
+
+    //
+    // The unchanged trailing blocks read back as erased from the spare block
+    // until the write completes, so they must not hold any variable.
+    //
+    Variable = GetStartPointer (VariableBuffer);
+    while (IsValidVariableHeader (Variable, GetEndPointer (VariableBuffer))) {
+      Variable = GetNextVariablePtr (Variable, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+    }
+
+    if (WriteEnd < (UINTN)Variable - (UINTN)VariableBuffer) {
+      WriteEnd = FtwBufferSize;
+    }
+
+    WriteLba       = VarLba + (WriteOffset + VarOffset) / BlockSize;
+    WriteLbaOffset = (WriteOffset + VarOffset) % BlockSize;
+  }
+
   //
   // FTW write record.
   //
   Status = FtwProtocol->Write (
                           FtwProtocol,
-                          VarLba,                // LBA
-                          VarOffset,             // Offset
-                          FtwBufferSize,         // NumBytes
-                          NULL,                  // PrivateData NULL
-                          FvbHandle,             // Fvb Handle
-                          (VOID *)VariableBuffer // write buffer
+                          WriteLba,                                        // LBA
+                          WriteLbaOffset,                                  // Offset
+                          WriteEnd - WriteOffset,                          // NumBytes
+                          NULL,                                            // PrivateData NULL
+                          FvbHandle,                                       // Fvb Handle
+                          (VOID *)((UINT8 *)VariableBuffer + WriteOffset)  // write buffer
                           );
+  if (!EFI_ERROR (Status) && (WriteEnd - WriteOffset < FtwBufferSize)) {
+    DEBUG ((
+      DEBUG_INFO,
+      "Variable: Rewrote 0x%x of 0x%x bytes of the NV storage from offset 0x%x\n",
+      WriteEnd - WriteOffset,
+      FtwBufferSize,
+      WriteOffset
+      ));
+  }
 
   return Status;
 }
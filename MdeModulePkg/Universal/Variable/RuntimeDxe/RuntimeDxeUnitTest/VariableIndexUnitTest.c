@@ -0,0 +1,614 @@
+/** @file
+  This is a host-based unit test for the variable store hash index.
+
+  It checks that FindVariableEx() returns the same variables with and without
+  the index, and reports the lookup rate for several variable store sizes.
+  It also checks that a hash index imported from PEI is only used if its
+  entries are variable headers of the store.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../VariableParsing.h"
+#include "../VariableIndex.h"
+
+#define UNIT_TEST_NAME     "Variable Hash Index Unit Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define TEST_NAME_LENGTH  16
+#define TEST_DATA_SIZE    8
+
+//
+// Number of lookups of each measurement.
+//
+#define TEST_LOOKUP_COUNT  200000
+
+//
+// Address of the test variable store in the non-volatile storage.
+//
+#define TEST_STORE_BASE  0xFFF80000
+
+/// === TEST DATA ==================================================================================
+
+//
+// Test GUID 1 {F955BA2D-4A2C-480C-BFD1-3CC522610592}
+//
+EFI_GUID  mTestGuid1 = {
+  0xf955ba2d, 0x4a2c, 0x480c, { 0xbf, 0xd1, 0x3c, 0xc5, 0x22, 0x61, 0x5, 0x92 }
+};
+
+//
+// Test GUID 2 {2DEA799E-5E73-43B9-870E-C945CE82AF3A}
+//
+EFI_GUID  mTestGuid2 = {
+  0x2dea799e, 0x5e73, 0x43b9, { 0x87, 0xe, 0xc9, 0x45, 0xce, 0x82, 0xaf, 0x3a }
+};
+
+typedef struct {
+  UINTN    VariableCount;
+} VARIABLE_INDEX_TEST_CONTEXT;
+
+VARIABLE_INDEX_TEST_CONTEXT  mStore64   = { 64 };
+VARIABLE_INDEX_TEST_CONTEXT  mStore256  = { 256 };
+VARIABLE_INDEX_TEST_CONTEXT  mStore1024 = { 1024 };
+VARIABLE_INDEX_TEST_CONTEXT  mStore4096 = { 4096 };
+
+VARIABLE_STORE_HEADER  *mStore;
+VARIABLE_HEADER        *mLastVariable;
+
+/// === HELPER FUNCTIONS ===========================================================================
+
+/**
+  Stub of the runtime state of the variable driver.
+
+  @retval FALSE   The tests run before ExitBootServices.
+
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Format the name of a test variable.
+
+  @param[out] Name      Buffer of TEST_NAME_LENGTH characters.
+  @param[in]  Number    Number of the variable.
+
+**/
+VOID
+TestVariableName (
+  OUT CHAR16  *Name,
+  IN  UINTN   Number
+  )
+{
+  CHAR8  Ascii[TEST_NAME_LENGTH];
+
+  snprintf (Ascii, sizeof (Ascii), "TestVar%u", (unsigned)Number);
+  AsciiStrToUnicodeStrS (Ascii, Name, TEST_NAME_LENGTH);
+}
+
+/**
+  Append a variable to the test variable store.
+
+  @param[in] Name     Name of the variable.
+  @param[in] Guid     Vendor GUID of the variable.
+  @param[in] State    State of the variable.
+
+  @return Pointer to the variable header.
+
+**/
+VARIABLE_HEADER *
+AppendTestVariable (
+  IN CHAR16    *Name,
+  IN EFI_GUID  *Guid,
+  IN UINT8     State
+  )
+{
+  VARIABLE_HEADER  *Variable;
+
+  Variable = (mLastVariable == NULL) ? GetStartPointer (mStore) : GetNextVariablePtr (mLastVariable, FALSE);
+
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = State;
+  Variable->Reserved   = 0;
+  Variable->Attributes = EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS;
+  Variable->NameSize   = (UINT32)StrSize (Name);
+  Variable->DataSize   = TEST_DATA_SIZE;
+  CopyGuid (&Variable->VendorGuid, Guid);
+  CopyMem (GetVariableNamePtr (Variable, FALSE), Name, Variable->NameSize);
+  SetMem (GetVariableDataPtr (Variable, FALSE), TEST_DATA_SIZE, 0x5A);
+
+  mLastVariable = Variable;
+  return Variable;
+}
+
+/**
+  Find a variable in the test variable store.
+
+  @param[in]  Name        Name of the variable.
+  @param[in]  Guid        Vendor GUID of the variable.
+  @param[out] PtrTrack    The result of the search.
+
+  @return The status returned by FindVariableEx().
+
+**/
+EFI_STATUS
+FindTestVariable (
+  IN  CHAR16                  *Name,
+  IN  EFI_GUID                *Guid,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  ZeroMem (PtrTrack, sizeof (*PtrTrack));
+  PtrTrack->StartPtr = GetStartPointer (mStore);
+  PtrTrack->EndPtr   = GetEndPointer (mStore);
+  return FindVariableEx (Name, Guid, FALSE, PtrTrack, FALSE);
+}
+
+/**
+  Allocate an empty variable store large enough for the test variables, with
+  two spare variables for each of them.
+
+  @param[in]  Context  Unit test case context
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CreateTestStore (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_INDEX_TEST_CONTEXT  *TestContext;
+  UINTN                        Size;
+
+  TestContext = (VARIABLE_INDEX_TEST_CONTEXT *)Context;
+  Size        = sizeof (VARIABLE_STORE_HEADER) +
+                TestContext->VariableCount * 3 *
+                HEADER_ALIGN (sizeof (VARIABLE_HEADER) + TEST_NAME_LENGTH * sizeof (CHAR16) + TEST_DATA_SIZE);
+
+  mStore = AllocatePool (Size);
+  if (mStore == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  SetMem (mStore, Size, 0xFF);
+  CopyGuid (&mStore->Signature, &gEfiVariableGuid);
+  mStore->Size      = (UINT32)Size;
+  mStore->Format    = VARIABLE_STORE_FORMATTED;
+  mStore->State     = VARIABLE_STORE_HEALTHY;
+  mStore->Reserved  = 0;
+  mStore->Reserved1 = 0;
+  mLastVariable     = NULL;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the test variable store and its index.
+
+  @param[in]  Context  Unit test case context
+
+**/
+STATIC
+VOID
+EFIAPI
+FreeTestStore (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VariableIndexDestroy (mStore);
+  FreePool (mStore);
+  mStore = NULL;
+}
+
+/**
+  Measure the rate of lookups of the test variables.
+
+  @param[in] VariableCount    Number of test variables.
+
+  @return Lookups per second.
+
+**/
+UINT64
+MeasureLookupRate (
+  IN UINTN  VariableCount
+  )
+{
+  VARIABLE_POINTER_TRACK  PtrTrack;
+  CHAR16                  Name[TEST_NAME_LENGTH];
+  UINTN                   Lookup;
+  clock_t                 Start;
+  clock_t                 Elapsed;
+
+  Start = clock ();
+  for (Lookup = 0; Lookup < TEST_LOOKUP_COUNT; Lookup++) {
+    TestVariableName (Name, (Lookup * 7919) % VariableCount);
+    FindTestVariable (Name, &mTestGuid1, &PtrTrack);
+  }
+
+  Elapsed = clock () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  return (UINT64)TEST_LOOKUP_COUNT * CLOCKS_PER_SEC / Elapsed;
+}
+
+/// === TEST CASES =================================================================================
+
+/**
+  Lookups with the index must return the same variables as the linear scan,
+  including for deleted, in-deleted-transition and missing variables.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexedLookupsShouldMatchLinearLookups (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_INDEX_TEST_CONTEXT  *TestContext;
+  VARIABLE_POINTER_TRACK       Linear;
+  VARIABLE_POINTER_TRACK       Indexed;
+  CHAR16                       Name[TEST_NAME_LENGTH];
+  EFI_STATUS                   LinearStatus;
+  EFI_STATUS                   IndexedStatus;
+  VARIABLE_HEADER              *Variable;
+  UINTN                        Number;
+  UINT64                       LinearRate;
+  UINT64                       IndexedRate;
+
+  TestContext = (VARIABLE_INDEX_TEST_CONTEXT *)Context;
+
+  for (Number = 0; Number < TestContext->VariableCount; Number++) {
+    TestVariableName (Name, Number);
+    Variable = AppendTestVariable (Name, &mTestGuid1, VAR_ADDED);
+    if (Number % 8 == 1) {
+      //
+      // Updated variable: the old copy is in deleted transition.
+      //
+      Variable->State &= VAR_IN_DELETED_TRANSITION;
+      AppendTestVariable (Name, &mTestGuid1, VAR_ADDED);
+    } else if (Number % 8 == 3) {
+      //
+      // Interrupted update: only the copy in deleted transition is left.
+      //
+      Variable->State &= VAR_IN_DELETED_TRANSITION;
+    } else if (Number % 8 == 5) {
+      Variable->State &= VAR_DELETED;
+    }
+  }
+
+  LinearRate = MeasureLookupRate (TestContext->VariableCount);
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableIndexCreate (mStore, FALSE));
+
+  for (Number = 0; Number < TestContext->VariableCount + 16; Number++) {
+    TestVariableName (Name, Number);
+
+    VariableIndexDestroy (mStore);
+    LinearStatus = FindTestVariable (Name, &mTestGuid1, &Linear);
+    UT_ASSERT_NOT_EFI_ERROR (VariableIndexCreate (mStore, FALSE));
+    IndexedStatus = FindTestVariable (Name, &mTestGuid1, &Indexed);
+
+    UT_ASSERT_STATUS_EQUAL (IndexedStatus, LinearStatus);
+    UT_ASSERT_EQUAL ((UINTN)Indexed.CurrPtr, (UINTN)Linear.CurrPtr);
+    UT_ASSERT_EQUAL ((UINTN)Indexed.InDeletedTransitionPtr, (UINTN)Linear.InDeletedTransitionPtr);
+
+    IndexedStatus = FindTestVariable (Name, &mTestGuid2, &Indexed);
+    UT_ASSERT_STATUS_EQUAL (IndexedStatus, EFI_NOT_FOUND);
+  }
+
+  IndexedRate = MeasureLookupRate (TestContext->VariableCount);
+
+  UT_LOG_INFO (
+    "%d variables: %ld lookups/s linear, %ld lookups/s indexed\n",
+    (UINT32)TestContext->VariableCount,
+    LinearRate,
+    IndexedRate
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Variables appended to the store after the index is built must be found,
+  and the index must follow a rewrite of the store.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexShouldFollowStoreUpdates (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_INDEX_TEST_CONTEXT  *TestContext;
+  VARIABLE_POINTER_TRACK       PtrTrack;
+  CHAR16                       Name[TEST_NAME_LENGTH];
+  VARIABLE_HEADER              *Variable;
+  UINTN                        Number;
+
+  TestContext = (VARIABLE_INDEX_TEST_CONTEXT *)Context;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableIndexCreate (mStore, TRUE));
+
+  for (Number = 0; Number < TestContext->VariableCount; Number++) {
+    TestVariableName (Name, Number);
+    Variable = AppendTestVariable (Name, &mTestGuid1, VAR_ADDED);
+    UT_ASSERT_NOT_EFI_ERROR (FindTestVariable (Name, &mTestGuid1, &PtrTrack));
+    UT_ASSERT_EQUAL ((UINTN)PtrTrack.CurrPtr, (UINTN)Variable);
+  }
+
+  //
+  // Deleting a variable changes its state in place.
+  //
+  TestVariableName (Name, 0);
+  UT_ASSERT_NOT_EFI_ERROR (FindTestVariable (Name, &mTestGuid1, &PtrTrack));
+  PtrTrack.CurrPtr->State &= VAR_DELETED;
+  UT_ASSERT_STATUS_EQUAL (FindTestVariable (Name, &mTestGuid1, &PtrTrack), EFI_NOT_FOUND);
+
+  //
+  // Rewrite the store from the start with the header, the way a runtime cache
+  // is synchronized after a reclaim: the variables are at other offsets.
+  //
+  mStore->Reserved1 = 0;
+  mLastVariable     = NULL;
+  for (Number = TestContext->VariableCount; Number-- > 0;) {
+    TestVariableName (Name, Number);
+    AppendTestVariable (Name, &mTestGuid2, VAR_ADDED);
+  }
+
+  SetMem (
+    GetNextVariablePtr (mLastVariable, FALSE),
+    (UINTN)GetEndPointer (mStore) - (UINTN)GetNextVariablePtr (mLastVariable, FALSE),
+    0xFF
+    );
+
+  for (Number = 0; Number < TestContext->VariableCount; Number++) {
+    TestVariableName (Name, Number);
+    UT_ASSERT_STATUS_EQUAL (FindTestVariable (Name, &mTestGuid1, &PtrTrack), EFI_NOT_FOUND);
+    UT_ASSERT_NOT_EFI_ERROR (FindTestVariable (Name, &mTestGuid2, &PtrTrack));
+    UT_ASSERT_MEM_EQUAL (GetVariableNamePtr (PtrTrack.CurrPtr, FALSE), Name, StrSize (Name));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Build the hash index of the test variable store, the way the PEI variable
+  driver does for the non-volatile store.
+
+  @return Pointer to the hash index, to be freed with FreePool().
+
+**/
+VARIABLE_HASH_INDEX_TABLE *
+BuildTestHashIndexTable (
+  VOID
+  )
+{
+  VARIABLE_HASH_INDEX_TABLE  *HashIndexTable;
+  VARIABLE_HASH_INDEX_ENTRY  *Entry;
+  VARIABLE_HEADER            *Variable;
+  UINTN                      Count;
+
+  Count = 0;
+  for (Variable = GetStartPointer (mStore); IsValidVariableHeader (Variable, GetEndPointer (mStore)); Variable = GetNextVariablePtr (Variable, FALSE)) {
+    Count++;
+  }
+
+  HashIndexTable = AllocateZeroPool (sizeof (VARIABLE_HASH_INDEX_TABLE) + Count * sizeof (VARIABLE_HASH_INDEX_ENTRY));
+  if (HashIndexTable == NULL) {
+    return NULL;
+  }
+
+  HashIndexTable->StoreBase = TEST_STORE_BASE;
+  HashIndexTable->StoreSize = mStore->Size;
+  for (Variable = GetStartPointer (mStore); IsValidVariableHeader (Variable, GetEndPointer (mStore)); Variable = GetNextVariablePtr (Variable, FALSE)) {
+    Entry         = &HashIndexTable->Entry[HashIndexTable->EntryCount++];
+    Entry->Offset = (UINT32)((UINTN)Variable - (UINTN)mStore);
+    Entry->Hash   = VariableIndexHash (
+                      GetVariableNamePtr (Variable, FALSE),
+                      NameSizeOfVariable (Variable, FALSE),
+                      GetVendorGuidPtr (Variable, FALSE)
+                      );
+  }
+
+  HashIndexTable->EndOffset = (UINT32)((UINTN)Variable - (UINTN)mStore);
+  return HashIndexTable;
+}
+
+/**
+  A hash index imported from PEI must be used if it describes the store, and
+  rejected if one of its entries is not the offset of a variable header whose
+  name and data are in the part of the store it covers.
+
+  @param[in]  Context  Unit test case context
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ImportShouldOnlyAcceptVariableHeaders (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_INDEX_TEST_CONTEXT  *TestContext;
+  VARIABLE_HASH_INDEX_TABLE    *HashIndexTable;
+  VARIABLE_HASH_INDEX_ENTRY    *Entry;
+  VARIABLE_POINTER_TRACK       PtrTrack;
+  CHAR16                       Name[TEST_NAME_LENGTH];
+  VARIABLE_HEADER              *Variable;
+  VARIABLE_HEADER              *LastVariable;
+  UINTN                        HashIndexSize;
+  UINTN                        Number;
+  UINT32                       Offset;
+  UINT32                       BadOffset[5];
+
+  TestContext = (VARIABLE_INDEX_TEST_CONTEXT *)Context;
+
+  for (Number = 0; Number < TestContext->VariableCount; Number++) {
+    TestVariableName (Name, Number);
+    AppendTestVariable (Name, &mTestGuid1, VAR_ADDED);
+  }
+
+  HashIndexTable = BuildTestHashIndexTable ();
+  UT_ASSERT_NOT_NULL (HashIndexTable);
+  HashIndexSize = sizeof (VARIABLE_HASH_INDEX_TABLE) + HashIndexTable->EntryCount * sizeof (VARIABLE_HASH_INDEX_ENTRY);
+
+  //
+  // Offsets in the variable store that are not variable headers: unaligned,
+  // in the name of a variable, in the data of a variable, past the end of the
+  // store, and a variable whose data ends past the end of the index.
+  //
+  Entry        = &HashIndexTable->Entry[HashIndexTable->EntryCount - 1];
+  Variable     = GetStartPointer (mStore);
+  LastVariable = (VARIABLE_HEADER *)((UINTN)mStore + Entry->Offset);
+  BadOffset[0] = (UINT32)((UINTN)Variable - (UINTN)mStore) + 2;
+  BadOffset[1] = (UINT32)((UINTN)GetVariableNamePtr (Variable, FALSE) - (UINTN)mStore);
+  BadOffset[2] = (UINT32)((UINTN)GetVariableDataPtr (Variable, FALSE) - (UINTN)mStore);
+  BadOffset[3] = HashIndexTable->EndOffset;
+  BadOffset[4] = (UINT32)((UINTN)LastVariable - (UINTN)mStore);
+
+  for (Number = 0; Number < ARRAY_SIZE (BadOffset); Number++) {
+    Offset        = Entry->Offset;
+    Entry->Offset = BadOffset[Number];
+    if (Number == 4) {
+      HashIndexTable->EndOffset -= 4;
+    }
+
+    UT_ASSERT_NOT_EFI_ERROR (VariableIndexCreate (mStore, FALSE));
+    UT_ASSERT_STATUS_EQUAL (VariableIndexImport (mStore, TEST_STORE_BASE, HashIndexTable, HashIndexSize, FALSE), EFI_UNSUPPORTED);
+    VariableIndexDestroy (mStore);
+
+    Entry->Offset = Offset;
+    if (Number == 4) {
+      HashIndexTable->EndOffset += 4;
+    }
+  }
+
+  //
+  // The index is not used for another store.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (VariableIndexCreate (mStore, FALSE));
+  UT_ASSERT_STATUS_EQUAL (VariableIndexImport (mStore, TEST_STORE_BASE + 1, HashIndexTable, HashIndexSize, FALSE), EFI_UNSUPPORTED);
+  VariableIndexDestroy (mStore);
+
+  //
+  // The valid index is imported, and every variable is found with it.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (VariableIndexCreate (mStore, FALSE));
+  UT_ASSERT_NOT_EFI_ERROR (VariableIndexImport (mStore, TEST_STORE_BASE, HashIndexTable, HashIndexSize, FALSE));
+  FreePool (HashIndexTable);
+
+  for (Number = 0; Number < TestContext->VariableCount; Number++) {
+    TestVariableName (Name, Number);
+    UT_ASSERT_NOT_EFI_ERROR (FindTestVariable (Name, &mTestGuid1, &PtrTrack));
+    UT_ASSERT_MEM_EQUAL (GetVariableNamePtr (PtrTrack.CurrPtr, FALSE), Name, StrSize (Name));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  variable hash index and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Add all test suites and tests.
+  //
+  Status = CreateUnitTestSuite (&IndexTests, Framework, "Variable Hash Index Tests", "VarIndex", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for VarIndex\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (IndexTests, "Indexed lookups in 64 variables should match linear lookups", "Match64", IndexedLookupsShouldMatchLinearLookups, CreateTestStore, FreeTestStore, &mStore64);
+  AddTestCase (IndexTests, "Indexed lookups in 256 variables should match linear lookups", "Match256", IndexedLookupsShouldMatchLinearLookups, CreateTestStore, FreeTestStore, &mStore256);
+  AddTestCase (IndexTests, "Indexed lookups in 1024 variables should match linear lookups", "Match1024", IndexedLookupsShouldMatchLinearLookups, CreateTestStore, FreeTestStore, &mStore1024);
+  AddTestCase (IndexTests, "Indexed lookups in 4096 variables should match linear lookups", "Match4096", IndexedLookupsShouldMatchLinearLookups, CreateTestStore, FreeTestStore, &mStore4096);
+  AddTestCase (IndexTests, "Index should follow appends, deletes and rewrites", "Updates", IndexShouldFollowStoreUpdates, CreateTestStore, FreeTestStore, &mStore256);
+  AddTestCase (IndexTests, "Import should only accept variable headers", "Import", ImportShouldOnlyAcceptVariableHeaders, CreateTestStore, FreeTestStore, &mStore256);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Main  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Main (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
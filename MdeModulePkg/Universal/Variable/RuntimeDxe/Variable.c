@@ -28,6 +28,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "Variable.h"
 #include "VariableNonVolatile.h"
 #include "VariableParsing.h"
+#include "VariableIndex.h"
 #include "VariableRuntimeCache.h"
 
 VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
@@ -59,6 +60,13 @@ BOOLEAN  mEndOfDxe = FALSE;
 ///
 VAR_CHECK_REQUEST_SOURCE  mRequestSource = VarCheckFromUntrusted;
 
+///
+/// TRUE while VariableServiceSetVariableBatch() holds the variable services
+/// lock. The check handlers run for the entries of a batch may call the
+/// variable services, which must then not take the lock again.
+///
+BOOLEAN  mVariableBatchLockHeld = FALSE;
+
 //
 // It will record the current boot error flag before EndOfDxe.
 //
@@ -168,6 +176,12 @@ UpdateVariableStore (
     if ((DataPtr + DataSize) > (FvVolHdr + mNvFvHeaderCache->FvLength)) {
       return EFI_OUT_OF_RESOURCES;
     }
+
+    RecordRuntimeVariableCacheUpdate (
+      &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
+      (UINTN)(DataPtr - mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase),
+      DataSize
+      );
   } else {
     //
     // Data Pointer should point to the actual Address where data is to be
@@ -182,6 +196,12 @@ UpdateVariableStore (
       if ((DataPtr + DataSize) > ((UINTN)VolatileBase + VolatileBase->Size)) {
         return EFI_OUT_OF_RESOURCES;
       }
+
+      RecordRuntimeVariableCacheUpdate (
+        &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache,
+        (UINTN)DataPtr - (UINTN)VolatileBase,
+        DataSize
+        );
     } else {
       //
       // Emulated non-volatile variable mode.
@@ -193,6 +213,12 @@ UpdateVariableStore (
       if ((DataPtr + DataSize) > ((UINTN)mNvVariableCache + mNvVariableCache->Size)) {
         return EFI_OUT_OF_RESOURCES;
       }
+
+      RecordRuntimeVariableCacheUpdate (
+        &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
+        (UINTN)DataPtr - (UINTN)mNvVariableCache,
+        DataSize
+        );
     }
 
     //
@@ -341,8 +367,8 @@ RecordVarErrorFlag (
       *VarErrFlag = TempFlag;
       Status      =  SynchronizeRuntimeVariableCache (
                        &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
-                       0,
-                       mNvVariableCache->Size
+                       (UINTN)VarErrFlag - (UINTN)mNvVariableCache,
+                       sizeof (TempFlag)
                        );
       ASSERT_EFI_ERROR (Status);
     }
@@ -792,10 +818,24 @@ Reclaim (
   }
 
 Done:
+  //
+  // The variables have been moved, the indexes of the store must be built again.
+  //
+  VariableIndexInvalidate (VariableStoreHeader);
+  if (!IsVolatile) {
+    VariableIndexInvalidate (mNvVariableCache);
+  }
+
   DoneStatus = EFI_SUCCESS;
   if (IsVolatile || mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
+    //
+    // The runtime caches are only synchronized with the updates recorded by
+    // UpdateVariableStore(), so the cache of the reclaimed store is copied whole.
+    //
     DoneStatus = SynchronizeRuntimeVariableCache (
-                   &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache,
+                   IsVolatile ?
+                   &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache :
+                   &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
                    0,
                    VariableStoreHeader->Size
                    );
@@ -2394,10 +2434,14 @@ Done:
     }
 
     if (VolatileCacheInstance->Store != NULL) {
+      //
+      // The updates of the variable stores were recorded by UpdateVariableStore(),
+      // only they are copied to the runtime caches.
+      //
       Status =  SynchronizeRuntimeVariableCache (
                   VolatileCacheInstance,
                   0,
-                  VolatileCacheInstance->Store->Size
+                  0
                   );
       ASSERT_EFI_ERROR (Status);
     }
@@ -2406,6 +2450,37 @@ Done:
   return Status;
 }
 
+/**
+  Acquire the variable services lock, unless VariableServiceSetVariableBatch()
+  holds it for the check handler that calls a variable service.
+
+**/
+STATIC
+VOID
+AcquireVariableServicesLock (
+  VOID
+  )
+{
+  if (!mVariableBatchLockHeld) {
+    AcquireLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  }
+}
+
+/**
+  Release the variable services lock taken by AcquireVariableServicesLock().
+
+**/
+STATIC
+VOID
+ReleaseVariableServicesLock (
+  VOID
+  )
+{
+  if (!mVariableBatchLockHeld) {
+    ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  }
+}
+
 /**
 
   This code finds variable in storage blocks (Volatile or Non-Volatile).
@@ -2450,7 +2525,7 @@ VariableServiceGetVariable (
     return EFI_NOT_FOUND;
   }
 
-  AcquireLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  AcquireVariableServicesLock ();
 
   Status = FindVariable (VariableName, VendorGuid, &Variable, &mVariableModuleGlobal->VariableGlobal, FALSE);
   if ((Variable.CurrPtr == NULL) || EFI_ERROR (Status)) {
@@ -2489,7 +2564,7 @@ Done:
     }
   }
 
-  ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  ReleaseVariableServicesLock ();
   return Status;
 }
 
@@ -2551,7 +2626,7 @@ VariableServiceGetNextVariableName (
     return EFI_INVALID_PARAMETER;
   }
 
-  AcquireLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  AcquireVariableServicesLock ();
 
   //
   // 0: Volatile, 1: HOB, 2: Non-Volatile.
@@ -2591,13 +2666,16 @@ VariableServiceGetNextVariableName (
     *VariableNameSize = VarNameSize;
   }
 
-  ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  ReleaseVariableServicesLock ();
   return Status;
 }
 
 /**
+  Check the parameters of a SetVariable() operation, and run the MOR handler
+  and the variable check handlers on it.
 
-  This code sets variable in storage blocks (Volatile or Non-Volatile).
+  This function must be called without the variable services lock held, as
+  the handlers may get or set variables.
 
   Caution: This function may receive untrusted input.
   This function may be invoked in SMM mode, and datasize and data are external input.
@@ -2606,23 +2684,20 @@ VariableServiceGetNextVariableName (
   buffer overflow, integer overflow.
   This function will check attribute carefully to avoid authentication bypass.
 
-  @param VariableName                     Name of Variable to be found.
+  @param VariableName                     Name of Variable to be set.
   @param VendorGuid                       Variable vendor GUID.
-  @param Attributes                       Attribute value of the variable found
-  @param DataSize                         Size of Data found. If size is less than the
-                                          data, this value contains the required size.
+  @param Attributes                       Attribute value of the variable.
+  @param DataSize                         Size of Data.
   @param Data                             Data pointer.
 
-  @return EFI_INVALID_PARAMETER           Invalid parameter.
-  @return EFI_SUCCESS                     Set successfully.
-  @return EFI_OUT_OF_RESOURCES            Resource not enough to set variable.
-  @return EFI_NOT_FOUND                   Not found.
-  @return EFI_WRITE_PROTECTED             Variable is read-only.
+  @retval EFI_SUCCESS                     The operation may be done by SetVariableWithLockHeld().
+  @retval EFI_ALREADY_STARTED             The operation was done by the MOR handler.
+  @return Others                          The operation is rejected.
 
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-VariableServiceSetVariable (
+SetVariableCheck (
   IN CHAR16    *VariableName,
   IN EFI_GUID  *VendorGuid,
   IN UINT32    Attributes,
@@ -2630,12 +2705,9 @@ VariableServiceSetVariable (
   IN VOID      *Data
   )
 {
-  VARIABLE_POINTER_TRACK  Variable;
-  EFI_STATUS              Status;
-  VARIABLE_HEADER         *NextVariable;
-  EFI_PHYSICAL_ADDRESS    Point;
-  UINTN                   PayloadSize;
-  BOOLEAN                 AuthFormat;
+  EFI_STATUS  Status;
+  UINTN       PayloadSize;
+  BOOLEAN     AuthFormat;
 
   AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
 
@@ -2829,27 +2901,51 @@ VariableServiceSetVariable (
   }
 
   //
-  // Special Handling for MOR Lock variable.
+  // Special Handling for MOR Lock variable. EFI_ALREADY_STARTED means the
+  // SetVariable() action is handled inside of SetVariableCheckHandlerMor().
   //
   Status = SetVariableCheckHandlerMor (VariableName, VendorGuid, Attributes, PayloadSize, (VOID *)((UINTN)Data + DataSize - PayloadSize));
-  if (Status == EFI_ALREADY_STARTED) {
-    //
-    // EFI_ALREADY_STARTED means the SetVariable() action is handled inside of SetVariableCheckHandlerMor().
-    // Variable driver can just return SUCCESS.
-    //
-    return EFI_SUCCESS;
-  }
-
   if (EFI_ERROR (Status)) {
     return Status;
   }
 
-  Status = VarCheckLibSetVariableCheck (VariableName, VendorGuid, Attributes, PayloadSize, (VOID *)((UINTN)Data + DataSize - PayloadSize), mRequestSource);
-  if (EFI_ERROR (Status)) {
-    return Status;
-  }
+  return VarCheckLibSetVariableCheck (VariableName, VendorGuid, Attributes, PayloadSize, (VOID *)((UINTN)Data + DataSize - PayloadSize), mRequestSource);
+}
 
-  AcquireLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+/**
+  Set a variable that passed SetVariableCheck(), with the variable services
+  lock held by the caller.
+
+  @param VariableName                     Name of Variable to be set.
+  @param VendorGuid                       Variable vendor GUID.
+  @param Attributes                       Attribute value of the variable.
+  @param DataSize                         Size of Data.
+  @param Data                             Data pointer.
+
+  @return EFI_INVALID_PARAMETER           Invalid parameter.
+  @return EFI_SUCCESS                     Set successfully.
+  @return EFI_OUT_OF_RESOURCES            Resource not enough to set variable.
+  @return EFI_NOT_FOUND                   Not found.
+  @return EFI_WRITE_PROTECTED             Variable is read-only.
+
+**/
+STATIC
+EFI_STATUS
+SetVariableWithLockHeld (
+  IN CHAR16    *VariableName,
+  IN EFI_GUID  *VendorGuid,
+  IN UINT32    Attributes,
+  IN UINTN     DataSize,
+  IN VOID      *Data
+  )
+{
+  VARIABLE_POINTER_TRACK  Variable;
+  EFI_STATUS              Status;
+  VARIABLE_HEADER         *NextVariable;
+  EFI_PHYSICAL_ADDRESS    Point;
+  BOOLEAN                 AuthFormat;
+
+  AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
 
   //
   // Consider reentrant in MCA/INIT/NMI. It needs be reupdated.
@@ -2911,7 +3007,62 @@ VariableServiceSetVariable (
 
 Done:
   InterlockedDecrement (&mVariableModuleGlobal->VariableGlobal.ReentrantState);
-  ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  return Status;
+}
+
+/**
+
+  This code sets variable in storage blocks (Volatile or Non-Volatile).
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and datasize and data are external input.
+  This function will do basic validation, before parse the data.
+  This function will parse the authentication carefully to avoid security issues, like
+  buffer overflow, integer overflow.
+  This function will check attribute carefully to avoid authentication bypass.
+
+  @param VariableName                     Name of Variable to be found.
+  @param VendorGuid                       Variable vendor GUID.
+  @param Attributes                       Attribute value of the variable found
+  @param DataSize                         Size of Data found. If size is less than the
+                                          data, this value contains the required size.
+  @param Data                             Data pointer.
+
+  @return EFI_INVALID_PARAMETER           Invalid parameter.
+  @return EFI_SUCCESS                     Set successfully.
+  @return EFI_OUT_OF_RESOURCES            Resource not enough to set variable.
+  @return EFI_NOT_FOUND                   Not found.
+  @return EFI_WRITE_PROTECTED             Variable is read-only.
+
+**/
+EFI_STATUS
+EFIAPI
+VariableServiceSetVariable (
+  IN CHAR16    *VariableName,
+  IN EFI_GUID  *VendorGuid,
+  IN UINT32    Attributes,
+  IN UINTN     DataSize,
+  IN VOID      *Data
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = SetVariableCheck (VariableName, VendorGuid, Attributes, DataSize, Data);
+  if (Status == EFI_ALREADY_STARTED) {
+    //
+    // The SetVariable() action is handled inside of SetVariableCheckHandlerMor().
+    // Variable driver can just return SUCCESS.
+    //
+    return EFI_SUCCESS;
+  }
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  AcquireVariableServicesLock ();
+  Status = SetVariableWithLockHeld (VariableName, VendorGuid, Attributes, DataSize, Data);
+  ReleaseVariableServicesLock ();
 
   if (!AtRuntime ()) {
     if (!EFI_ERROR (Status)) {
@@ -2925,6 +3076,190 @@ Done:
   return Status;
 }
 
+/**
+  This code sets a batch of variables, and writes the non-volatile variables
+  to the storage with at most one fault tolerant write.
+
+  The variable services lock is held for the whole batch, so that no other
+  SetVariable() call is done while the non-volatile variables are staged in
+  the memory copy of the storage. The staging is done in the same way as in the
+  emulated non-volatile variable mode, so a reclaim needed by an operation of
+  the batch is done in memory only. The memory copy is then written to the
+  storage at once.
+
+  Each entry is checked as by SetVariable() just before it is set, so the
+  checks see the variables set by the previous entries. A variable policy
+  that depends on the state of another variable, such as LockOnVarState,
+  then applies to the entries that follow the entry setting that state, as
+  for a sequence of SetVariable() calls.
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and the entries are external input.
+  Each entry is checked by SetVariableCheck().
+
+  @param[in]      EntryCount    Number of entries in Entries.
+  @param[in, out] Entries       The SetVariable operations to process. The Status
+                                field of each entry is updated.
+
+  @retval EFI_SUCCESS           All the operations were processed.
+  @retval EFI_INVALID_PARAMETER EntryCount is 0, or Entries is NULL.
+  @retval EFI_UNSUPPORTED       ExitBootServices() has already been called.
+  @retval EFI_NOT_AVAILABLE_YET The variable write service is not ready yet.
+  @retval EFI_DEVICE_ERROR      The non-volatile variable storage could not be updated.
+
+**/
+EFI_STATUS
+VariableServiceSetVariableBatch (
+  IN     UINTN                       EntryCount,
+  IN OUT EDKII_VARIABLE_BATCH_ENTRY  *Entries
+  )
+{
+  EFI_STATUS                  Status;
+  UINTN                       Index;
+  EDKII_VARIABLE_BATCH_ENTRY  *Entry;
+  EFI_PHYSICAL_ADDRESS        NonVolatileVariableBase;
+  BOOLEAN                     Staged;
+  UINTN                       NonVolatileLastVariableOffset;
+  UINTN                       CommonVariableTotalSize;
+  UINTN                       CommonUserVariableTotalSize;
+  UINTN                       HwErrVariableTotalSize;
+  UINT32                      Attributes;
+  UINTN                       DataSize;
+
+  if ((EntryCount == 0) || (Entries == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // The storage is only rewritten at boot time, as for a reclaim.
+  //
+  if (AtRuntime ()) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if ((mVariableModuleGlobal->FvbInstance == NULL) && !mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
+    return EFI_NOT_AVAILABLE_YET;
+  }
+
+  AcquireLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  mVariableBatchLockHeld = TRUE;
+
+  NonVolatileVariableBase = mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
+  Staged                  = !mVariableModuleGlobal->VariableGlobal.EmuNvMode;
+  if (Staged) {
+    //
+    // Flush the HOB variables first, so that they are not lost if the storage
+    // cannot be updated.
+    //
+    FlushHobVariableToFlash (NULL, NULL);
+
+    NonVolatileLastVariableOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+    CommonVariableTotalSize       = mVariableModuleGlobal->CommonVariableTotalSize;
+    CommonUserVariableTotalSize   = mVariableModuleGlobal->CommonUserVariableTotalSize;
+    HwErrVariableTotalSize        = mVariableModuleGlobal->HwErrVariableTotalSize;
+
+    //
+    // Redirect the non-volatile variable writes to the memory copy of the storage.
+    //
+    mVariableModuleGlobal->VariableGlobal.EmuNvMode               = TRUE;
+    mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = (EFI_PHYSICAL_ADDRESS)(UINTN)mNvVariableCache;
+  }
+
+  //
+  // The check handlers may get or set variables. They then see the staged
+  // variables, and a variable they set is staged with the batch.
+  //
+  for (Index = 0; Index < EntryCount; Index++) {
+    Entry         = &Entries[Index];
+    Entry->Status = SetVariableCheck (
+                      Entry->VariableName,
+                      Entry->VendorGuid,
+                      Entry->Attributes,
+                      Entry->DataSize,
+                      Entry->Data
+                      );
+    if (!EFI_ERROR (Entry->Status)) {
+      Entry->Status = SetVariableWithLockHeld (
+                        Entry->VariableName,
+                        Entry->VendorGuid,
+                        Entry->Attributes,
+                        Entry->DataSize,
+                        Entry->Data
+                        );
+    }
+  }
+
+  Status = EFI_SUCCESS;
+  if (Staged) {
+    mVariableModuleGlobal->VariableGlobal.EmuNvMode               = FALSE;
+    mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = NonVolatileVariableBase;
+
+    if (CompareMem (mNvVariableCache, (VOID *)(UINTN)NonVolatileVariableBase, mNvVariableCache->Size) != 0) {
+      Status = FtwVariableSpace (NonVolatileVariableBase, mNvVariableCache);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "Variable: Batch update of the variable storage failed - %r\n", Status));
+        //
+        // Discard the staged variables.
+        //
+        CopyMem (mNvVariableCache, (UINT8 *)(UINTN)NonVolatileVariableBase, mNvVariableCache->Size);
+        VariableIndexInvalidate (mNvVariableCache);
+        mVariableModuleGlobal->NonVolatileLastVariableOffset = NonVolatileLastVariableOffset;
+        mVariableModuleGlobal->CommonVariableTotalSize       = CommonVariableTotalSize;
+        mVariableModuleGlobal->CommonUserVariableTotalSize   = CommonUserVariableTotalSize;
+        mVariableModuleGlobal->HwErrVariableTotalSize        = HwErrVariableTotalSize;
+      }
+
+      SynchronizeRuntimeVariableCache (
+        &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
+        0,
+        mNvVariableCache->Size
+        );
+    }
+  }
+
+  mVariableBatchLockHeld = FALSE;
+  ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+
+  if (EFI_ERROR (Status)) {
+    //
+    // Fail the operations that set or deleted a non-volatile variable. After
+    // the staged variables are discarded, a variable deleted by the batch is
+    // found again. The MorLock variable set by the MOR handler was staged
+    // too, so the operation it handled fails as well.
+    //
+    for (Index = 0; Index < EntryCount; Index++) {
+      Entry = &Entries[Index];
+      if (EFI_ERROR (Entry->Status)) {
+        continue;
+      }
+
+      if ((Entry->Attributes & EFI_VARIABLE_NON_VOLATILE) == 0) {
+        DataSize = 0;
+        if ((VariableServiceGetVariable (Entry->VariableName, Entry->VendorGuid, &Attributes, &DataSize, NULL) != EFI_BUFFER_TOO_SMALL) ||
+            ((Attributes & EFI_VARIABLE_NON_VOLATILE) == 0))
+        {
+          continue;
+        }
+      }
+
+      Entry->Status = EFI_DEVICE_ERROR;
+    }
+
+    Status = EFI_DEVICE_ERROR;
+  }
+
+  for (Index = 0; Index < EntryCount; Index++) {
+    Entry = &Entries[Index];
+    if (Entry->Status == EFI_ALREADY_STARTED) {
+      Entry->Status = EFI_SUCCESS;
+    } else if (!EFI_ERROR (Entry->Status)) {
+      SecureBootHook (Entry->VariableName, Entry->VendorGuid);
+    }
+  }
+
+  return Status;
+}
+
 /**
 
   This code returns information about the EFI variables.
@@ -3187,7 +3522,7 @@ VariableServiceQueryVariableInfo (
     }
   }
 
-  AcquireLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  AcquireVariableServicesLock ();
 
   Status = VariableServiceQueryVariableInfoInternal (
              Attributes,
@@ -3196,7 +3531,7 @@ VariableServiceQueryVariableInfo (
              MaximumVariableSize
              );
 
-  ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  ReleaseVariableServicesLock ();
   return Status;
 }
 
@@ -3407,6 +3742,7 @@ FlushHobVariableToFlash (
       }
 
       if (!AtRuntime ()) {
+        VariableIndexDestroy (VariableStoreHeader);
         FreePool ((VOID *)VariableStoreHeader);
       }
     }
@@ -3717,6 +4053,7 @@ VariableCommonInitialize (
   VARIABLE_STORE_HEADER  *VolatileVariableStore;
   UINTN                  ScratchSize;
   EFI_GUID               *VariableGuid;
+  EFI_HOB_GUID_TYPE      *GuidHob;
 
   //
   // Allocate runtime memory for variable driver global structure.
@@ -3805,6 +4142,30 @@ VariableCommonInitialize (
   VolatileVariableStore->Reserved  = 0;
   VolatileVariableStore->Reserved1 = 0;
 
+  //
+  // Index the variable stores to speed up FindVariable ().
+  //
+  VariableIndexCreate (VolatileVariableStore, FALSE);
+  if (mVariableModuleGlobal->VariableGlobal.HobVariableBase != 0) {
+    VariableIndexCreate ((VARIABLE_STORE_HEADER *)(UINTN)mVariableModuleGlobal->VariableGlobal.HobVariableBase, FALSE);
+  }
+
+  VariableIndexCreate (mNvVariableCache, FALSE);
+
+  //
+  // Reuse the index of the non-volatile variable store built in PEI.
+  //
+  GuidHob = GetFirstGuidHob (&gEdkiiVariableHashIndexTableGuid);
+  if (GuidHob != NULL) {
+    VariableIndexImport (
+      mNvVariableCache,
+      mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase,
+      GET_GUID_HOB_DATA (GuidHob),
+      GET_GUID_HOB_DATA_SIZE (GuidHob),
+      mVariableModuleGlobal->VariableGlobal.AuthFormat
+      );
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -17,6 +17,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/Variable.h>
 #include <Protocol/VariableLock.h>
 #include <Protocol/VarCheck.h>
+#include <Protocol/VariableBatch.h>
 #include <Library/PcdLib.h>
 #include <Library/HobLib.h>
 #include <Library/UefiDriverEntryPoint.h>
@@ -39,6 +40,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/SystemNvDataGuid.h>
 #include <Guid/FaultTolerantWrite.h>
 #include <Guid/VarErrorFlag.h>
+#include <Guid/SmmVariableCommon.h>
 
 #include "PrivilegePolymorphic.h"
 
@@ -61,19 +63,42 @@ typedef enum {
   VariableStoreTypeMax
 } VARIABLE_STORE_TYPE;
 
+///
+/// Maximum number of disjoint pending updates of a runtime variable cache. An
+/// update that does not fit is merged with the closest pending update.
+///
+#define VARIABLE_RUNTIME_CACHE_MAX_PENDING_UPDATES  16
+
+typedef struct {
+  UINT32    Offset;
+  UINT32    Length;
+} VARIABLE_RUNTIME_CACHE_UPDATE;
+
 typedef struct {
-  UINT32                   PendingUpdateOffset;
-  UINT32                   PendingUpdateLength;
-  VARIABLE_STORE_HEADER    *Store;
+  UINT32                           PendingUpdateCount;
+  VARIABLE_RUNTIME_CACHE_UPDATE    PendingUpdate[VARIABLE_RUNTIME_CACHE_MAX_PENDING_UPDATES];
+  VARIABLE_STORE_HEADER            *Store;
 } VARIABLE_RUNTIME_CACHE;
 
 typedef struct {
-  BOOLEAN                   *ReadLock;
-  BOOLEAN                   *PendingUpdate;
-  BOOLEAN                   *HobFlushComplete;
-  VARIABLE_RUNTIME_CACHE    VariableRuntimeHobCache;
-  VARIABLE_RUNTIME_CACHE    VariableRuntimeNvCache;
-  VARIABLE_RUNTIME_CACHE    VariableRuntimeVolatileCache;
+  BOOLEAN                           *ReadLock;
+  BOOLEAN                           *PendingUpdate;
+  BOOLEAN                           *HobFlushComplete;
+  VARIABLE_RUNTIME_CACHE            VariableRuntimeHobCache;
+  VARIABLE_RUNTIME_CACHE            VariableRuntimeNvCache;
+  VARIABLE_RUNTIME_CACHE            VariableRuntimeVolatileCache;
+  ///
+  /// Log of the runtime cache updates shared with the SMM variable wrapper
+  /// module, and its size checked when the log was provided.
+  ///
+  SMM_VARIABLE_RUNTIME_CACHE_LOG    *Log;
+  UINT32                            LogSize;
+  ///
+  /// Number of times the pending updates were copied to the runtime caches or
+  /// to the log, and number of bytes copied.
+  ///
+  UINT64                            FlushCount;
+  UINT64                            FlushedBytes;
 } VARIABLE_RUNTIME_CACHE_CONTEXT;
 
 typedef struct {
@@ -530,6 +555,31 @@ VariableServiceSetVariable (
   IN VOID      *Data
   );
 
+/**
+  This code sets a batch of variables, and writes the non-volatile variables
+  to the storage with at most one fault tolerant write.
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and the entries are external input.
+  Each entry is checked as by VariableServiceSetVariable().
+
+  @param[in]      EntryCount    Number of entries in Entries.
+  @param[in, out] Entries       The SetVariable operations to process. The Status
+                                field of each entry is updated.
+
+  @retval EFI_SUCCESS           All the operations were processed.
+  @retval EFI_INVALID_PARAMETER EntryCount is 0, or Entries is NULL.
+  @retval EFI_UNSUPPORTED       ExitBootServices() has already been called.
+  @retval EFI_NOT_AVAILABLE_YET The variable write service is not ready yet.
+  @retval EFI_DEVICE_ERROR      The non-volatile variable storage could not be updated.
+
+**/
+EFI_STATUS
+VariableServiceSetVariableBatch (
+  IN     UINTN                       EntryCount,
+  IN OUT EDKII_VARIABLE_BATCH_ENTRY  *Entries
+  );
+
 /**
 
   This code returns information about the EFI variables.
@@ -0,0 +1,539 @@
+/** @file
+  Hash index of the variables in a variable store.
+
+  FindVariableEx() walks every variable of a store, which gets slow with large
+  stores. When PcdEnableVariableHashIndex is TRUE, the stores of the module
+  get an index of the offsets of their variables, chained in buckets by a hash
+  of the variable name and vendor GUID.
+
+  Variables are only ever appended to a store, or their state is changed in
+  place. The index is extended with the variables appended since the last
+  search, and the candidates it returns are checked like in the linear scan,
+  so state changes need no update. When the variables of a store are moved,
+  by Reclaim() or by a runtime cache synchronization, the index is built
+  again. If a store cannot be indexed, it is searched linearly.
+
+  Caution: This module requires additional review when modified.
+  This driver will have external input - variable data. They may be input in SMM mode.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableParsing.h"
+#include "VariableIndex.h"
+
+///
+/// One index for each of the volatile, HOB and non-volatile stores.
+///
+VARIABLE_STORE_INDEX  *mVariableStoreIndex[VariableStoreTypeMax];
+
+/**
+  Get the bucket heads of a hash index.
+
+  @param[in] Index    Pointer to the hash index.
+
+  @return Pointer to the bucket heads.
+
+**/
+UINT32 *
+VariableIndexHeads (
+  IN VARIABLE_STORE_INDEX  *Index
+  )
+{
+  return (UINT32 *)(Index + 1);
+}
+
+/**
+  Get the bucket tails of a hash index.
+
+  @param[in] Index    Pointer to the hash index.
+
+  @return Pointer to the bucket tails.
+
+**/
+UINT32 *
+VariableIndexTails (
+  IN VARIABLE_STORE_INDEX  *Index
+  )
+{
+  return VariableIndexHeads (Index) + Index->BucketCount;
+}
+
+/**
+  Get the entries of a hash index.
+
+  @param[in] Index    Pointer to the hash index.
+
+  @return Pointer to the entries.
+
+**/
+VARIABLE_INDEX_ENTRY *
+VariableIndexEntries (
+  IN VARIABLE_STORE_INDEX  *Index
+  )
+{
+  return (VARIABLE_INDEX_ENTRY *)(VariableIndexTails (Index) + Index->BucketCount);
+}
+
+/**
+  Find the hash index of a variable store.
+
+  @param[in] StartPtr   Pointer to the first variable of the store.
+
+  @return Pointer to the hash index, or NULL if the store has none.
+
+**/
+VARIABLE_STORE_INDEX *
+VariableIndexGet (
+  IN VARIABLE_HEADER  *StartPtr
+  )
+{
+  UINTN  Slot;
+
+  for (Slot = 0; Slot < ARRAY_SIZE (mVariableStoreIndex); Slot++) {
+    if ((mVariableStoreIndex[Slot] != NULL) &&
+        (GetStartPointer (mVariableStoreIndex[Slot]->Store) == StartPtr))
+    {
+      return mVariableStoreIndex[Slot];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Empty a hash index.
+
+  @param[in, out] Index   Pointer to the hash index.
+
+**/
+VOID
+VariableIndexReset (
+  IN OUT VARIABLE_STORE_INDEX  *Index
+  )
+{
+  SetMem32 (VariableIndexHeads (Index), Index->BucketCount * 2 * sizeof (UINT32), VARIABLE_INDEX_END);
+  Index->EntryCount    = 0;
+  Index->IndexedOffset = (UINT32)((UINTN)GetStartPointer (Index->Store) - (UINTN)Index->Store);
+  Index->Unusable      = FALSE;
+}
+
+/**
+  Add an entry to a hash index.
+
+  @param[in, out] Index     Pointer to the hash index.
+  @param[in]      Hash      Hash of the variable name and vendor GUID.
+  @param[in]      Offset    Offset of the variable header from the variable store header.
+
+**/
+VOID
+VariableIndexAppend (
+  IN OUT VARIABLE_STORE_INDEX  *Index,
+  IN     UINT32                Hash,
+  IN     UINT32                Offset
+  )
+{
+  VARIABLE_INDEX_ENTRY  *Entries;
+  UINT32                *Heads;
+  UINT32                *Tails;
+  UINT32                Bucket;
+
+  Heads   = VariableIndexHeads (Index);
+  Tails   = VariableIndexTails (Index);
+  Entries = VariableIndexEntries (Index);
+  Bucket  = Hash & (Index->BucketCount - 1);
+
+  Entries[Index->EntryCount].Hash   = Hash;
+  Entries[Index->EntryCount].Offset = Offset;
+  Entries[Index->EntryCount].Next   = VARIABLE_INDEX_END;
+  if (Heads[Bucket] == VARIABLE_INDEX_END) {
+    Heads[Bucket] = Index->EntryCount;
+  } else {
+    Entries[Tails[Bucket]].Next = Index->EntryCount;
+  }
+
+  Tails[Bucket] = Index->EntryCount;
+  Index->EntryCount++;
+}
+
+/**
+  Add the variables appended to a store since the last search to its index.
+
+  @param[in, out] Index       Pointer to the hash index.
+  @param[in]      EndPtr      Pointer to the end of the variable store.
+  @param[in]      AuthFormat  TRUE indicates authenticated variables are used.
+                              FALSE indicates authenticated variables are not used.
+
+  @retval TRUE    The index covers all the variables of the store.
+  @retval FALSE   The store could not be indexed.
+
+**/
+BOOLEAN
+VariableIndexUpdate (
+  IN OUT VARIABLE_STORE_INDEX  *Index,
+  IN     VARIABLE_HEADER       *EndPtr,
+  IN     BOOLEAN               AuthFormat
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  CHAR16           *Name;
+  UINTN            NameSize;
+
+  if (Index->DetectRewrite && (Index->Store->Reserved1 != Index->Stamp)) {
+    VariableIndexReset (Index);
+    Index->Stamp            = Index->Store->Reserved1 ^ BIT0;
+    Index->Store->Reserved1 = Index->Stamp;
+  }
+
+  if (Index->Unusable) {
+    return FALSE;
+  }
+
+  for ( Variable = (VARIABLE_HEADER *)((UINTN)Index->Store + Index->IndexedOffset)
+        ; IsValidVariableHeader (Variable, EndPtr)
+        ; Variable = GetNextVariablePtr (Variable, AuthFormat)
+        )
+  {
+    Name     = GetVariableNamePtr (Variable, AuthFormat);
+    NameSize = NameSizeOfVariable (Variable, AuthFormat);
+    if ((Index->EntryCount == Index->MaxEntryCount) ||
+        (NameSize == 0) ||
+        ((UINTN)Name >= (UINTN)EndPtr) ||
+        (NameSize > (UINTN)EndPtr - (UINTN)Name))
+    {
+      Index->Unusable = TRUE;
+      return FALSE;
+    }
+
+    VariableIndexAppend (
+      Index,
+      VariableIndexHash (Name, NameSize, GetVendorGuidPtr (Variable, AuthFormat)),
+      (UINT32)((UINTN)Variable - (UINTN)Index->Store)
+      );
+  }
+
+  Index->IndexedOffset = (UINT32)((UINTN)Variable - (UINTN)Index->Store);
+  return TRUE;
+}
+
+/**
+  Create the hash index of a variable store.
+
+  The index is built when the store is searched for the first time, and it is
+  extended when variables are appended to the store. It must be created before
+  ExitBootServices.
+
+  @param[in] VariableStore    Pointer to the variable store header.
+  @param[in] DetectRewrite    TRUE if the store may be rewritten without a call
+                              to VariableIndexInvalidate().
+
+  @retval EFI_SUCCESS           The index was created.
+  @retval EFI_UNSUPPORTED       The variable hash index is disabled.
+  @retval EFI_OUT_OF_RESOURCES  There is no space for another index.
+
+**/
+EFI_STATUS
+VariableIndexCreate (
+  IN VARIABLE_STORE_HEADER  *VariableStore,
+  IN BOOLEAN                DetectRewrite
+  )
+{
+  VARIABLE_STORE_INDEX  *Index;
+  UINTN                 Slot;
+  UINT32                MaxEntryCount;
+  UINT32                BucketCount;
+
+  if (!FeaturePcdGet (PcdEnableVariableHashIndex)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Index = VariableIndexGet (GetStartPointer (VariableStore));
+  if (Index != NULL) {
+    VariableIndexInvalidate (VariableStore);
+    return EFI_SUCCESS;
+  }
+
+  for (Slot = 0; Slot < ARRAY_SIZE (mVariableStoreIndex); Slot++) {
+    if (mVariableStoreIndex[Slot] == NULL) {
+      break;
+    }
+  }
+
+  if (Slot == ARRAY_SIZE (mVariableStoreIndex)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // The smallest variable has a one character name, so the index can never
+  // run out of entries. There are about four entries in each bucket at most.
+  //
+  MaxEntryCount = VariableStore->Size / HEADER_ALIGN (sizeof (VARIABLE_HEADER) + sizeof (CHAR16));
+  BucketCount   = GetPowerOfTwo32 (MAX (MaxEntryCount / 4, 16));
+
+  Index = AllocateRuntimeZeroPool (
+            sizeof (VARIABLE_STORE_INDEX) +
+            BucketCount * 2 * sizeof (UINT32) +
+            MaxEntryCount * sizeof (VARIABLE_INDEX_ENTRY)
+            );
+  if (Index == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Index->Store         = VariableStore;
+  Index->BucketCount   = BucketCount;
+  Index->MaxEntryCount = MaxEntryCount;
+  Index->DetectRewrite = DetectRewrite;
+  if (DetectRewrite) {
+    Index->Stamp             = VariableStore->Reserved1 ^ BIT0;
+    VariableStore->Reserved1 = Index->Stamp;
+  }
+
+  VariableIndexReset (Index);
+
+  mVariableStoreIndex[Slot] = Index;
+  return EFI_SUCCESS;
+}
+
+/**
+  Destroy the hash index of a variable store that is going to be freed.
+
+  @param[in] VariableStore    Pointer to the variable store header.
+
+**/
+VOID
+VariableIndexDestroy (
+  IN VARIABLE_STORE_HEADER  *VariableStore
+  )
+{
+  UINTN  Slot;
+
+  for (Slot = 0; Slot < ARRAY_SIZE (mVariableStoreIndex); Slot++) {
+    if ((mVariableStoreIndex[Slot] != NULL) && (mVariableStoreIndex[Slot]->Store == VariableStore)) {
+      FreePool (mVariableStoreIndex[Slot]);
+      mVariableStoreIndex[Slot] = NULL;
+    }
+  }
+}
+
+/**
+  Discard the content of the hash index of a variable store, after variables
+  have been moved in the store. The index is built again when the store is
+  searched the next time.
+
+  @param[in] VariableStore    Pointer to the variable store header.
+
+**/
+VOID
+VariableIndexInvalidate (
+  IN VARIABLE_STORE_HEADER  *VariableStore
+  )
+{
+  VARIABLE_STORE_INDEX  *Index;
+
+  Index = VariableIndexGet (GetStartPointer (VariableStore));
+  if (Index != NULL) {
+    VariableIndexReset (Index);
+  }
+}
+
+/**
+  Fill the empty hash index of a variable store with the hash index built by
+  the PEI variable driver, if it describes the same store.
+
+  The PEI hash index only has the variables in the VAR_ADDED and
+  VAR_IN_DELETED_TRANSITION states, the other ones are never returned by a
+  search anyway. Its entries are sorted by hash then by offset, so the
+  variables with the same name keep the variable store order in the buckets.
+
+  Each entry must be the offset of a variable header whose name and data end
+  before the end of the part of the store the PEI hash index covers, so that
+  the searches can read the candidates it returns.
+
+  @param[in] VariableStore    Pointer to the variable store header.
+  @param[in] StoreBase        Address of the variable store in the non-volatile storage.
+  @param[in] HashIndexTable   Pointer to the hash index built by the PEI variable driver.
+  @param[in] HashIndexSize    Size of the hash index built by the PEI variable driver.
+  @param[in] AuthFormat       TRUE indicates authenticated variables are used.
+                              FALSE indicates authenticated variables are not used.
+
+  @retval EFI_SUCCESS         The index was filled.
+  @retval EFI_UNSUPPORTED     The store has no empty index, or the PEI hash index does not match it.
+
+**/
+EFI_STATUS
+VariableIndexImport (
+  IN VARIABLE_STORE_HEADER            *VariableStore,
+  IN EFI_PHYSICAL_ADDRESS             StoreBase,
+  IN CONST VARIABLE_HASH_INDEX_TABLE  *HashIndexTable,
+  IN UINTN                            HashIndexSize,
+  IN BOOLEAN                          AuthFormat
+  )
+{
+  VARIABLE_STORE_INDEX  *Index;
+  VARIABLE_HEADER       *Variable;
+  VARIABLE_HEADER       *EndPtr;
+  UINT32                StartOffset;
+  UINT32                Offset;
+  UINTN                 Size;
+  UINTN                 NameSize;
+  UINTN                 Entry;
+
+  Index = VariableIndexGet (GetStartPointer (VariableStore));
+  if ((Index == NULL) || (Index->EntryCount != 0) || Index->DetectRewrite) {
+    return EFI_UNSUPPORTED;
+  }
+
+  StartOffset = (UINT32)((UINTN)GetStartPointer (VariableStore) - (UINTN)VariableStore);
+  if ((HashIndexSize < sizeof (VARIABLE_HASH_INDEX_TABLE)) ||
+      (HashIndexTable->Overflow != 0) ||
+      (HashIndexTable->StoreBase != StoreBase) ||
+      (HashIndexTable->StoreSize != VariableStore->Size) ||
+      (HashIndexTable->EndOffset < StartOffset) ||
+      (HashIndexTable->EndOffset > VariableStore->Size) ||
+      (HashIndexTable->EntryCount > Index->MaxEntryCount) ||
+      (HashIndexTable->EntryCount > (HashIndexSize - sizeof (VARIABLE_HASH_INDEX_TABLE)) / sizeof (VARIABLE_HASH_INDEX_ENTRY)))
+  {
+    return EFI_UNSUPPORTED;
+  }
+
+  EndPtr = (VARIABLE_HEADER *)((UINTN)VariableStore + HashIndexTable->EndOffset);
+  for (Entry = 0; Entry < HashIndexTable->EntryCount; Entry++) {
+    Offset = HashIndexTable->Entry[Entry].Offset;
+    if ((Offset < StartOffset) ||
+        ((Offset & (HEADER_ALIGNMENT - 1)) != 0) ||
+        (HashIndexTable->EndOffset - Offset < GetVariableHeaderSize (AuthFormat)))
+    {
+      VariableIndexReset (Index);
+      return EFI_UNSUPPORTED;
+    }
+
+    Variable = (VARIABLE_HEADER *)((UINTN)VariableStore + Offset);
+    Size     = HashIndexTable->EndOffset - Offset - GetVariableHeaderSize (AuthFormat);
+    NameSize = NameSizeOfVariable (Variable, AuthFormat);
+    if (!IsValidVariableHeader (Variable, EndPtr) ||
+        (NameSize == 0) ||
+        (NameSize > Size) ||
+        (DataSizeOfVariable (Variable, AuthFormat) > Size - NameSize - GET_PAD_SIZE (NameSize)))
+    {
+      VariableIndexReset (Index);
+      return EFI_UNSUPPORTED;
+    }
+
+    VariableIndexAppend (Index, HashIndexTable->Entry[Entry].Hash, Offset);
+  }
+
+  Index->IndexedOffset = HashIndexTable->EndOffset;
+  return EFI_SUCCESS;
+}
+
+/**
+  Convert the pointers of the hash indexes to virtual addresses.
+
+  @param[in] ConvertPointer   The function converting a pointer.
+
+**/
+VOID
+VariableIndexConvertPointers (
+  IN VARIABLE_INDEX_CONVERT_POINTER  ConvertPointer
+  )
+{
+  UINTN  Slot;
+
+  for (Slot = 0; Slot < ARRAY_SIZE (mVariableStoreIndex); Slot++) {
+    if (mVariableStoreIndex[Slot] != NULL) {
+      ConvertPointer (0x0, (VOID **)&mVariableStoreIndex[Slot]->Store);
+      ConvertPointer (0x0, (VOID **)&mVariableStoreIndex[Slot]);
+    }
+  }
+}
+
+/**
+  Find the variable in the specified variable store with its hash index.
+
+  @param[in]       VariableName        Name of the variable to be found, not an empty string.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+  @param[in]       AuthFormat          TRUE indicates authenticated variables are used.
+                                       FALSE indicates authenticated variables are not used.
+
+  @retval          EFI_SUCCESS         Variable found successfully
+  @retval          EFI_NOT_FOUND       Variable not found
+  @retval          EFI_UNSUPPORTED     The store has no usable index, it must be searched linearly.
+**/
+EFI_STATUS
+VariableIndexFind (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     BOOLEAN                 AuthFormat
+  )
+{
+  VARIABLE_STORE_INDEX  *Index;
+  VARIABLE_INDEX_ENTRY  *Entries;
+  VARIABLE_HEADER       *InDeletedVariable;
+  VARIABLE_HEADER       *Variable;
+  UINTN                 NameSize;
+  UINT32                Hash;
+  UINT32                Entry;
+
+  Index = VariableIndexGet (PtrTrack->StartPtr);
+  if ((Index == NULL) || !VariableIndexUpdate (Index, PtrTrack->EndPtr, AuthFormat)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  NameSize = StrSize (VariableName);
+  Hash     = VariableIndexHash (VariableName, NameSize, VendorGuid);
+  Entries  = VariableIndexEntries (Index);
+
+  //
+  // Same checks as the linear scan of FindVariableEx(), on the variables with
+  // the same hash only. The bucket chains are in variable store order.
+  //
+  PtrTrack->InDeletedTransitionPtr = NULL;
+  InDeletedVariable                = NULL;
+
+  for ( Entry = VariableIndexHeads (Index)[Hash & (Index->BucketCount - 1)]
+        ; Entry != VARIABLE_INDEX_END
+        ; Entry = Entries[Entry].Next
+        )
+  {
+    if (Entries[Entry].Hash != Hash) {
+      continue;
+    }
+
+    Variable = (VARIABLE_HEADER *)((UINTN)Index->Store + Entries[Entry].Offset);
+    if ((Variable->State != VAR_ADDED) &&
+        (Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)))
+    {
+      continue;
+    }
+
+    if (!IgnoreRtCheck && AtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+      continue;
+    }
+
+    if ((NameSizeOfVariable (Variable, AuthFormat) != NameSize) ||
+        !CompareGuid (VendorGuid, GetVendorGuidPtr (Variable, AuthFormat)) ||
+        (CompareMem (VariableName, GetVariableNamePtr (Variable, AuthFormat), NameSize) != 0))
+    {
+      continue;
+    }
+
+    if (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      InDeletedVariable = Variable;
+    } else {
+      PtrTrack->CurrPtr                = Variable;
+      PtrTrack->InDeletedTransitionPtr = InDeletedVariable;
+      return EFI_SUCCESS;
+    }
+  }
+
+  PtrTrack->CurrPtr = InDeletedVariable;
+  return (PtrTrack->CurrPtr == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/** @file
+  The variable store hash index routines shared by the DXE_RUNTIME variable
+  module, the DXE_SMM variable module and the variable runtime cache module.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VARIABLE_INDEX_H_
+#define _VARIABLE_INDEX_H_
+
+#include "Variable.h"
+
+#include <Guid/VariableHashIndexTable.h>
+
+#include "VariableIndexHash.h"
+
+///
+/// Index of an entry in a bucket chain, or the end of the chain.
+///
+#define VARIABLE_INDEX_END  MAX_UINT32
+
+typedef struct {
+  ///
+  /// Hash of the variable name and vendor GUID.
+  ///
+  UINT32    Hash;
+  ///
+  /// Offset of the variable header from the variable store header.
+  ///
+  UINT32    Offset;
+  ///
+  /// Next entry with the same bucket, in variable store order.
+  ///
+  UINT32    Next;
+} VARIABLE_INDEX_ENTRY;
+
+///
+/// The hash index of a variable store. It is followed by the bucket heads,
+/// the bucket tails and the entries.
+///
+typedef struct {
+  VARIABLE_STORE_HEADER    *Store;
+  UINT32                   BucketCount;
+  UINT32                   MaxEntryCount;
+  UINT32                   EntryCount;
+  ///
+  /// Offset of the first variable that has not been indexed yet.
+  ///
+  UINT32                   IndexedOffset;
+  ///
+  /// If the store may be rewritten by another agent, the index writes a stamp
+  /// in the Reserved1 field of the store header and rebuilds itself when the
+  /// stamp is gone.
+  ///
+  BOOLEAN                  DetectRewrite;
+  UINT32                   Stamp;
+  ///
+  /// The store could not be indexed, lookups fall back to a linear scan.
+  ///
+  BOOLEAN                  Unusable;
+} VARIABLE_STORE_INDEX;
+
+/**
+  Converts a pointer to a new virtual address.
+
+  @param[in]      DebugDisposition  Supplies type information for the pointer being converted.
+  @param[in, out] Address           The pointer to a pointer that is to be fixed to be the
+                                    value needed for the new virtual address mapping being
+                                    applied.
+
+  @retval EFI_SUCCESS               The pointer was converted.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *VARIABLE_INDEX_CONVERT_POINTER)(
+  IN     UINTN  DebugDisposition,
+  IN OUT VOID   **Address
+  );
+
+/**
+  Create the hash index of a variable store.
+
+  The index is built when the store is searched for the first time, and it is
+  extended when variables are appended to the store. It must be created before
+  ExitBootServices.
+
+  @param[in] VariableStore    Pointer to the variable store header.
+  @param[in] DetectRewrite    TRUE if the store may be rewritten without a call
+                              to VariableIndexInvalidate().
+
+  @retval EFI_SUCCESS           The index was created.
+  @retval EFI_UNSUPPORTED       The variable hash index is disabled.
+  @retval EFI_OUT_OF_RESOURCES  There is no space for another index.
+
+**/
+EFI_STATUS
+VariableIndexCreate (
+  IN VARIABLE_STORE_HEADER  *VariableStore,
+  IN BOOLEAN                DetectRewrite
+  );
+
+/**
+  Destroy the hash index of a variable store that is going to be freed.
+
+  @param[in] VariableStore    Pointer to the variable store header.
+
+**/
+VOID
+VariableIndexDestroy (
+  IN VARIABLE_STORE_HEADER  *VariableStore
+  );
+
+/**
+  Discard the content of the hash index of a variable store, after variables
+  have been moved in the store. The index is built again when the store is
+  searched the next time.
+
+  @param[in] VariableStore    Pointer to the variable store header.
+
+**/
+VOID
+VariableIndexInvalidate (
+  IN VARIABLE_STORE_HEADER  *VariableStore
+  );
+
+/**
+  Fill the empty hash index of a variable store with the hash index built by
+  the PEI variable driver, if it describes the same store.
+
+  @param[in] VariableStore    Pointer to the variable store header.
+  @param[in] StoreBase        Address of the variable store in the non-volatile storage.
+  @param[in] HashIndexTable   Pointer to the hash index built by the PEI variable driver.
+  @param[in] HashIndexSize    Size of the hash index built by the PEI variable driver.
+  @param[in] AuthFormat       TRUE indicates authenticated variables are used.
+                              FALSE indicates authenticated variables are not used.
+
+  @retval EFI_SUCCESS         The index was filled.
+  @retval EFI_UNSUPPORTED     The store has no empty index, or the PEI hash index does not match it.
+
+**/
+EFI_STATUS
+VariableIndexImport (
+  IN VARIABLE_STORE_HEADER            *VariableStore,
+  IN EFI_PHYSICAL_ADDRESS             StoreBase,
+  IN CONST VARIABLE_HASH_INDEX_TABLE  *HashIndexTable,
+  IN UINTN                            HashIndexSize,
+  IN BOOLEAN                          AuthFormat
+  );
+
+/**
+  Convert the pointers of the hash indexes to virtual addresses.
+
+  @param[in] ConvertPointer   The function converting a pointer.
+
+**/
+VOID
+VariableIndexConvertPointers (
+  IN VARIABLE_INDEX_CONVERT_POINTER  ConvertPointer
+  );
+
+/**
+  Find the variable in the specified variable store with its hash index.
+
+  @param[in]       VariableName        Name of the variable to be found, not an empty string.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+  @param[in]       AuthFormat          TRUE indicates authenticated variables are used.
+                                       FALSE indicates authenticated variables are not used.
+
+  @retval          EFI_SUCCESS         Variable found successfully
+  @retval          EFI_NOT_FOUND       Variable not found
+  @retval          EFI_UNSUPPORTED     The store has no usable index, it must be searched linearly.
+**/
+EFI_STATUS
+VariableIndexFind (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     BOOLEAN                 AuthFormat
+  );
+
+#endif
@@ -0,0 +1,46 @@
+/** @file
+  Hash of the variable hash indexes.
+
+  The PEI variable module publishes the hash index of the non-volatile store,
+  and the DXE_RUNTIME, DXE_SMM and MM_STANDALONE variable modules import it,
+  so they build this file to compute the same hash.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Guid/VariableHashIndexTable.h>
+#include <Library/BaseLib.h>
+
+#include "VariableIndexHash.h"
+
+/**
+  Compute the hash of a variable name and vendor GUID, as defined in
+  VariableHashIndexTable.h.
+
+  @param[in] Name       Pointer to the variable name.
+  @param[in] NameSize   Size of the variable name in bytes, including the null terminator.
+  @param[in] Guid       Pointer to the vendor GUID.
+
+  @return The hash.
+
+**/
+UINT32
+VariableIndexHash (
+  IN CONST CHAR16    *Name,
+  IN UINTN           NameSize,
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  CONST UINT8  *Byte;
+  UINT32       Hash;
+  UINTN        Index;
+
+  Hash = VARIABLE_HASH_INDEX_FNV_BASIS ^ ReadUnaligned32 ((CONST UINT32 *)Guid);
+  Byte = (CONST UINT8 *)Name;
+  for (Index = 0; Index < NameSize; Index++) {
+    Hash = (Hash ^ Byte[Index]) * VARIABLE_HASH_INDEX_FNV_PRIME;
+  }
+
+  return Hash;
+}
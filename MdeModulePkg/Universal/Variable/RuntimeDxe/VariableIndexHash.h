@@ -0,0 +1,32 @@
+/** @file
+  Hash of the variable hash indexes, shared by the PEI variable module and the
+  DXE_RUNTIME, DXE_SMM and MM_STANDALONE variable modules.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VARIABLE_INDEX_HASH_H_
+#define _VARIABLE_INDEX_HASH_H_
+
+#include <Uefi/UefiBaseType.h>
+
+/**
+  Compute the hash of a variable name and vendor GUID, as defined in
+  VariableHashIndexTable.h.
+
+  @param[in] Name       Pointer to the variable name.
+  @param[in] NameSize   Size of the variable name in bytes, including the null terminator.
+  @param[in] Guid       Pointer to the vendor GUID.
+
+  @return The hash.
+
+**/
+UINT32
+VariableIndexHash (
+  IN CONST CHAR16    *Name,
+  IN UINTN           NameSize,
+  IN CONST EFI_GUID  *Guid
+  );
+
+#endif
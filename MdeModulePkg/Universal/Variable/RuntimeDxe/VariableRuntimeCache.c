@@ -18,9 +18,176 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 extern VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
 extern VARIABLE_STORE_HEADER   *mNvVariableCache;
 
+/**
+  Gets the runtime variable cache of a variable store type, and the variable
+  store it caches.
+
+  @param[in]  StoreType         The variable store type.
+  @param[out] VariableStore     Pointer to the variable store header of the store being cached.
+
+  @return The runtime variable cache, or NULL if the store type is not cached.
+
+**/
+STATIC
+VARIABLE_RUNTIME_CACHE *
+GetRuntimeVariableCache (
+  IN  VARIABLE_STORE_TYPE    StoreType,
+  OUT VARIABLE_STORE_HEADER  **VariableStore
+  )
+{
+  VARIABLE_RUNTIME_CACHE_CONTEXT  *VariableRuntimeCacheContext;
+
+  VariableRuntimeCacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
+
+  switch (StoreType) {
+    case VariableStoreTypeVolatile:
+      *VariableStore = (VARIABLE_STORE_HEADER *)(UINTN)mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
+      return &VariableRuntimeCacheContext->VariableRuntimeVolatileCache;
+
+    case VariableStoreTypeHob:
+      if ((VariableRuntimeCacheContext->VariableRuntimeHobCache.Store == NULL) ||
+          (mVariableModuleGlobal->VariableGlobal.HobVariableBase == 0))
+      {
+        return NULL;
+      }
+
+      *VariableStore = (VARIABLE_STORE_HEADER *)(UINTN)mVariableModuleGlobal->VariableGlobal.HobVariableBase;
+      return &VariableRuntimeCacheContext->VariableRuntimeHobCache;
+
+    case VariableStoreTypeNv:
+      *VariableStore = mNvVariableCache;
+      return &VariableRuntimeCacheContext->VariableRuntimeNvCache;
+
+    default:
+      return NULL;
+  }
+}
+
+/**
+  Copies the pending updates of a runtime variable cache from its variable store.
+
+  @param[in, out] VariableRuntimeCache  Variable runtime cache structure for the runtime cache being updated.
+  @param[in]      VariableStore         Pointer to the variable store header of the store being cached.
+
+  @return The number of bytes copied.
+
+**/
+STATIC
+UINTN
+CopyPendingRuntimeVariableCacheUpdates (
+  IN OUT VARIABLE_RUNTIME_CACHE  *VariableRuntimeCache,
+  IN     VARIABLE_STORE_HEADER   *VariableStore
+  )
+{
+  VARIABLE_RUNTIME_CACHE_UPDATE  *Update;
+  UINTN                          Index;
+  UINTN                          Copied;
+
+  Copied = 0;
+  for (Index = 0; Index < VariableRuntimeCache->PendingUpdateCount; Index++) {
+    Update = &VariableRuntimeCache->PendingUpdate[Index];
+    CopyMem (
+      (UINT8 *)VariableRuntimeCache->Store + Update->Offset,
+      (UINT8 *)VariableStore + Update->Offset,
+      Update->Length
+      );
+    Copied += Update->Length;
+  }
+
+  VariableRuntimeCache->PendingUpdateCount = 0;
+  return Copied;
+}
+
+/**
+  Appends the pending updates of the runtime variable caches to the log shared
+  with the SMM variable wrapper module, with the data of the variable stores.
+
+  The pending updates are only appended if they all fit in the log, so that the
+  log is applied in the order of the updates.
+
+  Caution: The log is outside of SMRAM, its used size is checked before it is used.
+
+  @retval TRUE    The pending updates were appended to the log.
+  @retval FALSE   The pending updates do not fit in the log, they are kept.
+
+**/
+STATIC
+BOOLEAN
+LogPendingRuntimeVariableCacheUpdates (
+  VOID
+  )
+{
+  VARIABLE_RUNTIME_CACHE_CONTEXT         *VariableRuntimeCacheContext;
+  VARIABLE_RUNTIME_CACHE                 *VariableRuntimeCache;
+  VARIABLE_STORE_HEADER                  *VariableStore;
+  VARIABLE_RUNTIME_CACHE_UPDATE          *Update;
+  SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD  *Record;
+  VARIABLE_STORE_TYPE                    StoreType;
+  UINTN                                  UsedSize;
+  UINTN                                  NeededSize;
+  UINTN                                  Copied;
+  UINTN                                  Index;
+
+  VariableRuntimeCacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
+
+  UsedSize = VariableRuntimeCacheContext->Log->UsedSize;
+  if ((UsedSize > VariableRuntimeCacheContext->LogSize - SMM_VARIABLE_RUNTIME_CACHE_LOG_HEADER_SIZE) ||
+      ((UsedSize & (sizeof (UINT64) - 1)) != 0))
+  {
+    return FALSE;
+  }
+
+  NeededSize = 0;
+  for (StoreType = (VARIABLE_STORE_TYPE)0; StoreType < VariableStoreTypeMax; StoreType++) {
+    VariableRuntimeCache = GetRuntimeVariableCache (StoreType, &VariableStore);
+    if (VariableRuntimeCache == NULL) {
+      continue;
+    }
+
+    for (Index = 0; Index < VariableRuntimeCache->PendingUpdateCount; Index++) {
+      NeededSize += SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD_SIZE (VariableRuntimeCache->PendingUpdate[Index].Length);
+    }
+  }
+
+  if (NeededSize > VariableRuntimeCacheContext->LogSize - SMM_VARIABLE_RUNTIME_CACHE_LOG_HEADER_SIZE - UsedSize) {
+    return FALSE;
+  }
+
+  Copied = 0;
+  for (StoreType = (VARIABLE_STORE_TYPE)0; StoreType < VariableStoreTypeMax; StoreType++) {
+    VariableRuntimeCache = GetRuntimeVariableCache (StoreType, &VariableStore);
+    if (VariableRuntimeCache == NULL) {
+      continue;
+    }
+
+    for (Index = 0; Index < VariableRuntimeCache->PendingUpdateCount; Index++) {
+      Update            = &VariableRuntimeCache->PendingUpdate[Index];
+      Record            = (SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD *)((UINT8 *)VariableRuntimeCacheContext->Log + SMM_VARIABLE_RUNTIME_CACHE_LOG_HEADER_SIZE + UsedSize);
+      Record->StoreType = (UINT32)StoreType;
+      Record->Offset    = Update->Offset;
+      Record->Length    = Update->Length;
+      CopyMem (Record + 1, (UINT8 *)VariableStore + Update->Offset, Update->Length);
+      UsedSize += SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD_SIZE (Update->Length);
+      Copied   += Update->Length;
+    }
+
+    VariableRuntimeCache->PendingUpdateCount = 0;
+  }
+
+  VariableRuntimeCacheContext->Log->UsedSize = (UINT32)UsedSize;
+
+  VariableRuntimeCacheContext->FlushCount++;
+  VariableRuntimeCacheContext->FlushedBytes += Copied;
+  DEBUG ((DEBUG_VERBOSE, "Variable: Runtime cache log appended 0x%x bytes\n", Copied));
+  return TRUE;
+}
+
 /**
   Copies any pending updates to runtime variable caches.
 
+  The SMM variable wrapper module must have applied the log of the runtime cache
+  updates before, as the log is discarded.
+
   @retval EFI_UNSUPPORTED         The volatile store to be updated is not initialized properly.
   @retval EFI_SUCCESS             The volatile store was updated successfully.
 
@@ -31,6 +198,10 @@ FlushPendingRuntimeVariableCacheUpdates (
   )
 {
   VARIABLE_RUNTIME_CACHE_CONTEXT  *VariableRuntimeCacheContext;
+  VARIABLE_RUNTIME_CACHE          *VariableRuntimeCache;
+  VARIABLE_STORE_HEADER           *VariableStore;
+  VARIABLE_STORE_TYPE             StoreType;
+  UINTN                           Copied;
 
   VariableRuntimeCacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
 
@@ -41,69 +212,158 @@ FlushPendingRuntimeVariableCacheUpdates (
     return EFI_UNSUPPORTED;
   }
 
-  if (*(VariableRuntimeCacheContext->PendingUpdate)) {
-    if ((VariableRuntimeCacheContext->VariableRuntimeHobCache.Store != NULL) &&
-        (mVariableModuleGlobal->VariableGlobal.HobVariableBase > 0))
-    {
-      CopyMem (
-        (VOID *)(
-                 ((UINT8 *)(UINTN)VariableRuntimeCacheContext->VariableRuntimeHobCache.Store) +
-                 VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateOffset
-                 ),
-        (VOID *)(
-                 ((UINT8 *)(UINTN)mVariableModuleGlobal->VariableGlobal.HobVariableBase) +
-                 VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateOffset
-                 ),
-        VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateLength
-        );
-      VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateLength = 0;
-      VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateOffset = 0;
+  //
+  // The pending updates are copied even if PendingUpdate was cleared by the SMM
+  // variable wrapper module when it applied the log, as they were not in it.
+  //
+  Copied = 0;
+  for (StoreType = (VARIABLE_STORE_TYPE)0; StoreType < VariableStoreTypeMax; StoreType++) {
+    VariableRuntimeCache = GetRuntimeVariableCache (StoreType, &VariableStore);
+    if (VariableRuntimeCache != NULL) {
+      Copied += CopyPendingRuntimeVariableCacheUpdates (VariableRuntimeCache, VariableStore);
     }
+  }
 
-    CopyMem (
-      (VOID *)(
-               ((UINT8 *)(UINTN)VariableRuntimeCacheContext->VariableRuntimeNvCache.Store) +
-               VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateOffset
-               ),
-      (VOID *)(
-               ((UINT8 *)(UINTN)mNvVariableCache) +
-               VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateOffset
-               ),
-      VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateLength
-      );
-    VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateLength = 0;
-    VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateOffset = 0;
+  if (VariableRuntimeCacheContext->Log != NULL) {
+    VariableRuntimeCacheContext->Log->UsedSize   = 0;
+    VariableRuntimeCacheContext->Log->Incomplete = FALSE;
+  }
 
-    CopyMem (
-      (VOID *)(
-               ((UINT8 *)(UINTN)VariableRuntimeCacheContext->VariableRuntimeVolatileCache.Store) +
-               VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset
-               ),
-      (VOID *)(
-               ((UINT8 *)(UINTN)mVariableModuleGlobal->VariableGlobal.VolatileVariableBase) +
-               VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset
-               ),
-      VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength
-      );
-    VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength = 0;
-    VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset = 0;
-    *(VariableRuntimeCacheContext->PendingUpdate)                                 = FALSE;
+  if (*(VariableRuntimeCacheContext->PendingUpdate) || (Copied != 0)) {
+    *(VariableRuntimeCacheContext->PendingUpdate) = FALSE;
+
+    VariableRuntimeCacheContext->FlushCount++;
+    VariableRuntimeCacheContext->FlushedBytes += Copied;
+    DEBUG ((DEBUG_VERBOSE, "Variable: Runtime cache sync copied 0x%x bytes\n", Copied));
   }
 
   return EFI_SUCCESS;
 }
 
+/**
+  Adds an update of a variable store to the pending updates of its runtime cache.
+
+  The update is merged with the pending updates it overlaps or touches. If there
+  are too many pending updates, it is merged with the closest one.
+
+  @param[in, out] VariableRuntimeCache  Variable runtime cache structure for the runtime cache being updated.
+  @param[in]      Offset                Offset in bytes of the update.
+  @param[in]      Length                Length of data in bytes of the update.
+
+**/
+STATIC
+VOID
+AddPendingRuntimeVariableCacheUpdate (
+  IN OUT VARIABLE_RUNTIME_CACHE  *VariableRuntimeCache,
+  IN     UINTN                   Offset,
+  IN     UINTN                   Length
+  )
+{
+  VARIABLE_RUNTIME_CACHE_UPDATE  *Update;
+  UINTN                          Index;
+  UINTN                          Start;
+  UINTN                          End;
+  UINTN                          Gap;
+  UINTN                          ClosestGap;
+  UINTN                          Closest;
+
+  if (Length == 0) {
+    return;
+  }
+
+  Start = Offset;
+  End   = Offset + Length;
+
+  //
+  // Take out the pending updates that overlap or touch the update.
+  //
+  Index = 0;
+  while (Index < VariableRuntimeCache->PendingUpdateCount) {
+    Update = &VariableRuntimeCache->PendingUpdate[Index];
+    if ((Update->Offset <= End) && (Start <= (UINTN)Update->Offset + Update->Length)) {
+      Start   = MIN (Start, Update->Offset);
+      End     = MAX (End, (UINTN)Update->Offset + Update->Length);
+      *Update = VariableRuntimeCache->PendingUpdate[--VariableRuntimeCache->PendingUpdateCount];
+    } else {
+      Index++;
+    }
+  }
+
+  if (VariableRuntimeCache->PendingUpdateCount == VARIABLE_RUNTIME_CACHE_MAX_PENDING_UPDATES) {
+    //
+    // Take out the closest pending update. No other pending update is between
+    // them, so the merged update does not overlap any.
+    //
+    Closest    = 0;
+    ClosestGap = MAX_UINTN;
+    for (Index = 0; Index < VariableRuntimeCache->PendingUpdateCount; Index++) {
+      Update = &VariableRuntimeCache->PendingUpdate[Index];
+      if (Update->Offset > End) {
+        Gap = Update->Offset - End;
+      } else {
+        Gap = Start - ((UINTN)Update->Offset + Update->Length);
+      }
+
+      if (Gap < ClosestGap) {
+        Closest    = Index;
+        ClosestGap = Gap;
+      }
+    }
+
+    Update  = &VariableRuntimeCache->PendingUpdate[Closest];
+    Start   = MIN (Start, Update->Offset);
+    End     = MAX (End, (UINTN)Update->Offset + Update->Length);
+    *Update = VariableRuntimeCache->PendingUpdate[--VariableRuntimeCache->PendingUpdateCount];
+  }
+
+  Update         = &VariableRuntimeCache->PendingUpdate[VariableRuntimeCache->PendingUpdateCount++];
+  Update->Offset = (UINT32)Start;
+  Update->Length = (UINT32)(End - Start);
+}
+
+/**
+  Records an update of a variable store, that is copied to its runtime cache with
+  the next synchronization.
+
+  @param[in] VariableRuntimeCache Variable runtime cache structure for the runtime cache being updated.
+  @param[in] Offset               Offset in bytes of the update.
+  @param[in] Length               Length of data in bytes of the update.
+
+**/
+VOID
+RecordRuntimeVariableCacheUpdate (
+  IN  VARIABLE_RUNTIME_CACHE  *VariableRuntimeCache,
+  IN  UINTN                   Offset,
+  IN  UINTN                   Length
+  )
+{
+  if ((VariableRuntimeCache->Store == NULL) ||
+      (mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate == NULL))
+  {
+    return;
+  }
+
+  AddPendingRuntimeVariableCacheUpdate (VariableRuntimeCache, Offset, Length);
+  if (VariableRuntimeCache->PendingUpdateCount != 0) {
+    *(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate) = TRUE;
+  }
+}
+
 /**
   Synchronizes the runtime variable caches with all pending updates outside runtime.
 
-  Ensures all conditions are met to maintain coherency for runtime cache updates. This function will attempt
-  to write the given update (and any other pending updates) if the ReadLock is available. Otherwise, the
-  update is added as a pending update for the given variable store and it will be flushed to the runtime cache
-  at the next opportunity the ReadLock is available.
+  Ensures all conditions are met to maintain coherency for runtime cache updates. If the SMM variable wrapper
+  module provided a log of the runtime cache updates, the given update (and any other pending updates) is
+  appended to the log if the ReadLock is available, and the wrapper module applies the log before it reads
+  the runtime caches. Otherwise, the update is written to the runtime cache if the ReadLock is available.
+  An update that is neither written nor logged is kept as a pending update, and it is flushed to the runtime
+  cache with the next SMM_VARIABLE_FUNCTION_SYNC_RUNTIME_CACHE request, or at the next opportunity the
+  ReadLock is available if there is no log.
 
   @param[in] VariableRuntimeCache Variable runtime cache structure for the runtime cache being synchronized.
   @param[in] Offset               Offset in bytes to apply the update.
-  @param[in] Length               Length of data in bytes of the update.
+  @param[in] Length               Length of data in bytes of the update. It is 0 to only write the updates
+                                  recorded with RecordRuntimeVariableCacheUpdate().
 
   @retval EFI_SUCCESS             The update was added as a pending update successfully. If the variable runtime
                                   cache ReadLock was available, the runtime cache was updated successfully.
@@ -117,6 +377,8 @@ SynchronizeRuntimeVariableCache (
   IN  UINTN                   Length
   )
 {
+  VARIABLE_RUNTIME_CACHE_CONTEXT  *VariableRuntimeCacheContext;
+
   if (VariableRuntimeCache == NULL) {
     return EFI_INVALID_PARAMETER;
   } else if (VariableRuntimeCache->Store == NULL) {
@@ -131,27 +393,35 @@ SynchronizeRuntimeVariableCache (
     return EFI_UNSUPPORTED;
   }
 
-  if (*(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate) &&
-      (VariableRuntimeCache->PendingUpdateLength > 0))
+  VariableRuntimeCacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
+
+  if (Length != 0) {
+    AddPendingRuntimeVariableCacheUpdate (VariableRuntimeCache, Offset, Length);
+    *(VariableRuntimeCacheContext->PendingUpdate) = TRUE;
+  }
+
+  if (VariableRuntimeCacheContext->Log == NULL) {
+    if (*(VariableRuntimeCacheContext->ReadLock) == FALSE) {
+      return FlushPendingRuntimeVariableCacheUpdates ();
+    }
+
+    return EFI_SUCCESS;
+  }
+
+  if (!*(VariableRuntimeCacheContext->PendingUpdate)) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // The log is not changed while the SMM variable wrapper module reads the
+  // runtime caches, as it may be applying it. The updates that are not logged
+  // are copied with the next SMM_VARIABLE_FUNCTION_SYNC_RUNTIME_CACHE request.
+  //
+  if (*(VariableRuntimeCacheContext->ReadLock) ||
+      VariableRuntimeCacheContext->Log->Incomplete ||
+      !LogPendingRuntimeVariableCacheUpdates ())
   {
-    VariableRuntimeCache->PendingUpdateLength =
-      (UINT32)(
-               MAX (
-                 (UINTN)(VariableRuntimeCache->PendingUpdateOffset + VariableRuntimeCache->PendingUpdateLength),
-                 Offset + Length
-                 ) - MIN ((UINTN)VariableRuntimeCache->PendingUpdateOffset, Offset)
-               );
-    VariableRuntimeCache->PendingUpdateOffset =
-      (UINT32)MIN ((UINTN)VariableRuntimeCache->PendingUpdateOffset, Offset);
-  } else {
-    VariableRuntimeCache->PendingUpdateLength = (UINT32)Length;
-    VariableRuntimeCache->PendingUpdateOffset = (UINT32)Offset;
-  }
-
-  *(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate) = TRUE;
-
-  if (*(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.ReadLock) == FALSE) {
-    return FlushPendingRuntimeVariableCacheUpdates ();
+    VariableRuntimeCacheContext->Log->Incomplete = TRUE;
   }
 
   return EFI_SUCCESS;
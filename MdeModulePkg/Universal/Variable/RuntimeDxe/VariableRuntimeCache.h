@@ -24,17 +24,37 @@ FlushPendingRuntimeVariableCacheUpdates (
   VOID
   );
 
+/**
+  Records an update of a variable store, that is copied to its runtime cache with
+  the next synchronization.
+
+  @param[in] VariableRuntimeCache Variable runtime cache structure for the runtime cache being updated.
+  @param[in] Offset               Offset in bytes of the update.
+  @param[in] Length               Length of data in bytes of the update.
+
+**/
+VOID
+RecordRuntimeVariableCacheUpdate (
+  IN  VARIABLE_RUNTIME_CACHE  *VariableRuntimeCache,
+  IN  UINTN                   Offset,
+  IN  UINTN                   Length
+  );
+
 /**
   Synchronizes the runtime variable caches with all pending updates outside runtime.
 
-  Ensures all conditions are met to maintain coherency for runtime cache updates. This function will attempt
-  to write the given update (and any other pending updates) if the ReadLock is available. Otherwise, the
-  update is added as a pending update for the given variable store and it will be flushed to the runtime cache
-  at the next opportunity the ReadLock is available.
+  Ensures all conditions are met to maintain coherency for runtime cache updates. If the SMM variable wrapper
+  module provided a log of the runtime cache updates, the given update (and any other pending updates) is
+  appended to the log if the ReadLock is available, and the wrapper module applies the log before it reads
+  the runtime caches. Otherwise, the update is written to the runtime cache if the ReadLock is available.
+  An update that is neither written nor logged is kept as a pending update, and it is flushed to the runtime
+  cache with the next SMM_VARIABLE_FUNCTION_SYNC_RUNTIME_CACHE request, or at the next opportunity the
+  ReadLock is available if there is no log.
 
   @param[in] VariableRuntimeCache Variable runtime cache structure for the runtime cache being synchronized.
   @param[in] Offset               Offset in bytes to apply the update.
-  @param[in] Length               Length of data in bytes of the update.
+  @param[in] Length               Length of data in bytes of the update. It is 0 to only write the updates
+                                  recorded with RecordRuntimeVariableCacheUpdate().
 
   @retval EFI_SUCCESS             The update was added as a pending update successfully. If the variable runtime
                                   cache ReadLock was available, the runtime cache was updated successfully.
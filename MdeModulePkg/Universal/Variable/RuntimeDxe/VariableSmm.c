@@ -11,7 +11,7 @@
   SmmVariableHandler() will receive untrusted input and do basic validation.
 
   Each sub function VariableServiceGetVariable(), VariableServiceGetNextVariableName(),
-  VariableServiceSetVariable(), VariableServiceQueryVariableInfo(), ReclaimForOS(),
+  VariableServiceSetVariable(), SmmSetVariables(), VariableServiceQueryVariableInfo(), ReclaimForOS(),
   SmmVariableGetStatistics() should also do validation based on its own knowledge.
 
 Copyright (c) 2010 - 2019, Intel Corporation. All rights reserved.<BR>
@@ -424,6 +424,107 @@ SmmVariableGetStatistics (
   return EFI_SUCCESS;
 }
 
+/**
+  Set the batch of variables of a communicate buffer payload.
+
+  Caution: This function may receive untrusted input.
+  The payload is external input, so this function will validate each entry
+  carefully to avoid buffer overflow.
+
+  @param[in, out] SetVariables   Pointer to the payload, copied in SMRAM.
+  @param[in]      PayloadSize    Size of the payload.
+
+  @retval EFI_ACCESS_DENIED      The payload is invalid.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to process the batch.
+  @retval Others                 The status returned by VariableServiceSetVariableBatch().
+
+**/
+EFI_STATUS
+SmmSetVariables (
+  IN OUT SMM_VARIABLE_COMMUNICATE_SET_VARIABLES  *SetVariables,
+  IN     UINTN                                   PayloadSize
+  )
+{
+  EFI_STATUS                                    Status;
+  EDKII_VARIABLE_BATCH_ENTRY                    *Entries;
+  SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY  *CommEntry;
+  UINTN                                         EntryCount;
+  UINTN                                         Index;
+  UINTN                                         Offset;
+  UINTN                                         Remaining;
+
+  Offset     = ALIGN_VALUE (sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES), sizeof (UINT64));
+  EntryCount = SetVariables->EntryCount;
+  if ((PayloadSize < Offset) ||
+      (EntryCount == 0) ||
+      (EntryCount > (PayloadSize - Offset) / OFFSET_OF (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY, Name)))
+  {
+    return EFI_ACCESS_DENIED;
+  }
+
+  Entries = AllocatePool (EntryCount * sizeof (EDKII_VARIABLE_BATCH_ENTRY));
+  if (Entries == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < EntryCount; Index++) {
+    Remaining = PayloadSize - Offset;
+    if (Remaining < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY, Name)) {
+      Status = EFI_ACCESS_DENIED;
+      goto Done;
+    }
+
+    CommEntry  = (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY *)((UINT8 *)SetVariables + Offset);
+    Remaining -= OFFSET_OF (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY, Name);
+    if ((CommEntry->NameSize > Remaining) || (CommEntry->DataSize > Remaining - CommEntry->NameSize)) {
+      DEBUG ((DEBUG_ERROR, "SetVariables: Data size exceed communication buffer size limit!\n"));
+      Status = EFI_ACCESS_DENIED;
+      goto Done;
+    }
+
+    //
+    // The VariableSpeculationBarrier() call here is to ensure the previous
+    // range/content checks for the payload have been completed before the
+    // subsequent consumption of the payload content.
+    //
+    VariableSpeculationBarrier ();
+    if ((CommEntry->NameSize < sizeof (CHAR16)) || (CommEntry->Name[CommEntry->NameSize/sizeof (CHAR16) - 1] != L'\0')) {
+      //
+      // Make sure VariableName is A Null-terminated string.
+      //
+      Status = EFI_ACCESS_DENIED;
+      goto Done;
+    }
+
+    Entries[Index].VariableName = CommEntry->Name;
+    Entries[Index].VendorGuid   = &CommEntry->Guid;
+    Entries[Index].Attributes   = CommEntry->Attributes;
+    Entries[Index].DataSize     = CommEntry->DataSize;
+    Entries[Index].Data         = (UINT8 *)CommEntry->Name + CommEntry->NameSize;
+
+    //
+    // The padding of the last entry may be missing.
+    //
+    Offset += MIN (
+                SMM_VARIABLE_SET_VARIABLES_ENTRY_SIZE (CommEntry->NameSize, CommEntry->DataSize),
+                PayloadSize - Offset
+                );
+  }
+
+  Status = VariableServiceSetVariableBatch (EntryCount, Entries);
+
+  if (!EFI_ERROR (Status) || (Status == EFI_DEVICE_ERROR)) {
+    for (Index = 0; Index < EntryCount; Index++) {
+      CommEntry         = BASE_CR (Entries[Index].VariableName, SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY, Name);
+      CommEntry->Status = Entries[Index].Status;
+    }
+  }
+
+Done:
+  FreePool (Entries);
+  return Status;
+}
+
 /**
   Communication service SMI Handler entry.
 
@@ -432,7 +533,7 @@ SmmVariableGetStatistics (
   Caution: This function may receive untrusted input.
   This variable data and communicate buffer are external input, so this function will do basic validation.
   Each sub function VariableServiceGetVariable(), VariableServiceGetNextVariableName(),
-  VariableServiceSetVariable(), VariableServiceQueryVariableInfo(), ReclaimForOS(),
+  VariableServiceSetVariable(), SmmSetVariables(), VariableServiceQueryVariableInfo(), ReclaimForOS(),
   SmmVariableGetStatistics() should also do validation based on its own knowledge.
 
   @param[in]     DispatchHandle  The unique handle assigned to this handler by SmiHandlerRegister().
@@ -476,6 +577,7 @@ SmmVariableHandler (
   UINTN                                                    NameBufferSize;
   UINTN                                                    CommBufferPayloadSize;
   UINTN                                                    TempCommBufferSize;
+  UINT32                                                   LogSize;
 
   //
   // If input is invalid, stop processing this SMI
@@ -665,6 +767,20 @@ SmmVariableHandler (
                  );
       break;
 
+    case SMM_VARIABLE_FUNCTION_SET_VARIABLES:
+      if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES)) {
+        DEBUG ((DEBUG_ERROR, "SetVariables: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+
+      //
+      // Copy the input communicate buffer payload to pre-allocated SMM variable buffer payload.
+      //
+      CopyMem (mVariableBufferPayload, SmmVariableFunctionHeader->Data, CommBufferPayloadSize);
+      Status = SmmSetVariables ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLES *)mVariableBufferPayload, CommBufferPayloadSize);
+      CopyMem (SmmVariableFunctionHeader->Data, mVariableBufferPayload, CommBufferPayloadSize);
+      break;
+
     case SMM_VARIABLE_FUNCTION_QUERY_VARIABLE_INFO:
       if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_QUERY_VARIABLE_INFO)) {
         DEBUG ((DEBUG_ERROR, "QueryVariableInfo: SMM communication buffer size invalid!\n"));
@@ -717,6 +833,12 @@ SmmVariableHandler (
     case SMM_VARIABLE_FUNCTION_EXIT_BOOT_SERVICE:
       mAtRuntime = TRUE;
       Status     = EFI_SUCCESS;
+      DEBUG ((
+        DEBUG_INFO,
+        "Variable: Runtime cache synchronized %ld times, 0x%lx bytes copied\n",
+        mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.FlushCount,
+        mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.FlushedBytes
+        ));
       break;
 
     case SMM_VARIABLE_FUNCTION_GET_STATISTICS:
@@ -840,7 +962,8 @@ SmmVariableHandler (
           (RuntimeVariableCacheContext->RuntimeNvCache == NULL) ||
           (RuntimeVariableCacheContext->PendingUpdate == NULL) ||
           (RuntimeVariableCacheContext->ReadLock == NULL) ||
-          (RuntimeVariableCacheContext->HobFlushComplete == NULL))
+          (RuntimeVariableCacheContext->HobFlushComplete == NULL) ||
+          (RuntimeVariableCacheContext->RuntimeCacheLog == NULL))
       {
         DEBUG ((DEBUG_ERROR, "InitRuntimeVariableCacheContext: Required runtime cache buffer is NULL!\n"));
         Status = EFI_ACCESS_DENIED;
@@ -860,6 +983,13 @@ SmmVariableHandler (
         goto EXIT;
       }
 
+      LogSize = RuntimeVariableCacheContext->RuntimeCacheLog->Size;
+      if (LogSize < SMM_VARIABLE_RUNTIME_CACHE_LOG_HEADER_SIZE) {
+        DEBUG ((DEBUG_ERROR, "InitRuntimeVariableCacheContext: The runtime cache log size is invalid!\n"));
+        Status = EFI_ACCESS_DENIED;
+        goto EXIT;
+      }
+
       //
       // Verify runtime buffers do not overlap with SMRAM ranges.
       //
@@ -924,6 +1054,16 @@ SmmVariableHandler (
         goto EXIT;
       }
 
+      if (!VariableSmmIsBufferOutsideSmmValid (
+             (UINTN)RuntimeVariableCacheContext->RuntimeCacheLog,
+             LogSize
+             ))
+      {
+        DEBUG ((DEBUG_ERROR, "InitRuntimeVariableCacheContext: Runtime cache log buffer in SMRAM or overflow!\n"));
+        Status = EFI_ACCESS_DENIED;
+        goto EXIT;
+      }
+
       VariableCacheContext                                     = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
       VariableCacheContext->VariableRuntimeHobCache.Store      = RuntimeVariableCacheContext->RuntimeHobCache;
       VariableCacheContext->VariableRuntimeVolatileCache.Store = RuntimeVariableCacheContext->RuntimeVolatileCache;
@@ -931,31 +1071,38 @@ SmmVariableHandler (
       VariableCacheContext->PendingUpdate                      = RuntimeVariableCacheContext->PendingUpdate;
       VariableCacheContext->ReadLock                           = RuntimeVariableCacheContext->ReadLock;
       VariableCacheContext->HobFlushComplete                   = RuntimeVariableCacheContext->HobFlushComplete;
+      VariableCacheContext->Log                                = RuntimeVariableCacheContext->RuntimeCacheLog;
+      VariableCacheContext->LogSize                            = LogSize;
 
       // Set up the intial pending request since the RT cache needs to be in sync with SMM cache
-      VariableCacheContext->VariableRuntimeHobCache.PendingUpdateOffset = 0;
-      VariableCacheContext->VariableRuntimeHobCache.PendingUpdateLength = 0;
+      VariableCacheContext->VariableRuntimeHobCache.PendingUpdateCount = 0;
       if ((mVariableModuleGlobal->VariableGlobal.HobVariableBase > 0) &&
           (VariableCacheContext->VariableRuntimeHobCache.Store != NULL))
       {
-        VariableCache                                                     = (VARIABLE_STORE_HEADER *)(UINTN)mVariableModuleGlobal->VariableGlobal.HobVariableBase;
-        VariableCacheContext->VariableRuntimeHobCache.PendingUpdateLength = (UINT32)((UINTN)GetEndPointer (VariableCache) - (UINTN)VariableCache);
+        VariableCache                                                         = (VARIABLE_STORE_HEADER *)(UINTN)mVariableModuleGlobal->VariableGlobal.HobVariableBase;
+        VariableCacheContext->VariableRuntimeHobCache.PendingUpdateCount      = 1;
+        VariableCacheContext->VariableRuntimeHobCache.PendingUpdate[0].Offset = 0;
+        VariableCacheContext->VariableRuntimeHobCache.PendingUpdate[0].Length = (UINT32)((UINTN)GetEndPointer (VariableCache) - (UINTN)VariableCache);
         CopyGuid (&(VariableCacheContext->VariableRuntimeHobCache.Store->Signature), &(VariableCache->Signature));
       }
 
-      VariableCache                                                          = (VARIABLE_STORE_HEADER  *)(UINTN)mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
-      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset = 0;
-      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength = (UINT32)((UINTN)GetEndPointer (VariableCache) - (UINTN)VariableCache);
+      VariableCache                                                              = (VARIABLE_STORE_HEADER  *)(UINTN)mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
+      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateCount      = 1;
+      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdate[0].Offset = 0;
+      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdate[0].Length = (UINT32)((UINTN)GetEndPointer (VariableCache) - (UINTN)VariableCache);
       CopyGuid (&(VariableCacheContext->VariableRuntimeVolatileCache.Store->Signature), &(VariableCache->Signature));
 
-      VariableCache                                                    = (VARIABLE_STORE_HEADER  *)(UINTN)mNvVariableCache;
-      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateOffset = 0;
-      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateLength = (UINT32)((UINTN)GetEndPointer (VariableCache) - (UINTN)VariableCache);
+      VariableCache                                                        = (VARIABLE_STORE_HEADER  *)(UINTN)mNvVariableCache;
+      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateCount      = 1;
+      VariableCacheContext->VariableRuntimeNvCache.PendingUpdate[0].Offset = 0;
+      VariableCacheContext->VariableRuntimeNvCache.PendingUpdate[0].Length = (UINT32)((UINTN)GetEndPointer (VariableCache) - (UINTN)VariableCache);
       CopyGuid (&(VariableCacheContext->VariableRuntimeNvCache.Store->Signature), &(VariableCache->Signature));
 
       *(VariableCacheContext->PendingUpdate)    = TRUE;
       *(VariableCacheContext->ReadLock)         = FALSE;
       *(VariableCacheContext->HobFlushComplete) = FALSE;
+      VariableCacheContext->Log->UsedSize       = 0;
+      VariableCacheContext->Log->Incomplete     = TRUE;
 
       Status = EFI_SUCCESS;
       break;
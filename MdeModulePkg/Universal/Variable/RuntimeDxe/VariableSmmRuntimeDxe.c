@@ -25,6 +25,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/SmmVariable.h>
 #include <Protocol/VariableLock.h>
 #include <Protocol/VarCheck.h>
+#include <Protocol/VariableBatch.h>
 
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
@@ -42,6 +43,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "PrivilegePolymorphic.h"
 #include "VariableParsing.h"
+#include "VariableIndex.h"
 
 EFI_HANDLE                      mHandle                              = NULL;
 EFI_SMM_VARIABLE_PROTOCOL       *mSmmVariable                        = NULL;
@@ -53,6 +55,7 @@ VARIABLE_INFO_ENTRY             *mVariableInfo                       = NULL;
 VARIABLE_STORE_HEADER           *mVariableRuntimeHobCacheBuffer      = NULL;
 VARIABLE_STORE_HEADER           *mVariableRuntimeNvCacheBuffer       = NULL;
 VARIABLE_STORE_HEADER           *mVariableRuntimeVolatileCacheBuffer = NULL;
+SMM_VARIABLE_RUNTIME_CACHE_LOG  *mVariableRuntimeCacheLog            = NULL;
 UINTN                           mVariableBufferSize;
 UINTN                           mVariableRuntimeHobCacheBufferSize;
 UINTN                           mVariableRuntimeNvCacheBufferSize;
@@ -65,6 +68,7 @@ BOOLEAN                         mHobFlushComplete;
 EFI_LOCK                        mVariableServicesLock;
 EDKII_VARIABLE_LOCK_PROTOCOL    mVariableLock;
 EDKII_VAR_CHECK_PROTOCOL        mVarCheck;
+EDKII_VARIABLE_BATCH_PROTOCOL   mVariableBatch;
 
 /**
   The logic to initialize the VariablePolicy engine is in its own file.
@@ -214,6 +218,48 @@ InitVariableCache (
   return EFI_SUCCESS;
 }
 
+/**
+  Initialize the log of the runtime cache updates, that SMM appends the updates
+  of its variable stores to.
+
+  @param[out]     VariableCacheLog        A pointer to pointer of the log.
+
+  @retval EFI_SUCCESS             The log was allocated and initialized successfully.
+  @retval EFI_OUT_OF_RESOURCES    Insufficient resources are available to allocate the log.
+
+**/
+EFI_STATUS
+InitVariableCacheLog (
+  OUT    SMM_VARIABLE_RUNTIME_CACHE_LOG  **VariableCacheLog
+  )
+{
+  EFI_STATUS  Status;
+
+  *VariableCacheLog = (SMM_VARIABLE_RUNTIME_CACHE_LOG *)AllocateRuntimePages (
+                                                          EFI_SIZE_TO_PAGES (SMM_VARIABLE_RUNTIME_CACHE_LOG_SIZE)
+                                                          );
+  if (*VariableCacheLog == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Request to unblock the newly allocated log region to be accessible from inside MM
+  //
+  Status = MmUnblockMemoryRequest (
+             (EFI_PHYSICAL_ADDRESS)(UINTN)*VariableCacheLog,
+             EFI_SIZE_TO_PAGES (SMM_VARIABLE_RUNTIME_CACHE_LOG_SIZE)
+             );
+  if ((Status != EFI_UNSUPPORTED) && EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ZeroMem (*VariableCacheLog, sizeof (SMM_VARIABLE_RUNTIME_CACHE_LOG));
+  (*VariableCacheLog)->Size       = SMM_VARIABLE_RUNTIME_CACHE_LOG_SIZE;
+  (*VariableCacheLog)->Incomplete = TRUE;
+
+  return EFI_SUCCESS;
+}
+
 /**
   Initialize the communicate buffer using DataSize and Function.
 
@@ -558,9 +604,75 @@ SyncRuntimeCache (
   SendCommunicateBuffer (0);
 }
 
+/**
+  Applies the runtime cache updates logged by SMM to the runtime caches.
+
+**/
+VOID
+ApplyRuntimeCacheLog (
+  VOID
+  )
+{
+  SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD  *Record;
+  VARIABLE_STORE_HEADER                  *VariableCache;
+  UINTN                                  VariableCacheSize;
+  UINTN                                  UsedSize;
+  UINTN                                  Offset;
+  UINTN                                  Applied;
+
+  UsedSize = MIN (mVariableRuntimeCacheLog->UsedSize, SMM_VARIABLE_RUNTIME_CACHE_LOG_SIZE - SMM_VARIABLE_RUNTIME_CACHE_LOG_HEADER_SIZE);
+  Offset   = 0;
+  Applied  = 0;
+  while (UsedSize - Offset >= sizeof (SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD)) {
+    Record = (SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD *)((UINT8 *)mVariableRuntimeCacheLog + SMM_VARIABLE_RUNTIME_CACHE_LOG_HEADER_SIZE + Offset);
+    if (Record->Length > UsedSize - Offset - sizeof (SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD)) {
+      ASSERT (FALSE);
+      break;
+    }
+
+    switch (Record->StoreType) {
+      case VariableStoreTypeVolatile:
+        VariableCache     = mVariableRuntimeVolatileCacheBuffer;
+        VariableCacheSize = mVariableRuntimeVolatileCacheBufferSize;
+        break;
+      case VariableStoreTypeHob:
+        VariableCache     = mVariableRuntimeHobCacheBuffer;
+        VariableCacheSize = mVariableRuntimeHobCacheBufferSize;
+        break;
+      case VariableStoreTypeNv:
+        VariableCache     = mVariableRuntimeNvCacheBuffer;
+        VariableCacheSize = mVariableRuntimeNvCacheBufferSize;
+        break;
+      default:
+        VariableCache     = NULL;
+        VariableCacheSize = 0;
+        break;
+    }
+
+    //
+    // The HOB cache may have been freed once the HOB variables were flushed.
+    //
+    if ((VariableCache != NULL) &&
+        (Record->Offset <= VariableCacheSize) &&
+        (Record->Length <= VariableCacheSize - Record->Offset))
+    {
+      CopyMem ((UINT8 *)VariableCache + Record->Offset, Record + 1, Record->Length);
+      Applied += Record->Length;
+    }
+
+    Offset += MIN (SMM_VARIABLE_RUNTIME_CACHE_LOG_RECORD_SIZE (Record->Length), UsedSize - Offset);
+  }
+
+  mVariableRuntimeCacheLog->UsedSize = 0;
+  DEBUG ((DEBUG_VERBOSE, "Variable: Runtime cache log applied 0x%x bytes\n", Applied));
+}
+
 /**
   Check whether a SMI must be triggered to retrieve pending cache updates.
 
+  The updates logged by SMM are applied without a SMI. A SMI is only triggered
+  if some updates did not fit in the log.
+
   If the variable HOB was finished being flushed since the last check for a runtime cache update, this function
   will prevent the HOB cache from being used for future runtime cache hits.
 
@@ -571,7 +683,16 @@ CheckForRuntimeCacheSync (
   )
 {
   if (mVariableRuntimeCachePendingUpdate) {
-    SyncRuntimeCache ();
+    ApplyRuntimeCacheLog ();
+    mVariableRuntimeCachePendingUpdate = FALSE;
+    //
+    // A SMI may set Incomplete and the pending update flag while the log is
+    // applied. Incomplete is checked after the flag is cleared, so that no
+    // update is missed.
+    //
+    if (mVariableRuntimeCacheLog->Incomplete) {
+      SyncRuntimeCache ();
+    }
   }
 
   ASSERT (!mVariableRuntimeCachePendingUpdate);
@@ -581,6 +702,7 @@ CheckForRuntimeCacheSync (
   //
   if (mHobFlushComplete && (mVariableRuntimeHobCacheBuffer != NULL)) {
     if (!EfiAtRuntime ()) {
+      VariableIndexDestroy (mVariableRuntimeHobCacheBuffer);
       FreePages (mVariableRuntimeHobCacheBuffer, EFI_SIZE_TO_PAGES (mVariableRuntimeHobCacheBufferSize));
     }
 
@@ -904,9 +1026,9 @@ GetNextVariableNameInRuntimeCache (
   //
   ASSERT (!mVariableRuntimeCacheReadLock);
 
+  mVariableRuntimeCacheReadLock = TRUE;
   CheckForRuntimeCacheSync ();
 
-  mVariableRuntimeCacheReadLock = TRUE;
   if (!mVariableRuntimeCachePendingUpdate) {
     //
     // 0: Volatile, 1: HOB, 2: Non-Volatile.
@@ -1198,6 +1320,166 @@ Done:
   return Status;
 }
 
+/**
+  Set a batch of variables, with a single SMM communication.
+
+  The whole batch is sent to SMM at once, so that it is written to the storage
+  with at most one fault tolerant write. A batch that does not fit in the
+  communicate buffer is not split, as its parts could not be committed
+  together.
+
+  Caution: This function may receive untrusted input.
+  The data size and data are external input, so this function will validate it carefully to avoid buffer overflow.
+
+  @param[in]      This          The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      EntryCount    Number of entries in Entries.
+  @param[in, out] Entries       The SetVariable operations to process.
+
+  @retval EFI_SUCCESS           All the operations were processed, the Status field of
+                                each entry reports the result of the operation.
+  @retval EFI_INVALID_PARAMETER EntryCount is 0, or Entries is NULL.
+  @retval EFI_BAD_BUFFER_SIZE   The batch does not fit in the communicate buffer.
+  @retval EFI_UNSUPPORTED       ExitBootServices() has already been called.
+  @retval EFI_NOT_AVAILABLE_YET The variable write service is not ready yet.
+  @retval EFI_DEVICE_ERROR      The non-volatile variable storage could not be updated.
+  @return Others                The communication with SMM failed.
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchSetVariables (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL  *This,
+  IN       UINTN                          EntryCount,
+  IN OUT   EDKII_VARIABLE_BATCH_ENTRY     *Entries
+  )
+{
+  EFI_STATUS                                    Status;
+  UINTN                                         PayloadSize;
+  SMM_VARIABLE_COMMUNICATE_SET_VARIABLES        *SetVariables;
+  SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY  *CommEntry;
+  EDKII_VARIABLE_BATCH_ENTRY                    *Entry;
+  UINTN                                         VariableNameSize;
+  UINTN                                         EntrySize;
+  UINTN                                         CommEntryCount;
+  UINTN                                         Index;
+
+  if ((EntryCount == 0) || (Entries == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (EfiAtRuntime ()) {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Check the entries, and compute the size of the payload. The entries with
+  // invalid parameters are not sent to SMM.
+  //
+  Status         = EFI_SUCCESS;
+  CommEntryCount = 0;
+  PayloadSize    = ALIGN_VALUE (sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES), sizeof (UINT64));
+  for (Index = 0; Index < EntryCount; Index++) {
+    Entry         = &Entries[Index];
+    Entry->Status = EFI_NOT_STARTED;
+    if ((Entry->VariableName == NULL) || (Entry->VariableName[0] == 0) || (Entry->VendorGuid == NULL) ||
+        ((Entry->DataSize != 0) && (Entry->Data == NULL)))
+    {
+      Entry->Status = EFI_INVALID_PARAMETER;
+      continue;
+    }
+
+    VariableNameSize = StrSize (Entry->VariableName);
+    if ((VariableNameSize > mVariableBufferPayloadSize) ||
+        (Entry->DataSize > mVariableBufferPayloadSize - VariableNameSize))
+    {
+      Status = EFI_BAD_BUFFER_SIZE;
+      continue;
+    }
+
+    EntrySize = SMM_VARIABLE_SET_VARIABLES_ENTRY_SIZE (VariableNameSize, Entry->DataSize);
+    if (EntrySize > mVariableBufferPayloadSize - PayloadSize) {
+      Status = EFI_BAD_BUFFER_SIZE;
+      continue;
+    }
+
+    PayloadSize += EntrySize;
+    CommEntryCount++;
+  }
+
+  if (EFI_ERROR (Status) || (CommEntryCount == 0)) {
+    goto Done;
+  }
+
+  AcquireLockOnlyAtBootTime (&mVariableServicesLock);
+
+  //
+  // Init the communicate buffer. The buffer data size is:
+  // SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize.
+  //
+  SetVariables = NULL;
+  Status       = InitCommunicateBuffer ((VOID **)&SetVariables, PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLES);
+  if (EFI_ERROR (Status)) {
+    ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
+    goto Done;
+  }
+
+  ASSERT (SetVariables != NULL);
+
+  SetVariables->EntryCount = CommEntryCount;
+  CommEntry                = (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY *)((UINT8 *)SetVariables + ALIGN_VALUE (sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES), sizeof (UINT64)));
+  for (Index = 0; Index < EntryCount; Index++) {
+    Entry = &Entries[Index];
+    if (Entry->Status != EFI_NOT_STARTED) {
+      continue;
+    }
+
+    CopyGuid (&CommEntry->Guid, Entry->VendorGuid);
+    CommEntry->DataSize   = Entry->DataSize;
+    CommEntry->NameSize   = StrSize (Entry->VariableName);
+    CommEntry->Attributes = Entry->Attributes;
+    CommEntry->Status     = EFI_NOT_STARTED;
+    CopyMem (CommEntry->Name, Entry->VariableName, CommEntry->NameSize);
+    CopyMem ((UINT8 *)CommEntry->Name + CommEntry->NameSize, Entry->Data, Entry->DataSize);
+    CommEntry = (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY *)((UINT8 *)CommEntry + SMM_VARIABLE_SET_VARIABLES_ENTRY_SIZE (CommEntry->NameSize, CommEntry->DataSize));
+  }
+
+  //
+  // Send data to SMM.
+  //
+  Status = SendCommunicateBuffer (PayloadSize);
+  if (!EFI_ERROR (Status) || (Status == EFI_DEVICE_ERROR)) {
+    CommEntry = (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY *)((UINT8 *)SetVariables + ALIGN_VALUE (sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES), sizeof (UINT64)));
+    for (Index = 0; Index < EntryCount; Index++) {
+      Entry = &Entries[Index];
+      if (Entry->Status != EFI_NOT_STARTED) {
+        continue;
+      }
+
+      Entry->Status = CommEntry->Status;
+      CommEntry     = (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES_ENTRY *)((UINT8 *)CommEntry + SMM_VARIABLE_SET_VARIABLES_ENTRY_SIZE (CommEntry->NameSize, CommEntry->DataSize));
+    }
+  }
+
+  ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
+
+Done:
+  //
+  // The entries that were not processed by SMM take the status of the failure.
+  //
+  for (Index = 0; Index < EntryCount; Index++) {
+    Entry = &Entries[Index];
+    if (Entry->Status == EFI_NOT_STARTED) {
+      Entry->Status = Status;
+    } else if (!EFI_ERROR (Entry->Status)) {
+      SecureBootHook (
+        Entry->VariableName,
+        Entry->VendorGuid
+        );
+    }
+  }
+
+  return Status;
+}
+
 /**
   This code returns information about the EFI variables.
 
@@ -1361,6 +1643,8 @@ VariableAddressChangeEvent (
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **)&mVariableRuntimeHobCacheBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **)&mVariableRuntimeNvCacheBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **)&mVariableRuntimeVolatileCacheBuffer);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **)&mVariableRuntimeCacheLog);
+  VariableIndexConvertPointers (EfiConvertPointer);
 }
 
 /**
@@ -1570,6 +1854,7 @@ SendRuntimeVariableCacheContextToSmm (
   SmmRuntimeVarCacheContext->PendingUpdate        = &mVariableRuntimeCachePendingUpdate;
   SmmRuntimeVarCacheContext->ReadLock             = &mVariableRuntimeCacheReadLock;
   SmmRuntimeVarCacheContext->HobFlushComplete     = &mHobFlushComplete;
+  SmmRuntimeVarCacheContext->RuntimeCacheLog      = mVariableRuntimeCacheLog;
 
   //
   // Request to unblock this region to be accessible from inside MM environment
@@ -1675,9 +1960,27 @@ SmmVariableReady (
         if (!EFI_ERROR (Status)) {
           Status = InitVariableCache (&mVariableRuntimeVolatileCacheBuffer, &mVariableRuntimeVolatileCacheBufferSize);
           if (!EFI_ERROR (Status)) {
-            Status = SendRuntimeVariableCacheContextToSmm ();
+            Status = InitVariableCacheLog (&mVariableRuntimeCacheLog);
             if (!EFI_ERROR (Status)) {
-              SyncRuntimeCache ();
+              Status = SendRuntimeVariableCacheContextToSmm ();
+              if (!EFI_ERROR (Status)) {
+                SyncRuntimeCache ();
+                //
+                // The caches are rewritten from the start when the variables
+                // are reclaimed in SMM, their indexes detect it.
+                //
+                if (mVariableRuntimeHobCacheBuffer != NULL) {
+                  VariableIndexCreate (mVariableRuntimeHobCacheBuffer, TRUE);
+                }
+
+                if (mVariableRuntimeNvCacheBuffer != NULL) {
+                  VariableIndexCreate (mVariableRuntimeNvCacheBuffer, TRUE);
+                }
+
+                if (mVariableRuntimeVolatileCacheBuffer != NULL) {
+                  VariableIndexCreate (mVariableRuntimeVolatileCacheBuffer, TRUE);
+                }
+              }
             }
           }
         }
@@ -1687,6 +1990,7 @@ SmmVariableReady (
         mVariableRuntimeHobCacheBuffer      = NULL;
         mVariableRuntimeNvCacheBuffer       = NULL;
         mVariableRuntimeVolatileCacheBuffer = NULL;
+        mVariableRuntimeCacheLog            = NULL;
       }
     }
 
@@ -1773,6 +2077,15 @@ SmmVariableWriteReady (
                   );
   ASSERT_EFI_ERROR (Status);
 
+  mVariableBatch.SetVariables = VariableBatchSetVariables;
+  Status                      = gBS->InstallMultipleProtocolInterfaces (
+                                       &mHandle,
+                                       &gEdkiiVariableBatchProtocolGuid,
+                                       &mVariableBatch,
+                                       NULL
+                                       );
+  ASSERT_EFI_ERROR (Status);
+
   gBS->CloseEvent (Event);
 }
 